@@ -48,3 +48,11 @@
 # required), if the driver fails to compile with an error like:
 #     `fatal error: linux/dma/xilinx_dma.h: No such file or directory`
 #XILINX_DMA_INCLUDE_PATH_FIXUP = yes
+
+# This specifies to compile the V4L2 front-end into the driver, which registers
+# a video capture node for each VDMA receive channel, and a video output node
+# for each VDMA transmit channel. The kernel must be configured with V4L2
+# (`CONFIG_VIDEO_DEV`) and the videobuf2 contiguous DMA allocator
+# (`CONFIG_VIDEOBUF2_DMA_CONTIG`). Uncomment this (no value is required) to
+# build it.
+#AXIDMA_V4L2 = yes
@@ -65,10 +65,18 @@ static int axidma_probe(struct platform_device *pdev)
         goto destroy_dma_dev;
     }
 
+    // Register the V4L2 video nodes for the VDMA channels, if built
+    rc = axidma_v4l2_init(axidma_dev);
+    if (rc < 0) {
+        goto destroy_chrdev;
+    }
+
     // Set the private data in the device to the AXI DMA device structure
     dev_set_drvdata(&pdev->dev, axidma_dev);
     return 0;
 
+destroy_chrdev:
+    axidma_chrdev_exit(axidma_dev);
 destroy_dma_dev:
     axidma_dma_exit(axidma_dev);
 free_axidma_dev:
@@ -83,7 +91,8 @@ static int axidma_remove(struct platform_device *pdev)
     // Get the AXI DMA device structure from the device's private data
     axidma_dev = dev_get_drvdata(&pdev->dev);
 
-    // Cleanup the character device structures
+    // Cleanup the V4L2 video nodes and the character device structures
+    axidma_v4l2_exit(axidma_dev);
     axidma_chrdev_exit(axidma_dev);
 
     // Cleanup the DMA structures
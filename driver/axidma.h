@@ -18,6 +18,11 @@
 #include <linux/device.h>           // Definitions for class and device structs
 #include <linux/cdev.h>             // Definitions for character device structs
 #include <linux/signal.h>           // Definition of signal numbers
+#include <linux/wait.h>             // Wait queue definitions
+#include <linux/spinlock.h>         // Spinlock definitions
+#include <linux/mutex.h>            // Mutex definitions
+#include <linux/mm.h>               // Memory area definitions
+#include <linux/atomic.h>           // Atomic counter definitions
 #include <linux/dmaengine.h>        // Definitions for DMA structures and types
 #include <linux/platform_device.h>  // Defintions for a platform device
 
@@ -42,8 +47,28 @@
     printk(KERN_INFO MODULE_NAME ": %s: %s: %d: " fmt, __FILENAME__, __func__, \
             __LINE__, ## __VA_ARGS__)
 
-// Forward declaration of the callback data structure for DMA
-struct axidma_cb_data;
+// Forward declaration of the per-channel transfer tracking data for DMA
+struct axidma_chan_data;
+
+// Forward declaration of a named buffer pool owned by the driver
+struct axidma_pool;
+
+// Forward declaration of the V4L2 video nodes for the VDMA channels
+struct axidma_v4l2;
+
+/* The frames of a channel's capture ring that an open file holds references
+ * to, so that they can be released if its process exits while holding them.
+ * There are at most AXIDMA_MAX_FRAME_BUFFERS frames, one bit for each. */
+struct axidma_frame_refs {
+    u64 generation;                 // The capture the references are for
+    u32 held;                       // The frame buffers that are held
+};
+
+// The state of an open file of the character device
+struct axidma_file {
+    struct axidma_device *dev;      // The device the file was opened on
+    struct axidma_frame_refs *frame_refs;   // Frames held, for each channel
+};
 
 // All of the meta-data needed for an axidma device
 struct axidma_device {
@@ -59,13 +84,27 @@ struct axidma_device {
     int num_dma_rx_chans;           // The number of receive DMA channels
     int num_vdma_tx_chans;          // The number of transmit VDMA channels
     int num_vdma_rx_chans;          // The number of receive  VDMA channels
+    int num_cdma_chans;             // The number of memory copy CDMA channels
     int num_chans;                  // The total number of DMA channels
-    int notify_signal;              // Signal used to notify transfer completion
+    int notify_signal;              // Signal, and its flags, for completions
     struct platform_device *pdev;   // The platofrm device from the device tree
-    struct axidma_cb_data *cb_data; // The callback data for each channel
+    struct axidma_chan_data *chan_data; // Transfer tracking for each channel
     struct axidma_chan *channels;   // All available channels
     struct list_head dmabuf_list;   // List of allocated DMA buffers
     struct list_head external_dmabufs;  // Buffers allocated in other drivers
+    wait_queue_head_t wait_queue;   // Woken whenever any transfer completes
+    struct axidma_status_page *status_page; // Progress counters for userspace
+    atomic_t num_allocations;       // Number of allocated DMA buffers
+    atomic64_t allocated_bytes;     // Total size of the allocated buffers
+    atomic_t num_external;          // Number of registered external buffers
+    atomic64_t external_bytes;      // Total size of the external buffers
+    atomic_t transfer_allocations;  // Heap allocations made by transfers
+    spinlock_t wait_pool_lock;      // Protects the wait entry array pool
+    struct axidma_wait_entry *wait_pool;    // Arrays for AXIDMA_WAIT_ANY
+    bool *wait_pool_used;           // Which of the pool's arrays are in use
+    struct mutex pool_lock;         // Protects the named buffer pools
+    struct axidma_pool *pools[AXIDMA_MAX_POOLS];    // Named pools, by id
+    struct axidma_v4l2 *v4l2;       // V4L2 nodes, if the front-end is built
 };
 
 /*----------------------------------------------------------------------------
@@ -108,9 +147,66 @@ int axidma_rw_transfer(struct axidma_device *dev,
 int axidma_video_transfer(struct axidma_device *dev,
                           struct axidma_video_transaction *trans,
                           enum axidma_dir dir);
+int axidma_memcpy_transfer(struct axidma_device *dev,
+                           struct axidma_memcpy_transaction *trans);
 int axidma_stop_channel(struct axidma_device *dev, struct axidma_chan *chan);
+int axidma_wait_any(struct axidma_device *dev, struct axidma_wait_entry *entries,
+                    int num_entries, int timeout);
+struct axidma_wait_entry *axidma_get_wait_entries(struct axidma_device *dev,
+                                                  int num_entries);
+void axidma_put_wait_entries(struct axidma_device *dev,
+                             struct axidma_wait_entry *entries);
 dma_addr_t axidma_uservirt_to_dma(struct axidma_device *dev, void *user_addr,
                                   size_t size);
+int axidma_mmap_status_page(struct axidma_device *dev,
+                            struct vm_area_struct *vma);
+int axidma_set_adaptive(struct axidma_device *dev,
+                        struct axidma_adaptive_config *config);
+int axidma_get_chan_stats(struct axidma_device *dev,
+                          struct axidma_chan_stats *stats);
+int axidma_set_completion_config(struct axidma_device *dev,
+                                 struct axidma_completion_config *config);
+int axidma_set_sched(struct axidma_device *dev,
+                     struct axidma_sched_config *config);
+int axidma_set_submitter(struct axidma_device *dev,
+                         struct axidma_submitter_config *config);
+int axidma_start_capture(struct axidma_device *dev,
+                         struct axidma_video_transaction *trans);
+int axidma_acquire_frame(struct axidma_device *dev,
+                         struct axidma_frame_refs *frame_refs,
+                         struct axidma_capture_frame *req);
+int axidma_release_frame(struct axidma_device *dev,
+                         struct axidma_frame_refs *frame_refs,
+                         struct axidma_capture_frame *req);
+void axidma_release_frames(struct axidma_device *dev,
+                           struct axidma_frame_refs *frame_refs);
+int axidma_config_vdma(struct axidma_chan *chan);
+int axidma_claim_vdma(struct axidma_device *dev, struct axidma_chan *chan);
+void axidma_release_vdma(struct axidma_device *dev, struct axidma_chan *chan);
+struct dma_async_tx_descriptor *axidma_prep_frame(struct axidma_chan *chan,
+        dma_addr_t dma_addr, struct axidma_video_frame *frame,
+        unsigned long flags);
+
+/*----------------------------------------------------------------------------
+ * V4L2 Front-End Definitions
+ *----------------------------------------------------------------------------*/
+
+// Function Prototypes, which do nothing unless the front-end is compiled in
+#ifdef AXIDMA_V4L2
+int axidma_v4l2_init(struct axidma_device *dev);
+void axidma_v4l2_exit(struct axidma_device *dev);
+#else
+static inline int axidma_v4l2_init(struct axidma_device *dev)
+{
+    dev->v4l2 = NULL;
+    return 0;
+}
+
+static inline void axidma_v4l2_exit(struct axidma_device *dev)
+{
+    return;
+}
+#endif /* AXIDMA_V4L2 */
 
 /*----------------------------------------------------------------------------
  * Device Tree Definitions
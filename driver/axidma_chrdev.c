@@ -37,12 +37,28 @@
 // TODO: Maybe this can be improved?
 static struct axidma_device *axidma_dev;
 
+// A buffer in a named pool, which is kept until the pool is destroyed
+struct axidma_pool_buffer {
+    void *kern_addr;            // Kernel virtual address of the buffer
+    dma_addr_t dma_addr;        // DMA bus address of the buffer
+    int map_count;              // Number of mappings of the buffer
+};
+
+// A named pool of DMA buffers owned by the driver
+struct axidma_pool {
+    char name[AXIDMA_POOL_NAME_LEN];    // The name to attach to the pool by
+    int num_buffers;            // The number of buffers in the pool
+    size_t buffer_size;         // The size of each buffer
+    struct axidma_pool_buffer *buffers; // The buffers in the pool
+};
+
 // A structure that represents a DMA buffer allocation
 struct axidma_dma_allocation {
     size_t size;                // Size of the buffer
     void *user_addr;            // User virtual address of the buffer
     void *kern_addr;            // Kernel virtual address of the buffer
     dma_addr_t dma_addr;        // DMA bus address of the buffer
+    struct axidma_pool_buffer *pool_buf;    // The pool buffer mapped, if any
     struct list_head list;      // List node pointers for allocation list
 };
 
@@ -65,8 +81,10 @@ struct axidma_external_allocation {
 static bool valid_dma_request(void *dma_start, size_t dma_size, void *user_addr,
                               size_t user_size)
 {
-    return dma_start <= user_addr &&
-           (char *)user_addr + user_size <= (char *)dma_start + dma_size;
+    // Compare the sizes, so that a huge request can't wrap around the end
+    return dma_start <= user_addr && user_size <= dma_size &&
+           (size_t)((char *)user_addr - (char *)dma_start) <=
+           dma_size - user_size;
 }
 
 /* Converts the given user space virtual address to a DMA address. If the
@@ -161,6 +179,8 @@ static int axidma_get_external(struct axidma_device *dev,
     dma_alloc->size = ext_buf->size;
     dma_alloc->user_addr = ext_buf->user_addr;
     list_add(&dma_alloc->list, &dev->external_dmabufs);
+    atomic_inc(&dev->num_external);
+    atomic64_add(dma_alloc->size, &dev->external_bytes);
     return 0;
 
 unmap_ext_dma:
@@ -193,6 +213,8 @@ static int axidma_put_external(struct axidma_device *dev, void *user_addr)
                     dma_alloc->sg_table, DMA_BIDIRECTIONAL);
             dma_buf_detach(dma_alloc->dma_buf, dma_alloc->dma_attach);
             dma_buf_put(dma_alloc->dma_buf);
+            atomic_dec(&dev->num_external);
+            atomic64_sub(dma_alloc->size, &dev->external_bytes);
 
             // Free the allocation structure
             kfree(dma_alloc);
@@ -208,11 +230,20 @@ static void axidma_vma_close(struct vm_area_struct *vma)
     struct axidma_device *dev;
     struct axidma_dma_allocation *dma_alloc;
 
-    // Get the AXI DMA allocation data and free the DMA buffer
+    /* Get the AXI DMA allocation data and free the DMA buffer. The buffers of
+     * a named pool are kept until the pool is destroyed. */
     dev = axidma_dev;
     dma_alloc = vma->vm_private_data;
-    dma_free_coherent(&dev->pdev->dev, dma_alloc->size, dma_alloc->kern_addr,
-                      dma_alloc->dma_addr);
+    if (dma_alloc->pool_buf != NULL) {
+        mutex_lock(&dev->pool_lock);
+        dma_alloc->pool_buf->map_count -= 1;
+        mutex_unlock(&dev->pool_lock);
+    } else {
+        dma_free_coherent(&dev->pdev->dev, dma_alloc->size,
+                          dma_alloc->kern_addr, dma_alloc->dma_addr);
+        atomic_dec(&dev->num_allocations);
+        atomic64_sub(dma_alloc->size, &dev->allocated_bytes);
+    }
 
     // Remove the allocation from the list, and free the structure
     list_del(&dma_alloc->list);
@@ -226,12 +257,275 @@ static const struct vm_operations_struct axidma_vm_ops = {
     .close = axidma_vma_close,
 };
 
+/*----------------------------------------------------------------------------
+ * Named Buffer Pools
+ *----------------------------------------------------------------------------*/
+
+// Finds the pool with the given name. The caller must hold the pool lock.
+static int axidma_find_pool(struct axidma_device *dev, const char *name)
+{
+    int i;
+
+    for (i = 0; i < AXIDMA_MAX_POOLS; i++)
+    {
+        if (dev->pools[i] != NULL && strcmp(dev->pools[i]->name, name) == 0) {
+            return i;
+        }
+    }
+
+    return -ENOENT;
+}
+
+// Frees a pool, and all of its buffers. The caller must hold the pool lock.
+static void axidma_free_pool(struct axidma_device *dev, int pool_id)
+{
+    int i;
+    struct axidma_pool *pool;
+    struct axidma_pool_buffer *pool_buf;
+
+    pool = dev->pools[pool_id];
+    for (i = 0; i < pool->num_buffers; i++)
+    {
+        pool_buf = &pool->buffers[i];
+        if (pool_buf->kern_addr != NULL) {
+            dma_free_coherent(&dev->pdev->dev, pool->buffer_size,
+                              pool_buf->kern_addr, pool_buf->dma_addr);
+        }
+    }
+
+    kfree(pool->buffers);
+    kfree(pool);
+    dev->pools[pool_id] = NULL;
+}
+
+/* Attaches to the pool with the given name, or creates it if it does not
+ * exist, allocating all of its buffers up front. */
+static int axidma_open_pool(struct axidma_device *dev,
+                            struct axidma_pool_config *config)
+{
+    int rc, i, pool_id;
+    struct axidma_pool *pool;
+    struct axidma_pool_buffer *pool_buf;
+
+    // Validate the name and the layout of the pool
+    config->name[AXIDMA_POOL_NAME_LEN-1] = '\0';
+    if (config->name[0] == '\0') {
+        axidma_err("The name of a buffer pool cannot be empty.\n");
+        return -EINVAL;
+    } else if (config->num_buffers <= 0 ||
+               config->num_buffers > AXIDMA_MAX_POOL_BUFFERS) {
+        axidma_err("Invalid number of pool buffers %d.\n",
+                   config->num_buffers);
+        return -EINVAL;
+    } else if (config->buffer_size == 0) {
+        axidma_err("The size of a pool buffer cannot be 0.\n");
+        return -EINVAL;
+    }
+
+    // If the pool already exists, attach to it if it has the same layout
+    mutex_lock(&dev->pool_lock);
+    pool_id = axidma_find_pool(dev, config->name);
+    if (pool_id >= 0) {
+        pool = dev->pools[pool_id];
+        if (pool->num_buffers != config->num_buffers ||
+                pool->buffer_size != config->buffer_size) {
+            axidma_err("Buffer pool %s exists with %d buffers of %zu bytes.\n",
+                       pool->name, pool->num_buffers, pool->buffer_size);
+            rc = -EEXIST;
+            goto unlock;
+        }
+        config->pool_id = pool_id;
+        config->attached = 1;
+        rc = 0;
+        goto unlock;
+    }
+
+    // Otherwise, find an unused id, and create the pool
+    for (pool_id = 0; pool_id < AXIDMA_MAX_POOLS; pool_id++)
+    {
+        if (dev->pools[pool_id] == NULL) {
+            break;
+        }
+    }
+    if (pool_id == AXIDMA_MAX_POOLS) {
+        axidma_err("The maximum of %d buffer pools already exist.\n",
+                   AXIDMA_MAX_POOLS);
+        rc = -ENOSPC;
+        goto unlock;
+    }
+
+    pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+    if (pool == NULL) {
+        axidma_err("Unable to allocate the buffer pool structure.\n");
+        rc = -ENOMEM;
+        goto unlock;
+    }
+    pool->buffers = kcalloc(config->num_buffers, sizeof(pool->buffers[0]),
+                            GFP_KERNEL);
+    if (pool->buffers == NULL) {
+        axidma_err("Unable to allocate the buffer pool's buffer array.\n");
+        kfree(pool);
+        rc = -ENOMEM;
+        goto unlock;
+    }
+    memcpy(pool->name, config->name, sizeof(pool->name));
+    pool->num_buffers = config->num_buffers;
+    pool->buffer_size = config->buffer_size;
+    dev->pools[pool_id] = pool;
+
+    // Allocate all of the buffers now, so attaching to the pool cannot fail
+    for (i = 0; i < pool->num_buffers; i++)
+    {
+        pool_buf = &pool->buffers[i];
+        pool_buf->kern_addr = dma_alloc_coherent(&dev->pdev->dev,
+                pool->buffer_size, &pool_buf->dma_addr, GFP_KERNEL);
+        if (pool_buf->kern_addr == NULL) {
+            axidma_err("Unable to allocate buffer %d of size %zu for buffer "
+                       "pool %s.\n", i, pool->buffer_size, pool->name);
+            axidma_free_pool(dev, pool_id);
+            rc = -ENOMEM;
+            goto unlock;
+        }
+    }
+
+    config->pool_id = pool_id;
+    config->attached = 0;
+    rc = 0;
+
+unlock:
+    mutex_unlock(&dev->pool_lock);
+    return rc;
+}
+
+// Destroys the pool with the given name, if none of its buffers are mapped
+static int axidma_destroy_pool(struct axidma_device *dev,
+                               struct axidma_pool_config *config)
+{
+    int rc, i, pool_id;
+    struct axidma_pool *pool;
+
+    config->name[AXIDMA_POOL_NAME_LEN-1] = '\0';
+    mutex_lock(&dev->pool_lock);
+    pool_id = axidma_find_pool(dev, config->name);
+    if (pool_id < 0) {
+        axidma_err("Buffer pool %s does not exist.\n", config->name);
+        rc = -ENOENT;
+        goto unlock;
+    }
+
+    pool = dev->pools[pool_id];
+    for (i = 0; i < pool->num_buffers; i++)
+    {
+        if (pool->buffers[i].map_count > 0) {
+            axidma_err("Buffer %d of buffer pool %s is still mapped.\n", i,
+                       pool->name);
+            rc = -EBUSY;
+            goto unlock;
+        }
+    }
+
+    axidma_free_pool(dev, pool_id);
+    rc = 0;
+
+unlock:
+    mutex_unlock(&dev->pool_lock);
+    return rc;
+}
+
+// Gets the number of buffers in the named pools, and their total size
+static void axidma_get_pool_stats(struct axidma_device *dev,
+                                  struct axidma_device_stats *stats)
+{
+    int i;
+    struct axidma_pool *pool;
+
+    stats->num_pool_buffers = 0;
+    stats->pool_bytes = 0;
+    mutex_lock(&dev->pool_lock);
+    for (i = 0; i < AXIDMA_MAX_POOLS; i++)
+    {
+        pool = dev->pools[i];
+        if (pool != NULL) {
+            stats->num_pool_buffers += pool->num_buffers;
+            stats->pool_bytes += (u64)pool->num_buffers * pool->buffer_size;
+        }
+    }
+    mutex_unlock(&dev->pool_lock);
+}
+
+// Maps a buffer of a named pool into userspace, given its mmap offset unit
+static int axidma_mmap_pool_buffer(struct axidma_device *dev,
+        struct vm_area_struct *vma, unsigned long unit)
+{
+    int rc, pool_id, index;
+    struct axidma_pool *pool;
+    struct axidma_pool_buffer *pool_buf;
+    struct axidma_dma_allocation *dma_alloc;
+
+    // Find the pool buffer that the offset refers to
+    unit -= AXIDMA_POOL_OFFSET(0, 0) / AXIDMA_MMAP_OFFSET_UNIT;
+    pool_id = unit / AXIDMA_MAX_POOL_BUFFERS;
+    index = unit % AXIDMA_MAX_POOL_BUFFERS;
+
+    mutex_lock(&dev->pool_lock);
+    pool = (pool_id < AXIDMA_MAX_POOLS) ? dev->pools[pool_id] : NULL;
+    if (pool == NULL || index >= pool->num_buffers) {
+        axidma_err("Invalid buffer %d of buffer pool %d.\n", index, pool_id);
+        rc = -EINVAL;
+        goto unlock;
+    } else if (vma->vm_end - vma->vm_start > PAGE_ALIGN(pool->buffer_size)) {
+        axidma_err("Mapping of size %lu exceeds the pool buffer size %zu.\n",
+                   vma->vm_end - vma->vm_start, pool->buffer_size);
+        rc = -EINVAL;
+        goto unlock;
+    }
+    pool_buf = &pool->buffers[index];
+
+    // Track the mapping like any other buffer, so it can be used in transfers
+    dma_alloc = kmalloc(sizeof(*dma_alloc), GFP_KERNEL);
+    if (dma_alloc == NULL) {
+        axidma_err("Unable to allocate VMA data structure.");
+        rc = -ENOMEM;
+        goto unlock;
+    }
+    dma_alloc->size = vma->vm_end - vma->vm_start;
+    dma_alloc->user_addr = (void *)vma->vm_start;
+    dma_alloc->kern_addr = pool_buf->kern_addr;
+    dma_alloc->dma_addr = pool_buf->dma_addr;
+    dma_alloc->pool_buf = pool_buf;
+
+    /* The offset only selects the pool buffer, and dma_mmap_coherent treats it
+     * as a page offset into the buffer, so the whole buffer is mapped from
+     * its start. */
+    vma->vm_pgoff = 0;
+    rc = dma_mmap_coherent(&dev->pdev->dev, vma, dma_alloc->kern_addr,
+                           dma_alloc->dma_addr, dma_alloc->size);
+    if (rc < 0) {
+        axidma_err("Unable to remap buffer %d of buffer pool %s to userspace.\n",
+                   index, pool->name);
+        kfree(dma_alloc);
+        goto unlock;
+    }
+
+    vma->vm_ops = &axidma_vm_ops;
+    vma->vm_private_data = dma_alloc;
+    vma->vm_flags |= VM_DONTCOPY;
+    list_add(&dma_alloc->list, &dev->dmabuf_list);
+    pool_buf->map_count += 1;
+
+unlock:
+    mutex_unlock(&dev->pool_lock);
+    return rc;
+}
+
 /*----------------------------------------------------------------------------
  * File Operations
  *----------------------------------------------------------------------------*/
 
 static int axidma_open(struct inode *inode, struct file *file)
 {
+    struct axidma_file *axidma_file;
+
     // Only the root user can open this device, and it must be exclusive
     if (!capable(CAP_SYS_ADMIN)) {
         axidma_err("Only root can open this device.");
@@ -241,13 +535,32 @@ static int axidma_open(struct inode *inode, struct file *file)
         return -EINVAL;
     }
 
-    // Place the axidma structure in the private data of the file
-    file->private_data = (void *)axidma_dev;
+    /* Place the axidma structure in the private data of the file, along with
+     * the frames of the capture rings that the file holds. */
+    axidma_file = kzalloc(sizeof(*axidma_file), GFP_KERNEL);
+    if (axidma_file == NULL) {
+        return -ENOMEM;
+    }
+    axidma_file->frame_refs = kcalloc(axidma_dev->num_chans,
+            sizeof(axidma_file->frame_refs[0]), GFP_KERNEL);
+    if (axidma_file->frame_refs == NULL) {
+        kfree(axidma_file);
+        return -ENOMEM;
+    }
+    axidma_file->dev = axidma_dev;
+    file->private_data = axidma_file;
     return 0;
 }
 
 static int axidma_release(struct inode *inode, struct file *file)
 {
+    struct axidma_file *axidma_file;
+
+    // Give back any captured frames the process did not release
+    axidma_file = file->private_data;
+    axidma_release_frames(axidma_file->dev, axidma_file->frame_refs);
+    kfree(axidma_file->frame_refs);
+    kfree(axidma_file);
     file->private_data = NULL;
     return 0;
 }
@@ -255,11 +568,28 @@ static int axidma_release(struct inode *inode, struct file *file)
 static int axidma_mmap(struct file *file, struct vm_area_struct *vma)
 {
     int rc;
+    unsigned long offset;
     struct axidma_device *dev;
     struct axidma_dma_allocation *dma_alloc;
 
     // Get the axidma device structure
-    dev = file->private_data;
+    dev = ((struct axidma_file *)file->private_data)->dev;
+
+    /* The offset selects what is mapped. A zero offset allocates a new DMA
+     * buffer, the status page offset maps the channel counters, and the
+     * offsets after it map the buffers of the named pools. */
+    offset = vma->vm_pgoff << PAGE_SHIFT;
+    if (offset == AXIDMA_STATUS_PAGE_OFFSET) {
+        return axidma_mmap_status_page(dev, vma);
+    } else if (offset >= AXIDMA_POOL_OFFSET(0, 0) &&
+               offset % AXIDMA_MMAP_OFFSET_UNIT == 0) {
+        return axidma_mmap_pool_buffer(dev, vma,
+                                       offset / AXIDMA_MMAP_OFFSET_UNIT);
+    } else if (offset != 0) {
+        axidma_err("Invalid memory map offset 0x%lx.\n",
+                   vma->vm_pgoff << PAGE_SHIFT);
+        return -EINVAL;
+    }
 
     // Allocate a structure to store data about the DMA mapping
     dma_alloc = kmalloc(sizeof(*dma_alloc), GFP_KERNEL);
@@ -272,6 +602,7 @@ static int axidma_mmap(struct file *file, struct vm_area_struct *vma)
     // Set the user virtual address and the size
     dma_alloc->size = vma->vm_end - vma->vm_start;
     dma_alloc->user_addr = (void *)vma->vm_start;
+    dma_alloc->pool_buf = NULL;
 
     // Configure the DMA device
     of_dma_configure(dev->device, NULL);
@@ -310,6 +641,8 @@ static int axidma_mmap(struct file *file, struct vm_area_struct *vma)
 
     // Add the allocation to the driver's list of DMA buffers
     list_add(&dma_alloc->list, &dev->dmabuf_list);
+    atomic_inc(&dev->num_allocations);
+    atomic64_add(dma_alloc->size, &dev->allocated_bytes);
     return 0;
 
 free_dma_region:
@@ -344,6 +677,7 @@ static long axidma_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
     long rc;
     size_t size;
     void *__user arg_ptr;
+    struct axidma_file *axidma_file;
     struct axidma_device *dev;
     struct axidma_num_channels num_chans;
     struct axidma_channel_info usr_chans, kern_chans;
@@ -351,7 +685,19 @@ static long axidma_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
     struct axidma_transaction trans;
     struct axidma_inout_transaction inout_trans;
     struct axidma_video_transaction video_trans, *__user user_video_trans;
+    void *frame_buffers[AXIDMA_MAX_FRAME_BUFFERS];
     struct axidma_chan chan_info;
+    struct axidma_wait_any wait_any;
+    struct axidma_wait_entry *wait_entries;
+    struct axidma_adaptive_config adaptive;
+    struct axidma_chan_stats chan_stats;
+    struct axidma_completion_config completion;
+    struct axidma_device_stats dev_stats;
+    struct axidma_sched_config sched;
+    struct axidma_submitter_config submitter;
+    struct axidma_pool_config pool;
+    struct axidma_capture_frame capture_frame;
+    struct axidma_memcpy_transaction memcpy_trans;
 
     // Coerce the arguement as a userspace pointer
     arg_ptr = (void __user *)arg;
@@ -377,7 +723,8 @@ static long axidma_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
     }
 
     // Get the axidma device from the file
-    dev = file->private_data;
+    axidma_file = file->private_data;
+    dev = axidma_file->dev;
 
     // Perform the specified command
     switch (cmd) {
@@ -431,6 +778,16 @@ static long axidma_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
                 return -EFAULT;
             }
             rc = axidma_read_transfer(dev, &trans);
+            if (rc < 0) {
+                break;
+            }
+
+            // Copy the transfer's cookie back to userspace
+            if (copy_to_user(arg_ptr, &trans, sizeof(trans)) != 0) {
+                axidma_err("Unable to copy transfer info to userspace for "
+                           "AXIDMA_DMA_READ.\n");
+                return -EFAULT;
+            }
             break;
 
         case AXIDMA_DMA_WRITE:
@@ -440,6 +797,16 @@ static long axidma_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
                 return -EFAULT;
             }
             rc = axidma_write_transfer(dev, &trans);
+            if (rc < 0) {
+                break;
+            }
+
+            // Copy the transfer's cookie back to userspace
+            if (copy_to_user(arg_ptr, &trans, sizeof(trans)) != 0) {
+                axidma_err("Unable to copy transfer info to userspace for "
+                           "AXIDMA_DMA_WRITE.\n");
+                return -EFAULT;
+            }
             break;
 
         case AXIDMA_DMA_READWRITE:
@@ -450,6 +817,17 @@ static long axidma_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
                 return -EFAULT;
             }
             rc = axidma_rw_transfer(dev, &inout_trans);
+            if (rc < 0) {
+                break;
+            }
+
+            // Copy the transfers' cookies back to userspace
+            if (copy_to_user(arg_ptr, &inout_trans,
+                             sizeof(inout_trans)) != 0) {
+                axidma_err("Unable to copy transfer info to userspace for "
+                           "AXIDMA_DMA_READWRITE.\n");
+                return -EFAULT;
+            }
             break;
 
         case AXIDMA_DMA_VIDEO_READ:
@@ -460,27 +838,24 @@ static long axidma_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
                 return -EFAULT;
             }
 
-            // Allocate a kernel-space array for the frame buffers
-            size = video_trans.num_frame_buffers *
-                   sizeof(video_trans.frame_buffers[0]);
-            video_trans.frame_buffers = kmalloc(size, GFP_KERNEL);
-            if (video_trans.frame_buffers == NULL) {
-                axidma_err("Unable to allocate array for the frame buffers.\n");
-                return -ENOMEM;
-            }
-
             // Copy the frame buffer array from user space to kernel space
+            if (video_trans.num_frame_buffers <= 0 ||
+                    video_trans.num_frame_buffers > AXIDMA_MAX_FRAME_BUFFERS) {
+                axidma_err("Invalid number of frame buffers %d.\n",
+                           video_trans.num_frame_buffers);
+                return -EINVAL;
+            }
+            size = video_trans.num_frame_buffers * sizeof(frame_buffers[0]);
             user_video_trans = (struct axidma_video_transaction *__user)arg_ptr;
-            if (copy_from_user(video_trans.frame_buffers,
-                        user_video_trans->frame_buffers, size) != 0) {
+            if (copy_from_user(frame_buffers, user_video_trans->frame_buffers,
+                               size) != 0) {
                 axidma_err("Unable to copy the frame buffer array from "
-                        "userspace for AXIDMA_VIDEO_READ.\n");
-                kfree(video_trans.frame_buffers);
+                        "userspace for AXIDMA_DMA_VIDEO_READ.\n");
                 return -EFAULT;
             }
 
+            video_trans.frame_buffers = frame_buffers;
             rc = axidma_video_transfer(dev, &video_trans, AXIDMA_READ);
-            kfree(video_trans.frame_buffers);
             break;
 
         case AXIDMA_DMA_VIDEO_WRITE:
@@ -491,27 +866,24 @@ static long axidma_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
                 return -EFAULT;
             }
 
-            // Allocate a kernel-space array for the frame buffers
-            size = video_trans.num_frame_buffers *
-                   sizeof(video_trans.frame_buffers[0]);
-            video_trans.frame_buffers = kmalloc(size, GFP_KERNEL);
-            if (video_trans.frame_buffers == NULL) {
-                axidma_err("Unable to allocate array for the frame buffers.\n");
-                return -ENOMEM;
-            }
-
             // Copy the frame buffer array from user space to kernel space
+            if (video_trans.num_frame_buffers <= 0 ||
+                    video_trans.num_frame_buffers > AXIDMA_MAX_FRAME_BUFFERS) {
+                axidma_err("Invalid number of frame buffers %d.\n",
+                           video_trans.num_frame_buffers);
+                return -EINVAL;
+            }
+            size = video_trans.num_frame_buffers * sizeof(frame_buffers[0]);
             user_video_trans = (struct axidma_video_transaction *__user)arg_ptr;
-            if (copy_from_user(video_trans.frame_buffers,
-                        user_video_trans->frame_buffers, size) != 0) {
+            if (copy_from_user(frame_buffers, user_video_trans->frame_buffers,
+                               size) != 0) {
                 axidma_err("Unable to copy the frame buffer array from "
-                        "userspace for AXIDMA_VIDEO_READ.\n");
-                kfree(video_trans.frame_buffers);
+                        "userspace for AXIDMA_DMA_VIDEO_WRITE.\n");
                 return -EFAULT;
             }
 
+            video_trans.frame_buffers = frame_buffers;
             rc = axidma_video_transfer(dev, &video_trans, AXIDMA_WRITE);
-            kfree(video_trans.frame_buffers);
             break;
 
         case AXIDMA_STOP_DMA_CHANNEL:
@@ -526,6 +898,211 @@ static long axidma_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
             rc = axidma_put_external(dev, (void *)arg);
             break;
 
+        case AXIDMA_WAIT_ANY:
+            if (copy_from_user(&wait_any, arg_ptr, sizeof(wait_any)) != 0) {
+                axidma_err("Unable to copy wait info from userspace for "
+                           "AXIDMA_WAIT_ANY.\n");
+                return -EFAULT;
+            } else if (wait_any.num_entries <= 0 ||
+                       wait_any.num_entries > AXIDMA_MAX_WAIT_ENTRIES) {
+                axidma_err("Invalid number of wait entries %d.\n",
+                           wait_any.num_entries);
+                return -EINVAL;
+            }
+
+            // Copy the array of transfers to wait on into kernel space
+            size = wait_any.num_entries * sizeof(wait_entries[0]);
+            wait_entries = axidma_get_wait_entries(dev, wait_any.num_entries);
+            if (wait_entries == NULL) {
+                axidma_err("Unable to allocate array for the wait entries.\n");
+                return -ENOMEM;
+            }
+            if (copy_from_user(wait_entries, wait_any.entries, size) != 0) {
+                axidma_err("Unable to copy the wait entry array from "
+                           "userspace for AXIDMA_WAIT_ANY.\n");
+                axidma_put_wait_entries(dev, wait_entries);
+                return -EFAULT;
+            }
+
+            // Wait for a transfer, and report the status of all of them
+            rc = axidma_wait_any(dev, wait_entries, wait_any.num_entries,
+                                 wait_any.timeout);
+            if (rc >= 0 && copy_to_user(wait_any.entries, wait_entries,
+                                        size) != 0) {
+                axidma_err("Unable to copy the wait entry array to "
+                           "userspace for AXIDMA_WAIT_ANY.\n");
+                rc = -EFAULT;
+            }
+            axidma_put_wait_entries(dev, wait_entries);
+            break;
+
+        case AXIDMA_SET_ADAPTIVE:
+            if (copy_from_user(&adaptive, arg_ptr, sizeof(adaptive)) != 0) {
+                axidma_err("Unable to copy adaptive configuration from "
+                           "userspace for AXIDMA_SET_ADAPTIVE.\n");
+                return -EFAULT;
+            }
+            rc = axidma_set_adaptive(dev, &adaptive);
+            break;
+
+        case AXIDMA_SET_COMPLETION_CONFIG:
+            if (copy_from_user(&completion, arg_ptr, sizeof(completion)) != 0) {
+                axidma_err("Unable to copy completion configuration from "
+                           "userspace for AXIDMA_SET_COMPLETION_CONFIG.\n");
+                return -EFAULT;
+            }
+            rc = axidma_set_completion_config(dev, &completion);
+            break;
+
+        case AXIDMA_GET_CHAN_STATS:
+            if (copy_from_user(&chan_stats, arg_ptr, sizeof(chan_stats)) != 0) {
+                axidma_err("Unable to copy channel statistics from userspace "
+                           "for AXIDMA_GET_CHAN_STATS.\n");
+                return -EFAULT;
+            }
+            rc = axidma_get_chan_stats(dev, &chan_stats);
+            if (rc >= 0 && copy_to_user(arg_ptr, &chan_stats,
+                                        sizeof(chan_stats)) != 0) {
+                axidma_err("Unable to copy channel statistics to userspace "
+                           "for AXIDMA_GET_CHAN_STATS.\n");
+                rc = -EFAULT;
+            }
+            break;
+
+        case AXIDMA_SET_SCHED:
+            if (copy_from_user(&sched, arg_ptr, sizeof(sched)) != 0) {
+                axidma_err("Unable to copy scheduling configuration from "
+                           "userspace for AXIDMA_SET_SCHED.\n");
+                return -EFAULT;
+            }
+            rc = axidma_set_sched(dev, &sched);
+            break;
+
+        case AXIDMA_SET_SUBMITTER:
+            if (copy_from_user(&submitter, arg_ptr, sizeof(submitter)) != 0) {
+                axidma_err("Unable to copy submitter configuration from "
+                           "userspace for AXIDMA_SET_SUBMITTER.\n");
+                return -EFAULT;
+            }
+            rc = axidma_set_submitter(dev, &submitter);
+            break;
+
+        case AXIDMA_OPEN_POOL:
+            if (copy_from_user(&pool, arg_ptr, sizeof(pool)) != 0) {
+                axidma_err("Unable to copy pool configuration from userspace "
+                           "for AXIDMA_OPEN_POOL.\n");
+                return -EFAULT;
+            }
+            rc = axidma_open_pool(dev, &pool);
+            if (rc >= 0 && copy_to_user(arg_ptr, &pool, sizeof(pool)) != 0) {
+                axidma_err("Unable to copy pool configuration to userspace "
+                           "for AXIDMA_OPEN_POOL.\n");
+                rc = -EFAULT;
+            }
+            break;
+
+        case AXIDMA_DESTROY_POOL:
+            if (copy_from_user(&pool, arg_ptr, sizeof(pool)) != 0) {
+                axidma_err("Unable to copy pool configuration from userspace "
+                           "for AXIDMA_DESTROY_POOL.\n");
+                return -EFAULT;
+            }
+            rc = axidma_destroy_pool(dev, &pool);
+            break;
+
+        case AXIDMA_START_CAPTURE:
+            if (copy_from_user(&video_trans, arg_ptr,
+                               sizeof(video_trans)) != 0) {
+                axidma_err("Unable to copy transfer info from userspace for "
+                           "AXIDMA_START_CAPTURE.\n");
+                return -EFAULT;
+            }
+
+            // Copy the frame buffer array from user space to kernel space
+            if (video_trans.num_frame_buffers <= 0 ||
+                    video_trans.num_frame_buffers > AXIDMA_MAX_FRAME_BUFFERS) {
+                axidma_err("Invalid number of frame buffers %d.\n",
+                           video_trans.num_frame_buffers);
+                return -EINVAL;
+            }
+            size = video_trans.num_frame_buffers * sizeof(frame_buffers[0]);
+            user_video_trans = (struct axidma_video_transaction *__user)arg_ptr;
+            if (copy_from_user(frame_buffers, user_video_trans->frame_buffers,
+                               size) != 0) {
+                axidma_err("Unable to copy the frame buffer array from "
+                        "userspace for AXIDMA_START_CAPTURE.\n");
+                return -EFAULT;
+            }
+
+            video_trans.frame_buffers = frame_buffers;
+            rc = axidma_start_capture(dev, &video_trans);
+            break;
+
+        case AXIDMA_ACQUIRE_FRAME:
+            if (copy_from_user(&capture_frame, arg_ptr,
+                               sizeof(capture_frame)) != 0) {
+                axidma_err("Unable to copy frame request from userspace for "
+                           "AXIDMA_ACQUIRE_FRAME.\n");
+                return -EFAULT;
+            }
+            rc = axidma_acquire_frame(dev, axidma_file->frame_refs,
+                                      &capture_frame);
+            if (rc >= 0 && copy_to_user(arg_ptr, &capture_frame,
+                                        sizeof(capture_frame)) != 0) {
+                axidma_err("Unable to copy the frame to userspace for "
+                           "AXIDMA_ACQUIRE_FRAME.\n");
+                rc = -EFAULT;
+            }
+            break;
+
+        case AXIDMA_RELEASE_FRAME:
+            if (copy_from_user(&capture_frame, arg_ptr,
+                               sizeof(capture_frame)) != 0) {
+                axidma_err("Unable to copy frame request from userspace for "
+                           "AXIDMA_RELEASE_FRAME.\n");
+                return -EFAULT;
+            }
+            rc = axidma_release_frame(dev, axidma_file->frame_refs,
+                                      &capture_frame);
+            break;
+
+        case AXIDMA_GET_DEVICE_STATS:
+            dev_stats.num_allocations = atomic_read(&dev->num_allocations);
+            dev_stats.allocated_bytes = atomic64_read(&dev->allocated_bytes);
+            dev_stats.num_external = atomic_read(&dev->num_external);
+            dev_stats.external_bytes = atomic64_read(&dev->external_bytes);
+            dev_stats.transfer_allocations =
+                    atomic_read(&dev->transfer_allocations);
+            axidma_get_pool_stats(dev, &dev_stats);
+            if (copy_to_user(arg_ptr, &dev_stats, sizeof(dev_stats)) != 0) {
+                axidma_err("Unable to copy device statistics to userspace "
+                           "for AXIDMA_GET_DEVICE_STATS.\n");
+                return -EFAULT;
+            }
+            rc = 0;
+            break;
+
+        case AXIDMA_DMA_MEMCPY:
+            if (copy_from_user(&memcpy_trans, arg_ptr,
+                               sizeof(memcpy_trans)) != 0) {
+                axidma_err("Unable to copy transfer info from userspace for "
+                           "AXIDMA_DMA_MEMCPY.\n");
+                return -EFAULT;
+            }
+            rc = axidma_memcpy_transfer(dev, &memcpy_trans);
+            if (rc < 0) {
+                break;
+            }
+
+            // Copy the transfer's cookie back to userspace
+            if (copy_to_user(arg_ptr, &memcpy_trans,
+                             sizeof(memcpy_trans)) != 0) {
+                axidma_err("Unable to copy transfer info to userspace for "
+                           "AXIDMA_DMA_MEMCPY.\n");
+                return -EFAULT;
+            }
+            break;
+
         // Invalid command (already handled in preamble)
         default:
             return -ENOTTY;
@@ -591,6 +1168,12 @@ int axidma_chrdev_init(struct axidma_device *dev)
     // Initialize the list for DMA mmap'ed allocations
     INIT_LIST_HEAD(&dev->dmabuf_list);
     INIT_LIST_HEAD(&dev->external_dmabufs);
+    atomic_set(&dev->num_allocations, 0);
+    atomic64_set(&dev->allocated_bytes, 0);
+    atomic_set(&dev->num_external, 0);
+    atomic64_set(&dev->external_bytes, 0);
+    mutex_init(&dev->pool_lock);
+    memset(dev->pools, 0, sizeof(dev->pools));
 
     return 0;
 
@@ -606,6 +1189,16 @@ ret:
 
 void axidma_chrdev_exit(struct axidma_device *dev)
 {
+    int i;
+
+    // Free the named buffer pools, which no process can have mapped anymore
+    for (i = 0; i < AXIDMA_MAX_POOLS; i++)
+    {
+        if (dev->pools[i] != NULL) {
+            axidma_free_pool(dev, i);
+        }
+    }
+
     // Cleanup all related character device structures
     cdev_del(&dev->chrdev);
     device_destroy(dev->dev_class, dev->dev_num);
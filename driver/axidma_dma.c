@@ -12,6 +12,13 @@
 // Kernel dependencies
 #include <linux/delay.h>            // Milliseconds to jiffies converstion
 #include <linux/wait.h>             // Completion related functions
+#include <linux/spinlock.h>         // Spinlock definitions and functions
+#include <linux/ktime.h>            // Kernel monotonic timestamps
+#include <linux/mm.h>               // Page allocation and remapping functions
+#include <linux/mutex.h>            // Mutex definitions and functions
+#include <linux/kthread.h>          // Kernel thread functions
+#include <linux/math64.h>           // 64-bit division functions
+#include <linux/log2.h>             // Integer logarithm functions
 
 /* <linux/signal.h> was moved to <linux/sched/signal.h> in the 4.11 kernel */
 #include <linux/version.h>
@@ -19,6 +26,15 @@
 #include <linux/sched.h>            // Send signal to process function
 #else
 #include <linux/sched/signal.h>     // send_sig_info function
+#include <uapi/linux/sched/types.h> // Scheduling parameter structure
+#endif
+
+/* The arithmetic overflow checks were added in the 4.18 kernel */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,18,0)
+#include <linux/overflow.h>         // Overflow checked arithmetic
+#else
+#define check_add_overflow(a, b, d) __builtin_add_overflow(a, b, d)
+#define check_mul_overflow(a, b, d) __builtin_mul_overflow(a, b, d)
 #endif
 
 #include <linux/dmaengine.h>        // DMA types and functions
@@ -47,6 +63,40 @@
 // The default timeout for DMA is 10 seconds
 #define AXIDMA_DMA_TIMEOUT      10000
 
+/* The number of transfers tracked per channel. This bounds the number of
+ * transfers in-flight on a channel, and the number of completed transfers
+ * whose timestamps are retained for AXIDMA_WAIT_ANY. */
+#define AXIDMA_NUM_TRANSFER_SLOTS   64
+
+// The period over which the completion rate of a channel is measured
+#define AXIDMA_RATE_WINDOW_NS       (10 * NSEC_PER_MSEC)
+
+// The default time between polls for completions, in microseconds
+#define AXIDMA_DEFAULT_POLL_INTERVAL_US     50
+
+// The number of processes whose transfers are queued separately on a channel
+#define AXIDMA_MAX_SUBMITTERS       16
+
+// The bytes a process with a weight of 1 can issue in each fair scheduling round
+#define AXIDMA_SCHED_QUANTUM        (256 * 1024)
+
+/* The number of AXIDMA_WAIT_ANY calls that can wait at once using the arrays
+ * preallocated at probe time. Any more have to allocate their own. */
+#define AXIDMA_NUM_WAIT_ARRAYS      8
+
+// The number of frames a capture ring keeps queued in the VDMA at once
+#define AXIDMA_CAPTURE_DEPTH        2
+
+// The addresses and shape of a memory-to-memory copy on a CDMA channel
+struct axidma_copy {
+    dma_addr_t dst;                 // The DMA address of the destination
+    dma_addr_t src;                 // The DMA address of the source
+    size_t len;                     // The number of bytes in each row
+    int num_rows;                   // The number of rows to copy
+    size_t dst_stride;              // The bytes between destination rows
+    size_t src_stride;              // The bytes between source rows
+};
+
 // A convenient structure to pass between prep and start transfer functions
 struct axidma_transfer {
     int sg_len;                     // The length of the BD array
@@ -59,20 +109,129 @@ struct axidma_transfer {
     int channel_id;                 // The ID of the channel
     int notify_signal;              // The signal to use for async transfers
     struct task_struct *process;    // The process requesting the transfer
-    struct axidma_cb_data *cb_data; // The callback data struct
+    struct axidma_timestamps timestamps;    // The transfer's timestamps
+    struct axidma_metadata *metadata;   // Sideband words to send/receive, or NULL
+    struct axidma_chan_data *chan_data; // The channel's transfer tracking data
+    struct axidma_cb_data *cb_data; // The callback data struct (from prep)
 
-    // VDMA specific fields (kept as union for extensability)
+    // VDMA and CDMA specific fields (kept as union for extensability)
     union {
         struct axidma_video_frame frame;    // Frame information for VDMA
+        struct axidma_copy copy;            // Copy information for CDMA
     };
 };
 
-// The data to pass to the DMA transfer completion callback function
+// The state of a transfer slot on a channel
+enum axidma_slot_state {
+    AXIDMA_SLOT_FREE,               // The slot has never been used
+    AXIDMA_SLOT_QUEUED,             // The transfer is waiting to be issued
+    AXIDMA_SLOT_PENDING,            // The transfer is in-flight
+    AXIDMA_SLOT_DONE,               // The transfer has completed
+    AXIDMA_SLOT_ABORTED,            // The transfer was terminated
+};
+
+/* The data to pass to the DMA transfer completion callback function. There is
+ * one per transfer slot, and it is kept until the slot is reused, so that the
+ * transfer's timestamps can be reported after it completes. */
 struct axidma_cb_data {
     int channel_id;                 // The id of the channel used
     int notify_signal;              // For async, signal to send
     struct task_struct *process;    // The process to send the signal to
     struct completion *comp;        // For sync, the notification to kernel
+    wait_queue_head_t *wait_queue;  // Queue of threads waiting on any transfer
+    struct axidma_chan_data *chan_data; // The channel the slot belongs to
+    enum axidma_slot_state state;   // The state of the transfer in the slot
+    dma_cookie_t cookie;            // The driver's cookie for the transfer
+    dma_cookie_t dma_cookie;        // The DMA engine's cookie, once issued
+    struct dma_async_tx_descriptor *desc;   // The descriptor, until issued
+    struct list_head node;          // Entry in the submitter's queue
+    size_t len;                     // The number of bytes in the transfer
+    size_t received;                // The bytes transferred, once complete
+    bool polled;                    // The transfer has no completion callback
+    struct axidma_timestamps timestamps;    // When the transfer progressed
+    struct dma_async_tx_descriptor *meta_desc;  // To read received metadata
+    bool meta_attached;             // The metadata buffer is the engine's
+    struct axidma_metadata metadata;    // The sideband words sent or received
+};
+
+// The queue of transfers waiting to be issued for one process on a channel
+struct axidma_submitter {
+    pid_t tgid;                     // The process, or 0 if never used
+    bool configured;                // The settings were set by the user
+    u32 weight;                     // The share of the channel for fair
+    int priority;                   // The priority for strict priority
+    u64 deficit;                    // Bytes left to issue in this fair round
+    struct list_head queue;         // The transfers waiting to be issued
+};
+
+// The state of a frame buffer in a capture ring
+enum axidma_frame_state {
+    AXIDMA_FRAME_FREE,              // The buffer holds no frame
+    AXIDMA_FRAME_FILLING,           // The hardware is capturing into it
+    AXIDMA_FRAME_READY,             // The buffer holds a captured frame
+};
+
+// A frame buffer in a capture ring, passed to the completion callback
+struct axidma_capture_buffer {
+    struct axidma_chan_data *chan_data; // The channel capturing into it
+    dma_addr_t dma_addr;            // The DMA address of the buffer
+    enum axidma_frame_state state;  // What the buffer currently holds
+    int refcount;                   // Consumers holding the frame
+    bool acquired;                  // A consumer has acquired the frame
+    u64 sequence;                   // The number of the frame in the buffer
+    u64 timestamp_ns;               // When the frame was captured
+};
+
+// A ring of frame buffers captured into by a VDMA receive channel
+struct axidma_capture {
+    bool running;                   // The capture has been started
+    bool stalled;                   // No buffer was free to capture into
+    int num_frames;                 // The number of buffers in the ring
+    int num_filling;                // The buffers queued in the hardware
+    struct axidma_video_frame frame;    // The dimensions of the frames
+    u64 generation;                 // Counts the captures started
+    u64 last_sequence;              // The number of the last frame captured
+    u64 unread;                     // Frames reused before being acquired
+    u64 stalls;                     // Times no buffer was free
+    wait_queue_head_t *wait_queue;  // Woken up when a frame is captured
+    struct axidma_capture_buffer buffers[AXIDMA_MAX_FRAME_BUFFERS];
+};
+
+// The transfer tracking data for each channel
+struct axidma_chan_data {
+    struct axidma_chan *chan;       // The channel the data belongs to
+    spinlock_t lock;                // Protects the transfer slots
+    int next_slot;                  // The next slot to use for a transfer
+    struct axidma_chan_status *status;  // Counters in the status page, if any
+    struct axidma_cb_data slots[AXIDMA_NUM_TRANSFER_SLOTS];
+
+    // Adaptive completion handling state, protected by the lock
+    struct mutex config_lock;       // Serializes changes to the configuration
+    struct axidma_adaptive_config config;   // The adaptive mode settings
+    bool polling;                   // Completions are currently polled for
+    u64 window_start_ns;            // Start of the rate measurement window
+    u64 window_completions;         // Completions in the measurement window
+    u64 mode_start_ns;              // When the current mode was entered
+    struct axidma_chan_stats stats; // Time and completions in each mode
+    struct task_struct *poll_thread;    // Thread polling for completions
+    wait_queue_head_t poll_queue;   // Wakes the thread when polling starts
+    struct axidma_completion_config completion; // Where the thread runs
+
+    // Scatter-gather list for starting video transfers, so none is allocated
+    struct mutex video_lock;        // Serializes the use of the list
+    struct scatterlist video_sg[AXIDMA_MAX_FRAME_BUFFERS];
+
+    // The capture ring for a VDMA receive channel, protected by the lock
+    struct axidma_capture capture;
+    bool v4l2_owned;                // The channel is streaming through V4L2
+
+    // Scheduling of the transfers into the engine, protected by the lock
+    dma_cookie_t next_cookie;       // The cookie for the next transfer
+    struct axidma_sched_config sched;   // The scheduling settings
+    int hw_transfers;               // Transfers issued to the engine
+    u64 hw_bytes;                   // Bytes issued to the engine
+    int next_submitter;             // Where the round robin resumes
+    struct axidma_submitter submitters[AXIDMA_MAX_SUBMITTERS];
 };
 
 /*----------------------------------------------------------------------------
@@ -87,8 +246,10 @@ static char *axidma_dir_to_string(enum axidma_dir dma_dir)
 
 static char *axidma_type_to_string(enum axidma_type dma_type)
 {
-    BUG_ON(dma_type != AXIDMA_DMA && dma_type != AXIDMA_VDMA);
-    return (dma_type == AXIDMA_DMA) ? "DMA" : "VDMA";
+    BUG_ON(dma_type != AXIDMA_DMA && dma_type != AXIDMA_VDMA &&
+           dma_type != AXIDMA_CDMA);
+    return (dma_type == AXIDMA_DMA) ? "DMA" :
+           (dma_type == AXIDMA_VDMA) ? "VDMA" : "CDMA";
 }
 
 // Convert the AXI DMA direction enumeration to a DMA direction enumeration
@@ -140,494 +301,2522 @@ static struct axidma_chan *axidma_get_chan(struct axidma_device *dev,
     return NULL;
 }
 
-static void axidma_dma_callback(void *data)
+// Gets the transfer tracking data for the given channel
+static struct axidma_chan_data *axidma_get_chan_data(struct axidma_device *dev,
+        struct axidma_chan *chan)
 {
-    struct axidma_cb_data *cb_data;
-    struct siginfo sig_info;
-
-    /* For synchronous transfers, notify the kernel thread waiting. For
-     * asynchronous transfers, send a signal to userspace if requested. */
-    cb_data = data;
-    if (cb_data->comp != NULL) {
-        complete(cb_data->comp);
-    } else if (VALID_NOTIFY_SIGNAL(cb_data->notify_signal)) {
-        memset(&sig_info, 0, sizeof(sig_info));
-        sig_info.si_signo = cb_data->notify_signal;
-        sig_info.si_code = SI_QUEUE;
-        sig_info.si_int = cb_data->channel_id;
-        send_sig_info(cb_data->notify_signal, &sig_info, cb_data->process);
-    }
+    return &dev->chan_data[chan - dev->channels];
 }
 
-// Setup the config structure for VDMA
-static void axidma_setup_vdma_config(struct xilinx_vdma_config *dma_config)
+/* Updates the channel's counters in the status page for a completed or failed
+ * transfer. The caller must hold the channel data's lock, which serializes the
+ * writers, while the sequence count lets userspace read without any lock. */
+static void axidma_update_status(struct axidma_chan_data *chan_data,
+        struct axidma_cb_data *cb_data, bool failed)
 {
-    memset(dma_config, 0, sizeof(*dma_config));
-    dma_config->frm_dly = 0;            // Number of frames to delay
-    dma_config->gen_lock = 0;           // Genlock, VDMA runs on fsyncs
-    dma_config->master = 0;             // VDMA is the genlock master
-    dma_config->frm_cnt_en = 1;         // Interrupt based on frame count
-    dma_config->park = 0;               // Continuously process all frames
-    dma_config->park_frm = 0;           // Frame to stop (park) at (N/A)
-    dma_config->coalesc = 1;            // Interrupt after one frame completion
-    dma_config->delay = 0;              // Disable the delay counter interrupt
-    dma_config->reset = 0;              // Don't reset the channel
-    dma_config->ext_fsync = 0;          // VDMA handles synchronizes itself
-    return;
+    struct axidma_chan_status *status;
+
+    status = chan_data->status;
+    if (status == NULL) {
+        return;
+    }
+
+    WRITE_ONCE(status->sequence, status->sequence + 1);
+    smp_wmb();
+    if (failed) {
+        WRITE_ONCE(status->errors, status->errors + 1);
+    } else {
+        WRITE_ONCE(status->completed, status->completed + 1);
+        WRITE_ONCE(status->bytes, status->bytes + cb_data->len);
+        WRITE_ONCE(status->last_cookie, cb_data->cookie);
+    }
+    smp_wmb();
+    WRITE_ONCE(status->sequence, status->sequence + 1);
 }
 
-static int axidma_prep_transfer(struct axidma_chan *axidma_chan,
-                                struct axidma_transfer *dma_tfr)
+/* Claims the next transfer slot on the channel, or returns NULL if there are
+ * already the maximum number of transfers in-flight on the channel. Returns
+ * -EBUSY if the channel is streaming through its V4L2 node. */
+static struct axidma_cb_data *axidma_get_slot(struct axidma_chan_data *chan_data)
 {
-    struct dma_chan *chan;
-    struct dma_device *dma_dev;
-    struct dma_async_tx_descriptor *dma_txnd;
-    struct completion *dma_comp;
-    struct xilinx_vdma_config vdma_config;
+    unsigned long flags;
     struct axidma_cb_data *cb_data;
-    struct dma_interleaved_template dma_template;
-    enum dma_transfer_direction dma_dir;
-    enum dma_ctrl_flags dma_flags;
-    struct scatterlist *sg_list;
-    int sg_len;
-    dma_cookie_t dma_cookie;
-    char *direction, *type;
-    int rc;
-
-    // Get the fields from the structures
-    chan = axidma_chan->chan;
-    dma_comp = &dma_tfr->comp;
-    dma_dir = axidma_to_dma_dir(dma_tfr->dir);
-    dma_dev = chan->device;
-    sg_list = dma_tfr->sg_list;
-    sg_len = dma_tfr->sg_len;
-    direction = axidma_dir_to_string(dma_tfr->dir);
-    type = axidma_type_to_string(dma_tfr->type);
-    cb_data = dma_tfr->cb_data;
 
-    /* For VDMA transfers, we configure the channel, then prepare an interlaved
-     * transfer. For DMA, we simply prepare a slave scatter-gather transfer. */
-    dma_flags = DMA_CTRL_ACK | DMA_PREP_INTERRUPT;
-    if (dma_tfr->type == AXIDMA_DMA) {
-        dma_txnd = dmaengine_prep_slave_sg(chan, sg_list, sg_len, dma_dir,
-                                           dma_flags);
+    spin_lock_irqsave(&chan_data->lock, flags);
+    cb_data = &chan_data->slots[chan_data->next_slot];
+    if (chan_data->v4l2_owned) {
+        cb_data = ERR_PTR(-EBUSY);
+    } else if (cb_data->state == AXIDMA_SLOT_QUEUED ||
+            cb_data->state == AXIDMA_SLOT_PENDING) {
+        cb_data = NULL;
     } else {
-        axidma_setup_vdma_config(&vdma_config);
-        rc = xilinx_vdma_channel_set_config(chan, &vdma_config);
-        if (rc < 0) {
-            axidma_err("Unable to set the config for channel.\n");
-            goto stop_dma;
-        }
-
-        memset(&dma_template, 0, sizeof(dma_template));
-        dma_template.dst_start = sg_dma_address(&sg_list[0]);
-        dma_template.src_start = sg_dma_address(&sg_list[0]);
-        dma_template.dir = dma_dir;
-        dma_template.numf = dma_tfr->frame.height;
-        dma_template.frame_size = 1;
-        dma_template.sgl[0].size = dma_tfr->frame.width *
-                dma_tfr->frame.depth;
-        dma_template.sgl[0].icg = 0;
-        dma_txnd = dmaengine_prep_interleaved_dma(chan, &dma_template,
-                dma_flags);
-    }
-    if (dma_txnd == NULL) {
-        axidma_err("Unable to prepare the dma engine for the %s %s buffer.\n",
-                   type, direction);
-        rc = -EBUSY;
-        goto stop_dma;
+        memset(&cb_data->timestamps, 0, sizeof(cb_data->timestamps));
+        cb_data->received = 0;
+        cb_data->cookie = chan_data->next_cookie;
+        cb_data->dma_cookie = -EBUSY;
+        cb_data->desc = NULL;
+        cb_data->meta_desc = NULL;
+        cb_data->meta_attached = false;
+        memset(&cb_data->metadata, 0, sizeof(cb_data->metadata));
+        cb_data->state = AXIDMA_SLOT_QUEUED;
+        cb_data->polled = chan_data->polling;
+        chan_data->next_slot = (chan_data->next_slot + 1) %
+                               AXIDMA_NUM_TRANSFER_SLOTS;
+
+        // Like the DMA engine's cookies, skip over the negative error values
+        chan_data->next_cookie += 1;
+        if (chan_data->next_cookie < DMA_MIN_COOKIE) {
+            chan_data->next_cookie = DMA_MIN_COOKIE;
+        }
     }
+    spin_unlock_irqrestore(&chan_data->lock, flags);
 
-    /* If we're going to wait for this channel, initialize the completion for
-     * the channel, and setup the callback to complete it. */
-    cb_data->channel_id = dma_tfr->channel_id;
-    if (dma_tfr->wait) {
-        cb_data->comp = dma_comp;
-        cb_data->notify_signal = -1;
-        cb_data->process = NULL;
-        init_completion(cb_data->comp);
-        dma_txnd->callback_param = cb_data;
-        dma_txnd->callback = axidma_dma_callback;
-    } else {
-        cb_data->comp = NULL;
-        cb_data->notify_signal = dma_tfr->notify_signal;
-        cb_data->process = dma_tfr->process;
-        dma_txnd->callback_param = cb_data;
-        dma_txnd->callback = axidma_dma_callback;
-    }
-    dma_cookie = dmaengine_submit(dma_txnd);
-    if (dma_submit_error(dma_cookie)) {
-        axidma_err("Unable to submit the %s %s transaction to the engine.\n",
-                   direction, type);
-        rc = -EBUSY;
-        goto stop_dma;
-    }
+    return cb_data;
+}
 
-    // Return the DMA cookie for the transaction
-    dma_tfr->cookie = dma_cookie;
-    return 0;
+// Releases the slot of a transfer that failed before it could be submitted
+static void axidma_put_slot(struct axidma_cb_data *cb_data)
+{
+    unsigned long flags;
 
-stop_dma:
-    dmaengine_terminate_all(chan);
-    return rc;
+    spin_lock_irqsave(&cb_data->chan_data->lock, flags);
+    cb_data->state = AXIDMA_SLOT_FREE;
+    axidma_update_status(cb_data->chan_data, cb_data, true);
+    spin_unlock_irqrestore(&cb_data->chan_data->lock, flags);
 }
 
-static int axidma_start_transfer(struct axidma_chan *chan,
-                                 struct axidma_transfer *dma_tfr)
+/* Finds the slot holding the transfer with the given cookie on the channel.
+ * The caller must hold the channel data's lock. */
+static struct axidma_cb_data *axidma_find_slot(
+        struct axidma_chan_data *chan_data, dma_cookie_t cookie)
 {
-    struct completion *dma_comp;
-    dma_cookie_t dma_cookie;
-    enum dma_status status;
-    char *direction, *type;
-    unsigned long timeout, time_remain;
-    int rc;
+    int i;
+    struct axidma_cb_data *cb_data;
 
-    // Get the fields from the structures
-    dma_comp = &dma_tfr->comp;
-    dma_cookie = dma_tfr->cookie;
-    direction = axidma_dir_to_string(dma_tfr->dir);
-    type = axidma_type_to_string(dma_tfr->type);
+    for (i = 0; i < AXIDMA_NUM_TRANSFER_SLOTS; i++)
+    {
+        cb_data = &chan_data->slots[i];
+        if (cb_data->state != AXIDMA_SLOT_FREE && cb_data->cookie == cookie) {
+            return cb_data;
+        }
+    }
 
-    // Flush all pending transaction in the dma engine for this channel
-    dma_async_issue_pending(chan->chan);
+    return NULL;
+}
 
-    // Wait for the completion timeout or the DMA to complete
-    if (dma_tfr->wait) {
-        timeout = msecs_to_jiffies(AXIDMA_DMA_TIMEOUT);
-        time_remain = wait_for_completion_timeout(dma_comp, timeout);
-        status = dma_async_is_tx_complete(chan->chan, dma_cookie, NULL, NULL);
+/* Copies out the timestamps and received metadata for the transfer in the
+ * given slot, the latter only if metadata is non-NULL. If the slot has already
+ * been reused for another transfer, they are reported as zero. */
+static void axidma_read_completion(struct axidma_cb_data *cb_data,
+        dma_cookie_t cookie, struct axidma_timestamps *timestamps,
+        struct axidma_metadata *metadata)
+{
+    unsigned long flags;
 
-        if (time_remain == 0) {
-            axidma_err("%s %s transaction timed out.\n", type, direction);
-            rc = -ETIME;
-            goto stop_dma;
-        } else if (status != DMA_COMPLETE) {
-            axidma_err("%s %s transaction did not succceed. Status is %d.\n",
-                       type, direction, status);
-            rc = -EBUSY;
-            goto stop_dma;
+    spin_lock_irqsave(&cb_data->chan_data->lock, flags);
+    if (cb_data->cookie == cookie) {
+        *timestamps = cb_data->timestamps;
+        if (metadata != NULL) {
+            *metadata = cb_data->metadata;
+        }
+    } else {
+        memset(timestamps, 0, sizeof(*timestamps));
+        if (metadata != NULL) {
+            memset(metadata, 0, sizeof(*metadata));
         }
     }
-
-    return 0;
-
-stop_dma:
-    dmaengine_terminate_all(chan->chan);
-    return rc;
+    spin_unlock_irqrestore(&cb_data->chan_data->lock, flags);
 }
 
 /*----------------------------------------------------------------------------
- * DMA Operations (Public Interface)
+ * Packet Metadata
  *----------------------------------------------------------------------------*/
 
-void axidma_get_num_channels(struct axidma_device *dev,
-                             struct axidma_num_channels *num_chans)
-{
-    num_chans->num_channels = dev->num_chans;
-    num_chans->num_dma_tx_channels = dev->num_dma_tx_chans;
-    num_chans->num_dma_rx_channels = dev->num_dma_rx_chans;
-    num_chans->num_vdma_tx_channels = dev->num_vdma_tx_chans;
-    num_chans->num_vdma_rx_channels = dev->num_vdma_rx_chans;
-    return;
-}
-
-void axidma_get_channel_info(struct axidma_device *dev,
-                             struct axidma_channel_info *chan_info)
-{
-    chan_info->channels = dev->channels;
-    return;
-}
+/* The DMA engine's descriptor metadata interface was added in the 5.6 kernel.
+ * An engine either lets the client attach its own buffer for the metadata, or
+ * hands out a pointer to the metadata inside of the descriptor, which is the
+ * case for the Xilinx AXI DMA, whose APP words are in the hardware descriptor. */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,6,0)
 
-int axidma_set_signal(struct axidma_device *dev, int signal)
+// Checks that the channel can carry the metadata requested for a transfer
+static int axidma_check_metadata(struct axidma_chan *chan,
+                                 struct axidma_metadata *metadata)
 {
-    // Verify the signal is a real-time one
-    if (!VALID_NOTIFY_SIGNAL(signal)) {
-        axidma_err("Invalid signal %d requested for DMA notification.\n",
-                   signal);
-        axidma_err("You must specify one of the POSIX real-time signals.\n");
+    if (metadata == NULL || chan->dir == AXIDMA_READ || metadata->len == 0) {
+        return 0;
+    } else if (metadata->len > sizeof(metadata->app)) {
+        axidma_err("Metadata of %u bytes exceeds the %zu byte maximum.\n",
+                   metadata->len, sizeof(metadata->app));
         return -EINVAL;
+    } else if (chan->type != AXIDMA_DMA ||
+               (!dmaengine_is_metadata_mode_supported(chan->chan,
+                        DESC_METADATA_ENGINE) &&
+                !dmaengine_is_metadata_mode_supported(chan->chan,
+                        DESC_METADATA_CLIENT))) {
+        axidma_err("Channel %d does not support packet metadata.\n",
+                   chan->channel_id);
+        return -EOPNOTSUPP;
     }
 
-    dev->notify_signal = signal;
     return 0;
 }
 
-int axidma_read_transfer(struct axidma_device *dev,
-                         struct axidma_transaction *trans)
+/* Checks if the channel receives metadata with its transfers. The engine frees
+ * the descriptor, and the metadata with it, once it has called the completion
+ * callback, so these transfers must always be completed by the callback. */
+static bool axidma_receives_metadata(struct axidma_chan *chan)
 {
-    int rc;
-    struct axidma_chan *rx_chan;
-    struct scatterlist sg_list;
-    struct axidma_transfer rx_tfr;
+    return chan->type == AXIDMA_DMA && chan->dir == AXIDMA_READ &&
+           (dmaengine_is_metadata_mode_supported(chan->chan,
+                                                 DESC_METADATA_ENGINE) ||
+            dmaengine_is_metadata_mode_supported(chan->chan,
+                                                 DESC_METADATA_CLIENT));
+}
 
-    // Get the channel with the given channel id
-    rx_chan = axidma_get_chan(dev, trans->channel_id);
-    if (rx_chan == NULL || rx_chan->dir != AXIDMA_READ) {
-        axidma_err("Invalid device id %d for DMA receive channel.\n",
-                   trans->channel_id);
-        return -ENODEV;
-    }
+/* Attaches the metadata to send with a transmit transfer, or sets up the
+ * descriptor to receive it for a receive transfer. */
+static int axidma_attach_metadata(struct axidma_chan *chan,
+        struct axidma_cb_data *cb_data, struct dma_async_tx_descriptor *desc,
+        struct axidma_metadata *metadata)
+{
+    void *engine_metadata;
+    size_t payload_len, max_len;
 
-    // Setup the scatter-gather list for the transfer (only one entry)
-    sg_init_table(&sg_list, 1);
-    rc = axidma_init_sg_entry(dev, &sg_list, 0, trans->buf,
-                              trans->buf_len);
-    if (rc < 0) {
-        return rc;
+    if (chan->type != AXIDMA_DMA) {
+        return 0;
     }
 
-    // Setup receive transfer structure for DMA
-    rx_tfr.sg_list = &sg_list;
-    rx_tfr.sg_len = 1;
-    rx_tfr.dir = rx_chan->dir;
-    rx_tfr.type = rx_chan->type;
-    rx_tfr.wait = trans->wait;
-    rx_tfr.channel_id = trans->channel_id;
-    rx_tfr.notify_signal = dev->notify_signal;
-    rx_tfr.process = get_current();
-    rx_tfr.cb_data = &dev->cb_data[trans->channel_id];
+    // The engine keeps the metadata in the descriptor
+    if (dmaengine_is_metadata_mode_supported(chan->chan,
+                                             DESC_METADATA_ENGINE)) {
+        if (chan->dir == AXIDMA_READ) {
+            cb_data->meta_desc = desc;
+            return 0;
+        } else if (metadata == NULL || metadata->len == 0) {
+            return 0;
+        }
 
-    // Prepare the receive transfer
-    rc = axidma_prep_transfer(rx_chan, &rx_tfr);
-    if (rc < 0) {
-        return rc;
+        engine_metadata = dmaengine_desc_get_metadata_ptr(desc, &payload_len,
+                                                          &max_len);
+        if (IS_ERR(engine_metadata)) {
+            return PTR_ERR(engine_metadata);
+        }
+        memcpy(engine_metadata, metadata->app, min_t(size_t, metadata->len,
+                                                     max_len));
+        return dmaengine_desc_set_metadata_len(desc, min_t(size_t,
+                metadata->len, max_len));
     }
 
-    // Submit the receive transfer, and wait for it to complete
-    rc = axidma_start_transfer(rx_chan, &rx_tfr);
-    if (rc < 0) {
-        return rc;
+    // The engine reads or writes the metadata from a buffer in the slot
+    if (!dmaengine_is_metadata_mode_supported(chan->chan,
+                                              DESC_METADATA_CLIENT)) {
+        return 0;
+    } else if (chan->dir == AXIDMA_READ) {
+        cb_data->meta_attached = true;
+        return dmaengine_desc_attach_metadata(desc, cb_data->metadata.app,
+                                              sizeof(cb_data->metadata.app));
+    } else if (metadata == NULL || metadata->len == 0) {
+        return 0;
     }
 
-    return 0;
+    cb_data->metadata = *metadata;
+    return dmaengine_desc_attach_metadata(desc, cb_data->metadata.app,
+                                          metadata->len);
 }
 
-int axidma_write_transfer(struct axidma_device *dev,
-                          struct axidma_transaction *trans)
+/* Gathers the metadata received with a transfer, from its completion callback,
+ * while the engine's descriptor is still valid. Only received metadata is kept
+ * in the slot to report back. The caller must hold the channel's lock. */
+static void axidma_collect_metadata(struct axidma_cb_data *cb_data)
 {
-    int rc;
-    struct axidma_chan *tx_chan;
-    struct scatterlist sg_list;
-    struct axidma_transfer tx_tfr;
-
-    // Get the channel with the given id
-    tx_chan = axidma_get_chan(dev, trans->channel_id);
-    if (tx_chan == NULL || tx_chan->dir != AXIDMA_WRITE) {
-        axidma_err("Invalid device id %d for DMA transmit channel.\n",
-                   trans->channel_id);
-        return -ENODEV;
-    }
-
-    // Setup the scatter-gather list for the transfer (only one entry)
-    sg_init_table(&sg_list, 1);
-    rc = axidma_init_sg_entry(dev, &sg_list, 0, trans->buf,
-                              trans->buf_len);
-    if (rc < 0) {
-        return rc;
+    void *engine_metadata;
+    size_t payload_len, max_len;
+
+    if (cb_data->meta_desc != NULL) {
+        engine_metadata = dmaengine_desc_get_metadata_ptr(cb_data->meta_desc,
+                &payload_len, &max_len);
+        if (!IS_ERR(engine_metadata)) {
+            cb_data->metadata.len = min_t(size_t, payload_len,
+                                          sizeof(cb_data->metadata.app));
+            memcpy(cb_data->metadata.app, engine_metadata,
+                   cb_data->metadata.len);
+        }
+        cb_data->meta_desc = NULL;
+    } else if (cb_data->meta_attached) {
+        cb_data->metadata.len = sizeof(cb_data->metadata.app);
+    } else {
+        cb_data->metadata.len = 0;
     }
+}
 
-    // Setup transmit transfer structure for DMA
-    tx_tfr.sg_list = &sg_list;
-    tx_tfr.sg_len = 1;
-    tx_tfr.dir = tx_chan->dir;
-    tx_tfr.type = tx_chan->type;
-    tx_tfr.wait = trans->wait;
-    tx_tfr.channel_id = trans->channel_id;
-    tx_tfr.notify_signal = dev->notify_signal;
-    tx_tfr.process = get_current();
-    tx_tfr.cb_data = &dev->cb_data[trans->channel_id];
+#else
 
-    // Prepare the transmit transfer
-    rc = axidma_prep_transfer(tx_chan, &tx_tfr);
-    if (rc < 0) {
-        return rc;
+static int axidma_check_metadata(struct axidma_chan *chan,
+                                 struct axidma_metadata *metadata)
+{
+    if (metadata != NULL && chan->dir == AXIDMA_WRITE && metadata->len != 0) {
+        axidma_err("Packet metadata requires a 5.6 or later kernel.\n");
+        return -EOPNOTSUPP;
     }
+    return 0;
+}
 
-    // Submit the transmit transfer, and wait for it to complete
-    rc = axidma_start_transfer(tx_chan, &tx_tfr);
-    if (rc < 0) {
-        return rc;
-    }
+static bool axidma_receives_metadata(struct axidma_chan *chan)
+{
+    return false;
+}
 
+static int axidma_attach_metadata(struct axidma_chan *chan,
+        struct axidma_cb_data *cb_data, struct dma_async_tx_descriptor *desc,
+        struct axidma_metadata *metadata)
+{
     return 0;
 }
 
-/* Transfers data from the given source buffer out to the AXI DMA device, and
- * places the data received into the receive buffer. */
-int axidma_rw_transfer(struct axidma_device *dev,
-                       struct axidma_inout_transaction *trans)
+static void axidma_collect_metadata(struct axidma_cb_data *cb_data)
 {
-    int rc;
-    struct axidma_chan *tx_chan, *rx_chan;
-    struct scatterlist tx_sg_list, rx_sg_list;
+    return;
+}
+
+#endif /* LINUX_VERSION_CODE >= KERNEL_VERSION(5,6,0) */
+
+/*----------------------------------------------------------------------------
+ * Transfer Scheduling
+ *----------------------------------------------------------------------------*/
+
+/* Finds the queue for the given process on the channel, taking over an idle
+ * entry if the process does not have one yet. If every entry is in use, the
+ * process shares the first one. The caller must hold the channel's lock. */
+static struct axidma_submitter *axidma_get_submitter(
+        struct axidma_chan_data *chan_data, pid_t tgid)
+{
+    int i;
+    struct axidma_submitter *submitter, *idle;
+
+    idle = NULL;
+    for (i = 0; i < AXIDMA_MAX_SUBMITTERS; i++)
+    {
+        submitter = &chan_data->submitters[i];
+        if (submitter->tgid == tgid) {
+            return submitter;
+        } else if (idle == NULL && !submitter->configured &&
+                   list_empty(&submitter->queue)) {
+            idle = submitter;
+        }
+    }
+
+    if (idle == NULL) {
+        return &chan_data->submitters[0];
+    }
+    idle->tgid = tgid;
+    idle->weight = 1;
+    idle->priority = 0;
+    idle->deficit = 0;
+    return idle;
+}
+
+// Gets the next transfer waiting in the submitter's queue
+static struct axidma_cb_data *axidma_queue_head(
+        struct axidma_submitter *submitter)
+{
+    return list_first_entry(&submitter->queue, struct axidma_cb_data, node);
+}
+
+/* Picks the queue to issue from with deficit round robin. The queues take
+ * turns, and each issues transfers until it has used up its deficit. A queue
+ * that cannot afford its next transfer is given its quantum, in proportion to
+ * its weight, and passes the turn on. */
+static struct axidma_submitter *axidma_pick_fair(
+        struct axidma_chan_data *chan_data)
+{
+    int i, num_backlogged;
+    struct axidma_submitter *submitter;
+
+    do {
+        num_backlogged = 0;
+        for (i = 0; i < AXIDMA_MAX_SUBMITTERS; i++)
+        {
+            submitter = &chan_data->submitters[chan_data->next_submitter];
+            if (list_empty(&submitter->queue)) {
+                submitter->deficit = 0;
+            } else if (axidma_queue_head(submitter)->len <= submitter->deficit) {
+                return submitter;
+            } else {
+                submitter->deficit += (u64)submitter->weight *
+                                      AXIDMA_SCHED_QUANTUM;
+                num_backlogged += 1;
+            }
+            chan_data->next_submitter = (chan_data->next_submitter + 1) %
+                                        AXIDMA_MAX_SUBMITTERS;
+        }
+    } while (num_backlogged > 0);
+
+    return NULL;
+}
+
+/* Picks the queue whose next transfer should be issued according to the
+ * channel's policy, or NULL if no transfers are queued. The caller must hold
+ * the channel's lock. */
+static struct axidma_submitter *axidma_pick_submitter(
+        struct axidma_chan_data *chan_data)
+{
+    int i;
+    struct axidma_submitter *submitter, *best;
+
+    if (chan_data->sched.policy == AXIDMA_SCHED_FAIR) {
+        return axidma_pick_fair(chan_data);
+    }
+
+    /* For FIFO, pick the oldest transfer across the queues. For priority,
+     * pick the highest priority queue, starting the search after the last one
+     * issued from, so that queues of the same priority alternate. */
+    best = NULL;
+    for (i = 0; i < AXIDMA_MAX_SUBMITTERS; i++)
+    {
+        submitter = &chan_data->submitters[(chan_data->next_submitter + i) %
+                                           AXIDMA_MAX_SUBMITTERS];
+        if (list_empty(&submitter->queue)) {
+            continue;
+        } else if (best == NULL) {
+            best = submitter;
+        } else if (chan_data->sched.policy == AXIDMA_SCHED_FIFO &&
+                   axidma_queue_head(submitter)->cookie -
+                   axidma_queue_head(best)->cookie < 0) {
+            best = submitter;
+        } else if (chan_data->sched.policy == AXIDMA_SCHED_PRIORITY &&
+                   submitter->priority > best->priority) {
+            best = submitter;
+        }
+    }
+
+    return best;
+}
+
+/* Issues the queued transfers to the DMA engine in the order picked by the
+ * channel's policy, until the channel reaches its in-flight limits. The caller
+ * must hold the channel's lock. */
+static void axidma_dispatch(struct axidma_chan_data *chan_data)
+{
+    bool issued;
+    dma_cookie_t dma_cookie;
+    struct axidma_sched_config *sched;
+    struct axidma_submitter *submitter;
+    struct axidma_cb_data *cb_data;
+
+    sched = &chan_data->sched;
+    issued = false;
+    while (chan_data->hw_transfers < sched->max_hw_transfers)
+    {
+        // The byte limit always lets at least one transfer through
+        submitter = axidma_pick_submitter(chan_data);
+        if (submitter == NULL) {
+            break;
+        }
+        cb_data = axidma_queue_head(submitter);
+        if (sched->max_hw_bytes != 0 && chan_data->hw_transfers > 0 &&
+                chan_data->hw_bytes + cb_data->len > sched->max_hw_bytes) {
+            break;
+        }
+
+        // Charge the transfer to its queue, and move on from it
+        list_del_init(&cb_data->node);
+        if (sched->policy == AXIDMA_SCHED_FAIR) {
+            submitter->deficit -= cb_data->len;
+        } else {
+            chan_data->next_submitter = (submitter - chan_data->submitters +
+                                         1) % AXIDMA_MAX_SUBMITTERS;
+        }
+
+        /* Record the issue time before submitting, as the callback may run as
+         * soon as the transfer is in the engine. */
+        cb_data->state = AXIDMA_SLOT_PENDING;
+        cb_data->timestamps.issue_ns = ktime_get_ns();
+        dma_cookie = dmaengine_submit(cb_data->desc);
+        cb_data->desc = NULL;
+        if (dma_submit_error(dma_cookie)) {
+            axidma_err("Unable to submit the transaction on channel %d to the "
+                       "engine.\n", cb_data->channel_id);
+            cb_data->state = AXIDMA_SLOT_ABORTED;
+            axidma_update_status(chan_data, cb_data, true);
+            if (cb_data->comp != NULL) {
+                complete(cb_data->comp);
+            }
+            wake_up_interruptible(cb_data->wait_queue);
+            continue;
+        }
+
+        cb_data->dma_cookie = dma_cookie;
+        chan_data->hw_transfers += 1;
+        chan_data->hw_bytes += cb_data->len;
+        issued = true;
+    }
+
+    if (issued) {
+        dma_async_issue_pending(chan_data->chan->chan);
+    }
+}
+
+static void axidma_set_callback(struct dma_async_tx_descriptor *desc,
+                                bool enable);
+
+/* Terminates all transfers on the channel, marking any queued or in-flight
+ * transfers as aborted, and waking up anyone waiting on them. If the transfers
+ * are being terminated because of an error, they are counted as failed. */
+static void axidma_terminate_transfers(struct axidma_device *dev,
+        struct axidma_chan *chan, bool failed)
+{
+    int i;
+    unsigned long flags;
+    struct axidma_chan_data *chan_data;
+    struct axidma_cb_data *cb_data;
+
+    /* The descriptors of the transfers that were never issued are only freed
+     * by the engine once submitted, so hand them over without a callback. Also
+     * stop any capture, so it does not queue more frames. */
+    chan_data = axidma_get_chan_data(dev, chan);
+    spin_lock_irqsave(&chan_data->lock, flags);
+    chan_data->capture.running = false;
+    for (i = 0; i < AXIDMA_NUM_TRANSFER_SLOTS; i++)
+    {
+        cb_data = &chan_data->slots[i];
+        if (cb_data->state == AXIDMA_SLOT_QUEUED && cb_data->desc != NULL) {
+            list_del_init(&cb_data->node);
+            axidma_set_callback(cb_data->desc, false);
+            dmaengine_submit(cb_data->desc);
+            cb_data->desc = NULL;
+        }
+    }
+    spin_unlock_irqrestore(&chan_data->lock, flags);
+
+    dmaengine_terminate_all(chan->chan);
+
+    spin_lock_irqsave(&chan_data->lock, flags);
+    for (i = 0; i < AXIDMA_NUM_TRANSFER_SLOTS; i++)
+    {
+        cb_data = &chan_data->slots[i];
+        if (cb_data->state == AXIDMA_SLOT_QUEUED ||
+                cb_data->state == AXIDMA_SLOT_PENDING) {
+            cb_data->state = AXIDMA_SLOT_ABORTED;
+            if (failed) {
+                axidma_update_status(chan_data, cb_data, true);
+            }
+        }
+    }
+    chan_data->hw_transfers = 0;
+    chan_data->hw_bytes = 0;
+    chan_data->capture.num_filling = 0;
+    for (i = 0; i < chan_data->capture.num_frames; i++)
+    {
+        chan_data->capture.buffers[i].state = AXIDMA_FRAME_FREE;
+        chan_data->capture.buffers[i].refcount = 0;
+    }
+    spin_unlock_irqrestore(&chan_data->lock, flags);
+
+    wake_up_interruptible(&dev->wait_queue);
+}
+
+/* Accounts the time spent in the channel's current completion mode, and
+ * switches it to the given mode. The caller must hold the channel's lock. */
+static void axidma_set_mode(struct axidma_chan_data *chan_data, bool polling,
+                            u64 now)
+{
+    u64 elapsed;
+
+    elapsed = now - chan_data->mode_start_ns;
+    if (chan_data->polling) {
+        chan_data->stats.poll_mode_ns += elapsed;
+    } else {
+        chan_data->stats.irq_mode_ns += elapsed;
+    }
+    chan_data->mode_start_ns = now;
+
+    if (chan_data->polling != polling) {
+        chan_data->stats.mode_switches += 1;
+        WRITE_ONCE(chan_data->polling, polling);
+    }
+}
+
+/* Measures the completion rate of the channel once per window, and switches
+ * between interrupts and polling as it crosses the thresholds. The caller must
+ * hold the channel's lock. */
+static void axidma_update_mode(struct axidma_chan_data *chan_data, u64 now)
+{
+    u64 elapsed, rate;
+    struct axidma_adaptive_config *config;
+
+    elapsed = now - chan_data->window_start_ns;
+    if (elapsed < AXIDMA_RATE_WINDOW_NS) {
+        return;
+    }
+
+    rate = div64_u64(chan_data->window_completions * NSEC_PER_SEC, elapsed);
+    chan_data->window_start_ns = now;
+    chan_data->window_completions = 0;
+
+    config = &chan_data->config;
+    if (!chan_data->polling && config->poll_enter_rate != 0 &&
+            rate >= config->poll_enter_rate) {
+        axidma_set_mode(chan_data, true, now);
+        wake_up_interruptible(&chan_data->poll_queue);
+    } else if (chan_data->polling && (config->poll_enter_rate == 0 ||
+               rate < config->poll_exit_rate)) {
+        axidma_set_mode(chan_data, false, now);
+    }
+}
+
+// Adds the latency of a completed transfer to the channel's histogram
+static void axidma_record_latency(struct axidma_chan_data *chan_data,
+                                  struct axidma_cb_data *cb_data)
+{
+    u64 latency_us;
+    int bucket;
+
+    if (cb_data->timestamps.submit_ns == 0 ||
+            cb_data->timestamps.complete_ns < cb_data->timestamps.submit_ns) {
+        return;
+    }
+
+    latency_us = div_u64(cb_data->timestamps.complete_ns -
+                         cb_data->timestamps.submit_ns, NSEC_PER_USEC);
+    bucket = (latency_us == 0) ? 0 : ilog2(latency_us);
+    bucket = min(bucket, AXIDMA_LATENCY_BUCKETS - 1);
+    chan_data->stats.latency_hist[bucket] += 1;
+}
+
+/* Marks the transfer in the slot as complete, returning false if it was
+ * already completed or terminated. The residue is the number of bytes the
+ * engine did not transfer. The caller must hold the channel's lock. */
+static bool axidma_retire_transfer(struct axidma_cb_data *cb_data,
+                                   u64 complete_ns, bool polled, u32 residue)
+{
+    struct axidma_chan_data *chan_data;
+
+    if (cb_data->state != AXIDMA_SLOT_PENDING) {
+        return false;
+    }
+
+    chan_data = cb_data->chan_data;
+    cb_data->timestamps.complete_ns = complete_ns;
+    cb_data->received = cb_data->len - min_t(size_t, residue, cb_data->len);
+    cb_data->state = AXIDMA_SLOT_DONE;
+    axidma_update_status(chan_data, cb_data, false);
+    axidma_record_latency(chan_data, cb_data);
+
+    // Release the transfer's share of the engine, and issue what it frees up
+    chan_data->hw_transfers -= 1;
+    chan_data->hw_bytes -= cb_data->len;
+    axidma_dispatch(chan_data);
+
+    // Account for the completion in the channel's completion rate
+    if (polled) {
+        chan_data->stats.poll_completions += 1;
+    } else {
+        chan_data->stats.irq_completions += 1;
+    }
+    chan_data->window_completions += 1;
+    axidma_update_mode(chan_data, complete_ns);
+
+    return true;
+}
+
+// Notifies whoever is waiting on a transfer that it has completed
+static void axidma_notify_transfer(struct axidma_cb_data *cb_data)
+{
+    int signal;
+    struct siginfo sig_info;
+
+    /* For synchronous transfers, notify the kernel thread waiting. For
+     * asynchronous transfers, send a signal to userspace if requested, with
+     * the transfer's cookie if it was asked for. */
+    signal = cb_data->notify_signal & ~AXIDMA_SIGNAL_WITH_COOKIE;
+    if (cb_data->comp != NULL) {
+        complete(cb_data->comp);
+    } else if (VALID_NOTIFY_SIGNAL(signal)) {
+        memset(&sig_info, 0, sizeof(sig_info));
+        sig_info.si_signo = signal;
+        sig_info.si_code = SI_QUEUE;
+        if (cb_data->notify_signal & AXIDMA_SIGNAL_WITH_COOKIE) {
+            sig_info.si_int = AXIDMA_SIGNAL_VALUE(cb_data->channel_id,
+                                                  cb_data->cookie);
+        } else {
+            sig_info.si_int = cb_data->channel_id;
+        }
+        send_sig_info(signal, &sig_info, cb_data->process);
+    }
+
+    // Wake up any threads waiting on a set of transfers to complete
+    wake_up_interruptible(cb_data->wait_queue);
+}
+
+// Completes a transfer from its callback, given the engine's residue for it
+static void axidma_complete_transfer(struct axidma_cb_data *cb_data,
+                                     u32 residue)
+{
+    unsigned long flags;
+    ktime_t complete_time;
+    bool retired;
+
+    /* Record when the completion happened, then gather any metadata received
+     * while the descriptor is still around, and retire the transfer's slot.
+     * Both are done under one hold of the lock, so the polling thread can't
+     * see the metadata gathered and retire the slot first, without the
+     * residue. */
+    complete_time = ktime_get();
+    spin_lock_irqsave(&cb_data->chan_data->lock, flags);
+    if (cb_data->state == AXIDMA_SLOT_PENDING) {
+        axidma_collect_metadata(cb_data);
+    }
+    retired = axidma_retire_transfer(cb_data, ktime_to_ns(complete_time),
+                                     false, residue);
+    spin_unlock_irqrestore(&cb_data->chan_data->lock, flags);
+
+    // If the transfer was already terminated, no one is waiting on it
+    if (retired) {
+        axidma_notify_transfer(cb_data);
+    }
+}
+
+/* Callbacks that receive the transfer's result were added in the 4.9 kernel.
+ * The result has the residue, which for a receive transfer is the part of the
+ * buffer past the end of the packet. Older kernels report the full length. */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,9,0)
+static void axidma_dma_callback(void *data,
+                                const struct dmaengine_result *result)
+{
+    axidma_complete_transfer(data, (result != NULL) ? result->residue : 0);
+}
+
+// Sets or clears the transfer's completion callback on its descriptor
+static void axidma_set_callback(struct dma_async_tx_descriptor *desc,
+                                bool enable)
+{
+    desc->callback = NULL;
+    desc->callback_result = enable ? axidma_dma_callback : NULL;
+}
+#else
+static void axidma_dma_callback(void *data)
+{
+    axidma_complete_transfer(data, 0);
+}
+
+static void axidma_set_callback(struct dma_async_tx_descriptor *desc,
+                                bool enable)
+{
+    desc->callback = enable ? axidma_dma_callback : NULL;
+}
+#endif
+
+// Checks if the polling thread has any work to do on the channel
+static bool axidma_poll_needed(struct axidma_chan_data *chan_data)
+{
+    int i;
+    bool needed;
+    unsigned long flags;
+
+    // Transfers submitted without a callback must be polled until they finish
+    spin_lock_irqsave(&chan_data->lock, flags);
+    needed = chan_data->polling;
+    for (i = 0; i < AXIDMA_NUM_TRANSFER_SLOTS && !needed; i++)
+    {
+        needed = (chan_data->slots[i].state == AXIDMA_SLOT_PENDING &&
+                  chan_data->slots[i].polled);
+    }
+    spin_unlock_irqrestore(&chan_data->lock, flags);
+
+    return needed;
+}
+
+// Retires all of the in-flight transfers on the channel that have finished
+static void axidma_poll_transfers(struct axidma_chan_data *chan_data)
+{
+    int i;
+    bool retired;
+    unsigned long flags;
+    dma_cookie_t cookie;
+    enum dma_status status;
+    struct axidma_cb_data *cb_data;
+
+    for (i = 0; i < AXIDMA_NUM_TRANSFER_SLOTS; i++)
+    {
+        /* The engine completes the cookie before it calls the callback, so
+         * transfers receiving metadata are left to the callback to retire,
+         * or the metadata would be reported before it is read. */
+        cb_data = &chan_data->slots[i];
+        spin_lock_irqsave(&chan_data->lock, flags);
+        cookie = cb_data->dma_cookie;
+        retired = (cb_data->state != AXIDMA_SLOT_PENDING) ||
+                  cb_data->meta_desc != NULL || cb_data->meta_attached;
+        spin_unlock_irqrestore(&chan_data->lock, flags);
+
+        // Skip transfers that are finished, not yet issued, or the callback's
+        if (retired || dma_submit_error(cookie)) {
+            continue;
+        }
+
+        status = dma_async_is_tx_complete(chan_data->chan->chan, cookie, NULL,
+                                          NULL);
+        if (status != DMA_COMPLETE) {
+            continue;
+        }
+
+        // The slot may have been reused since the cookie was read
+        spin_lock_irqsave(&chan_data->lock, flags);
+        retired = (cb_data->dma_cookie == cookie) &&
+                  axidma_retire_transfer(cb_data, ktime_get_ns(), true, 0);
+        spin_unlock_irqrestore(&chan_data->lock, flags);
+
+        if (retired) {
+            axidma_notify_transfer(cb_data);
+        }
+    }
+
+    // Re-evaluate the mode, as there may have been no completions to do so
+    spin_lock_irqsave(&chan_data->lock, flags);
+    axidma_update_mode(chan_data, ktime_get_ns());
+    spin_unlock_irqrestore(&chan_data->lock, flags);
+}
+
+/* The kernel thread that polls for completions on a channel. It sleeps while
+ * the channel is using interrupts, and has no transfers without callbacks. */
+static int axidma_poll_thread(void *data)
+{
+    struct axidma_chan_data *chan_data;
+    unsigned long interval;
+
+    chan_data = data;
+    while (!kthread_should_stop())
+    {
+        wait_event_interruptible(chan_data->poll_queue,
+                kthread_should_stop() || axidma_poll_needed(chan_data));
+        if (kthread_should_stop()) {
+            break;
+        }
+
+        axidma_poll_transfers(chan_data);
+        interval = READ_ONCE(chan_data->config.poll_interval_us);
+        usleep_range(interval, interval + interval / 4 + 1);
+    }
+
+    return 0;
+}
+
+/* Applies the CPU affinity and scheduling priority to the channel's completion
+ * thread. The caller must hold the channel's configuration lock. */
+static int axidma_config_poll_thread(struct axidma_chan_data *chan_data)
+{
+    int rc;
+    struct task_struct *thread;
+    struct axidma_completion_config *config;
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5,9,0)
+    struct sched_param param;
+#endif
+
+    thread = chan_data->poll_thread;
+    config = &chan_data->completion;
+
+    // Pin the thread to the CPU, or let it run anywhere
+    if (config->cpu >= 0) {
+        rc = set_cpus_allowed_ptr(thread, cpumask_of(config->cpu));
+    } else {
+        rc = set_cpus_allowed_ptr(thread, cpu_possible_mask);
+    }
+    if (rc < 0) {
+        axidma_err("Unable to set the CPU affinity of the completion "
+                   "thread.\n");
+        return rc;
+    }
+
+    /* Modules can no longer pick the real-time priority since the 5.9 kernel,
+     * so any non-zero priority uses the kernel's default SCHED_FIFO one. */
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5,9,0)
+    param.sched_priority = config->priority;
+    rc = sched_setscheduler_nocheck(thread, (config->priority > 0) ?
+                                    SCHED_FIFO : SCHED_NORMAL, &param);
+    if (rc < 0) {
+        axidma_err("Unable to set the priority of the completion thread.\n");
+        return rc;
+    }
+#else
+    if (config->priority > 0) {
+        sched_set_fifo(thread);
+    } else {
+        sched_set_normal(thread, 0);
+    }
+#endif
+
+    return 0;
+}
+
+/* Starts the thread that polls for completions on the channel, if it is not
+ * already running. The caller must hold the channel's configuration lock. */
+static int axidma_start_poll_thread(struct axidma_chan_data *chan_data)
+{
+    struct task_struct *thread;
+
+    if (chan_data->poll_thread != NULL) {
+        return 0;
+    }
+
+    thread = kthread_run(axidma_poll_thread, chan_data, "axidma_poll/%d",
+                         chan_data->chan->channel_id);
+    if (IS_ERR(thread)) {
+        axidma_err("Unable to create the polling thread for channel %d.\n",
+                   chan_data->chan->channel_id);
+        return PTR_ERR(thread);
+    }
+    chan_data->poll_thread = thread;
+
+    return axidma_config_poll_thread(chan_data);
+}
+
+// Setup the config structure for VDMA
+static void axidma_setup_vdma_config(struct xilinx_vdma_config *dma_config)
+{
+    memset(dma_config, 0, sizeof(*dma_config));
+    dma_config->frm_dly = 0;            // Number of frames to delay
+    dma_config->gen_lock = 0;           // Genlock, VDMA runs on fsyncs
+    dma_config->master = 0;             // VDMA is the genlock master
+    dma_config->frm_cnt_en = 1;         // Interrupt based on frame count
+    dma_config->park = 0;               // Continuously process all frames
+    dma_config->park_frm = 0;           // Frame to stop (park) at (N/A)
+    dma_config->coalesc = 1;            // Interrupt after one frame completion
+    dma_config->delay = 0;              // Disable the delay counter interrupt
+    dma_config->reset = 0;              // Don't reset the channel
+    dma_config->ext_fsync = 0;          // VDMA handles synchronizes itself
+    return;
+}
+
+// Configures a VDMA channel to continuously process the frames queued on it
+int axidma_config_vdma(struct axidma_chan *chan)
+{
+    int rc;
+    struct xilinx_vdma_config vdma_config;
+
+    axidma_setup_vdma_config(&vdma_config);
+    rc = xilinx_vdma_channel_set_config(chan->chan, &vdma_config);
+    if (rc < 0) {
+        axidma_err("Unable to set the config for channel.\n");
+    }
+    return rc;
+}
+
+/* Gives the V4L2 node of a VDMA channel exclusive use of it while streaming.
+ * Fails with -EBUSY if the character device has transfers or a capture ring
+ * on the channel, and those fail in turn until the channel is released. */
+int axidma_claim_vdma(struct axidma_device *dev, struct axidma_chan *chan)
+{
+    int i, rc;
+    unsigned long flags;
+    struct axidma_chan_data *chan_data;
+
+    chan_data = axidma_get_chan_data(dev, chan);
+    spin_lock_irqsave(&chan_data->lock, flags);
+    rc = (chan_data->v4l2_owned || chan_data->capture.running) ? -EBUSY : 0;
+    for (i = 0; i < AXIDMA_NUM_TRANSFER_SLOTS && rc == 0; i++)
+    {
+        if (chan_data->slots[i].state == AXIDMA_SLOT_QUEUED ||
+                chan_data->slots[i].state == AXIDMA_SLOT_PENDING) {
+            rc = -EBUSY;
+        }
+    }
+    chan_data->v4l2_owned = chan_data->v4l2_owned || rc == 0;
+    spin_unlock_irqrestore(&chan_data->lock, flags);
+
+    if (rc < 0) {
+        axidma_err("Channel %d is in use through the character device.\n",
+                   chan->channel_id);
+    }
+    return rc;
+}
+
+// Hands a VDMA channel claimed by its V4L2 node back to the character device
+void axidma_release_vdma(struct axidma_device *dev, struct axidma_chan *chan)
+{
+    unsigned long flags;
+    struct axidma_chan_data *chan_data;
+
+    chan_data = axidma_get_chan_data(dev, chan);
+    spin_lock_irqsave(&chan_data->lock, flags);
+    chan_data->v4l2_owned = false;
+    spin_unlock_irqrestore(&chan_data->lock, flags);
+}
+
+/* Prepares an interleaved descriptor that transfers a single frame to or from
+ * the frame buffer at the given DMA address on a VDMA channel. */
+struct dma_async_tx_descriptor *axidma_prep_frame(struct axidma_chan *chan,
+        dma_addr_t dma_addr, struct axidma_video_frame *frame,
+        unsigned long flags)
+{
+    struct dma_interleaved_template dma_template;
+
+    memset(&dma_template, 0, sizeof(dma_template));
+    dma_template.dst_start = dma_addr;
+    dma_template.src_start = dma_addr;
+    dma_template.dir = axidma_to_dma_dir(chan->dir);
+    dma_template.numf = frame->height;
+    dma_template.frame_size = 1;
+    dma_template.sgl[0].size = frame->width * frame->depth;
+    dma_template.sgl[0].icg = 0;
+    return dmaengine_prep_interleaved_dma(chan->chan, &dma_template, flags);
+}
+
+// Indicates if the rows of a copy are contiguous in both buffers
+static bool axidma_copy_contiguous(struct axidma_copy *copy)
+{
+    return copy->num_rows == 1 || (copy->src_stride == copy->len &&
+                                   copy->dst_stride == copy->len);
+}
+
+/* Prepares a memory-to-memory copy on a CDMA channel. Rows that are contiguous
+ * in both buffers are copied as a single block, otherwise the copy is prepared
+ * as an interleaved transfer. */
+static struct dma_async_tx_descriptor *axidma_prep_copy(
+        struct axidma_chan *chan, struct axidma_copy *copy,
+        unsigned long flags)
+{
+    struct {
+        struct dma_interleaved_template xt;
+        struct data_chunk chunk;
+    } copy_template;
+    struct dma_interleaved_template *xt;
+
+    if (axidma_copy_contiguous(copy)) {
+        return dmaengine_prep_dma_memcpy(chan->chan, copy->dst, copy->src,
+                                         copy->len * copy->num_rows, flags);
+    }
+
+    // The chunk follows the template, as its single entry of the gather list
+    memset(&copy_template, 0, sizeof(copy_template));
+    xt = &copy_template.xt;
+    xt->src_start = copy->src;
+    xt->dst_start = copy->dst;
+    xt->dir = DMA_MEM_TO_MEM;
+    xt->src_inc = true;
+    xt->dst_inc = true;
+    xt->src_sgl = true;
+    xt->dst_sgl = true;
+    xt->numf = copy->num_rows;
+    xt->frame_size = 1;
+    xt->sgl[0].size = copy->len;
+    xt->sgl[0].src_icg = copy->src_stride - copy->len;
+    xt->sgl[0].dst_icg = copy->dst_stride - copy->len;
+    return dmaengine_prep_interleaved_dma(chan->chan, xt, flags);
+}
+
+static int axidma_prep_transfer(struct axidma_chan *axidma_chan,
+                                struct axidma_transfer *dma_tfr)
+{
+    struct dma_chan *chan;
+    struct dma_device *dma_dev;
+    struct dma_async_tx_descriptor *dma_txnd;
+    struct completion *dma_comp;
+    struct axidma_cb_data *cb_data;
+    enum dma_transfer_direction dma_dir;
+    enum dma_ctrl_flags dma_flags;
+    struct scatterlist *sg_list;
+    int sg_len;
+    char *direction, *type;
+    int rc, i;
+
+    // Get the fields from the structures
+    chan = axidma_chan->chan;
+    dma_comp = &dma_tfr->comp;
+    dma_dir = axidma_to_dma_dir(dma_tfr->dir);
+    dma_dev = chan->device;
+    sg_list = dma_tfr->sg_list;
+    sg_len = dma_tfr->sg_len;
+    direction = axidma_dir_to_string(dma_tfr->dir);
+    type = axidma_type_to_string(dma_tfr->type);
+
+    // Check the metadata before anything is prepared that would need undoing
+    rc = axidma_check_metadata(axidma_chan, dma_tfr->metadata);
+    if (rc < 0) {
+        return rc;
+    }
+
+    // Claim a slot to track the transfer in
+    cb_data = axidma_get_slot(dma_tfr->chan_data);
+    if (IS_ERR(cb_data)) {
+        axidma_err("Channel %d is in use by its V4L2 video node.\n",
+                   dma_tfr->channel_id);
+        return PTR_ERR(cb_data);
+    } else if (cb_data == NULL) {
+        axidma_err("Too many %s %s transfers in-flight on channel %d.\n",
+                   type, direction, dma_tfr->channel_id);
+        return -EBUSY;
+    }
+    dma_tfr->cb_data = cb_data;
+    cb_data->len = 0;
+    for (i = 0; i < sg_len; i++)
+    {
+        cb_data->len += sg_dma_len(&sg_list[i]);
+    }
+    if (dma_tfr->type == AXIDMA_CDMA) {
+        cb_data->len = dma_tfr->copy.len * dma_tfr->copy.num_rows;
+    }
+
+    /* When the channel is polling for completions, the transfer is prepared
+     * without requesting an interrupt or a callback, and the polling thread
+     * retires it. The Xilinx DMA driver ignores the interrupt flag, so the
+     * engine still interrupts, and its tasklet still runs, for every transfer.
+     * Polling only moves the completion handling off of that path, it does
+     * not reduce the interrupt load. Transfers that receive metadata always
+     * use the callback, as the metadata can only be read from it. */
+    if (axidma_receives_metadata(axidma_chan)) {
+        cb_data->polled = false;
+    }
+    dma_flags = DMA_CTRL_ACK;
+    if (!cb_data->polled) {
+        dma_flags |= DMA_PREP_INTERRUPT;
+    }
+
+    /* For VDMA transfers, we configure the channel, then prepare an interlaved
+     * transfer. For DMA, we simply prepare a slave scatter-gather transfer, and
+     * for CDMA, a memory-to-memory copy. */
+    if (dma_tfr->type == AXIDMA_DMA) {
+        dma_txnd = dmaengine_prep_slave_sg(chan, sg_list, sg_len, dma_dir,
+                                           dma_flags);
+    } else if (dma_tfr->type == AXIDMA_CDMA) {
+        dma_txnd = axidma_prep_copy(axidma_chan, &dma_tfr->copy, dma_flags);
+    } else {
+        rc = axidma_config_vdma(axidma_chan);
+        if (rc < 0) {
+            goto put_slot;
+        }
+        dma_txnd = axidma_prep_frame(axidma_chan, sg_dma_address(&sg_list[0]),
+                                     &dma_tfr->frame, dma_flags);
+    }
+    if (dma_txnd == NULL) {
+        axidma_err("Unable to prepare the dma engine for the %s %s buffer.\n",
+                   type, direction);
+        rc = -EBUSY;
+        goto put_slot;
+    }
+
+    /* The descriptor cannot be released once it is prepared, so a failure to
+     * attach the metadata, which was checked beforehand, is only reported. */
+    if (axidma_attach_metadata(axidma_chan, cb_data, dma_txnd,
+                               dma_tfr->metadata) < 0) {
+        axidma_err("Unable to attach the metadata to the %s %s buffer.\n",
+                   type, direction);
+    }
+
+    /* If we're going to wait for this channel, initialize the completion for
+     * the channel, and setup the callback to complete it. */
+    cb_data->channel_id = dma_tfr->channel_id;
+    if (dma_tfr->wait) {
+        cb_data->comp = dma_comp;
+        cb_data->notify_signal = -1;
+        cb_data->process = NULL;
+        init_completion(cb_data->comp);
+    } else {
+        cb_data->comp = NULL;
+        cb_data->notify_signal = dma_tfr->notify_signal;
+        cb_data->process = dma_tfr->process;
+    }
+    dma_txnd->callback_param = cb_data;
+    axidma_set_callback(dma_txnd, !cb_data->polled);
+
+    /* The descriptor is kept until the scheduler issues it to the engine, so
+     * the submission time is when the transfer was queued in the driver. */
+    cb_data->timestamps.submit_ns = ktime_get_ns();
+    cb_data->desc = dma_txnd;
+
+    // Return the driver's cookie for the transaction
+    dma_tfr->cookie = cb_data->cookie;
+    return 0;
+
+put_slot:
+    axidma_put_slot(cb_data);
+    return rc;
+}
+
+// Counts a blocking transfer on the channel that timed out
+static void axidma_count_timeout(struct axidma_chan_data *chan_data)
+{
+    unsigned long flags;
+
+    spin_lock_irqsave(&chan_data->lock, flags);
+    chan_data->stats.timeouts += 1;
+    spin_unlock_irqrestore(&chan_data->lock, flags);
+}
+
+// Queues a prepared transfer on the channel, issuing it if the policy allows
+static int axidma_queue_transfer(struct axidma_transfer *dma_tfr)
+{
+    struct axidma_chan_data *chan_data;
+    struct axidma_cb_data *cb_data;
+    struct axidma_submitter *submitter;
+    unsigned long flags;
+    bool queued;
+
+    /* Queue the transfer behind the calling process's other transfers, and
+     * issue whatever the channel's policy and limits allow. If the channel was
+     * stopped since the transfer was prepared, it has already been aborted. */
+    chan_data = dma_tfr->chan_data;
+    cb_data = dma_tfr->cb_data;
+    spin_lock_irqsave(&chan_data->lock, flags);
+    queued = (cb_data->state == AXIDMA_SLOT_QUEUED);
+    if (queued) {
+        submitter = axidma_get_submitter(chan_data, task_tgid_nr(current));
+        list_add_tail(&cb_data->node, &submitter->queue);
+        axidma_dispatch(chan_data);
+    }
+    spin_unlock_irqrestore(&chan_data->lock, flags);
+
+    if (!queued) {
+        axidma_err("%s %s transaction was stopped before it started.\n",
+                   axidma_type_to_string(dma_tfr->type),
+                   axidma_dir_to_string(dma_tfr->dir));
+        return -ECANCELED;
+    }
+    return 0;
+}
+
+/* Leaves a blocking transfer to finish on its own, as its caller is no longer
+ * waiting. The completion is on the caller's stack, so it must not be used. */
+static void axidma_detach_transfer(struct axidma_transfer *dma_tfr)
+{
+    unsigned long flags;
+    struct axidma_chan_data *chan_data;
+
+    chan_data = dma_tfr->chan_data;
+    spin_lock_irqsave(&chan_data->lock, flags);
+    if (dma_tfr->cb_data->cookie == dma_tfr->cookie) {
+        dma_tfr->cb_data->comp = NULL;
+    }
+    spin_unlock_irqrestore(&chan_data->lock, flags);
+}
+
+/* Waits for a blocking transfer to finish, returning its final slot state, or
+ * AXIDMA_SLOT_PENDING if it timed out on the engine. The timeout only starts
+ * once the transfer is issued, as under the priority and fair policies it can
+ * wait behind other processes' transfers for much longer. Returns -EINTR if
+ * the caller is killed, leaving the transfer to finish on its own. */
+static int axidma_wait_transfer(struct axidma_transfer *dma_tfr)
+{
+    long rc;
+    unsigned long flags;
+    u64 timeout_ns, wait_ns, elapsed_ns, issue_ns;
+    enum axidma_slot_state state;
+    struct axidma_chan_data *chan_data;
+    struct axidma_cb_data *cb_data;
+
+    chan_data = dma_tfr->chan_data;
+    cb_data = dma_tfr->cb_data;
+    timeout_ns = (u64)AXIDMA_DMA_TIMEOUT * NSEC_PER_MSEC;
+    wait_ns = timeout_ns;
+    while (true)
+    {
+        rc = wait_for_completion_killable_timeout(&dma_tfr->comp,
+                                                  nsecs_to_jiffies(wait_ns));
+        if (rc < 0) {
+            axidma_detach_transfer(dma_tfr);
+            return -EINTR;
+        }
+
+        // A slot that was reused finished long ago, and was not waited for
+        spin_lock_irqsave(&chan_data->lock, flags);
+        state = (cb_data->cookie == dma_tfr->cookie) ? cb_data->state :
+                AXIDMA_SLOT_ABORTED;
+        issue_ns = cb_data->timestamps.issue_ns;
+        spin_unlock_irqrestore(&chan_data->lock, flags);
+
+        // Keep waiting while the transfer is queued, or has time left
+        elapsed_ns = ktime_get_ns() - issue_ns;
+        if (state == AXIDMA_SLOT_QUEUED) {
+            wait_ns = timeout_ns;
+        } else if (state == AXIDMA_SLOT_PENDING && rc == 0 &&
+                   elapsed_ns < timeout_ns) {
+            wait_ns = timeout_ns - elapsed_ns;
+        } else if (state != AXIDMA_SLOT_PENDING || rc == 0) {
+            return state;
+        }
+    }
+}
+
+/* Waits for a queued transfer, if it is blocking, and reports back its
+ * timestamps and metadata. */
+static int axidma_finish_transfer(struct axidma_device *dev,
+                                  struct axidma_chan *chan,
+                                  struct axidma_transfer *dma_tfr)
+{
+    char *direction, *type;
+    int rc;
+
+    direction = axidma_dir_to_string(dma_tfr->dir);
+    type = axidma_type_to_string(dma_tfr->type);
+
+    /* Wait for the transfer to complete. Only a transfer stuck on the engine
+     * stops the channel, a failed one was already aborted by whoever stopped
+     * it, and the other processes' transfers are left alone. */
+    if (dma_tfr->wait) {
+        rc = axidma_wait_transfer(dma_tfr);
+        if (rc == AXIDMA_SLOT_PENDING) {
+            axidma_err("%s %s transaction timed out.\n", type, direction);
+            axidma_count_timeout(dma_tfr->chan_data);
+            axidma_terminate_transfers(dev, chan, true);
+            return -ETIME;
+        } else if (rc == -EINTR) {
+            return rc;
+        } else if (rc != AXIDMA_SLOT_DONE) {
+            axidma_err("%s %s transaction did not succceed.\n", type,
+                       direction);
+            return -EBUSY;
+        }
+    }
+
+    // Report back the timestamps, and any metadata received, for the transfer
+    axidma_read_completion(dma_tfr->cb_data, dma_tfr->cookie,
+            &dma_tfr->timestamps,
+            (dma_tfr->dir == AXIDMA_READ) ? dma_tfr->metadata : NULL);
+    return 0;
+}
+
+static int axidma_start_transfer(struct axidma_device *dev,
+                                 struct axidma_chan *chan,
+                                 struct axidma_transfer *dma_tfr)
+{
+    int rc;
+
+    rc = axidma_queue_transfer(dma_tfr);
+    if (rc < 0) {
+        return rc;
+    }
+    return axidma_finish_transfer(dev, chan, dma_tfr);
+}
+
+/*----------------------------------------------------------------------------
+ * DMA Operations (Public Interface)
+ *----------------------------------------------------------------------------*/
+
+void axidma_get_num_channels(struct axidma_device *dev,
+                             struct axidma_num_channels *num_chans)
+{
+    num_chans->num_channels = dev->num_chans;
+    num_chans->num_dma_tx_channels = dev->num_dma_tx_chans;
+    num_chans->num_dma_rx_channels = dev->num_dma_rx_chans;
+    num_chans->num_vdma_tx_channels = dev->num_vdma_tx_chans;
+    num_chans->num_vdma_rx_channels = dev->num_vdma_rx_chans;
+    num_chans->num_cdma_channels = dev->num_cdma_chans;
+    return;
+}
+
+void axidma_get_channel_info(struct axidma_device *dev,
+                             struct axidma_channel_info *chan_info)
+{
+    chan_info->channels = dev->channels;
+    return;
+}
+
+int axidma_set_signal(struct axidma_device *dev, int signal)
+{
+    // Verify the signal is a real-time one
+    if (!VALID_NOTIFY_SIGNAL(signal & ~AXIDMA_SIGNAL_WITH_COOKIE)) {
+        axidma_err("Invalid signal %d requested for DMA notification.\n",
+                   signal & ~AXIDMA_SIGNAL_WITH_COOKIE);
+        axidma_err("You must specify one of the POSIX real-time signals.\n");
+        return -EINVAL;
+    }
+
+    dev->notify_signal = signal;
+    return 0;
+}
+
+int axidma_read_transfer(struct axidma_device *dev,
+                         struct axidma_transaction *trans)
+{
+    int rc;
+    struct axidma_chan *rx_chan;
+    struct scatterlist sg_list;
+    struct axidma_transfer rx_tfr;
+
+    // Get the channel with the given channel id
+    rx_chan = axidma_get_chan(dev, trans->channel_id);
+    if (rx_chan == NULL || rx_chan->dir != AXIDMA_READ) {
+        axidma_err("Invalid device id %d for DMA receive channel.\n",
+                   trans->channel_id);
+        return -ENODEV;
+    }
+
+    // Setup the scatter-gather list for the transfer (only one entry)
+    sg_init_table(&sg_list, 1);
+    rc = axidma_init_sg_entry(dev, &sg_list, 0, trans->buf,
+                              trans->buf_len);
+    if (rc < 0) {
+        return rc;
+    }
+
+    // Setup receive transfer structure for DMA
+    rx_tfr.sg_list = &sg_list;
+    rx_tfr.sg_len = 1;
+    rx_tfr.dir = rx_chan->dir;
+    rx_tfr.type = rx_chan->type;
+    rx_tfr.wait = trans->wait;
+    rx_tfr.channel_id = trans->channel_id;
+    rx_tfr.notify_signal = dev->notify_signal;
+    rx_tfr.process = get_current();
+    rx_tfr.metadata = &trans->metadata;
+    rx_tfr.chan_data = axidma_get_chan_data(dev, rx_chan);
+
+    // Prepare the receive transfer
+    rc = axidma_prep_transfer(rx_chan, &rx_tfr);
+    if (rc < 0) {
+        return rc;
+    }
+
+    // Submit the receive transfer, and wait for it to complete
+    rc = axidma_start_transfer(dev, rx_chan, &rx_tfr);
+    if (rc < 0) {
+        return rc;
+    }
+
+    trans->cookie = rx_tfr.cookie;
+    trans->timestamps = rx_tfr.timestamps;
+    return 0;
+}
+
+int axidma_write_transfer(struct axidma_device *dev,
+                          struct axidma_transaction *trans)
+{
+    int rc;
+    struct axidma_chan *tx_chan;
+    struct scatterlist sg_list;
+    struct axidma_transfer tx_tfr;
+
+    // Get the channel with the given id
+    tx_chan = axidma_get_chan(dev, trans->channel_id);
+    if (tx_chan == NULL || tx_chan->dir != AXIDMA_WRITE ||
+            tx_chan->type == AXIDMA_CDMA) {
+        axidma_err("Invalid device id %d for DMA transmit channel.\n",
+                   trans->channel_id);
+        return -ENODEV;
+    }
+
+    // Setup the scatter-gather list for the transfer (only one entry)
+    sg_init_table(&sg_list, 1);
+    rc = axidma_init_sg_entry(dev, &sg_list, 0, trans->buf,
+                              trans->buf_len);
+    if (rc < 0) {
+        return rc;
+    }
+
+    // Setup transmit transfer structure for DMA
+    tx_tfr.sg_list = &sg_list;
+    tx_tfr.sg_len = 1;
+    tx_tfr.dir = tx_chan->dir;
+    tx_tfr.type = tx_chan->type;
+    tx_tfr.wait = trans->wait;
+    tx_tfr.channel_id = trans->channel_id;
+    tx_tfr.notify_signal = dev->notify_signal;
+    tx_tfr.process = get_current();
+    tx_tfr.metadata = &trans->metadata;
+    tx_tfr.chan_data = axidma_get_chan_data(dev, tx_chan);
+
+    // Prepare the transmit transfer
+    rc = axidma_prep_transfer(tx_chan, &tx_tfr);
+    if (rc < 0) {
+        return rc;
+    }
+
+    // Submit the transmit transfer, and wait for it to complete
+    rc = axidma_start_transfer(dev, tx_chan, &tx_tfr);
+    if (rc < 0) {
+        return rc;
+    }
+
+    trans->cookie = tx_tfr.cookie;
+    trans->timestamps = tx_tfr.timestamps;
+    return 0;
+}
+
+/* Transfers data from the given source buffer out to the AXI DMA device, and
+ * places the data received into the receive buffer. */
+int axidma_rw_transfer(struct axidma_device *dev,
+                       struct axidma_inout_transaction *trans)
+{
+    int rc;
+    struct axidma_chan *tx_chan, *rx_chan;
+    struct scatterlist tx_sg_list, rx_sg_list;
     struct axidma_transfer tx_tfr, rx_tfr;
 
-    // Get the transmit and receive channels with the given ids.
-    tx_chan = axidma_get_chan(dev, trans->tx_channel_id);
-    if (tx_chan == NULL || tx_chan->dir != AXIDMA_WRITE) {
-        axidma_err("Invalid device id %d for DMA transmit channel.\n",
-                   trans->tx_channel_id);
+    // Get the transmit and receive channels with the given ids.
+    tx_chan = axidma_get_chan(dev, trans->tx_channel_id);
+    if (tx_chan == NULL || tx_chan->dir != AXIDMA_WRITE ||
+            tx_chan->type == AXIDMA_CDMA) {
+        axidma_err("Invalid device id %d for DMA transmit channel.\n",
+                   trans->tx_channel_id);
+        return -ENODEV;
+    }
+
+    rx_chan = axidma_get_chan(dev, trans->rx_channel_id);
+    if (rx_chan == NULL || rx_chan->dir != AXIDMA_READ) {
+        axidma_err("Invalid device id %d for DMA receive channel.\n",
+                   trans->rx_channel_id);
+        return -ENODEV;
+    }
+
+    // Setup the scatter-gather list for the transfers (only one entry)
+    sg_init_table(&tx_sg_list, 1);
+    rc = axidma_init_sg_entry(dev, &tx_sg_list, 0, trans->tx_buf,
+                              trans->tx_buf_len);
+    if (rc < 0) {
+        return rc;
+    }
+    sg_init_table(&rx_sg_list, 1);
+    rc = axidma_init_sg_entry(dev, &rx_sg_list, 0, trans->rx_buf,
+                              trans->rx_buf_len);
+    if (rc < 0) {
+        return rc;
+    }
+
+    // Setup receive and trasmit transfer structures for DMA
+    tx_tfr.sg_list = &tx_sg_list,
+    tx_tfr.sg_len = 1,
+    tx_tfr.dir = tx_chan->dir,
+    tx_tfr.type = tx_chan->type,
+    tx_tfr.wait = false,
+    tx_tfr.channel_id = trans->tx_channel_id,
+    tx_tfr.notify_signal = dev->notify_signal,
+    tx_tfr.process = get_current(),
+    tx_tfr.metadata = NULL,
+    tx_tfr.chan_data = axidma_get_chan_data(dev, tx_chan);
+
+    // Add in the frame information for VDMA transfers
+    if (tx_chan->type == AXIDMA_VDMA) {
+        memcpy(&tx_tfr.frame, &trans->tx_frame, sizeof(tx_tfr.frame));
+    }
+
+    rx_tfr.sg_list = &rx_sg_list,
+    rx_tfr.sg_len = 1,
+    rx_tfr.dir = rx_chan->dir,
+    rx_tfr.type = rx_chan->type,
+    rx_tfr.wait = trans->wait,
+    rx_tfr.channel_id = trans->rx_channel_id,
+    rx_tfr.notify_signal = dev->notify_signal,
+    rx_tfr.process = get_current(),
+    rx_tfr.metadata = NULL,
+    rx_tfr.chan_data = axidma_get_chan_data(dev, rx_chan);
+
+    // Add in the frame information for VDMA transfers
+    if (tx_chan->type == AXIDMA_VDMA) {
+        memcpy(&rx_tfr.frame, &trans->rx_frame, sizeof(rx_tfr.frame));
+    }
+
+    /* Queue the receive transfer before the transmit transfer is prepared, so
+     * the device always has somewhere to put its output. A prepared descriptor
+     * can't be handed back to the engine without it being sent, so the
+     * transmit transfer is only prepared once nothing else can fail. */
+    rc = axidma_prep_transfer(rx_chan, &rx_tfr);
+    if (rc < 0) {
+        return rc;
+    }
+    rc = axidma_queue_transfer(&rx_tfr);
+    if (rc < 0) {
+        return rc;
+    }
+
+    /* If the transmit transfer can't be started, the receive transfer is left
+     * posted, and finishes on its own. */
+    rc = axidma_prep_transfer(tx_chan, &tx_tfr);
+    if (rc < 0) {
+        axidma_detach_transfer(&rx_tfr);
+        return rc;
+    }
+    rc = axidma_start_transfer(dev, tx_chan, &tx_tfr);
+    if (rc < 0) {
+        axidma_detach_transfer(&rx_tfr);
+        return rc;
+    }
+
+    // Wait on the receive transfer, which was already queued
+    rc = axidma_finish_transfer(dev, rx_chan, &rx_tfr);
+    if (rc < 0) {
+        return rc;
+    }
+
+    trans->tx_cookie = tx_tfr.cookie;
+    trans->rx_cookie = rx_tfr.cookie;
+    trans->tx_timestamps = tx_tfr.timestamps;
+    trans->rx_timestamps = rx_tfr.timestamps;
+    return 0;
+}
+
+int axidma_video_transfer(struct axidma_device *dev,
+                          struct axidma_video_transaction *trans,
+                          enum axidma_dir dir)
+{
+    int rc, i;
+    size_t image_size;
+    struct axidma_chan *chan;
+
+    // Setup transmit transfer structure for DMA
+    struct axidma_transfer transfer = {
+        .sg_len = trans->num_frame_buffers,
+        .dir = dir,
+        .type = AXIDMA_VDMA,
+        .wait = false,
+        .channel_id = trans->channel_id,
+        .notify_signal = dev->notify_signal,
+        .process = get_current(),
+        .frame = trans->frame,
+    };
+
+    // Get the channel with the given id
+    chan = axidma_get_chan(dev, trans->channel_id);
+    if (chan == NULL || chan->dir != dir || chan->type != AXIDMA_VDMA) {
+        axidma_err("Invalid device id %d for VDMA %s channel.\n",
+                   trans->channel_id, axidma_dir_to_string(dir));
+        return -ENODEV;
+    } else if (transfer.sg_len <= 0 ||
+               transfer.sg_len > AXIDMA_MAX_FRAME_BUFFERS) {
+        axidma_err("Invalid number of frame buffers %d.\n", transfer.sg_len);
+        return -EINVAL;
+    }
+    transfer.chan_data = axidma_get_chan_data(dev, chan);
+
+    /* Use the channel's scatter-gather list, which is only needed until the
+     * transfer is prepared, as the descriptor holds the addresses. */
+    mutex_lock(&transfer.chan_data->video_lock);
+    transfer.sg_list = transfer.chan_data->video_sg;
+    sg_init_table(transfer.sg_list, transfer.sg_len);
+
+    // For each frame, setup a scatter-gather entry
+    image_size = trans->frame.width * trans->frame.height * trans->frame.depth;
+    for (i = 0; i < transfer.sg_len; i++)
+    {
+        rc = axidma_init_sg_entry(dev, transfer.sg_list, i,
+                                  trans->frame_buffers[i], image_size);
+        if (rc < 0) {
+            goto unlock;
+        }
+    }
+
+    // Prepare the transmit transfer
+    rc = axidma_prep_transfer(chan, &transfer);
+    if (rc < 0) {
+        goto unlock;
+    }
+
+    // Submit the transfer, and immediately return
+    rc = axidma_start_transfer(dev, chan, &transfer);
+
+unlock:
+    mutex_unlock(&transfer.chan_data->video_lock);
+    return rc;
+}
+
+/* Copies data between two buffers in memory with a CDMA channel, as a number of
+ * rows of the same length. */
+int axidma_memcpy_transfer(struct axidma_device *dev,
+                           struct axidma_memcpy_transaction *trans)
+{
+    int rc;
+    size_t dst_span, src_span;
+    struct axidma_chan *chan;
+    struct axidma_transfer copy_tfr;
+
+    // Get the channel with the given id
+    chan = axidma_get_chan(dev, trans->channel_id);
+    if (chan == NULL || chan->type != AXIDMA_CDMA) {
+        axidma_err("Invalid device id %d for CDMA channel.\n",
+                   trans->channel_id);
+        return -ENODEV;
+    }
+
+    // Check the shape of the copy, and find the extent of each buffer
+    if (trans->len == 0 || trans->num_rows < 1) {
+        axidma_err("Invalid copy of %d rows of %zu bytes.\n",
+                   trans->num_rows, trans->len);
+        return -EINVAL;
+    } else if (trans->num_rows > 1 && (trans->dst_stride < trans->len ||
+                                       trans->src_stride < trans->len)) {
+        axidma_err("The strides of a copy must be at least the row length.\n");
+        return -EINVAL;
+    } else if (trans->num_rows > AXIDMA_MAX_COPY_ROWS ||
+               (trans->num_rows > 1 &&
+                (trans->dst_stride > AXIDMA_MAX_COPY_STRIDE ||
+                 trans->src_stride > AXIDMA_MAX_COPY_STRIDE))) {
+        axidma_err("A copy can have at most %d rows, %d bytes apart.\n",
+                   AXIDMA_MAX_COPY_ROWS, AXIDMA_MAX_COPY_STRIDE);
+        return -EINVAL;
+    }
+
+    /* The spans are checked against the buffers, so they must not wrap, or
+     * the engine could be pointed outside of them by the strides. */
+    dst_span = 0;
+    src_span = 0;
+    if (trans->num_rows > 1 &&
+            (check_mul_overflow((size_t)(trans->num_rows - 1),
+                                trans->dst_stride, &dst_span) ||
+             check_mul_overflow((size_t)(trans->num_rows - 1),
+                                trans->src_stride, &src_span))) {
+        rc = -EOVERFLOW;
+    } else if (check_add_overflow(dst_span, trans->len, &dst_span) ||
+               check_add_overflow(src_span, trans->len, &src_span)) {
+        rc = -EOVERFLOW;
+    } else {
+        rc = 0;
+    }
+    if (rc < 0) {
+        axidma_err("Copy of %d rows of %zu bytes is too large.\n",
+                   trans->num_rows, trans->len);
+        return rc;
+    }
+
+    // Both buffers must be DMA buffers, from the driver or registered
+    copy_tfr.copy.dst = axidma_uservirt_to_dma(dev, trans->dst, dst_span);
+    copy_tfr.copy.src = axidma_uservirt_to_dma(dev, trans->src, src_span);
+    if (copy_tfr.copy.dst == (dma_addr_t)NULL ||
+            copy_tfr.copy.src == (dma_addr_t)NULL) {
+        axidma_err("Requested copy from %p to %p does not fall within "
+                   "previously allocated DMA buffers.\n", trans->src,
+                   trans->dst);
+        return -EFAULT;
+    }
+    copy_tfr.copy.len = trans->len;
+    copy_tfr.copy.num_rows = trans->num_rows;
+    copy_tfr.copy.dst_stride = trans->dst_stride;
+    copy_tfr.copy.src_stride = trans->src_stride;
+
+    // Separate rows can only be copied if the engine supports interleaving
+    if (!axidma_copy_contiguous(&copy_tfr.copy) &&
+            !dma_has_cap(DMA_INTERLEAVE, chan->chan->device->cap_mask)) {
+        axidma_err("CDMA channel %d does not support copies of several "
+                   "rows.\n", chan->channel_id);
+        return -EOPNOTSUPP;
+    }
+
+    // Setup the copy transfer structure, which has no scatter-gather list
+    copy_tfr.sg_list = NULL;
+    copy_tfr.sg_len = 0;
+    copy_tfr.dir = chan->dir;
+    copy_tfr.type = chan->type;
+    copy_tfr.wait = trans->wait;
+    copy_tfr.channel_id = trans->channel_id;
+    copy_tfr.notify_signal = dev->notify_signal;
+    copy_tfr.process = get_current();
+    copy_tfr.metadata = NULL;
+    copy_tfr.chan_data = axidma_get_chan_data(dev, chan);
+
+    // Prepare the copy, then submit it and wait for it to complete
+    rc = axidma_prep_transfer(chan, &copy_tfr);
+    if (rc < 0) {
+        return rc;
+    }
+    rc = axidma_start_transfer(dev, chan, &copy_tfr);
+    if (rc < 0) {
+        return rc;
+    }
+
+    trans->cookie = copy_tfr.cookie;
+    trans->timestamps = copy_tfr.timestamps;
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Video Capture Ring
+ *----------------------------------------------------------------------------*/
+
+static void axidma_capture_callback(void *data);
+
+/* Picks the buffer to capture the next frame into. A free buffer is used
+ * first, and otherwise the oldest frame that no consumer holds. The newest
+ * frame is always kept, so there is a frame for consumers to acquire. The
+ * caller must hold the channel's lock. */
+static struct axidma_capture_buffer *axidma_capture_pick(
+        struct axidma_capture *capture)
+{
+    int i;
+    struct axidma_capture_buffer *buf, *oldest;
+
+    oldest = NULL;
+    for (i = 0; i < capture->num_frames; i++)
+    {
+        buf = &capture->buffers[i];
+        if (buf->state == AXIDMA_FRAME_FREE) {
+            return buf;
+        } else if (buf->state == AXIDMA_FRAME_READY && buf->refcount == 0 &&
+                   buf->sequence != capture->last_sequence &&
+                   (oldest == NULL || buf->sequence < oldest->sequence)) {
+            oldest = buf;
+        }
+    }
+
+    return oldest;
+}
+
+/* Queues a frame buffer in the VDMA to capture the next frame into. The caller
+ * must hold the channel's lock. */
+static int axidma_capture_fill(struct axidma_chan_data *chan_data,
+                               struct axidma_capture_buffer *buf)
+{
+    struct dma_async_tx_descriptor *dma_txnd;
+    struct axidma_capture *capture;
+    dma_cookie_t dma_cookie;
+
+    capture = &chan_data->capture;
+    dma_txnd = axidma_prep_frame(chan_data->chan, buf->dma_addr,
+            &capture->frame, DMA_CTRL_ACK | DMA_PREP_INTERRUPT);
+    if (dma_txnd == NULL) {
+        axidma_err("Unable to prepare a capture frame on channel %d.\n",
+                   chan_data->chan->channel_id);
+        return -EBUSY;
+    }
+
+    dma_txnd->callback = axidma_capture_callback;
+    dma_txnd->callback_param = buf;
+    dma_cookie = dmaengine_submit(dma_txnd);
+    if (dma_submit_error(dma_cookie)) {
+        axidma_err("Unable to submit a capture frame on channel %d.\n",
+                   chan_data->chan->channel_id);
+        return -EBUSY;
+    }
+
+    // A frame that is overwritten before anyone acquired it was never read
+    if (buf->state == AXIDMA_FRAME_READY && !buf->acquired) {
+        capture->unread += 1;
+    }
+    buf->state = AXIDMA_FRAME_FILLING;
+    capture->num_filling += 1;
+    return 0;
+}
+
+/* Keeps the VDMA queued with buffers to capture into, as long as there are
+ * buffers that no consumer holds. The caller must hold the channel's lock. */
+static void axidma_capture_refill(struct axidma_chan_data *chan_data)
+{
+    bool queued;
+    struct axidma_capture *capture;
+    struct axidma_capture_buffer *buf;
+
+    capture = &chan_data->capture;
+    queued = false;
+    while (capture->running && capture->num_filling < AXIDMA_CAPTURE_DEPTH)
+    {
+        buf = axidma_capture_pick(capture);
+        if (buf == NULL || axidma_capture_fill(chan_data, buf) < 0) {
+            break;
+        }
+        queued = true;
+    }
+
+    // Count each time the hardware runs out of buffers to capture into
+    if (capture->running && capture->num_filling == 0 && !capture->stalled) {
+        capture->stalls += 1;
+    }
+    capture->stalled = (capture->num_filling == 0);
+
+    if (queued) {
+        dma_async_issue_pending(chan_data->chan->chan);
+    }
+}
+
+// Publishes a captured frame to the consumers, and queues the next buffer
+static void axidma_capture_callback(void *data)
+{
+    unsigned long flags;
+    struct axidma_chan_data *chan_data;
+    struct axidma_capture_buffer *buf;
+
+    buf = data;
+    chan_data = buf->chan_data;
+    spin_lock_irqsave(&chan_data->lock, flags);
+    if (buf->state == AXIDMA_FRAME_FILLING) {
+        chan_data->capture.last_sequence += 1;
+        buf->sequence = chan_data->capture.last_sequence;
+        buf->timestamp_ns = ktime_get_ns();
+        buf->acquired = false;
+        buf->state = AXIDMA_FRAME_READY;
+        chan_data->capture.num_filling -= 1;
+        axidma_capture_refill(chan_data);
+    }
+    spin_unlock_irqrestore(&chan_data->lock, flags);
+
+    wake_up_interruptible(chan_data->capture.wait_queue);
+}
+
+/* Starts capturing into a ring of frame buffers on a VDMA receive channel,
+ * which runs until the channel is stopped. */
+int axidma_start_capture(struct axidma_device *dev,
+                         struct axidma_video_transaction *trans)
+{
+    int rc, i;
+    size_t image_size;
+    unsigned long flags;
+    dma_addr_t dma_addr;
+    struct axidma_chan *chan;
+    struct axidma_chan_data *chan_data;
+    struct axidma_capture *capture;
+
+    // Validate the channel and the frame buffers
+    chan = axidma_get_chan(dev, trans->channel_id);
+    if (chan == NULL || chan->dir != AXIDMA_READ || chan->type != AXIDMA_VDMA) {
+        axidma_err("Invalid device id %d for VDMA receive channel.\n",
+                   trans->channel_id);
+        return -ENODEV;
+    } else if (trans->num_frame_buffers < 2 ||
+               trans->num_frame_buffers > AXIDMA_MAX_FRAME_BUFFERS) {
+        axidma_err("A capture ring needs between 2 and %d frame buffers.\n",
+                   AXIDMA_MAX_FRAME_BUFFERS);
+        return -EINVAL;
+    }
+    chan_data = axidma_get_chan_data(dev, chan);
+    capture = &chan_data->capture;
+
+    // Don't touch the channel's configuration while V4L2 is streaming on it
+    if (READ_ONCE(chan_data->v4l2_owned)) {
+        axidma_err("Channel %d is in use by its V4L2 video node.\n",
+                   trans->channel_id);
+        return -EBUSY;
+    }
+    rc = axidma_config_vdma(chan);
+    if (rc < 0) {
+        return rc;
+    }
+
+    // Reset the ring, and start capturing into it
+    image_size = trans->frame.width * trans->frame.height * trans->frame.depth;
+    spin_lock_irqsave(&chan_data->lock, flags);
+    if (chan_data->v4l2_owned) {
+        axidma_err("Channel %d is in use by its V4L2 video node.\n",
+                   trans->channel_id);
+        rc = -EBUSY;
+        goto unlock;
+    } else if (capture->running) {
+        axidma_err("A capture is already running on channel %d.\n",
+                   trans->channel_id);
+        rc = -EBUSY;
+        goto unlock;
+    }
+    memset(capture->buffers, 0, sizeof(capture->buffers));
+    for (i = 0; i < trans->num_frame_buffers; i++)
+    {
+        dma_addr = axidma_uservirt_to_dma(dev, trans->frame_buffers[i],
+                                          image_size);
+        if (dma_addr == (dma_addr_t)NULL) {
+            axidma_err("Frame buffer %p is not a DMA buffer of size %zu.\n",
+                       trans->frame_buffers[i], image_size);
+            rc = -EFAULT;
+            goto unlock;
+        }
+        capture->buffers[i].chan_data = chan_data;
+        capture->buffers[i].dma_addr = dma_addr;
+        capture->buffers[i].state = AXIDMA_FRAME_FREE;
+    }
+    capture->num_frames = trans->num_frame_buffers;
+    capture->num_filling = 0;
+    capture->generation += 1;
+    capture->frame = trans->frame;
+    capture->last_sequence = 0;
+    capture->unread = 0;
+    capture->stalls = 0;
+    capture->stalled = false;
+    capture->running = true;
+    axidma_capture_refill(chan_data);
+    rc = 0;
+
+unlock:
+    spin_unlock_irqrestore(&chan_data->lock, flags);
+    return rc;
+}
+
+/* Acquires the requested frame, if one is available, returning -EAGAIN if
+ * not. Fails if the capture is not running. */
+/* Gets the frames of the current capture that a file holds. References to an
+ * earlier capture's frames were dropped when the ring was reset. The caller
+ * must hold the channel's lock. */
+static u32 *axidma_capture_held(struct axidma_capture *capture,
+                                struct axidma_frame_refs *refs)
+{
+    if (refs->generation != capture->generation) {
+        refs->generation = capture->generation;
+        refs->held = 0;
+    }
+    return &refs->held;
+}
+
+static int axidma_capture_try_acquire(struct axidma_chan_data *chan_data,
+                                      struct axidma_frame_refs *refs,
+                                      struct axidma_capture_frame *req)
+{
+    u32 *held;
+    int i, rc;
+    unsigned long flags;
+    struct axidma_capture *capture;
+    struct axidma_capture_buffer *buf, *best;
+
+    capture = &chan_data->capture;
+    spin_lock_irqsave(&chan_data->lock, flags);
+    if (!capture->running) {
+        rc = -EPIPE;
+        goto unlock;
+    }
+
+    /* Find the newest or oldest frame after the last one the consumer saw,
+     * that the file does not already hold. */
+    held = axidma_capture_held(capture, refs);
+    best = NULL;
+    for (i = 0; i < capture->num_frames; i++)
+    {
+        buf = &capture->buffers[i];
+        if (buf->state != AXIDMA_FRAME_READY ||
+                buf->sequence <= req->after_sequence || (*held & BIT(i))) {
+            continue;
+        } else if (best == NULL || (req->latest ?
+                   buf->sequence > best->sequence :
+                   buf->sequence < best->sequence)) {
+            best = buf;
+        }
+    }
+    if (best == NULL) {
+        rc = -EAGAIN;
+        goto unlock;
+    }
+
+    best->refcount += 1;
+    best->acquired = true;
+    req->index = best - capture->buffers;
+    *held |= BIT(req->index);
+    req->sequence = best->sequence;
+    req->timestamp_ns = best->timestamp_ns;
+    req->unread = capture->unread;
+    req->stalls = capture->stalls;
+    rc = 0;
+
+unlock:
+    spin_unlock_irqrestore(&chan_data->lock, flags);
+    return rc;
+}
+
+// Acquires a reference to a captured frame, waiting until one is available
+int axidma_acquire_frame(struct axidma_device *dev,
+                         struct axidma_frame_refs *frame_refs,
+                         struct axidma_capture_frame *req)
+{
+    int rc;
+    long wait_rc;
+    struct axidma_chan *chan;
+    struct axidma_chan_data *chan_data;
+
+    chan = axidma_get_chan(dev, req->channel_id);
+    if (chan == NULL) {
+        axidma_err("Invalid channel id %d for acquiring a frame.\n",
+                   req->channel_id);
         return -ENODEV;
     }
+    chan_data = axidma_get_chan_data(dev, chan);
+    frame_refs = &frame_refs[chan - dev->channels];
+    rc = -EAGAIN;
+
+    // Sleep until a frame is captured, re-checking on every completion
+    if (req->timeout < 0) {
+        wait_rc = wait_event_interruptible(*chan_data->capture.wait_queue,
+                (rc = axidma_capture_try_acquire(chan_data, frame_refs,
+                                                 req)) != -EAGAIN);
+    } else {
+        wait_rc = wait_event_interruptible_timeout(
+                *chan_data->capture.wait_queue,
+                (rc = axidma_capture_try_acquire(chan_data, frame_refs,
+                                                 req)) != -EAGAIN,
+                msecs_to_jiffies(req->timeout));
+    }
 
-    rx_chan = axidma_get_chan(dev, trans->rx_channel_id);
-    if (rx_chan == NULL || rx_chan->dir != AXIDMA_READ) {
-        axidma_err("Invalid device id %d for DMA receive channel.\n",
-                   trans->rx_channel_id);
+    // Report an interruption by a signal, otherwise the acquired frame
+    if (wait_rc < 0) {
+        return wait_rc;
+    }
+    return rc;
+}
+
+/* Releases a reference to a captured frame held by the file. If the hardware
+ * ran out of buffers to capture into, the frame's buffer can be used again. */
+int axidma_release_frame(struct axidma_device *dev,
+                         struct axidma_frame_refs *frame_refs,
+                         struct axidma_capture_frame *req)
+{
+    int rc;
+    u32 *held;
+    unsigned long flags;
+    struct axidma_chan *chan;
+    struct axidma_chan_data *chan_data;
+    struct axidma_capture *capture;
+
+    chan = axidma_get_chan(dev, req->channel_id);
+    if (chan == NULL) {
+        axidma_err("Invalid channel id %d for releasing a frame.\n",
+                   req->channel_id);
         return -ENODEV;
     }
+    chan_data = axidma_get_chan_data(dev, chan);
+    capture = &chan_data->capture;
+    frame_refs = &frame_refs[chan - dev->channels];
+
+    spin_lock_irqsave(&chan_data->lock, flags);
+    held = axidma_capture_held(capture, frame_refs);
+    if (req->index < 0 || req->index >= capture->num_frames ||
+            !(*held & BIT(req->index))) {
+        rc = -EINVAL;
+    } else {
+        *held &= ~BIT(req->index);
+        capture->buffers[req->index].refcount -= 1;
+        axidma_capture_refill(chan_data);
+        rc = 0;
+    }
+    spin_unlock_irqrestore(&chan_data->lock, flags);
 
-    // Setup the scatter-gather list for the transfers (only one entry)
-    sg_init_table(&tx_sg_list, 1);
-    rc = axidma_init_sg_entry(dev, &tx_sg_list, 0, trans->tx_buf,
-                              trans->tx_buf_len);
     if (rc < 0) {
-        return rc;
+        axidma_err("Frame %d on channel %d is not acquired.\n", req->index,
+                   req->channel_id);
     }
-    sg_init_table(&rx_sg_list, 1);
-    rc = axidma_init_sg_entry(dev, &rx_sg_list, 0, trans->rx_buf,
-                              trans->rx_buf_len);
-    if (rc < 0) {
-        return rc;
+    return rc;
+}
+
+/* Releases all of the frames held by a file that is being closed, on each of
+ * the channels, so that a consumer that exits can't pin them forever. */
+void axidma_release_frames(struct axidma_device *dev,
+                           struct axidma_frame_refs *frame_refs)
+{
+    int i, j;
+    u32 *held;
+    unsigned long flags;
+    struct axidma_chan_data *chan_data;
+    struct axidma_capture *capture;
+
+    for (i = 0; i < dev->num_chans; i++)
+    {
+        chan_data = &dev->chan_data[i];
+        capture = &chan_data->capture;
+        spin_lock_irqsave(&chan_data->lock, flags);
+        held = axidma_capture_held(capture, &frame_refs[i]);
+        if (*held != 0) {
+            for (j = 0; j < capture->num_frames; j++)
+            {
+                capture->buffers[j].refcount -= (*held & BIT(j)) ? 1 : 0;
+            }
+            *held = 0;
+            axidma_capture_refill(chan_data);
+        }
+        spin_unlock_irqrestore(&chan_data->lock, flags);
     }
+}
 
-    // Setup receive and trasmit transfer structures for DMA
-    tx_tfr.sg_list = &tx_sg_list,
-    tx_tfr.sg_len = 1,
-    tx_tfr.dir = tx_chan->dir,
-    tx_tfr.type = tx_chan->type,
-    tx_tfr.wait = false,
-    tx_tfr.channel_id = trans->tx_channel_id,
-    tx_tfr.notify_signal = dev->notify_signal,
-    tx_tfr.process = get_current(),
-    tx_tfr.cb_data = &dev->cb_data[trans->tx_channel_id];
+int axidma_stop_channel(struct axidma_device *dev,
+                        struct axidma_chan *chan_info)
+{
+    struct axidma_chan *chan;
 
-    // Add in the frame information for VDMA transfers
-    if (tx_chan->type == AXIDMA_VDMA) {
-        memcpy(&tx_tfr.frame, &trans->tx_frame, sizeof(tx_tfr.frame));
+    // Get the transmit and receive channels with the given ids.
+    chan = axidma_get_chan(dev, chan_info->channel_id);
+    if (chan == NULL || chan->type != chan_info->type ||
+            chan->dir != chan_info->dir) {
+        axidma_err("Invalid channel id %d for %s %s channel.\n",
+            chan_info->channel_id, axidma_type_to_string(chan_info->type),
+            axidma_dir_to_string(chan_info->dir));
+        return -ENODEV;
+    } else if (READ_ONCE(axidma_get_chan_data(dev, chan)->v4l2_owned)) {
+        axidma_err("Channel %d is in use by its V4L2 video node.\n",
+                   chan_info->channel_id);
+        return -EBUSY;
     }
 
-    rx_tfr.sg_list = &rx_sg_list,
-    rx_tfr.sg_len = 1,
-    rx_tfr.dir = rx_chan->dir,
-    rx_tfr.type = rx_chan->type,
-    rx_tfr.wait = trans->wait,
-    rx_tfr.channel_id = trans->rx_channel_id,
-    rx_tfr.notify_signal = dev->notify_signal,
-    rx_tfr.process = get_current(),
-    rx_tfr.cb_data = &dev->cb_data[trans->rx_channel_id];
+    // Terminate all DMA transactions on the given channel
+    axidma_terminate_transfers(dev, chan, false);
+    return 0;
+}
 
-    // Add in the frame information for VDMA transfers
-    if (tx_chan->type == AXIDMA_VDMA) {
-        memcpy(&rx_tfr.frame, &trans->rx_frame, sizeof(rx_tfr.frame));
+/* Updates the status of each of the given transfers, returning the number of
+ * transfers that have finished, either successfully or with an error. */
+static int axidma_check_transfers(struct axidma_device *dev,
+        struct axidma_wait_entry *entries, int num_entries)
+{
+    int i, num_finished;
+    unsigned long flags;
+    struct axidma_chan *chan;
+    struct axidma_chan_data *chan_data;
+    struct axidma_cb_data *cb_data;
+    enum dma_status status;
+
+    num_finished = 0;
+    for (i = 0; i < num_entries; i++)
+    {
+        chan = axidma_get_chan(dev, entries[i].channel_id);
+        chan_data = axidma_get_chan_data(dev, chan);
+
+        /* If the transfer is still tracked by the channel, then its slot has
+         * its state and timestamps. Otherwise, its slot has been reused, so it
+         * finished long ago, provided the channel handed out the cookie. */
+        spin_lock_irqsave(&chan_data->lock, flags);
+        cb_data = axidma_find_slot(chan_data, entries[i].cookie);
+        if (cb_data == NULL) {
+            memset(&entries[i].timestamps, 0, sizeof(entries[i].timestamps));
+            memset(&entries[i].metadata, 0, sizeof(entries[i].metadata));
+            entries[i].len = 0;
+            status = (entries[i].cookie >= DMA_MIN_COOKIE &&
+                      entries[i].cookie < chan_data->next_cookie) ?
+                     DMA_COMPLETE : DMA_ERROR;
+        } else {
+            entries[i].timestamps = cb_data->timestamps;
+            entries[i].metadata = cb_data->metadata;
+            entries[i].len = cb_data->received;
+            status = (cb_data->state == AXIDMA_SLOT_QUEUED ||
+                      cb_data->state == AXIDMA_SLOT_PENDING) ? DMA_IN_PROGRESS :
+                     (cb_data->state == AXIDMA_SLOT_DONE) ? DMA_COMPLETE :
+                     DMA_ERROR;
+        }
+        spin_unlock_irqrestore(&chan_data->lock, flags);
+
+        if (status == DMA_COMPLETE) {
+            entries[i].status = AXIDMA_WAIT_COMPLETE;
+            num_finished += 1;
+        } else if (status == DMA_ERROR) {
+            entries[i].status = AXIDMA_WAIT_ERROR;
+            num_finished += 1;
+        } else {
+            entries[i].status = AXIDMA_WAIT_PENDING;
+        }
     }
 
-    // Prep both the receive and transmit transfers
-    rc = axidma_prep_transfer(tx_chan, &tx_tfr);
-    if (rc < 0) {
-        return rc;
+    return num_finished;
+}
+
+/* Waits until at least one of the given transfers finishes, or the timeout
+ * expires. Returns the number of finished transfers (0 on a timeout). */
+int axidma_wait_any(struct axidma_device *dev, struct axidma_wait_entry *entries,
+                    int num_entries, int timeout)
+{
+    int i, num_finished;
+    long rc;
+
+    // Verify that all of the transfers refer to valid channels
+    for (i = 0; i < num_entries; i++)
+    {
+        if (axidma_get_chan(dev, entries[i].channel_id) == NULL) {
+            axidma_err("Invalid channel id %d for wait entry %d.\n",
+                       entries[i].channel_id, i);
+            return -ENODEV;
+        }
     }
-    rc = axidma_prep_transfer(rx_chan, &rx_tfr);
-    if (rc < 0) {
-        return rc;
+
+    /* Sleep until a transfer finishes. The callback wakes up the queue on every
+     * completion, and the condition re-checks all of the transfers. */
+    num_finished = 0;
+    if (timeout < 0) {
+        rc = wait_event_interruptible(dev->wait_queue,
+                (num_finished = axidma_check_transfers(dev, entries,
+                                                       num_entries)) > 0);
+    } else {
+        rc = wait_event_interruptible_timeout(dev->wait_queue,
+                (num_finished = axidma_check_transfers(dev, entries,
+                                                       num_entries)) > 0,
+                msecs_to_jiffies(timeout));
     }
 
-    // Submit both transfers to the DMA engine, and wait on the receive transfer
-    rc = axidma_start_transfer(tx_chan, &tx_tfr);
+    // Report an interruption by a signal, otherwise the number finished
     if (rc < 0) {
         return rc;
     }
-    rc = axidma_start_transfer(rx_chan, &rx_tfr);
-    if (rc < 0) {
-        return rc;
+    return num_finished;
+}
+
+/* Gets an array to hold the entries of an AXIDMA_WAIT_ANY call, from the ones
+ * preallocated at probe time. If all of them are in use by other waiters, an
+ * array is allocated, and counted in the device's statistics. */
+struct axidma_wait_entry *axidma_get_wait_entries(struct axidma_device *dev,
+                                                  int num_entries)
+{
+    int i;
+    unsigned long flags;
+
+    spin_lock_irqsave(&dev->wait_pool_lock, flags);
+    for (i = 0; i < AXIDMA_NUM_WAIT_ARRAYS; i++)
+    {
+        if (!dev->wait_pool_used[i]) {
+            dev->wait_pool_used[i] = true;
+            break;
+        }
     }
+    spin_unlock_irqrestore(&dev->wait_pool_lock, flags);
 
-    return 0;
+    if (i < AXIDMA_NUM_WAIT_ARRAYS) {
+        return &dev->wait_pool[i * AXIDMA_MAX_WAIT_ENTRIES];
+    }
+    atomic_inc(&dev->transfer_allocations);
+    return kmalloc(num_entries * sizeof(dev->wait_pool[0]), GFP_KERNEL);
 }
 
-int axidma_video_transfer(struct axidma_device *dev,
-                          struct axidma_video_transaction *trans,
-                          enum axidma_dir dir)
+// Returns an array from axidma_get_wait_entries to the pool, or frees it
+void axidma_put_wait_entries(struct axidma_device *dev,
+                             struct axidma_wait_entry *entries)
 {
-    int rc, i;
-    size_t image_size;
-    struct axidma_chan *chan;
-    struct scatterlist *sg_list;
+    int i;
+    unsigned long flags;
 
-    // Setup transmit transfer structure for DMA
-    struct axidma_transfer transfer = {
-        .sg_len = trans->num_frame_buffers,
-        .dir = dir,
-        .type = AXIDMA_VDMA,
-        .wait = false,
-        .channel_id = trans->channel_id,
-        .notify_signal = dev->notify_signal,
-        .process = get_current(),
-        .frame = trans->frame,
-    };
+    i = (entries - dev->wait_pool) / AXIDMA_MAX_WAIT_ENTRIES;
+    if (entries < dev->wait_pool || i >= AXIDMA_NUM_WAIT_ARRAYS) {
+        kfree(entries);
+        return;
+    }
 
-    // Allocate an array to store the scatter list structures for the buffers
-    transfer.sg_list = kmalloc(transfer.sg_len * sizeof(*sg_list), GFP_KERNEL);
-    if (transfer.sg_list == NULL) {
-        axidma_err("Unable to allocate memory for the scatter-gather list.\n");
-        rc = -ENOMEM;
-        goto ret;
+    spin_lock_irqsave(&dev->wait_pool_lock, flags);
+    dev->wait_pool_used[i] = false;
+    spin_unlock_irqrestore(&dev->wait_pool_lock, flags);
+}
+
+/* Configures the adaptive completion mode for a channel. The polling thread
+ * for the channel is created the first time polling is enabled, and is kept
+ * until the driver is removed. */
+int axidma_set_adaptive(struct axidma_device *dev,
+                        struct axidma_adaptive_config *config)
+{
+    int rc;
+    unsigned long flags;
+    struct axidma_chan *chan;
+    struct axidma_chan_data *chan_data;
+
+    // Validate the channel id and the thresholds
+    chan = axidma_get_chan(dev, config->channel_id);
+    if (chan == NULL) {
+        axidma_err("Invalid channel id %d for adaptive configuration.\n",
+                   config->channel_id);
+        return -ENODEV;
+    } else if (config->poll_exit_rate > config->poll_enter_rate) {
+        axidma_err("Poll exit rate %u is larger than the enter rate %u.\n",
+                   config->poll_exit_rate, config->poll_enter_rate);
+        return -EINVAL;
+    }
+    if (config->poll_interval_us == 0) {
+        config->poll_interval_us = AXIDMA_DEFAULT_POLL_INTERVAL_US;
     }
 
-    // For each frame, setup a scatter-gather entry
-    image_size = trans->frame.width * trans->frame.height * trans->frame.depth;
-    for (i = 0; i < transfer.sg_len; i++)
-    {
-        rc = axidma_init_sg_entry(dev, transfer.sg_list, i,
-                                  trans->frame_buffers[i], image_size);
+    chan_data = axidma_get_chan_data(dev, chan);
+    mutex_lock(&chan_data->config_lock);
+
+    // Start the polling thread if this is the first time polling is enabled
+    rc = 0;
+    if (config->poll_enter_rate != 0) {
+        rc = axidma_start_poll_thread(chan_data);
         if (rc < 0) {
-            goto free_sg_list;
+            goto unlock;
         }
     }
 
-    // Get the channel with the given id
-    chan = axidma_get_chan(dev, trans->channel_id);
-    if (chan == NULL && chan->dir != dir &&
-            chan->type != AXIDMA_VDMA) {
-        axidma_err("Invalid device id %d for VDMA %s channel.\n",
-                   trans->channel_id, axidma_dir_to_string(chan->dir));
-        rc = -ENODEV;
-        goto free_sg_list;
+    // Update the settings, going back to interrupts if polling is disabled
+    spin_lock_irqsave(&chan_data->lock, flags);
+    chan_data->config = *config;
+    if (config->poll_enter_rate == 0 && chan_data->polling) {
+        axidma_set_mode(chan_data, false, ktime_get_ns());
     }
-    transfer.cb_data = &dev->cb_data[trans->channel_id];
+    spin_unlock_irqrestore(&chan_data->lock, flags);
 
-    // Prepare the transmit transfer
-    rc = axidma_prep_transfer(chan, &transfer);
-    if (rc < 0) {
-        goto free_sg_list;
+unlock:
+    mutex_unlock(&chan_data->config_lock);
+    return rc;
+}
+
+/* Sets the CPU and priority of the channel's completion thread, creating the
+ * thread if needed, so that the settings are in place before polling starts. */
+int axidma_set_completion_config(struct axidma_device *dev,
+                                 struct axidma_completion_config *config)
+{
+    int rc;
+    struct axidma_chan *chan;
+    struct axidma_chan_data *chan_data;
+
+    // Validate the channel id, CPU, and priority
+    chan = axidma_get_chan(dev, config->channel_id);
+    if (chan == NULL) {
+        axidma_err("Invalid channel id %d for completion configuration.\n",
+                   config->channel_id);
+        return -ENODEV;
+    } else if (config->cpu < -1 || (config->cpu >= 0 &&
+               (config->cpu >= nr_cpu_ids || !cpu_online(config->cpu)))) {
+        axidma_err("CPU %d is not a valid online CPU.\n", config->cpu);
+        return -EINVAL;
+    } else if (config->priority < 0 || config->priority >= MAX_RT_PRIO) {
+        axidma_err("Priority %d must be between 0 and %d.\n", config->priority,
+                   MAX_RT_PRIO - 1);
+        return -EINVAL;
     }
 
-    // Submit the transfer, and immediately return
-    rc = axidma_start_transfer(chan, &transfer);
+    chan_data = axidma_get_chan_data(dev, chan);
+    mutex_lock(&chan_data->config_lock);
+    chan_data->completion = *config;
+    if (chan_data->poll_thread == NULL) {
+        rc = axidma_start_poll_thread(chan_data);
+    } else {
+        rc = axidma_config_poll_thread(chan_data);
+    }
+    mutex_unlock(&chan_data->config_lock);
+
+    return rc;
+}
+
+/* Sets how the transfers of different processes on a channel are scheduled.
+ * Raising the limits immediately issues any transfers held back by them. */
+int axidma_set_sched(struct axidma_device *dev,
+                     struct axidma_sched_config *config)
+{
+    int i;
+    unsigned long flags;
+    struct axidma_chan *chan;
+    struct axidma_chan_data *chan_data;
+
+    // Validate the channel id, the policy, and the limits
+    chan = axidma_get_chan(dev, config->channel_id);
+    if (chan == NULL) {
+        axidma_err("Invalid channel id %d for scheduling configuration.\n",
+                   config->channel_id);
+        return -ENODEV;
+    } else if (config->policy != AXIDMA_SCHED_FIFO &&
+               config->policy != AXIDMA_SCHED_FAIR &&
+               config->policy != AXIDMA_SCHED_PRIORITY) {
+        axidma_err("Invalid scheduling policy %d.\n", config->policy);
+        return -EINVAL;
+    } else if (config->max_hw_transfers < 0 ||
+               config->max_hw_transfers > AXIDMA_NUM_TRANSFER_SLOTS) {
+        axidma_err("In-flight transfer limit %d must be between 0 and %d.\n",
+                   config->max_hw_transfers, AXIDMA_NUM_TRANSFER_SLOTS);
+        return -EINVAL;
+    }
+    if (config->max_hw_transfers == 0) {
+        config->max_hw_transfers = AXIDMA_NUM_TRANSFER_SLOTS;
+    }
+
+    // Start the new policy from a clean round
+    chan_data = axidma_get_chan_data(dev, chan);
+    spin_lock_irqsave(&chan_data->lock, flags);
+    chan_data->sched = *config;
+    for (i = 0; i < AXIDMA_MAX_SUBMITTERS; i++)
+    {
+        chan_data->submitters[i].deficit = 0;
+    }
+    axidma_dispatch(chan_data);
+    spin_unlock_irqrestore(&chan_data->lock, flags);
 
-free_sg_list:
-    kfree(transfer.sg_list);
-ret:
     return 0;
 }
 
-int axidma_stop_channel(struct axidma_device *dev,
-                        struct axidma_chan *chan_info)
+/* Sets the weight and priority of a process on a channel. A weight of 0 resets
+ * the process, so that its entry can be reused once its queue is empty. */
+int axidma_set_submitter(struct axidma_device *dev,
+                         struct axidma_submitter_config *config)
 {
+    int rc;
+    pid_t tgid;
+    unsigned long flags;
     struct axidma_chan *chan;
+    struct axidma_chan_data *chan_data;
+    struct axidma_submitter *submitter;
 
-    // Get the transmit and receive channels with the given ids.
-    chan = axidma_get_chan(dev, chan_info->channel_id);
-    if (chan == NULL && chan->type != chan_info->type &&
-            chan->dir != chan_info->dir) {
-        axidma_err("Invalid channel id %d for %s %s channel.\n",
-            chan_info->channel_id, axidma_type_to_string(chan_info->type),
-            axidma_dir_to_string(chan_info->dir));
+    chan = axidma_get_chan(dev, config->channel_id);
+    if (chan == NULL) {
+        axidma_err("Invalid channel id %d for submitter configuration.\n",
+                   config->channel_id);
         return -ENODEV;
+    } else if (config->pid < 0) {
+        axidma_err("Invalid process id %d.\n", config->pid);
+        return -EINVAL;
+    }
+    tgid = (config->pid == 0) ? task_tgid_nr(current) : config->pid;
+
+    // Find or claim the process's entry, which fails if all are in use
+    rc = 0;
+    chan_data = axidma_get_chan_data(dev, chan);
+    spin_lock_irqsave(&chan_data->lock, flags);
+    submitter = axidma_get_submitter(chan_data, tgid);
+    if (submitter->tgid != tgid) {
+        rc = -ENOSPC;
+    } else if (config->weight == 0) {
+        submitter->configured = false;
+        submitter->weight = 1;
+        submitter->priority = 0;
+    } else {
+        submitter->configured = true;
+        submitter->weight = config->weight;
+        submitter->priority = config->priority;
     }
+    spin_unlock_irqrestore(&chan_data->lock, flags);
 
-    // Terminate all DMA transactions on the given channel
-    return dmaengine_terminate_all(chan->chan);
+    if (rc < 0) {
+        axidma_err("Too many processes are configured on channel %d.\n",
+                   config->channel_id);
+    }
+    return rc;
+}
+
+// Gets the completion handling statistics for a channel
+int axidma_get_chan_stats(struct axidma_device *dev,
+                          struct axidma_chan_stats *stats)
+{
+    int i, channel_id;
+    unsigned long flags;
+    struct axidma_chan *chan;
+    struct axidma_chan_data *chan_data;
+
+    channel_id = stats->channel_id;
+    chan = axidma_get_chan(dev, channel_id);
+    if (chan == NULL) {
+        axidma_err("Invalid channel id %d for channel statistics.\n",
+                   channel_id);
+        return -ENODEV;
+    }
+
+    // Account for the time spent in the current mode up until now
+    chan_data = axidma_get_chan_data(dev, chan);
+    spin_lock_irqsave(&chan_data->lock, flags);
+    axidma_set_mode(chan_data, chan_data->polling, ktime_get_ns());
+    *stats = chan_data->stats;
+    stats->polling = chan_data->polling;
+    stats->config = chan_data->config;
+    stats->inflight = 0;
+    stats->queued = 0;
+    for (i = 0; i < AXIDMA_NUM_TRANSFER_SLOTS; i++)
+    {
+        if (chan_data->slots[i].state == AXIDMA_SLOT_PENDING) {
+            stats->inflight += 1;
+        } else if (chan_data->slots[i].state == AXIDMA_SLOT_QUEUED) {
+            stats->queued += 1;
+        }
+    }
+    spin_unlock_irqrestore(&chan_data->lock, flags);
+
+    stats->channel_id = channel_id;
+    stats->config.channel_id = channel_id;
+    return 0;
+}
+
+/* Maps the status page into the given userspace region. The page is shared by
+ * all processes, so it can only be mapped read-only. */
+int axidma_mmap_status_page(struct axidma_device *dev,
+                            struct vm_area_struct *vma)
+{
+    int rc;
+    unsigned long size, pfn;
+
+    // The region must fit in the page, and cannot be writable
+    size = vma->vm_end - vma->vm_start;
+    if (size > PAGE_SIZE) {
+        axidma_err("Status page mapping of size %lu exceeds page size %lu.\n",
+                   size, PAGE_SIZE);
+        return -EINVAL;
+    } else if (vma->vm_flags & VM_WRITE) {
+        axidma_err("The status page can only be mapped read-only.\n");
+        return -EPERM;
+    }
+
+    // Prevent the mapping from being made writable later with mprotect
+    vma->vm_flags &= ~VM_MAYWRITE;
+    vma->vm_flags |= VM_DONTCOPY;
+
+    pfn = virt_to_phys(dev->status_page) >> PAGE_SHIFT;
+    rc = remap_pfn_range(vma, vma->vm_start, pfn, size, vma->vm_page_prot);
+    if (rc < 0) {
+        axidma_err("Unable to remap the status page to userspace.\n");
+        return rc;
+    }
+
+    return 0;
 }
 
 /*----------------------------------------------------------------------------
@@ -653,6 +2842,15 @@ static int axidma_request_channels(struct platform_device *pdev,
             goto release_channels;
         }
         num_reserved_chans += 1;
+
+        // A CDMA channel is only useful if its engine can copy memory
+        if (chan->type == AXIDMA_CDMA &&
+                !dma_has_cap(DMA_MEMCPY, chan->chan->device->cap_mask)) {
+            axidma_err("Channel %d: %s does not support memory copies.\n", i,
+                       chan->name);
+            rc = -ENODEV;
+            goto release_channels;
+        }
     }
 
     return 0;
@@ -668,8 +2866,9 @@ release_channels:
 
 int axidma_dma_init(struct platform_device *pdev, struct axidma_device *dev)
 {
-    int rc;
+    int rc, i, j;
     size_t elem_size;
+    struct axidma_chan_data *chan_data;
     u64 dma_mask;
 
     dma_mask = DMA_BIT_MASK(8 * sizeof(dma_addr_t));
@@ -693,35 +2892,104 @@ int axidma_dma_init(struct platform_device *pdev, struct axidma_device *dev)
         return -ENOMEM;
     }
 
-    // Allocate an array to store all callback structures, for async
-    elem_size = sizeof(dev->cb_data[0]);
-    dev->cb_data = kmalloc(dev->num_chans * elem_size, GFP_KERNEL);
-    if (dev->cb_data == NULL) {
+    // Allocate an array to store the transfer tracking data for each channel
+    elem_size = sizeof(dev->chan_data[0]);
+    dev->chan_data = kzalloc(dev->num_chans * elem_size, GFP_KERNEL);
+    if (dev->chan_data == NULL) {
         axidma_err("Unable to allocate memory for callback structures.\n");
         rc = -ENOMEM;
         goto free_channels;
     }
 
+    // Allocate the page that exports the channel counters to userspace
+    dev->status_page = (void *)get_zeroed_page(GFP_KERNEL);
+    if (dev->status_page == NULL) {
+        axidma_err("Unable to allocate memory for the status page.\n");
+        rc = -ENOMEM;
+        goto free_callback_data;
+    }
+    dev->status_page->num_channels = min(dev->num_chans,
+                                         AXIDMA_STATUS_MAX_CHANNELS);
+
+    /* Preallocate the arrays for the entries of AXIDMA_WAIT_ANY calls, so that
+     * waiting on transfers does not allocate memory. */
+    elem_size = sizeof(dev->wait_pool[0]);
+    dev->wait_pool = kmalloc(AXIDMA_NUM_WAIT_ARRAYS * AXIDMA_MAX_WAIT_ENTRIES *
+                             elem_size, GFP_KERNEL);
+    dev->wait_pool_used = kzalloc(AXIDMA_NUM_WAIT_ARRAYS *
+                                  sizeof(dev->wait_pool_used[0]), GFP_KERNEL);
+    if (dev->wait_pool == NULL || dev->wait_pool_used == NULL) {
+        axidma_err("Unable to allocate memory for the wait entry arrays.\n");
+        rc = -ENOMEM;
+        goto free_wait_pool;
+    }
+    spin_lock_init(&dev->wait_pool_lock);
+    atomic_set(&dev->transfer_allocations, 0);
+
+    // Every completion wakes up the threads waiting on a set of transfers
+    init_waitqueue_head(&dev->wait_queue);
+    for (i = 0; i < dev->num_chans; i++)
+    {
+        chan_data = &dev->chan_data[i];
+        chan_data->chan = &dev->channels[i];
+        spin_lock_init(&chan_data->lock);
+        mutex_init(&chan_data->config_lock);
+        mutex_init(&chan_data->video_lock);
+        init_waitqueue_head(&chan_data->poll_queue);
+        chan_data->config.poll_interval_us = AXIDMA_DEFAULT_POLL_INTERVAL_US;
+        chan_data->completion.cpu = -1;
+        chan_data->window_start_ns = ktime_get_ns();
+        chan_data->mode_start_ns = chan_data->window_start_ns;
+        chan_data->next_cookie = DMA_MIN_COOKIE;
+        chan_data->sched.policy = AXIDMA_SCHED_FIFO;
+        chan_data->sched.max_hw_transfers = AXIDMA_NUM_TRANSFER_SLOTS;
+        for (j = 0; j < AXIDMA_MAX_SUBMITTERS; j++)
+        {
+            INIT_LIST_HEAD(&chan_data->submitters[j].queue);
+        }
+        if (i < AXIDMA_STATUS_MAX_CHANNELS) {
+            chan_data->status = &dev->status_page->channels[i];
+        }
+        for (j = 0; j < AXIDMA_NUM_TRANSFER_SLOTS; j++)
+        {
+            chan_data->slots[j].chan_data = chan_data;
+            chan_data->slots[j].wait_queue = &dev->wait_queue;
+            INIT_LIST_HEAD(&chan_data->slots[j].node);
+        }
+        chan_data->capture.wait_queue = &dev->wait_queue;
+    }
+
     // Parse the type and direction of each DMA channel from the device tree
     rc = axidma_of_parse_dma_nodes(pdev, dev);
     if (rc < 0) {
-        return rc;
+        goto free_wait_pool;
+    }
+
+    // Label each status entry with its channel's id
+    for (i = 0; i < dev->status_page->num_channels; i++)
+    {
+        dev->status_page->channels[i].channel_id = dev->channels[i].channel_id;
     }
 
     // Exclusively request all of the channels in the device tree entry
     rc = axidma_request_channels(pdev, dev);
     if (rc < 0) {
-        goto free_callback_data;
+        goto free_wait_pool;
     }
 
     axidma_info("DMA: Found %d transmit channels and %d receive channels.\n",
                 dev->num_dma_tx_chans, dev->num_dma_rx_chans);
     axidma_info("VDMA: Found %d transmit channels and %d receive channels.\n",
                 dev->num_vdma_tx_chans, dev->num_vdma_rx_chans);
+    axidma_info("CDMA: Found %d memory copy channels.\n", dev->num_cdma_chans);
     return 0;
 
+free_wait_pool:
+    kfree(dev->wait_pool_used);
+    kfree(dev->wait_pool);
+    free_page((unsigned long)dev->status_page);
 free_callback_data:
-    kfree(dev->cb_data);
+    kfree(dev->chan_data);
 free_channels:
     kfree(dev->channels);
     return rc;
@@ -732,6 +3000,14 @@ void axidma_dma_exit(struct axidma_device *dev)
     int i;
     struct dma_chan *chan;
 
+    // Stop the polling threads, so that none of them are left running
+    for (i = 0; i < dev->num_chans; i++)
+    {
+        if (dev->chan_data[i].poll_thread != NULL) {
+            kthread_stop(dev->chan_data[i].poll_thread);
+        }
+    }
+
     // Stop all running DMA transactions on all channels, and release
     for (i = 0; i < dev->num_chans; i++)
     {
@@ -742,7 +3018,10 @@ void axidma_dma_exit(struct axidma_device *dev)
 
     // Free the channel and callback data arrays
     kfree(dev->channels);
-    kfree(dev->cb_data);
+    kfree(dev->chan_data);
+    kfree(dev->wait_pool_used);
+    kfree(dev->wait_pool);
+    free_page((unsigned long)dev->status_page);
 
     return;
 }
@@ -29,7 +29,8 @@ static int axidma_parse_compatible_property(struct device_node *dma_chan_node,
     // Shorten the name for the dma_chan_node
     np = dma_chan_node;
 
-    // Determine if the channel is DMA or VDMA, and if it is transmit or receive
+    /* Determine if the channel is DMA, VDMA, or CDMA, and if it is transmit or
+     * receive. CDMA channels copy within memory, so they count as transmit. */
     if (of_device_is_compatible(np, "xlnx,axi-dma-mm2s-channel") > 0) {
         chan->type = AXIDMA_DMA;
         chan->dir = AXIDMA_WRITE;
@@ -46,14 +47,19 @@ static int axidma_parse_compatible_property(struct device_node *dma_chan_node,
         chan->type = AXIDMA_VDMA;
         chan->dir = AXIDMA_READ;
         dev->num_vdma_rx_chans += 1;
+    } else if (of_device_is_compatible(np, "xlnx,axi-cdma-channel") > 0) {
+        chan->type = AXIDMA_CDMA;
+        chan->dir = AXIDMA_WRITE;
+        dev->num_cdma_chans += 1;
     } else if (of_find_property(np, "compatible", NULL) == NULL) {
         axidma_node_err(np, "DMA channel lacks 'compatible' property.\n");
     } else {
         axidma_node_err(np, "DMA channel has an invalid 'compatible' "
                         "property.\n");
         axidma_err("The 'compatible' property must be one of: {"
-                   "xlnx,axi-dma-mm2s-channel, xlnx,axi-dma-mm2s-channel, "
-                   "xlnx,axi-dma-mm2s-channel, xlnx,axi-dma-mm2s-channel}.\n");
+                   "xlnx,axi-dma-mm2s-channel, xlnx,axi-dma-s2mm-channel, "
+                   "xlnx,axi-vdma-mm2s-channel, xlnx,axi-vdma-s2mm-channel, "
+                   "xlnx,axi-cdma-channel}.\n");
         return -EINVAL;
     }
 
@@ -217,6 +223,7 @@ int axidma_of_parse_dma_nodes(struct platform_device *pdev,
     dev->num_dma_rx_chans = 0;
     dev->num_vdma_tx_chans = 0;
     dev->num_vdma_rx_chans = 0;
+    dev->num_cdma_chans = 0;
 
     /* For each DMA channel specified in the deivce tree, parse out the
      * information about the channel, namely its direction and type. */
@@ -0,0 +1,691 @@
+/**
+ * @file axidma_v4l2.c
+ * @date Sunday, October 18, 2026 at 06:02:37 PM EDT
+ *
+ * This file contains the optional V4L2 front-end for the VDMA channels. Each
+ * VDMA receive channel is exposed as a video capture node, and each VDMA
+ * transmit channel as a video output node. The nodes support streaming I/O
+ * with MMAP and DMABUF buffers through videobuf2, so standard V4L2
+ * applications can use the channels without copying the frames.
+ *
+ * The front-end is only compiled when AXIDMA_V4L2 is defined.
+ *
+ * @bug No known bugs.
+ **/
+
+// Kernel dependencies
+#include <linux/kernel.h>       // Contains the definition for printk
+#include <linux/slab.h>         // Kernel allocation functions
+#include <linux/list.h>         // Linked list definitions and functions
+#include <linux/mutex.h>        // Mutex definitions
+#include <linux/spinlock.h>     // Spinlock definitions
+#include <linux/version.h>      // Linux version macros
+#include <linux/dmaengine.h>    // DMA engine functions
+#include <linux/videodev2.h>    // V4L2 userspace definitions
+
+#include <media/v4l2-dev.h>             // Video device registration
+#include <media/v4l2-device.h>          // V4L2 device structures
+#include <media/v4l2-ioctl.h>           // V4L2 ioctl handlers
+#include <media/videobuf2-v4l2.h>       // Videobuf2 queue functions
+#include <media/videobuf2-dma-contig.h> // Contiguous DMA buffer allocator
+
+// Local dependencies
+#include "axidma.h"             // Internal definitions
+
+/*----------------------------------------------------------------------------
+ * Internal Definitions
+ *----------------------------------------------------------------------------*/
+
+// The default dimensions of the frames, and the limits on them
+#define AXIDMA_V4L2_DEF_WIDTH       640
+#define AXIDMA_V4L2_DEF_HEIGHT      480
+#define AXIDMA_V4L2_MIN_SIZE        16
+#define AXIDMA_V4L2_MAX_SIZE        8192
+
+/* The buffers queued before the channel starts. With at least two, the VDMA
+ * always has the next frame to move to when it finishes one. */
+#define AXIDMA_V4L2_MIN_BUFFERS     2
+
+// The video device type was renamed in 5.7
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5,7,0)
+#define VFL_TYPE_VIDEO              VFL_TYPE_GRABBER
+#endif
+
+// A pixel format supported by the nodes, and its size in bytes
+struct axidma_v4l2_format {
+    u32 fourcc;                     // The V4L2 pixel format
+    int depth;                      // The number of bytes in a pixel
+};
+
+/* The VDMA only moves bytes, so the pixel format is whatever the hardware
+ * produces or consumes. The application picks the one matching its design. */
+static const struct axidma_v4l2_format axidma_v4l2_formats[] = {
+    { V4L2_PIX_FMT_GREY, 1 },
+    { V4L2_PIX_FMT_YUYV, 2 },
+    { V4L2_PIX_FMT_UYVY, 2 },
+    { V4L2_PIX_FMT_RGB24, 3 },
+    { V4L2_PIX_FMT_BGR24, 3 },
+    { V4L2_PIX_FMT_XBGR32, 4 },
+};
+
+// A frame buffer queued on a node
+struct axidma_v4l2_buffer {
+    struct vb2_v4l2_buffer vb;      // The videobuf2 buffer, must be first
+    struct list_head list;          // Entry in the node's queued list
+};
+
+// A video node for a single VDMA channel
+struct axidma_v4l2_node {
+    struct axidma_device *dev;      // The device the channel belongs to
+    struct axidma_chan *chan;       // The VDMA channel of the node
+    struct video_device vdev;       // The video device for the node
+    struct vb2_queue queue;         // The queue of frame buffers
+    struct mutex lock;              // Serializes the ioctls on the node
+    spinlock_t qlock;               // Protects the queued list and streaming
+    struct list_head queued;        // Buffers queued, in hardware order
+    bool streaming;                 // The channel is processing buffers
+    u32 sequence;                   // The number of the next frame
+    struct v4l2_pix_format format;  // The format of the frames
+    int depth;                      // The number of bytes in a pixel
+};
+
+// The V4L2 front-end for the device
+struct axidma_v4l2 {
+    struct v4l2_device v4l2_dev;    // The V4L2 device the nodes belong to
+    int num_nodes;                  // The number of registered nodes
+    struct axidma_v4l2_node nodes[];    // A node for each VDMA channel
+};
+
+static inline struct axidma_v4l2_buffer *to_axidma_buf(struct vb2_buffer *vb)
+{
+    return container_of(to_vb2_v4l2_buffer(vb), struct axidma_v4l2_buffer,
+                        vb);
+}
+
+static bool axidma_v4l2_is_capture(struct axidma_v4l2_node *node)
+{
+    return node->chan->dir == AXIDMA_READ;
+}
+
+/*----------------------------------------------------------------------------
+ * Streaming
+ *----------------------------------------------------------------------------*/
+
+// Completes a frame, handing its buffer back to videobuf2
+static void axidma_v4l2_callback(void *data)
+{
+    unsigned long flags;
+    struct axidma_v4l2_buffer *buf;
+    struct axidma_v4l2_node *node;
+
+    buf = data;
+    node = vb2_get_drv_priv(buf->vb.vb2_buf.vb2_queue);
+
+    // Once streaming stops, the buffers are returned by stop_streaming
+    spin_lock_irqsave(&node->qlock, flags);
+    if (!node->streaming) {
+        spin_unlock_irqrestore(&node->qlock, flags);
+        return;
+    }
+    list_del(&buf->list);
+    buf->vb.sequence = node->sequence++;
+    spin_unlock_irqrestore(&node->qlock, flags);
+
+    buf->vb.field = V4L2_FIELD_NONE;
+    buf->vb.vb2_buf.timestamp = ktime_get_ns();
+    vb2_buffer_done(&buf->vb.vb2_buf, VB2_BUF_STATE_DONE);
+}
+
+// Queues a buffer's frame on the VDMA channel, without issuing it
+static int axidma_v4l2_submit(struct axidma_v4l2_node *node,
+                              struct axidma_v4l2_buffer *buf)
+{
+    dma_addr_t dma_addr;
+    dma_cookie_t dma_cookie;
+    struct axidma_video_frame frame;
+    struct dma_async_tx_descriptor *dma_txnd;
+
+    frame.width = node->format.width;
+    frame.height = node->format.height;
+    frame.depth = node->depth;
+    dma_addr = vb2_dma_contig_plane_dma_addr(&buf->vb.vb2_buf, 0);
+    dma_txnd = axidma_prep_frame(node->chan, dma_addr, &frame,
+                                 DMA_CTRL_ACK | DMA_PREP_INTERRUPT);
+    if (dma_txnd == NULL) {
+        axidma_err("Unable to prepare a frame on channel %d.\n",
+                   node->chan->channel_id);
+        return -EBUSY;
+    }
+
+    dma_txnd->callback = axidma_v4l2_callback;
+    dma_txnd->callback_param = buf;
+    dma_cookie = dmaengine_submit(dma_txnd);
+    if (dma_submit_error(dma_cookie)) {
+        axidma_err("Unable to submit a frame on channel %d.\n",
+                   node->chan->channel_id);
+        return -EBUSY;
+    }
+
+    return 0;
+}
+
+// Hands all of the queued buffers back to videobuf2 in the given state
+static void axidma_v4l2_return_buffers(struct axidma_v4l2_node *node,
+                                       enum vb2_buffer_state state)
+{
+    unsigned long flags;
+    struct axidma_v4l2_buffer *buf, *next;
+
+    spin_lock_irqsave(&node->qlock, flags);
+    list_for_each_entry_safe(buf, next, &node->queued, list)
+    {
+        list_del(&buf->list);
+        vb2_buffer_done(&buf->vb.vb2_buf, state);
+    }
+    spin_unlock_irqrestore(&node->qlock, flags);
+}
+
+static int axidma_v4l2_queue_setup(struct vb2_queue *queue,
+        unsigned int *num_buffers, unsigned int *num_planes,
+        unsigned int sizes[], struct device *alloc_devs[])
+{
+    struct axidma_v4l2_node *node;
+
+    node = vb2_get_drv_priv(queue);
+    if (*num_planes != 0) {
+        return (sizes[0] < node->format.sizeimage) ? -EINVAL : 0;
+    }
+
+    *num_planes = 1;
+    sizes[0] = node->format.sizeimage;
+    return 0;
+}
+
+static int axidma_v4l2_buf_prepare(struct vb2_buffer *vb)
+{
+    struct axidma_v4l2_node *node;
+
+    node = vb2_get_drv_priv(vb->vb2_queue);
+    if (vb2_plane_size(vb, 0) < node->format.sizeimage) {
+        axidma_err("Buffer of %lu bytes is too small for a %u byte frame.\n",
+                   vb2_plane_size(vb, 0), node->format.sizeimage);
+        return -EINVAL;
+    }
+
+    // The VDMA always moves whole frames
+    vb2_set_plane_payload(vb, 0, node->format.sizeimage);
+    return 0;
+}
+
+static void axidma_v4l2_buf_queue(struct vb2_buffer *vb)
+{
+    int rc;
+    unsigned long flags;
+    struct axidma_v4l2_buffer *buf;
+    struct axidma_v4l2_node *node;
+
+    node = vb2_get_drv_priv(vb->vb2_queue);
+    buf = to_axidma_buf(vb);
+
+    // Until streaming starts, the buffers are only collected
+    spin_lock_irqsave(&node->qlock, flags);
+    list_add_tail(&buf->list, &node->queued);
+    if (!node->streaming) {
+        spin_unlock_irqrestore(&node->qlock, flags);
+        return;
+    }
+
+    rc = axidma_v4l2_submit(node, buf);
+    if (rc < 0) {
+        list_del(&buf->list);
+        spin_unlock_irqrestore(&node->qlock, flags);
+        vb2_buffer_done(vb, VB2_BUF_STATE_ERROR);
+        return;
+    }
+    spin_unlock_irqrestore(&node->qlock, flags);
+
+    dma_async_issue_pending(node->chan->chan);
+}
+
+static int axidma_v4l2_start_streaming(struct vb2_queue *queue,
+                                       unsigned int count)
+{
+    int rc;
+    unsigned long flags;
+    struct axidma_v4l2_buffer *buf;
+    struct axidma_v4l2_node *node;
+
+    /* The character device can't use the channel while the node streams on
+     * it, and the node can't start while the character device is using it. */
+    node = vb2_get_drv_priv(queue);
+    rc = axidma_claim_vdma(node->dev, node->chan);
+    if (rc < 0) {
+        goto return_buffers;
+    }
+    rc = axidma_config_vdma(node->chan);
+    if (rc < 0) {
+        goto release_chan;
+    }
+
+    // Hand the buffers queued so far to the hardware, in order
+    spin_lock_irqsave(&node->qlock, flags);
+    node->sequence = 0;
+    list_for_each_entry(buf, &node->queued, list)
+    {
+        rc = axidma_v4l2_submit(node, buf);
+        if (rc < 0) {
+            spin_unlock_irqrestore(&node->qlock, flags);
+            goto terminate;
+        }
+    }
+    node->streaming = true;
+    spin_unlock_irqrestore(&node->qlock, flags);
+
+    dma_async_issue_pending(node->chan->chan);
+    return 0;
+
+/* The frames submitted so far are dropped, and their callbacks must have
+ * finished before their buffers are given back to videobuf2. */
+terminate:
+    dmaengine_terminate_async(node->chan->chan);
+    dmaengine_synchronize(node->chan->chan);
+release_chan:
+    axidma_release_vdma(node->dev, node->chan);
+return_buffers:
+    axidma_v4l2_return_buffers(node, VB2_BUF_STATE_QUEUED);
+    return rc;
+}
+
+static void axidma_v4l2_stop_streaming(struct vb2_queue *queue)
+{
+    unsigned long flags;
+    struct axidma_v4l2_node *node;
+
+    node = vb2_get_drv_priv(queue);
+    spin_lock_irqsave(&node->qlock, flags);
+    node->streaming = false;
+    spin_unlock_irqrestore(&node->qlock, flags);
+
+    /* Wait for any callback still running, so that no buffer is completed
+     * after it has been given back, or once the channel is released. */
+    dmaengine_terminate_sync(node->chan->chan);
+    axidma_v4l2_return_buffers(node, VB2_BUF_STATE_ERROR);
+    axidma_release_vdma(node->dev, node->chan);
+}
+
+static const struct vb2_ops axidma_v4l2_qops = {
+    .queue_setup = axidma_v4l2_queue_setup,
+    .buf_prepare = axidma_v4l2_buf_prepare,
+    .buf_queue = axidma_v4l2_buf_queue,
+    .start_streaming = axidma_v4l2_start_streaming,
+    .stop_streaming = axidma_v4l2_stop_streaming,
+    .wait_prepare = vb2_ops_wait_prepare,
+    .wait_finish = vb2_ops_wait_finish,
+};
+
+/*----------------------------------------------------------------------------
+ * V4L2 IOCTL Handlers
+ *----------------------------------------------------------------------------*/
+
+static int axidma_v4l2_querycap(struct file *file, void *fh,
+                                struct v4l2_capability *cap)
+{
+    struct axidma_v4l2_node *node;
+
+    node = video_drvdata(file);
+    snprintf(cap->driver, sizeof(cap->driver), "%s", MODULE_NAME);
+    snprintf(cap->card, sizeof(cap->card), "%s", node->vdev.name);
+    snprintf(cap->bus_info, sizeof(cap->bus_info), "platform:%s",
+             MODULE_NAME);
+    cap->device_caps = node->vdev.device_caps;
+    cap->capabilities = cap->device_caps | V4L2_CAP_DEVICE_CAPS;
+    return 0;
+}
+
+static int axidma_v4l2_enum_fmt(struct file *file, void *fh,
+                                struct v4l2_fmtdesc *fmt)
+{
+    if (fmt->index >= ARRAY_SIZE(axidma_v4l2_formats)) {
+        return -EINVAL;
+    }
+
+    fmt->pixelformat = axidma_v4l2_formats[fmt->index].fourcc;
+    return 0;
+}
+
+static int axidma_v4l2_g_fmt(struct file *file, void *fh,
+                             struct v4l2_format *fmt)
+{
+    struct axidma_v4l2_node *node;
+
+    node = video_drvdata(file);
+    fmt->fmt.pix = node->format;
+    return 0;
+}
+
+/* Adjusts the format to the closest one the node supports, returning the size
+ * of its pixels. Unknown pixel formats fall back to the first one. */
+static int axidma_v4l2_adjust_fmt(struct v4l2_pix_format *pix)
+{
+    int i;
+    const struct axidma_v4l2_format *format;
+
+    format = &axidma_v4l2_formats[0];
+    for (i = 0; i < ARRAY_SIZE(axidma_v4l2_formats); i++)
+    {
+        if (axidma_v4l2_formats[i].fourcc == pix->pixelformat) {
+            format = &axidma_v4l2_formats[i];
+            break;
+        }
+    }
+
+    pix->pixelformat = format->fourcc;
+    pix->width = clamp_t(u32, pix->width, AXIDMA_V4L2_MIN_SIZE,
+                         AXIDMA_V4L2_MAX_SIZE);
+    pix->height = clamp_t(u32, pix->height, AXIDMA_V4L2_MIN_SIZE,
+                          AXIDMA_V4L2_MAX_SIZE);
+    pix->field = V4L2_FIELD_NONE;
+    pix->bytesperline = pix->width * format->depth;
+    pix->sizeimage = pix->bytesperline * pix->height;
+    pix->colorspace = V4L2_COLORSPACE_SRGB;
+    pix->ycbcr_enc = V4L2_YCBCR_ENC_DEFAULT;
+    pix->quantization = V4L2_QUANTIZATION_DEFAULT;
+    pix->xfer_func = V4L2_XFER_FUNC_DEFAULT;
+    pix->priv = 0;
+    pix->flags = 0;
+    return format->depth;
+}
+
+static int axidma_v4l2_try_fmt(struct file *file, void *fh,
+                               struct v4l2_format *fmt)
+{
+    axidma_v4l2_adjust_fmt(&fmt->fmt.pix);
+    return 0;
+}
+
+static int axidma_v4l2_s_fmt(struct file *file, void *fh,
+                             struct v4l2_format *fmt)
+{
+    struct axidma_v4l2_node *node;
+
+    // The format can't change while buffers are allocated for it
+    node = video_drvdata(file);
+    if (vb2_is_busy(&node->queue)) {
+        return -EBUSY;
+    }
+
+    node->depth = axidma_v4l2_adjust_fmt(&fmt->fmt.pix);
+    node->format = fmt->fmt.pix;
+    return 0;
+}
+
+static int axidma_v4l2_enum_input(struct file *file, void *fh,
+                                  struct v4l2_input *input)
+{
+    struct axidma_v4l2_node *node;
+
+    node = video_drvdata(file);
+    if (input->index != 0) {
+        return -EINVAL;
+    }
+
+    snprintf(input->name, sizeof(input->name), "VDMA channel %d",
+             node->chan->channel_id);
+    input->type = V4L2_INPUT_TYPE_CAMERA;
+    return 0;
+}
+
+static int axidma_v4l2_g_input(struct file *file, void *fh, unsigned int *i)
+{
+    *i = 0;
+    return 0;
+}
+
+static int axidma_v4l2_s_input(struct file *file, void *fh, unsigned int i)
+{
+    return (i == 0) ? 0 : -EINVAL;
+}
+
+static int axidma_v4l2_enum_output(struct file *file, void *fh,
+                                   struct v4l2_output *output)
+{
+    struct axidma_v4l2_node *node;
+
+    node = video_drvdata(file);
+    if (output->index != 0) {
+        return -EINVAL;
+    }
+
+    snprintf(output->name, sizeof(output->name), "VDMA channel %d",
+             node->chan->channel_id);
+    output->type = V4L2_OUTPUT_TYPE_ANALOG;
+    return 0;
+}
+
+static int axidma_v4l2_g_output(struct file *file, void *fh, unsigned int *i)
+{
+    *i = 0;
+    return 0;
+}
+
+static int axidma_v4l2_s_output(struct file *file, void *fh, unsigned int i)
+{
+    return (i == 0) ? 0 : -EINVAL;
+}
+
+/* The core only enables the handlers that match the direction of the node, so
+ * the capture and output nodes share the same table. */
+static const struct v4l2_ioctl_ops axidma_v4l2_ioctl_ops = {
+    .vidioc_querycap = axidma_v4l2_querycap,
+
+    .vidioc_enum_fmt_vid_cap = axidma_v4l2_enum_fmt,
+    .vidioc_g_fmt_vid_cap = axidma_v4l2_g_fmt,
+    .vidioc_try_fmt_vid_cap = axidma_v4l2_try_fmt,
+    .vidioc_s_fmt_vid_cap = axidma_v4l2_s_fmt,
+    .vidioc_enum_fmt_vid_out = axidma_v4l2_enum_fmt,
+    .vidioc_g_fmt_vid_out = axidma_v4l2_g_fmt,
+    .vidioc_try_fmt_vid_out = axidma_v4l2_try_fmt,
+    .vidioc_s_fmt_vid_out = axidma_v4l2_s_fmt,
+
+    .vidioc_enum_input = axidma_v4l2_enum_input,
+    .vidioc_g_input = axidma_v4l2_g_input,
+    .vidioc_s_input = axidma_v4l2_s_input,
+    .vidioc_enum_output = axidma_v4l2_enum_output,
+    .vidioc_g_output = axidma_v4l2_g_output,
+    .vidioc_s_output = axidma_v4l2_s_output,
+
+    .vidioc_reqbufs = vb2_ioctl_reqbufs,
+    .vidioc_create_bufs = vb2_ioctl_create_bufs,
+    .vidioc_prepare_buf = vb2_ioctl_prepare_buf,
+    .vidioc_querybuf = vb2_ioctl_querybuf,
+    .vidioc_qbuf = vb2_ioctl_qbuf,
+    .vidioc_dqbuf = vb2_ioctl_dqbuf,
+    .vidioc_expbuf = vb2_ioctl_expbuf,
+    .vidioc_streamon = vb2_ioctl_streamon,
+    .vidioc_streamoff = vb2_ioctl_streamoff,
+};
+
+static const struct v4l2_file_operations axidma_v4l2_fops = {
+    .owner = THIS_MODULE,
+    .open = v4l2_fh_open,
+    .release = vb2_fop_release,
+    .unlocked_ioctl = video_ioctl2,
+    .mmap = vb2_fop_mmap,
+    .poll = vb2_fop_poll,
+};
+
+/*----------------------------------------------------------------------------
+ * Initialization and Cleanup
+ *----------------------------------------------------------------------------*/
+
+// Sets up and registers the video node for a VDMA channel
+static int axidma_v4l2_init_node(struct axidma_device *dev,
+        struct axidma_v4l2 *v4l2, struct axidma_v4l2_node *node,
+        struct axidma_chan *chan)
+{
+    int rc;
+    bool capture;
+    struct vb2_queue *queue;
+    struct video_device *vdev;
+
+    node->dev = dev;
+    node->chan = chan;
+    mutex_init(&node->lock);
+    spin_lock_init(&node->qlock);
+    INIT_LIST_HEAD(&node->queued);
+    node->format.width = AXIDMA_V4L2_DEF_WIDTH;
+    node->format.height = AXIDMA_V4L2_DEF_HEIGHT;
+    node->format.pixelformat = axidma_v4l2_formats[0].fourcc;
+    node->depth = axidma_v4l2_adjust_fmt(&node->format);
+    capture = axidma_v4l2_is_capture(node);
+
+    // Buffers are allocated from, or imported into, the device's DMA memory
+    queue = &node->queue;
+    queue->type = capture ? V4L2_BUF_TYPE_VIDEO_CAPTURE :
+                            V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    queue->io_modes = VB2_MMAP | VB2_DMABUF;
+    queue->drv_priv = node;
+    queue->buf_struct_size = sizeof(struct axidma_v4l2_buffer);
+    queue->ops = &axidma_v4l2_qops;
+    queue->mem_ops = &vb2_dma_contig_memops;
+    queue->timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+    queue->lock = &node->lock;
+    queue->dev = &dev->pdev->dev;
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6,8,0)
+    queue->min_buffers_needed = AXIDMA_V4L2_MIN_BUFFERS;
+#else
+    queue->min_queued_buffers = AXIDMA_V4L2_MIN_BUFFERS;
+#endif
+    rc = vb2_queue_init(queue);
+    if (rc < 0) {
+        axidma_err("Unable to initialize the buffer queue for channel %d.\n",
+                   chan->channel_id);
+        return rc;
+    }
+
+    vdev = &node->vdev;
+    snprintf(vdev->name, sizeof(vdev->name), "axidma vdma %d",
+             chan->channel_id);
+    vdev->fops = &axidma_v4l2_fops;
+    vdev->ioctl_ops = &axidma_v4l2_ioctl_ops;
+    /* The node is part of the front-end's allocation, which is freed once the
+     * last node is released, by axidma_v4l2_release. */
+    vdev->release = video_device_release_empty;
+    vdev->v4l2_dev = &v4l2->v4l2_dev;
+    vdev->queue = queue;
+    vdev->lock = &node->lock;
+    vdev->vfl_dir = capture ? VFL_DIR_RX : VFL_DIR_TX;
+    vdev->device_caps = V4L2_CAP_STREAMING | (capture ?
+            V4L2_CAP_VIDEO_CAPTURE : V4L2_CAP_VIDEO_OUTPUT);
+    video_set_drvdata(vdev, node);
+
+    rc = video_register_device(vdev, VFL_TYPE_VIDEO, -1);
+    if (rc < 0) {
+        axidma_err("Unable to register the video node for channel %d.\n",
+                   chan->channel_id);
+        return rc;
+    }
+
+    axidma_info("Registered %s as the %s node for VDMA channel %d.\n",
+                video_device_node_name(vdev), capture ? "capture" : "output",
+                chan->channel_id);
+    return 0;
+}
+
+/* Unregisters a node, stopping its queue if it is still streaming, so that a
+ * file left open can't touch the channel once the driver is removed. */
+static void axidma_v4l2_unregister_node(struct axidma_v4l2_node *node)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,13,0)
+    vb2_video_unregister_device(&node->vdev);
+#else
+    video_unregister_device(&node->vdev);
+    mutex_lock(&node->lock);
+    vb2_queue_release(&node->queue);
+    node->queue.owner = NULL;
+    mutex_unlock(&node->lock);
+#endif
+}
+
+/* Frees the front-end once the V4L2 device's last reference is dropped. Each
+ * registered node holds one until it is released, which may be after the
+ * driver is removed, if the node is still open. */
+static void axidma_v4l2_release(struct v4l2_device *v4l2_dev)
+{
+    kfree(container_of(v4l2_dev, struct axidma_v4l2, v4l2_dev));
+}
+
+int axidma_v4l2_init(struct axidma_device *dev)
+{
+    int rc, i, num_vdma;
+    struct axidma_v4l2 *v4l2;
+
+    // Without any VDMA channels, there are no nodes to register
+    dev->v4l2 = NULL;
+    num_vdma = dev->num_vdma_tx_chans + dev->num_vdma_rx_chans;
+    if (num_vdma == 0) {
+        return 0;
+    }
+
+    v4l2 = kzalloc(sizeof(*v4l2) + num_vdma * sizeof(v4l2->nodes[0]),
+                   GFP_KERNEL);
+    if (v4l2 == NULL) {
+        axidma_err("Unable to allocate the V4L2 video nodes.\n");
+        return -ENOMEM;
+    }
+
+    rc = v4l2_device_register(&dev->pdev->dev, &v4l2->v4l2_dev);
+    if (rc < 0) {
+        axidma_err("Unable to register the V4L2 device.\n");
+        kfree(v4l2);
+        return rc;
+    }
+    v4l2->v4l2_dev.release = axidma_v4l2_release;
+
+    for (i = 0; i < dev->num_chans; i++)
+    {
+        if (dev->channels[i].type != AXIDMA_VDMA) {
+            continue;
+        }
+
+        rc = axidma_v4l2_init_node(dev, v4l2, &v4l2->nodes[v4l2->num_nodes],
+                                   &dev->channels[i]);
+        if (rc < 0) {
+            goto unregister_nodes;
+        }
+        v4l2->num_nodes += 1;
+    }
+
+    dev->v4l2 = v4l2;
+    return 0;
+
+unregister_nodes:
+    for (i = 0; i < v4l2->num_nodes; i++)
+    {
+        axidma_v4l2_unregister_node(&v4l2->nodes[i]);
+    }
+    v4l2_device_unregister(&v4l2->v4l2_dev);
+    v4l2_device_put(&v4l2->v4l2_dev);
+    return rc;
+}
+
+void axidma_v4l2_exit(struct axidma_device *dev)
+{
+    int i;
+    struct axidma_v4l2 *v4l2;
+
+    v4l2 = dev->v4l2;
+    if (v4l2 == NULL) {
+        return;
+    }
+
+    // The front-end is freed once the last open node is closed
+    for (i = 0; i < v4l2->num_nodes; i++)
+    {
+        axidma_v4l2_unregister_node(&v4l2->nodes[i]);
+    }
+    v4l2_device_unregister(&v4l2->v4l2_dev);
+    v4l2_device_put(&v4l2->v4l2_dev);
+    dev->v4l2 = NULL;
+    return;
+}
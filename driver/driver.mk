@@ -30,6 +30,9 @@ endif
 ifneq ($(origin XILINX_DMA_INCLUDE_PATH_FIXUP),undefined)
     export XILINX_DMA_INCLUDE_PATH_FIXUP
 endif
+ifneq ($(origin AXIDMA_V4L2),undefined)
+    export AXIDMA_V4L2
+endif
 
 # When natively compiling, we can infer the kernel's source tree directory,
 # if the user has not specified it.
@@ -45,6 +48,9 @@ KERNEL_SYMS = $(KBUILD_DIR)/Module.symvers
 DRIVER_DIR = driver
 export AXIDMA_FILES = axi_dma.c axidma_chrdev.c axidma_dma.c axidma.h \
 		axidma_of.c
+ifneq ($(origin AXIDMA_V4L2),undefined)
+    AXIDMA_FILES += axidma_v4l2.c
+endif
 DRIVER_PATHS = $(addprefix $(DRIVER_DIR)/,$(AXIDMA_FILES))
 
 # The kernel object files generated by compilation
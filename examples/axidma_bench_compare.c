@@ -0,0 +1,408 @@
+/**
+ * @file axidma_bench_compare.c
+ * @date Sunday, October 18, 2026 at 02:41:07 PM EDT
+ *
+ * This program compares archived benchmark results, and reports any test
+ * points where the candidate results are significantly slower than the
+ * baseline results.
+ *
+ * The results are the JSON lines appended by axidma_benchmark with the '-w'
+ * option. Each line is a single run of a test point, identified by its test
+ * id. Runs of the same test point are pooled together, and the throughput and
+ * mean latency of the baseline and candidate are compared with Welch's t-test.
+ * A test point regresses when it is worse by more than the threshold, and the
+ * difference is statistically significant. The program exits with a non-zero
+ * status if any test point regressed, so it can be used from scripts.
+ *
+ * @bug No known bugs.
+ **/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>             // String functions
+#include <math.h>               // Square root and absolute value functions
+
+#include <getopt.h>             // Option parsing
+#include <errno.h>              // Error codes
+
+#include "util.h"               // Miscellaneous utilities
+
+/*----------------------------------------------------------------------------
+ * Internal Definitions
+ *----------------------------------------------------------------------------*/
+
+// The schema of the results that this program understands
+#define RESULT_SCHEMA           "axidma-bench/1"
+
+// The default percentage change that is considered a regression
+#define DEFAULT_THRESHOLD       5.0
+
+/* The critical value of the t statistic for a 99% two-sided confidence level.
+ * This is the large sample value, which is conservative enough for the number
+ * of transfers in a typical run. */
+#define T_CRITICAL              2.576
+
+// The longest line of results that will be read
+#define MAX_LINE_LEN            4096
+
+/* The pooled statistics for a metric. Each run reports its mean, standard
+ * deviation, and number of samples, so the runs are combined into one set. */
+struct metric {
+    double total;               // The sum of all the samples
+    double total_sq;            // The sum of all the squared samples
+    double num;                 // The number of samples
+    double p99;                 // The largest 99th percentile of the runs
+};
+
+// The results for a single test point
+struct test_point {
+    char test[128];             // The id of the test point
+    int runs;                   // The number of runs of the test point
+    struct metric throughput;   // The throughput of each transfer, in MiB/s
+    struct metric latency;      // The latency of each transfer, in us
+};
+
+// A set of results, from one or more files
+struct result_set {
+    struct test_point *points;  // The test points in the set
+    int len;                    // The number of test points
+    int capacity;               // The number of test points allocated
+};
+
+/*----------------------------------------------------------------------------
+ * Command-line Interface
+ *----------------------------------------------------------------------------*/
+
+// Prints the usage for this program
+static void print_usage(bool help)
+{
+    FILE* stream = (help) ? stdout : stderr;
+
+    fprintf(stream, "Usage: axidma_bench_compare [-t <threshold (%%)>] "
+            "<baseline results> <candidate results>...\n");
+    if (!help) {
+        return;
+    }
+
+    fprintf(stream, "\t-t <threshold (%%)>:\t\tThe change in throughput or "
+            "latency, as a percentage, that is considered a regression. "
+            "Default is %0.1f%%.\n", DEFAULT_THRESHOLD);
+    fprintf(stream, "\t<baseline results>:\t\tThe JSON results file written "
+            "by axidma_benchmark to compare against.\n");
+    fprintf(stream, "\t<candidate results>:\t\tOne or more JSON results files "
+            "to compare. The runs in all of the files are pooled.\n");
+    return;
+}
+
+// Parses the command line arguments for the threshold
+static int parse_args(int argc, char **argv, double *threshold)
+{
+    double double_arg;
+    char option;
+
+    *threshold = DEFAULT_THRESHOLD;
+
+    while ((option = getopt(argc, argv, "t:h")) != (char)-1)
+    {
+        switch (option)
+        {
+            // Parse the threshold argument
+            case 't':
+                if (parse_double(option, optarg, &double_arg) < 0 ||
+                        double_arg < 0.0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                *threshold = double_arg;
+                break;
+
+            // Print detailed usage message
+            case 'h':
+                print_usage(true);
+                exit(0);
+
+            default:
+                print_usage(false);
+                return -EINVAL;
+        }
+    }
+
+    // There must be a baseline and at least one candidate file
+    if (argc - optind < 2) {
+        fprintf(stderr, "Error: A baseline and candidate results file must be "
+                "specified.\n");
+        print_usage(false);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Result Parsing
+ *----------------------------------------------------------------------------*/
+
+/* Finds the string value for the given key in a line of results. The keys
+ * written by axidma_benchmark are unique across the whole line, so there is no
+ * need to track which object the key is in. */
+static int find_string(const char *line, const char *key, char *buf,
+        size_t size)
+{
+    char pattern[64];
+    const char *start, *end;
+
+    snprintf(pattern, sizeof(pattern), "\"%s\": \"", key);
+    start = strstr(line, pattern);
+    if (start == NULL) {
+        return -1;
+    }
+    start += strlen(pattern);
+    end = strchr(start, '"');
+    if (end == NULL || (size_t)(end - start) >= size) {
+        return -1;
+    }
+
+    memcpy(buf, start, end - start);
+    buf[end - start] = '\0';
+    return 0;
+}
+
+// Finds the numeric value for the given key in a line of results
+static int find_number(const char *line, const char *key, double *value)
+{
+    char pattern[64];
+    const char *start;
+    char *end;
+
+    snprintf(pattern, sizeof(pattern), "\"%s\": ", key);
+    start = strstr(line, pattern);
+    if (start == NULL) {
+        return -1;
+    }
+    start += strlen(pattern);
+    *value = strtod(start, &end);
+    return (end == start) ? -1 : 0;
+}
+
+// Finds the test point with the given id, adding it if it does not exist
+static struct test_point *find_point(struct result_set *set, const char *test)
+{
+    int i;
+    struct test_point *points;
+
+    for (i = 0; i < set->len; i++)
+    {
+        if (strcmp(set->points[i].test, test) == 0) {
+            return &set->points[i];
+        }
+    }
+
+    if (set->len == set->capacity) {
+        set->capacity = (set->capacity == 0) ? 16 : set->capacity * 2;
+        points = realloc(set->points, set->capacity * sizeof(points[0]));
+        if (points == NULL) {
+            return NULL;
+        }
+        set->points = points;
+    }
+
+    memset(&set->points[set->len], 0, sizeof(set->points[set->len]));
+    snprintf(set->points[set->len].test, sizeof(set->points[set->len].test),
+             "%s", test);
+    set->len += 1;
+    return &set->points[set->len - 1];
+}
+
+/* Adds a run to the pooled statistics for the metric. The sums are recovered
+ * from the mean and sample standard deviation that the run reports. */
+static void add_run(struct metric *metric, double num, double mean,
+        double stddev, double p99)
+{
+    metric->total += num * mean;
+    metric->total_sq += (num - 1) * stddev * stddev + num * mean * mean;
+    metric->num += num;
+    if (p99 > metric->p99) {
+        metric->p99 = p99;
+    }
+}
+
+// Reads all of the runs in the results file into the set
+static int read_results(const char *path, struct result_set *set)
+{
+    FILE *file;
+    int line_num, rc;
+    char line[MAX_LINE_LEN], schema[64], test[128];
+    double num, mean, stddev, p99;
+    struct test_point *point;
+
+    file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Unable to open results file '%s': %s.\n", path,
+                strerror(errno));
+        return -errno;
+    }
+
+    rc = 0;
+    for (line_num = 1; fgets(line, sizeof(line), file) != NULL; line_num++)
+    {
+        if (line[strspn(line, " \t\n")] == '\0') {
+            continue;
+        }
+
+        // Skip runs from a schema that is not understood
+        if (find_string(line, "schema", schema, sizeof(schema)) < 0 ||
+                strcmp(schema, RESULT_SCHEMA) != 0) {
+            fprintf(stderr, "Warning: %s:%d: Unknown schema, skipping.\n",
+                    path, line_num);
+            continue;
+        }
+        if (find_string(line, "test", test, sizeof(test)) < 0 ||
+                find_number(line, "samples", &num) < 0 || num < 1) {
+            fprintf(stderr, "Warning: %s:%d: Malformed results, skipping.\n",
+                    path, line_num);
+            continue;
+        }
+
+        point = find_point(set, test);
+        if (point == NULL) {
+            fprintf(stderr, "Unable to allocate the test points.\n");
+            rc = -ENOMEM;
+            break;
+        }
+        point->runs += 1;
+
+        if (find_number(line, "throughput_mean_mibps", &mean) == 0 &&
+                find_number(line, "throughput_stddev_mibps", &stddev) == 0 &&
+                find_number(line, "throughput_p99_mibps", &p99) == 0) {
+            add_run(&point->throughput, num, mean, stddev, p99);
+        }
+        if (find_number(line, "latency_mean_us", &mean) == 0 &&
+                find_number(line, "latency_stddev_us", &stddev) == 0 &&
+                find_number(line, "latency_p99_us", &p99) == 0) {
+            add_run(&point->latency, num, mean, stddev, p99);
+        }
+    }
+
+    fclose(file);
+    return rc;
+}
+
+/*----------------------------------------------------------------------------
+ * Comparison
+ *----------------------------------------------------------------------------*/
+
+// Computes the mean and variance of the pooled samples
+static void metric_stats(const struct metric *metric, double *mean,
+        double *variance)
+{
+    *mean = metric->total / metric->num;
+    *variance = 0.0;
+    if (metric->num > 1) {
+        *variance = (metric->total_sq - metric->num * (*mean) * (*mean)) /
+                    (metric->num - 1);
+        *variance = (*variance < 0.0) ? 0.0 : *variance;
+    }
+}
+
+/* Compares the metric between the baseline and candidate, printing the change
+ * and returning true if it is a regression. If higher values are better, then
+ * a decrease is a regression, otherwise an increase is. */
+static bool compare_metric(const char *name, const struct metric *base,
+        const struct metric *cand, bool higher_better, double threshold)
+{
+    double base_mean, base_var, cand_mean, cand_var, change, std_err, t;
+    bool worse, significant;
+
+    if (base->num == 0 || cand->num == 0) {
+        printf("    %-12s %12s\n", name, "no data");
+        return false;
+    }
+
+    metric_stats(base, &base_mean, &base_var);
+    metric_stats(cand, &cand_mean, &cand_var);
+    change = (base_mean != 0.0) ?
+             (cand_mean - base_mean) / base_mean * 100.0 : 0.0;
+
+    // Welch's t-test, since the runs may have different variances
+    std_err = sqrt(base_var / base->num + cand_var / cand->num);
+    t = (std_err > 0.0) ? (cand_mean - base_mean) / std_err : 0.0;
+    significant = (std_err == 0.0) ? (cand_mean != base_mean) :
+                  (fabs(t) >= T_CRITICAL);
+
+    worse = higher_better ? (change < -threshold) : (change > threshold);
+    printf("    %-12s %12.2f %12.2f %+9.2f%% %8.2f %10.2f %10.2f  %s\n", name,
+           base_mean, cand_mean, change, t, base->p99, cand->p99,
+           (worse && significant) ? "REGRESSION" :
+           significant ? "changed" : "");
+
+    return worse && significant;
+}
+
+/*----------------------------------------------------------------------------
+ * Main Function
+ *----------------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+    int rc, i, regressions;
+    double threshold;
+    struct result_set baseline, candidate;
+    struct test_point *base, *cand;
+
+    memset(&baseline, 0, sizeof(baseline));
+    memset(&candidate, 0, sizeof(candidate));
+
+    if (parse_args(argc, argv, &threshold) < 0) {
+        rc = 2;
+        goto ret;
+    }
+
+    // Read the baseline, and pool all of the candidate files together
+    if (read_results(argv[optind], &baseline) < 0) {
+        rc = 2;
+        goto free_results;
+    }
+    for (i = optind + 1; i < argc; i++)
+    {
+        if (read_results(argv[i], &candidate) < 0) {
+            rc = 2;
+            goto free_results;
+        }
+    }
+
+    // Compare each candidate test point against the same point in the baseline
+    regressions = 0;
+    printf("    %-12s %12s %12s %10s %8s %10s %10s\n", "Metric", "Baseline",
+           "Candidate", "Change", "t", "Base P99", "Cand P99");
+    for (i = 0; i < candidate.len; i++)
+    {
+        cand = &candidate.points[i];
+        base = find_point(&baseline, cand->test);
+        if (base == NULL || base->runs == 0) {
+            printf("%s: not in the baseline, skipping.\n", cand->test);
+            continue;
+        }
+
+        printf("%s (%d baseline runs, %d candidate runs):\n", cand->test,
+               base->runs, cand->runs);
+        if (compare_metric("MiB/s", &base->throughput, &cand->throughput,
+                           true, threshold)) {
+            regressions += 1;
+        }
+        if (compare_metric("Latency (us)", &base->latency, &cand->latency,
+                           false, threshold)) {
+            regressions += 1;
+        }
+    }
+
+    printf("\n%d regression(s) beyond %0.1f%% found.\n", regressions,
+           threshold);
+    rc = (regressions > 0) ? 1 : 0;
+
+free_results:
+    free(candidate.points);
+    free(baseline.points);
+ret:
+    return rc;
+}
@@ -15,6 +15,19 @@
  * the a given number of times to calculate the performance statistics. All of
  * these options are configurable from the command line.
  *
+ * With VDMA, the channels can instead be run continuously on a ring of frame
+ * stores for a fixed duration, as they would be with a camera or display. This
+ * reports the frame rate, the distribution of the interval between frames,
+ * and the effective bandwidth, at each of the given resolutions.
+ *
+ * The packed ADC samples received can also be unpacked into integers and floats
+ * with both the scalar and SIMD kernels, to check that the copy-out from DMA
+ * memory keeps up with the link.
+ *
+ * The results can also be appended to a file as a single line of JSON, along
+ * with the kernel, driver, and CPU they were measured on, so that runs can be
+ * archived and compared against each other with axidma_bench_compare.
+ *
  * NOTE: This program assumes that there are only two DMA channels being used by
  * the PL fabric, one that consumes data and sends it to the PL fabric logic,
  * and another that sends the output of the PL fabric back to memory. If you
@@ -39,10 +52,16 @@
 #include <sys/time.h>           // Timing functions and definitions
 #include <getopt.h>             // Option parsing
 #include <errno.h>              // Error codes
+#include <time.h>               // Clock and sleep functions
+#include <stdint.h>             // Fixed-width integer types
+#include <inttypes.h>           // Format specifiers for fixed-width types
+#include <math.h>               // Square root function
+#include <sys/utsname.h>        // Kernel version information
 
 #include "libaxidma.h"          // Interface to the AXI DMA
 #include "util.h"               // Miscellaneous utilities
 #include "conversion.h"         // Miscellaneous conversion utilities
+#include "sample.h"             // Sample unpacking
 
 /*----------------------------------------------------------------------------
  * Internal Definitons
@@ -60,6 +79,61 @@
 
 // The DMA context passed to the helper thread, who handles remainder channels
 
+// The real-time settings for the jitter measurement
+struct rt_config {
+    int period_us;              // Period of the loop, 0 disables the test
+    int cpu;                    // CPU to pin to, or -1 for any
+    int priority;               // SCHED_FIFO priority, or 0 for normal
+    bool lock_memory;           // Lock the process' memory with mlockall
+};
+
+// The default duration of the sustained frame rate test at each resolution
+#define DEFAULT_FRAME_DURATION      5.0
+
+// The most resolutions the sustained frame rate test can be run at
+#define MAX_RESOLUTIONS             16
+
+// How long to wait for a frame to complete before giving up, in milliseconds
+#define FRAME_TIMEOUT               1000
+
+// The settings for the sustained VDMA frame rate test
+struct frame_config {
+    int num_stores;             // Frame stores per channel, 0 disables the test
+    double duration;            // How long to run each resolution, in seconds
+    int num_resolutions;        // The number of resolutions to run at
+    struct axidma_video_frame resolutions[MAX_RESOLUTIONS];
+};
+
+// The number of times the received buffer is unpacked by each kernel
+#define UNPACK_ITERATIONS           20
+
+// The unpacking benchmark compares the SIMD kernels against the scalar ones
+#define NUM_KERNELS                 2
+
+// The version of the schema for the JSON results, bumped on incompatible changes
+#define RESULT_SCHEMA               "axidma-bench/1"
+
+// A summary of a set of samples
+struct summary {
+    int num;                    // The number of samples
+    double mean;                // The average of the samples
+    double stddev;              // The sample standard deviation
+    double min;                 // The smallest sample
+    double p50;                 // The median of the samples
+    double p99;                 // The 99th percentile of the samples
+    double max;                 // The largest sample
+};
+
+// The results of a benchmark run, in microseconds and MiB/s
+struct bench_result {
+    const char *mode;           // The benchmark that was run
+    double elapsed;             // Total time taken in seconds
+    struct summary latency;     // Latency of each transfer
+    struct summary throughput;  // Throughput of each transfer
+    bool have_wakeup;           // Indicates if the wake-up latency is valid
+    struct summary wakeup;      // How late the loop woke up, for jitter
+};
+
 /*----------------------------------------------------------------------------
  * Command-line Interface
  *----------------------------------------------------------------------------*/
@@ -74,7 +148,10 @@ static void print_usage(bool help)
             "[-r <(V)DMA rx channel>] [-i <Tx transfer size (MiB)>] "
             "[-b <Tx transfer size (bytes)>] [-f <Tx frame size (HxWxD)>] "
             "[-o <Rx transfer size (MiB)>] [-s <Rx transfer size (bytes)>] "
-            "[-g <Rx frame size (HxWxD)>] [-n <number transfers>]\n");
+            "[-g <Rx frame size (HxWxD)>] [-n <number transfers>] "
+            "[-j <jitter period (us)>] [-c <CPU>] [-p <priority>] [-m] "
+            "[-F <frame stores>] [-R <resolutions>] [-d <duration (s)>] "
+            "[-w <JSON results path>] [-u <sample format>]\n");
     if (!help) {
         return;
     }
@@ -107,14 +184,64 @@ static void print_usage(bool help)
     fprintf(stream, "\t-n <number transfers>:\t\t\tThe number of DMA transfers "
             "to perform to do the benchmark. Default is %d transfers.\n",
             DEFAULT_NUM_TRANSFERS);
+    fprintf(stream, "\t-j <jitter period (us)>:\t\tMeasure the jitter of a "
+            "periodic loop doing one transfer per period, like cyclictest, "
+            "instead of the throughput.\n");
+    fprintf(stream, "\t-c <CPU>:\t\t\tPin the loop and the driver's "
+            "completion threads to the given CPU.\n");
+    fprintf(stream, "\t-p <priority>:\t\t\tRun the loop and the driver's "
+            "completion threads with the given SCHED_FIFO priority.\n");
+    fprintf(stream, "\t-m:\t\t\t\tLock the process' memory with mlockall "
+            "before running the loop.\n");
+    fprintf(stream, "\t-F <frame stores>:\t\tWith -v, run the channels "
+            "continuously on the given number of frame stores, and measure "
+            "the sustained frame rate instead.\n");
+    fprintf(stream, "\t-R <resolutions>:\t\tA comma-separated list of "
+            "resolutions (HxWxD) to run the frame rate test at. Default is "
+            "the receive frame size.\n");
+    fprintf(stream, "\t-d <duration (s)>:\t\tHow long to run the frame rate "
+            "test at each resolution. Default is %0.1f s.\n",
+            DEFAULT_FRAME_DURATION);
+    fprintf(stream, "\t-w <JSON results path>:\t\tAppend the results to the "
+            "given file as a line of JSON, for axidma_bench_compare.\n");
+    fprintf(stream, "\t-u <sample format>:\t\tAfter the benchmark, time "
+            "unpacking the received buffer as ADC samples, one of 12le, 12be, "
+            "14le, 14be, 16le, or 16be.\n");
     return;
 }
 
+// Parses a comma-separated list of resolutions, each as HxWxD
+static int parse_resolutions(char *arg, struct frame_config *frames)
+{
+    char *token;
+    struct axidma_video_frame *frame;
+
+    frames->num_resolutions = 0;
+    for (token = strtok(arg, ","); token != NULL; token = strtok(NULL, ","))
+    {
+        frame = &frames->resolutions[frames->num_resolutions];
+        if (frames->num_resolutions == MAX_RESOLUTIONS ||
+                sscanf(token, "%dx%dx%d", &frame->height, &frame->width,
+                       &frame->depth) != 3 ||
+                frame->height <= 0 || frame->width <= 0 || frame->depth <= 0) {
+            fprintf(stderr, "Error: Invalid resolution '%s', at most %d "
+                    "resolutions of HxWxD can be given.\n", token,
+                    MAX_RESOLUTIONS);
+            return -EINVAL;
+        }
+        frames->num_resolutions += 1;
+    }
+
+    return (frames->num_resolutions > 0) ? 0 : -EINVAL;
+}
+
 /* Parses the command line arguments overriding the default transfer sizes,
  * and number of transfer to use for the benchmark if specified. */
 static int parse_args(int argc, char **argv, int *tx_channel, int *rx_channel,
         size_t *tx_size, struct axidma_video_frame *tx_frame, size_t *rx_size,
-        struct axidma_video_frame *rx_frame, int *num_transfers, bool *use_vdma)
+        struct axidma_video_frame *rx_frame, int *num_transfers, bool *use_vdma,
+        struct rt_config *rt, struct frame_config *frames, char **json_path,
+        struct sample_format *sample_format, bool *unpack_samples)
 {
     double double_arg;
     int int_arg;
@@ -134,8 +261,20 @@ static int parse_args(int argc, char **argv, int *tx_channel, int *rx_channel,
     rx_frame->width = -1;
     rx_frame->depth = -1;
     *num_transfers = DEFAULT_NUM_TRANSFERS;
-
-    while ((option = getopt(argc, argv, "vt:r:i:b:f:o:s:g:n:h")) != (char)-1)
+    rt->period_us = 0;
+    rt->cpu = -1;
+    rt->priority = 0;
+    rt->lock_memory = false;
+    frames->num_stores = 0;
+    frames->duration = DEFAULT_FRAME_DURATION;
+    frames->num_resolutions = 0;
+    *json_path = NULL;
+    *unpack_samples = false;
+    tx_frame_specified = false;
+    rx_frame_specified = false;
+
+    while ((option = getopt(argc, argv,
+                            "vt:r:i:b:f:o:s:g:n:j:c:p:mF:R:d:w:u:h")) != (char)-1)
     {
         switch (option)
         {
@@ -238,6 +377,83 @@ static int parse_args(int argc, char **argv, int *tx_channel, int *rx_channel,
                 *num_transfers = int_arg;
                 break;
 
+            // Parse the jitter measurement period argument
+            case 'j':
+                if (parse_int(option, optarg, &int_arg) < 0 || int_arg <= 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                rt->period_us = int_arg;
+                break;
+
+            // Parse the CPU to run the loop on
+            case 'c':
+                if (parse_int(option, optarg, &int_arg) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                rt->cpu = int_arg;
+                break;
+
+            // Parse the real-time priority argument
+            case 'p':
+                if (parse_int(option, optarg, &int_arg) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                rt->priority = int_arg;
+                break;
+
+            case 'm':
+                rt->lock_memory = true;
+                break;
+
+            // Parse the number of frame stores for the frame rate test
+            case 'F':
+                if (parse_int(option, optarg, &int_arg) < 0 || int_arg < 2 ||
+                        int_arg > AXIDMA_MAX_FRAME_BUFFERS) {
+                    fprintf(stderr, "Error: The number of frame stores must be "
+                            "between 2 and %d.\n", AXIDMA_MAX_FRAME_BUFFERS);
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                frames->num_stores = int_arg;
+                break;
+
+            // Parse the resolutions for the frame rate test
+            case 'R':
+                if (parse_resolutions(optarg, frames) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                break;
+
+            // Parse the duration of the frame rate test
+            case 'd':
+                if (parse_double(option, optarg, &double_arg) < 0 ||
+                        double_arg <= 0.0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                frames->duration = double_arg;
+                break;
+
+            // Parse the path to append the JSON results to
+            case 'w':
+                *json_path = optarg;
+                break;
+
+            // Parse the format of the samples to unpack the received data as
+            case 'u':
+                if (sample_parse_format(optarg, sample_format) < 0) {
+                    fprintf(stderr, "Error: Unknown sample format '%s'.\n",
+                            optarg);
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                *unpack_samples = true;
+                break;
+
             // Print detailed usage message
             case 'h':
                 print_usage(true);
@@ -262,6 +478,22 @@ static int parse_args(int argc, char **argv, int *tx_channel, int *rx_channel,
         return -EINVAL;
     }
 
+    // The frame rate test sets its own frame sizes with -R
+    if (frames->num_stores > 0) {
+        if (!*use_vdma) {
+            fprintf(stderr, "Error: The -F option requires -v.\n");
+            return -EINVAL;
+        } else if (frames->num_resolutions == 0 && !rx_frame_specified) {
+            fprintf(stderr, "Error: If -F is specified, then either -R or -g "
+                    "must also be specified.\n");
+            return -EINVAL;
+        } else if (frames->num_resolutions == 0) {
+            frames->resolutions[0] = *rx_frame;
+            frames->num_resolutions = 1;
+        }
+        return 0;
+    }
+
     if (*use_vdma && (!tx_frame_specified || !rx_frame_specified)) {
         fprintf(stderr, "Error: If -v is specified, then both -f and -g must "
                 "also be specified.\n");
@@ -403,6 +635,80 @@ static int single_transfer_test(axidma_dev_t dev, int tx_channel, void *tx_buf,
     return verify_data(tx_buf, rx_buf, tx_size, rx_size);
 }
 
+/*----------------------------------------------------------------------------
+ * Statistics
+ *----------------------------------------------------------------------------*/
+
+// Compares two samples for sorting
+static int compare_samples(const void *a, const void *b)
+{
+    double x, y;
+
+    x = *(const double *)a;
+    y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Summarizes the samples, sorting them in place
+static void summarize(double *samples, int num, struct summary *summary)
+{
+    int i;
+    double total, variance;
+
+    memset(summary, 0, sizeof(*summary));
+    summary->num = num;
+    if (num == 0) {
+        return;
+    }
+
+    qsort(samples, num, sizeof(samples[0]), compare_samples);
+    total = 0.0;
+    for (i = 0; i < num; i++)
+    {
+        total += samples[i];
+    }
+    summary->mean = total / num;
+
+    variance = 0.0;
+    for (i = 0; i < num; i++)
+    {
+        variance += (samples[i] - summary->mean) * (samples[i] - summary->mean);
+    }
+    summary->stddev = (num > 1) ? sqrt(variance / (num - 1)) : 0.0;
+
+    summary->min = samples[0];
+    summary->p50 = samples[(num - 1) / 2];
+    summary->p99 = samples[(int)((num - 1) * 0.99)];
+    summary->max = samples[num - 1];
+}
+
+// Prints the summary of a set of latency samples in microseconds
+static void print_summary(const char *name, struct summary *summary)
+{
+    printf("\t%s: Min %0.2f us, Avg %0.2f us, P99 %0.2f us, Max %0.2f us\n",
+           name, summary->min, summary->mean, summary->p99, summary->max);
+}
+
+/* Summarizes the transfer latencies, and the throughput of each transfer
+ * derived from them. The latencies are in microseconds. */
+static void summarize_transfers(double *latencies, int num, size_t total_size,
+        struct bench_result *result)
+{
+    int i;
+    double *throughputs;
+
+    throughputs = malloc(num * sizeof(throughputs[0]));
+    if (throughputs != NULL) {
+        for (i = 0; i < num; i++)
+        {
+            throughputs[i] = BYTE_TO_MIB(total_size) / (latencies[i] / 1e6);
+        }
+        summarize(throughputs, num, &result->throughput);
+        free(throughputs);
+    }
+    summarize(latencies, num, &result->latency);
+}
+
 /*----------------------------------------------------------------------------
  * Benchmarking Test
  *----------------------------------------------------------------------------*/
@@ -411,25 +717,38 @@ static int single_transfer_test(axidma_dev_t dev, int tx_channel, void *tx_buf,
  * of each channel in MiB/s. */
 static int time_dma(axidma_dev_t dev, int tx_channel, void *tx_buf, int tx_size,
         struct axidma_video_frame *tx_frame, int rx_channel, void *rx_buf,
-        int rx_size, struct axidma_video_frame *rx_frame, int num_transfers)
+        int rx_size, struct axidma_video_frame *rx_frame, int num_transfers,
+        struct bench_result *result)
 {
     int i, rc;
+    uint64_t transfer_start_ns;
+    double *latencies;
     struct timeval start_time, end_time;
     double elapsed_time, tx_data_rate, rx_data_rate;
 
+    // Allocate space for the latency of each transfer
+    latencies = malloc(num_transfers * sizeof(latencies[0]));
+    if (latencies == NULL) {
+        fprintf(stderr, "Unable to allocate the latency samples.\n");
+        return -ENOMEM;
+    }
+
     // Begin timing
     gettimeofday(&start_time, NULL);
 
     // Perform n transfers
     for (i = 0; i < num_transfers; i++)
     {
+        transfer_start_ns = axidma_time_ns();
         rc = axidma_twoway_transfer(dev, tx_channel, tx_buf, tx_size, tx_frame,
                 rx_channel, rx_buf, rx_size, rx_frame, true);
         if (rc < 0) {
             fprintf(stderr, "DMA failed on transfer %d, not reporting timing "
                     "results.\n", i+1);
+            free(latencies);
             return rc;
         }
+        latencies[i] = (axidma_time_ns() - transfer_start_ns) / 1000.0;
     }
 
     // End timing
@@ -440,13 +759,416 @@ static int time_dma(axidma_dev_t dev, int tx_channel, void *tx_buf, int tx_size,
     tx_data_rate = BYTE_TO_MIB(tx_size) * num_transfers / elapsed_time;
     rx_data_rate = BYTE_TO_MIB(rx_size) * num_transfers / elapsed_time;
 
+    // Summarize the transfers for the results file
+    memset(result, 0, sizeof(*result));
+    result->mode = "throughput";
+    result->elapsed = elapsed_time;
+    summarize_transfers(latencies, num_transfers, tx_size + rx_size, result);
+    free(latencies);
+
     // Report the statistics to the user
     printf("DMA Timing Statistics:\n");
     printf("\tElapsed Time: %0.2f s\n", elapsed_time);
     printf("\tTransmit Throughput: %0.2f MiB/s\n", tx_data_rate);
     printf("\tReceive Throughput: %0.2f MiB/s\n", rx_data_rate);
     printf("\tTotal Throughput: %0.2f MiB/s\n", tx_data_rate + rx_data_rate);
+    print_summary("Transfer Latency", &result->latency);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Sample Unpacking Test
+ *----------------------------------------------------------------------------*/
+
+// Gets the current time of the monotonic clock in seconds
+static double get_time(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/* Times unpacking the received buffer into integers and floats with each
+ * kernel, returning the rate of each in samples per second. */
+static int time_unpacking(const struct sample_format *format,
+        const void *rx_buf, int16_t *ints, float *floats, size_t num_samples,
+        float scale, double int_rates[NUM_KERNELS],
+        double float_rates[NUM_KERNELS])
+{
+    int i, kernel, rc;
+    double start_time;
+
+    for (kernel = 0; kernel < NUM_KERNELS; kernel++)
+    {
+        start_time = get_time();
+        for (i = 0; i < UNPACK_ITERATIONS; i++)
+        {
+            rc = sample_unpack_int16(format, rx_buf, ints, num_samples,
+                                     kernel == 1);
+            if (rc < 0) {
+                return rc;
+            }
+        }
+        int_rates[kernel] = num_samples * UNPACK_ITERATIONS /
+                            (get_time() - start_time);
+
+        start_time = get_time();
+        for (i = 0; i < UNPACK_ITERATIONS; i++)
+        {
+            rc = sample_unpack_float(format, rx_buf, floats, num_samples,
+                                     scale, kernel == 1);
+            if (rc < 0) {
+                return rc;
+            }
+        }
+        float_rates[kernel] = num_samples * UNPACK_ITERATIONS /
+                              (get_time() - start_time);
+    }
+
+    return 0;
+}
+
+/* Benchmarks unpacking the samples in the received buffer straight out of DMA
+ * memory into cached memory, with both the scalar and SIMD kernels, and
+ * compares the rates against the rate the samples arrived at. The floats are
+ * scaled to [-1, 1), and the outputs of the two kernels are compared. */
+static int benchmark_unpacking(const struct sample_format *format,
+        const void *rx_buf, size_t rx_size, double rx_data_rate)
+{
+    int rc, bits;
+    size_t num_samples, packed_size;
+    float scale;
+    double int_rates[NUM_KERNELS], float_rates[NUM_KERNELS], link_rate;
+    bool matches;
+    int16_t *ints, *int_reference;
+    float *floats, *float_reference;
+
+    // Unpack as many whole groups of samples as the buffer holds
+    bits = sample_format_bits(format);
+    num_samples = rx_size * 8 / bits;
+    num_samples -= num_samples % sample_group_size(format);
+    packed_size = sample_packed_size(format, num_samples);
+    scale = 1.0f / (1 << (bits - 1));
+    if (num_samples == 0) {
+        fprintf(stderr, "Error: The receive buffer is too small to hold any "
+                "%s samples.\n", sample_format_name(format));
+        return -EINVAL;
+    }
+
+    ints = malloc(num_samples * sizeof(ints[0]));
+    int_reference = malloc(num_samples * sizeof(int_reference[0]));
+    floats = malloc(num_samples * sizeof(floats[0]));
+    float_reference = malloc(num_samples * sizeof(float_reference[0]));
+    if (ints == NULL || int_reference == NULL || floats == NULL ||
+            float_reference == NULL) {
+        fprintf(stderr, "Unable to allocate the unpacked sample buffers.\n");
+        rc = -ENOMEM;
+        goto free_buffers;
+    }
+
+    rc = time_unpacking(format, rx_buf, ints, floats, num_samples, scale,
+                        int_rates, float_rates);
+    if (rc < 0) {
+        goto free_buffers;
+    }
+
+    // Check that the SIMD kernels match the scalar ones
+    sample_unpack_int16(format, rx_buf, int_reference, num_samples, false);
+    sample_unpack_int16(format, rx_buf, ints, num_samples, true);
+    sample_unpack_float(format, rx_buf, float_reference, num_samples, scale,
+                        false);
+    sample_unpack_float(format, rx_buf, floats, num_samples, scale, true);
+    matches = memcmp(ints, int_reference, num_samples * sizeof(ints[0])) == 0 &&
+              memcmp(floats, float_reference,
+                     num_samples * sizeof(floats[0])) == 0;
+
+    // The rate the samples arrived at over the link, in samples per second
+    link_rate = rx_data_rate * (1024 * 1024) * 8 / bits;
+
+    printf("Sample Unpacking Statistics (%s, %s, %zu samples in %0.2f "
+           "MiB):\n", sample_format_name(format), sample_simd_name(),
+           num_samples, BYTE_TO_MIB(packed_size));
+    printf("\tLink Rate: %0.2f Msamples/s\n", link_rate / 1e6);
+    printf("\tTo int16: Scalar %0.2f Msamples/s, SIMD %0.2f Msamples/s "
+           "(%0.2fx, %0.2fx the link)\n", int_rates[0] / 1e6,
+           int_rates[1] / 1e6, int_rates[1] / int_rates[0],
+           int_rates[1] / link_rate);
+    printf("\tTo float: Scalar %0.2f Msamples/s, SIMD %0.2f Msamples/s "
+           "(%0.2fx, %0.2fx the link)\n", float_rates[0] / 1e6,
+           float_rates[1] / 1e6, float_rates[1] / float_rates[0],
+           float_rates[1] / link_rate);
+    printf("\tSIMD Output: %s\n", matches ? "Matches scalar" : "MISMATCH");
+    rc = matches ? 0 : -EIO;
+
+free_buffers:
+    free(float_reference);
+    free(floats);
+    free(int_reference);
+    free(ints);
+    return rc;
+}
+
+/*----------------------------------------------------------------------------
+ * Jitter Test
+ *----------------------------------------------------------------------------*/
+
+/* Applies the real-time settings to this thread, and to the driver's completion
+ * threads for the channels used by the loop. */
+static int setup_realtime(axidma_dev_t dev, int tx_channel, int rx_channel,
+        struct rt_config *rt)
+{
+    int rc;
 
+    if (rt->cpu >= 0 && axidma_pin_thread(rt->cpu) < 0) {
+        return -1;
+    }
+    if (rt->priority > 0 && axidma_set_realtime(rt->priority) < 0) {
+        return -1;
+    }
+    if (rt->lock_memory && axidma_lock_memory() < 0) {
+        return -1;
+    }
+
+    if (rt->cpu >= 0 || rt->priority > 0) {
+        rc = axidma_set_completion_config(dev, tx_channel, rt->cpu,
+                                          rt->priority);
+        if (rc < 0) {
+            return rc;
+        }
+        rc = axidma_set_completion_config(dev, rx_channel, rt->cpu,
+                                          rt->priority);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+
+    return 0;
+}
+
+/* Runs a periodic loop like cyclictest, doing one transfer per period. This
+ * reports how late the loop woke up for each period, and how long the
+ * transfer took from when the loop woke up until the transfer completed. */
+static int measure_jitter(axidma_dev_t dev, int tx_channel, void *tx_buf,
+        int tx_size, struct axidma_video_frame *tx_frame, int rx_channel,
+        void *rx_buf, int rx_size, struct axidma_video_frame *rx_frame,
+        int num_transfers, struct rt_config *rt, struct bench_result *result)
+{
+    int i, rc;
+    uint64_t start_ns, next_ns, wakeup_ns, done_ns;
+    struct timespec next;
+    double *wakeups, *latencies;
+
+    rc = setup_realtime(dev, tx_channel, rx_channel, rt);
+    if (rc < 0) {
+        fprintf(stderr, "Unable to apply the real-time settings.\n");
+        return rc;
+    }
+
+    // Allocate space for the samples before the loop starts
+    wakeups = malloc(num_transfers * sizeof(wakeups[0]));
+    latencies = malloc(num_transfers * sizeof(latencies[0]));
+    if (wakeups == NULL || latencies == NULL) {
+        fprintf(stderr, "Unable to allocate the latency samples.\n");
+        rc = -ENOMEM;
+        goto free_samples;
+    }
+
+    // Sleep until the start of each period, then do the transfer
+    start_ns = axidma_time_ns();
+    next_ns = start_ns;
+    for (i = 0; i < num_transfers; i++)
+    {
+        next_ns += (uint64_t)rt->period_us * 1000;
+        next.tv_sec = next_ns / 1000000000ULL;
+        next.tv_nsec = next_ns % 1000000000ULL;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        wakeup_ns = axidma_time_ns();
+
+        rc = axidma_twoway_transfer(dev, tx_channel, tx_buf, tx_size, tx_frame,
+                rx_channel, rx_buf, rx_size, rx_frame, true);
+        if (rc < 0) {
+            fprintf(stderr, "DMA failed on transfer %d, not reporting jitter "
+                    "results.\n", i+1);
+            goto free_samples;
+        }
+        done_ns = axidma_time_ns();
+
+        wakeups[i] = (wakeup_ns > next_ns) ? (wakeup_ns - next_ns) / 1000.0 : 0;
+        latencies[i] = (done_ns - wakeup_ns) / 1000.0;
+    }
+
+    // Summarize the samples for the results file
+    memset(result, 0, sizeof(*result));
+    result->mode = "jitter";
+    result->elapsed = (axidma_time_ns() - start_ns) / 1e9;
+    result->have_wakeup = true;
+    summarize(wakeups, num_transfers, &result->wakeup);
+    summarize_transfers(latencies, num_transfers, tx_size + rx_size, result);
+
+    // Report the statistics to the user
+    printf("DMA Jitter Statistics:\n");
+    printf("\tPeriod: %d us, CPU: %d, Priority: %d, Memory Locked: %s\n",
+           rt->period_us, rt->cpu, rt->priority,
+           rt->lock_memory ? "yes" : "no");
+    print_summary("Wake-up Latency", &result->wakeup);
+    print_summary("Transfer Latency", &result->latency);
+    rc = 0;
+
+free_samples:
+    free(latencies);
+    free(wakeups);
+    return rc;
+}
+
+/*----------------------------------------------------------------------------
+ * Result Archiving
+ *----------------------------------------------------------------------------*/
+
+/* Reads the first line of the given file into the buffer, without the newline.
+ * If the file cannot be read, the buffer is set to "unknown". */
+static void read_first_line(const char *path, char *buf, size_t size)
+{
+    FILE *file;
+
+    snprintf(buf, size, "unknown");
+    file = fopen(path, "r");
+    if (file == NULL) {
+        return;
+    }
+    if (fgets(buf, size, file) == NULL) {
+        snprintf(buf, size, "unknown");
+    }
+    buf[strcspn(buf, "\n")] = '\0';
+    fclose(file);
+}
+
+/* Finds the name of the CPU model from /proc/cpuinfo. ARM kernels report it
+ * under a different key than x86 ones, so any of them are accepted. */
+static void read_cpu_model(char *buf, size_t size)
+{
+    FILE *file;
+    char line[256];
+    char *value;
+
+    snprintf(buf, size, "unknown");
+    file = fopen("/proc/cpuinfo", "r");
+    if (file == NULL) {
+        return;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        if (strncmp(line, "model name", 10) != 0 &&
+                strncmp(line, "Processor", 9) != 0 &&
+                strncmp(line, "Hardware", 8) != 0) {
+            continue;
+        }
+        value = strchr(line, ':');
+        if (value != NULL) {
+            value += strspn(value + 1, " \t") + 1;
+            value[strcspn(value, "\n")] = '\0';
+            snprintf(buf, size, "%s", value);
+            break;
+        }
+    }
+    fclose(file);
+}
+
+// Writes the string to the file as a JSON string, escaping it as needed
+static void write_json_string(FILE *file, const char *str)
+{
+    fputc('"', file);
+    for (; *str != '\0'; str++)
+    {
+        if (*str == '"' || *str == '\\') {
+            fputc('\\', file);
+            fputc(*str, file);
+        } else if ((unsigned char)*str >= 0x20) {
+            fputc(*str, file);
+        }
+    }
+    fputc('"', file);
+}
+
+// Writes the summary as the fields of a JSON object with the given prefix
+static void write_json_summary(FILE *file, const char *prefix,
+        const char *unit, struct summary *summary)
+{
+    fprintf(file, "\"%s_mean_%s\": %0.3f, \"%s_stddev_%s\": %0.3f, "
+            "\"%s_min_%s\": %0.3f, \"%s_p50_%s\": %0.3f, \"%s_p99_%s\": %0.3f, "
+            "\"%s_max_%s\": %0.3f", prefix, unit, summary->mean, prefix, unit,
+            summary->stddev, prefix, unit, summary->min, prefix, unit,
+            summary->p50, prefix, unit, summary->p99, prefix, unit,
+            summary->max);
+}
+
+/* Appends the results to the given file as a single line of JSON. The line
+ * records the system and configuration, along with a test id that identifies
+ * the test point, so that results for the same point can be compared. */
+static int write_result(const char *path, struct bench_result *result,
+        bool use_vdma, int tx_channel, size_t tx_size, int rx_channel,
+        size_t rx_size, int num_transfers, struct rt_config *rt)
+{
+    FILE *file;
+    struct utsname uts;
+    char test_id[128], driver_version[64], cpu_model[128], cpu_khz[64];
+
+    // Gather the information about the system the results were measured on
+    if (uname(&uts) < 0) {
+        memset(&uts, 0, sizeof(uts));
+    }
+    read_first_line("/sys/module/axidma/version", driver_version,
+                    sizeof(driver_version));
+    read_first_line("/sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq",
+                    cpu_khz, sizeof(cpu_khz));
+    read_cpu_model(cpu_model, sizeof(cpu_model));
+    snprintf(test_id, sizeof(test_id), "%s-%s-tx%zu-rx%zu-p%d", result->mode,
+             use_vdma ? "vdma" : "dma", tx_size, rx_size, rt->period_us);
+
+    file = fopen(path, "a");
+    if (file == NULL) {
+        perror("Unable to open the JSON results file");
+        return -errno;
+    }
+
+    fprintf(file, "{\"schema\": \"%s\", \"test\": ", RESULT_SCHEMA);
+    write_json_string(file, test_id);
+    fprintf(file, ", \"timestamp\": %lld, ", (long long)time(NULL));
+    fprintf(file, "\"system\": {\"kernel\": ");
+    write_json_string(file, uts.release);
+    fprintf(file, ", \"machine\": ");
+    write_json_string(file, uts.machine);
+    fprintf(file, ", \"driver_version\": ");
+    write_json_string(file, driver_version);
+    fprintf(file, ", \"cpu\": ");
+    write_json_string(file, cpu_model);
+    fprintf(file, ", \"num_cpus\": %ld, \"cpu_khz\": ",
+            sysconf(_SC_NPROCESSORS_ONLN));
+    write_json_string(file, cpu_khz);
+    fprintf(file, "}, \"config\": {\"mode\": \"%s\", \"vdma\": %s, "
+            "\"tx_channel\": %d, \"rx_channel\": %d, \"tx_size\": %zu, "
+            "\"rx_size\": %zu, \"num_transfers\": %d, \"period_us\": %d, "
+            "\"cpu_pin\": %d, \"priority\": %d, \"memory_locked\": %s}, ",
+            result->mode, use_vdma ? "true" : "false", tx_channel, rx_channel,
+            tx_size, rx_size, num_transfers, rt->period_us, rt->cpu,
+            rt->priority, rt->lock_memory ? "true" : "false");
+    fprintf(file, "\"results\": {\"samples\": %d, \"elapsed_s\": %0.6f, ",
+            result->latency.num, result->elapsed);
+    write_json_summary(file, "throughput", "mibps", &result->throughput);
+    fprintf(file, ", ");
+    write_json_summary(file, "latency", "us", &result->latency);
+    if (result->have_wakeup) {
+        fprintf(file, ", ");
+        write_json_summary(file, "wakeup", "us", &result->wakeup);
+    }
+    fprintf(file, "}}\n");
+
+    if (fclose(file) != 0) {
+        perror("Unable to write the JSON results file");
+        return -errno;
+    }
     return 0;
 }
 
@@ -454,6 +1176,208 @@ static int time_dma(axidma_dev_t dev, int tx_channel, void *tx_buf, int tx_size,
  * Main Function
  *----------------------------------------------------------------------------*/
 
+/*----------------------------------------------------------------------------
+ * Frame Rate Test
+ *----------------------------------------------------------------------------*/
+
+/* Runs the VDMA channels continuously on a ring of frame stores at the given
+ * resolution for the configured duration, and records when each frame
+ * completes on the receive channel. The transmit channel displays its frame
+ * stores in circular mode, while the receive channel captures into a ring, so
+ * that the driver reports the sequence and timestamp of every frame. */
+static int run_frame_rate(axidma_dev_t dev, int tx_channel, int rx_channel,
+        struct axidma_video_frame *frame, struct frame_config *config,
+        struct bench_result *result, uint64_t *num_frames, uint32_t *stalls)
+{
+    int i, rc, index, num_intervals, max_intervals;
+    size_t frame_size;
+    uint64_t start_ns, first_sequence, last_sequence, first_ns, last_ns;
+    double *intervals, *new_intervals;
+    void *tx_bufs[AXIDMA_MAX_FRAME_BUFFERS], *rx_bufs[AXIDMA_MAX_FRAME_BUFFERS];
+    struct axidma_capture_frame capture;
+
+    // Allocate the frame stores for both channels
+    frame_size = (size_t)frame->height * frame->width * frame->depth;
+    memset(tx_bufs, 0, sizeof(tx_bufs));
+    memset(rx_bufs, 0, sizeof(rx_bufs));
+    for (i = 0; i < config->num_stores; i++)
+    {
+        tx_bufs[i] = axidma_malloc(dev, frame_size);
+        rx_bufs[i] = axidma_malloc(dev, frame_size);
+        if (tx_bufs[i] == NULL || rx_bufs[i] == NULL) {
+            perror("Unable to allocate the frame stores from the AXI DMA "
+                   "device");
+            rc = -ENOMEM;
+            goto free_stores;
+        }
+    }
+
+    // The interval samples grow as frames arrive, since the rate is unknown
+    max_intervals = 1024;
+    num_intervals = 0;
+    intervals = malloc(max_intervals * sizeof(intervals[0]));
+    if (intervals == NULL) {
+        fprintf(stderr, "Unable to allocate the frame interval samples.\n");
+        rc = -ENOMEM;
+        goto free_stores;
+    }
+
+    // Start both channels running continuously
+    rc = axidma_video_transfer(dev, tx_channel, frame->width, frame->height,
+            frame->depth, tx_bufs, config->num_stores);
+    if (rc < 0) {
+        fprintf(stderr, "Failed to start the transmit channel.\n");
+        goto free_intervals;
+    }
+    rc = axidma_capture_start(dev, rx_channel, frame->width, frame->height,
+            frame->depth, rx_bufs, config->num_stores);
+    if (rc < 0) {
+        fprintf(stderr, "Failed to start the receive channel.\n");
+        goto stop_tx;
+    }
+
+    /* Take every frame in order, releasing it right away so the hardware never
+     * waits on us. Only the gap between consecutive frames is an interval. */
+    first_sequence = 0;
+    last_sequence = 0;
+    first_ns = 0;
+    last_ns = 0;
+    start_ns = axidma_time_ns();
+    while (axidma_time_ns() - start_ns < config->duration * 1e9)
+    {
+        index = axidma_capture_acquire(dev, rx_channel, false, last_sequence,
+                FRAME_TIMEOUT, &capture);
+        if (index == -EAGAIN) {
+            fprintf(stderr, "No frame completed within %d ms.\n",
+                    FRAME_TIMEOUT);
+            rc = -ETIMEDOUT;
+            goto stop_rx;
+        } else if (index < 0) {
+            rc = index;
+            goto stop_rx;
+        }
+        axidma_capture_release(dev, rx_channel, index);
+
+        if (last_sequence == 0) {
+            first_sequence = capture.sequence;
+            first_ns = capture.timestamp_ns;
+        } else if (capture.sequence == last_sequence + 1) {
+            if (num_intervals == max_intervals) {
+                new_intervals = realloc(intervals,
+                        2 * max_intervals * sizeof(intervals[0]));
+                if (new_intervals == NULL) {
+                    fprintf(stderr, "Unable to grow the frame interval "
+                            "samples.\n");
+                    rc = -ENOMEM;
+                    goto stop_rx;
+                }
+                intervals = new_intervals;
+                max_intervals *= 2;
+            }
+            intervals[num_intervals] = (capture.timestamp_ns - last_ns) /
+                                       1000.0;
+            num_intervals += 1;
+        }
+        last_sequence = capture.sequence;
+        last_ns = capture.timestamp_ns;
+        *stalls = capture.stalls;
+    }
+
+    if (num_intervals == 0) {
+        fprintf(stderr, "Not enough consecutive frames completed to measure "
+                "the frame rate.\n");
+        rc = -EIO;
+        goto stop_rx;
+    }
+
+    // The frames completed between the first and last ones we saw
+    *num_frames = last_sequence - first_sequence;
+    memset(result, 0, sizeof(*result));
+    result->mode = "framerate";
+    result->elapsed = (last_ns - first_ns) / 1e9;
+    summarize_transfers(intervals, num_intervals, frame_size, result);
+    rc = 0;
+
+stop_rx:
+    axidma_stop_transfer(dev, rx_channel);
+stop_tx:
+    axidma_stop_transfer(dev, tx_channel);
+free_intervals:
+    free(intervals);
+free_stores:
+    for (i = 0; i < config->num_stores; i++)
+    {
+        if (tx_bufs[i] != NULL) {
+            axidma_free(dev, tx_bufs[i], frame_size);
+        }
+        if (rx_bufs[i] != NULL) {
+            axidma_free(dev, rx_bufs[i], frame_size);
+        }
+    }
+    return rc;
+}
+
+/* Measures the sustained frame rate of the VDMA channels at each resolution,
+ * reporting the frames per second, the distribution of the frame interval,
+ * and the effective bandwidth of each channel. */
+static int measure_frame_rate(axidma_dev_t dev, int tx_channel, int rx_channel,
+        struct frame_config *config, struct rt_config *rt,
+        const char *json_path)
+{
+    int i, rc;
+    size_t frame_size;
+    uint32_t stalls;
+    uint64_t num_frames;
+    double frame_rate;
+    struct axidma_video_frame *frame;
+    struct bench_result result;
+
+    for (i = 0; i < config->num_resolutions; i++)
+    {
+        frame = &config->resolutions[i];
+        frame_size = (size_t)frame->height * frame->width * frame->depth;
+        printf("Running %dx%dx%d (%0.2f MiB) on %d frame stores for %0.1f "
+               "s.\n", frame->height, frame->width, frame->depth,
+               BYTE_TO_MIB(frame_size), config->num_stores, config->duration);
+
+        num_frames = 0;
+        stalls = 0;
+        rc = run_frame_rate(dev, tx_channel, rx_channel, frame, config,
+                &result, &num_frames, &stalls);
+        if (rc < 0) {
+            fprintf(stderr, "Frame rate test failed at %dx%dx%d.\n",
+                    frame->height, frame->width, frame->depth);
+            return rc;
+        }
+
+        // Report the statistics to the user
+        frame_rate = num_frames / result.elapsed;
+        printf("Frame Rate Statistics:\n");
+        printf("\tFrames: %" PRIu64 " in %0.2f s\n", num_frames,
+               result.elapsed);
+        printf("\tFrame Rate: %0.2f frames/s\n", frame_rate);
+        printf("\tBandwidth: %0.2f MiB/s per channel\n",
+               BYTE_TO_MIB(frame_size) * frame_rate);
+        printf("\tCapture Stalls: %u\n", stalls);
+        print_summary("Frame Interval", &result.latency);
+        printf("\tFrame Interval Jitter: Stddev %0.2f us, P99-P50 %0.2f us, "
+               "Max-Min %0.2f us\n\n", result.latency.stddev,
+               result.latency.p99 - result.latency.p50,
+               result.latency.max - result.latency.min);
+
+        // Archive the results, if requested
+        if (json_path != NULL) {
+            rc = write_result(json_path, &result, true, tx_channel, frame_size,
+                              rx_channel, frame_size, num_frames, rt);
+            if (rc < 0) {
+                return rc;
+            }
+        }
+    }
+
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
     int rc;
@@ -465,16 +1389,28 @@ int main(int argc, char **argv)
     axidma_dev_t axidma_dev;
     const array_t *tx_chans, *rx_chans;
     struct axidma_video_frame transmit_frame, *tx_frame, receive_frame, *rx_frame;
+    struct rt_config rt;
+    struct frame_config frames;
+    struct bench_result result;
+    char *json_path;
+    struct axidma_device_stats start_stats, end_stats;
+    struct sample_format sample_format;
+    bool unpack_samples;
 
     // Check if the user overrided the default transfer size and number
     if (parse_args(argc, argv, &tx_channel, &rx_channel, &tx_size,
             &transmit_frame, &rx_size, &receive_frame, &num_transfers,
-            &use_vdma) < 0) {
+            &use_vdma, &rt, &frames, &json_path, &sample_format,
+            &unpack_samples) < 0) {
         rc = 1;
         goto ret;
     }
     printf("AXI DMA Benchmark Parameters:\n");
-    if (!use_vdma) {
+    if (frames.num_stores > 0) {
+        printf("\tFrame Stores: %d per channel\n", frames.num_stores);
+        printf("\tDuration: %0.1f s per resolution\n", frames.duration);
+        printf("\tResolutions: %d\n", frames.num_resolutions);
+    } else if (!use_vdma) {
         printf("\tTransmit Buffer Size: %0.2f MiB\n", BYTE_TO_MIB(tx_size));
         printf("\tReceive Buffer Size: %0.2f MiB\n", BYTE_TO_MIB(rx_size));
     } else {
@@ -485,7 +1421,10 @@ int main(int argc, char **argv)
                 receive_frame.height, receive_frame.width, receive_frame.depth,
                 BYTE_TO_MIB(rx_size));
     }
-    printf("\tNumber of DMA Transfers: %d transfers\n\n", num_transfers);
+    if (frames.num_stores == 0) {
+        printf("\tNumber of DMA Transfers: %d transfers\n", num_transfers);
+    }
+    printf("\n");
 
     // Initialize the AXI DMA device
     axidma_dev = axidma_init();
@@ -541,6 +1480,14 @@ int main(int argc, char **argv)
     printf("Using transmit channel %d and receive channel %d.\n", tx_channel,
            rx_channel);
 
+    // The frame rate test runs on its own frame stores, instead of the others
+    if (frames.num_stores > 0) {
+        printf("Beginning frame rate analysis of the VDMA engine.\n\n");
+        rc = measure_frame_rate(axidma_dev, tx_channel, rx_channel, &frames,
+                &rt, json_path);
+        goto free_rx_buf;
+    }
+
     // Transmit the buffer to DMA a single time
     rc = single_transfer_test(axidma_dev, tx_channel, tx_buf, tx_size,
             tx_frame, rx_channel, rx_buf, rx_size, rx_frame);
@@ -549,10 +1496,43 @@ int main(int argc, char **argv)
     }
     printf("Single transfer test successfully completed!\n");
 
-    // Time the DMA eingine
-    printf("Beginning performance analysis of the DMA engine.\n\n");
-    rc = time_dma(axidma_dev, tx_channel, tx_buf, tx_size, tx_frame,
-            rx_channel, rx_buf, rx_size, rx_frame, num_transfers);
+    /* The driver should not allocate any memory for transfers in steady state,
+     * so that their latency is deterministic. Check that it did not. */
+    memset(&start_stats, 0, sizeof(start_stats));
+    axidma_get_device_stats(axidma_dev, &start_stats);
+
+    // Measure the jitter of a periodic loop, if requested
+    if (rt.period_us > 0) {
+        printf("Beginning jitter analysis of the DMA engine.\n\n");
+        rc = measure_jitter(axidma_dev, tx_channel, tx_buf, tx_size, tx_frame,
+                rx_channel, rx_buf, rx_size, rx_frame, num_transfers, &rt,
+                &result);
+    } else {
+        // Time the DMA eingine
+        printf("Beginning performance analysis of the DMA engine.\n\n");
+        rc = time_dma(axidma_dev, tx_channel, tx_buf, tx_size, tx_frame,
+                rx_channel, rx_buf, rx_size, rx_frame, num_transfers, &result);
+    }
+
+    if (rc == 0 && axidma_get_device_stats(axidma_dev, &end_stats) == 0 &&
+            end_stats.transfer_allocations != start_stats.transfer_allocations) {
+        fprintf(stderr, "Warning: The driver made %u allocations during the "
+                "transfers.\n", end_stats.transfer_allocations -
+                start_stats.transfer_allocations);
+    }
+
+    // Archive the results, if requested
+    if (rc == 0 && json_path != NULL) {
+        rc = write_result(json_path, &result, use_vdma, tx_channel, tx_size,
+                          rx_channel, rx_size, num_transfers, &rt);
+    }
+
+    // Time unpacking the last buffer received, against the rate it arrived at
+    if (rc == 0 && unpack_samples) {
+        printf("\n");
+        rc = benchmark_unpacking(&sample_format, rx_buf, rx_size,
+                BYTE_TO_MIB(rx_size) * num_transfers / result.elapsed);
+    }
 
 free_rx_buf:
     axidma_free(axidma_dev, rx_buf, rx_size);
@@ -9,7 +9,10 @@
  * up to either a VGA or HDMI controller.
  *
  * The program reads the image into DMA memory, then repeatedly sends it out
- * over the PL fabric to display it on the device.
+ * over the PL fabric to display it on the device. Images in other pixel
+ * formats are converted into the XRGB8888 frame buffer as they are loaded.
+ * The conversion can also be benchmarked, comparing the SIMD kernels against
+ * the scalar ones.
  *
  * @bug No known bugs.
  **/
@@ -29,13 +32,18 @@
 #include <errno.h>              // Error codes
 #include <signal.h>             // Signal handling functions
 #include <string.h>             // Memory copy/move functions
+#include <time.h>               // Clock functions
 
 #include "axidma_ioctl.h"       // The AXI DMA IOCTL interface
+#include "pixel.h"              // Pixel format conversion
 
 // The default image size is 640x480
 #define DEFAULT_IMAGE_WIDTH     640
 #define DEFAULT_IMAGE_HEIGHT    480
 
+// The conversion benchmark compares the SIMD kernels against the scalar ones
+#define NUM_KERNELS             2
+
 /* Indicates if the program is still running. Used to communicate between the
  * signal handlers and the main thread. */
 static volatile bool running = true;
@@ -59,7 +67,8 @@ static void print_usage(bool help)
     FILE *stream = (help) ? stdout : stderr;
 
     fprintf(stream, "Usage: axidma_display_image <image path> [-w <image "
-            "width>] [-i <image height>].\n");
+            "width>] [-i <image height>] [-f <pixel format>] [-j <threads>] "
+            "[-B <iterations>].\n");
 
     if (!help) {
         return;
@@ -74,6 +83,13 @@ static void print_usage(bool help)
     fprintf(stream, "\t-t <DMA tx channel>:\tThe device id of the "
             "DMA channel to use for transmitting the image. Default is to use "
             "the lowest numbered channel available.\n");
+    fprintf(stream, "\t-f <pixel format>:\tThe pixel format of the image file, "
+            "one of xrgb8888, rgb888, bgr888, rgb565, or yuyv. Default is "
+            "xrgb8888.\n");
+    fprintf(stream, "\t-j <threads>:\t\tThe number of threads to convert the "
+            "image with. Default is 1.\n");
+    fprintf(stream, "\t-B <iterations>:\tInstead of displaying the image, "
+            "benchmark the conversion to and from the frame buffer format.\n");
     return;
 }
 
@@ -97,10 +113,12 @@ static int parse_int(char option, char *arg_str, int *data)
 }
 
 static int parse_args(int argc, char **argv, char **image_path,
-                      int *image_width, int *image_height, int *tx_channel)
+                      int *image_width, int *image_height, int *tx_channel,
+                      enum pixel_format *format, int *num_threads,
+                      int *num_iterations)
 {
     int rc;
-    int width, height, tx_channel_id;
+    int width, height, tx_channel_id, threads, iterations;
     char option;
 
     // Check that there are enough command line arguments
@@ -115,8 +133,11 @@ static int parse_args(int argc, char **argv, char **image_path,
     *image_width = DEFAULT_IMAGE_WIDTH;
     *image_height = DEFAULT_IMAGE_HEIGHT;
     *tx_channel = -1;
+    *format = PIXEL_XRGB8888;
+    *num_threads = 1;
+    *num_iterations = 0;
 
-    while ((option = getopt(argc, argv, "w:i:t:h")) != (char)-1)
+    while ((option = getopt(argc, argv, "w:i:t:f:j:B:h")) != (char)-1)
     {
         switch (option)
         {
@@ -147,6 +168,44 @@ static int parse_args(int argc, char **argv, char **image_path,
                 *tx_channel = tx_channel_id;
                 break;
 
+            // Parse the pixel format of the image
+            case 'f':
+                if (pixel_parse_format(optarg, format) < 0) {
+                    fprintf(stderr, "Error: Unknown pixel format '%s'.\n",
+                            optarg);
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                break;
+
+            // Parse the number of threads to convert the image with
+            case 'j':
+                rc = parse_int(option, optarg, &threads);
+                if (rc < 0) {
+                    return rc;
+                } else if (threads <= 0) {
+                    fprintf(stderr, "Error: The number of threads must be "
+                            "positive.\n");
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                *num_threads = threads;
+                break;
+
+            // Parse the number of iterations for the conversion benchmark
+            case 'B':
+                rc = parse_int(option, optarg, &iterations);
+                if (rc < 0) {
+                    return rc;
+                } else if (iterations <= 0) {
+                    fprintf(stderr, "Error: The number of iterations must be "
+                            "positive.\n");
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                *num_iterations = iterations;
+                break;
+
             case 'h':
                 print_usage(true);
                 exit(0);
@@ -227,15 +286,108 @@ static int find_dma_channel(int axidma_fd)
     return -ENODEV;
 }
 
+// Gets the current time of the monotonic clock in seconds
+static double get_time(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// Times the conversion with each kernel, returning the frame rate of each
+static int time_conversion(const struct pixel_image *src,
+        struct pixel_image *dst, int num_threads, int num_iterations,
+        double frame_rates[NUM_KERNELS])
+{
+    int i, kernel, rc;
+    double start_time;
+
+    for (kernel = 0; kernel < NUM_KERNELS; kernel++)
+    {
+        start_time = get_time();
+        for (i = 0; i < num_iterations; i++)
+        {
+            rc = pixel_convert(src, dst, kernel == 1, num_threads);
+            if (rc < 0) {
+                return rc;
+            }
+        }
+        frame_rates[kernel] = num_iterations / (get_time() - start_time);
+    }
+
+    return 0;
+}
+
+/* Benchmarks the conversion of the image into the frame buffer, as the display
+ * path does, and out of it into cached memory, as a capture path would. Both
+ * the scalar and SIMD kernels are timed, and their outputs are compared. */
+static int benchmark_conversion(struct pixel_image *image,
+        struct pixel_image *frame, int num_threads, int num_iterations)
+{
+    int rc;
+    size_t image_size;
+    double to_rates[NUM_KERNELS], from_rates[NUM_KERNELS];
+    bool matches;
+    struct pixel_image capture, reference;
+
+    // Allocate cached buffers to convert the frame buffer back into
+    image_size = image->stride * image->height;
+    capture = *image;
+    reference = *image;
+    capture.data = malloc(image_size);
+    reference.data = malloc(image_size);
+    if (capture.data == NULL || reference.data == NULL) {
+        fprintf(stderr, "Unable to allocate the capture buffers.\n");
+        rc = -ENOMEM;
+        goto free_buffers;
+    }
+
+    rc = time_conversion(image, frame, num_threads, num_iterations, to_rates);
+    if (rc < 0) {
+        goto free_buffers;
+    }
+    rc = time_conversion(frame, &capture, num_threads, num_iterations,
+            from_rates);
+    if (rc < 0) {
+        goto free_buffers;
+    }
+
+    // Check that a round trip through the SIMD kernels matches the scalar one
+    pixel_convert(image, frame, false, num_threads);
+    pixel_convert(frame, &reference, false, num_threads);
+    pixel_convert(image, frame, true, num_threads);
+    pixel_convert(frame, &capture, true, num_threads);
+    matches = (memcmp(capture.data, reference.data, image_size) == 0);
+
+    printf("Conversion Benchmark (%s, %s, %d threads):\n",
+           pixel_format_name(image->format), pixel_simd_name(), num_threads);
+    printf("\tTo Frame Buffer: Scalar %0.2f frames/s, SIMD %0.2f frames/s "
+           "(%0.2fx)\n", to_rates[0], to_rates[1], to_rates[1] / to_rates[0]);
+    printf("\tFrom Frame Buffer: Scalar %0.2f frames/s, SIMD %0.2f frames/s "
+           "(%0.2fx)\n", from_rates[0], from_rates[1],
+           from_rates[1] / from_rates[0]);
+    printf("\tSIMD Output: %s\n", matches ? "Matches scalar" : "MISMATCH");
+    rc = matches ? 0 : -EIO;
+
+free_buffers:
+    free(reference.data);
+    free(capture.data);
+    return rc;
+}
+
 int main(int argc, char **argv)
 {
     int rc;
     char *image_path;
     int axidma_fd, image_fd;
     int tx_channel;
-    int image_width, image_height, image_byte_size;
-    char *image_buf;
+    int image_width, image_height, image_byte_size, file_byte_size;
+    int num_threads, num_iterations;
+    char *image_buf, *file_buf;
     int bytes_remain;
+    enum pixel_format format;
+    struct pixel_image image, frame;
     sigset_t sig_mask;
     struct stat image_stat;
     struct axidma_video_transaction trans;
@@ -248,11 +400,12 @@ int main(int argc, char **argv)
 
     // Parse out the image path and image size
     if (parse_args(argc, argv, &image_path, &image_width, &image_height,
-                   &tx_channel) < 0) {
+                   &tx_channel, &format, &num_threads, &num_iterations) < 0) {
         rc = 1;
         goto ret;
     }
     image_byte_size = image_width * image_height * sizeof(int);
+    file_byte_size = image_width * image_height * pixel_format_depth(format);
 
     // Try opening the image
     image_fd = open(image_path, O_RDONLY);
@@ -290,26 +443,39 @@ int main(int argc, char **argv)
         goto close_axidma;
     }
 
+    /* An image in the frame buffer's format is read straight into it, while
+     * others are read into normal memory, and then converted into it. */
+    if (format == PIXEL_XRGB8888) {
+        file_buf = image_buf;
+    } else {
+        file_buf = malloc(file_byte_size);
+        if (file_buf == NULL) {
+            fprintf(stderr, "Unable to allocate the image file buffer.\n");
+            rc = 1;
+            goto free_image_buf;
+        }
+    }
+
     // Check the file size of the image
     rc = fstat(image_fd, &image_stat);
     if (rc < 0) {
         perror("Unable to get file statistics");
         rc = 1;
-        goto free_image_buf;
-    } else if (image_stat.st_size < (off_t)image_byte_size) {
+        goto free_file_buf;
+    } else if (image_stat.st_size < (off_t)file_byte_size) {
         fprintf(stderr, "Error: File is not large enough for a %dx%d image.\n",
                 image_width, image_height);
         rc = 1;
-        goto free_image_buf;
-    } else if (image_stat.st_size > (off_t)image_byte_size) {
+        goto free_file_buf;
+    } else if (image_stat.st_size > (off_t)file_byte_size) {
         printf("Warning: File is too large for a %dx%d image. It will be "
                "truncated.\n", image_width, image_height);
     }
 
     // Read the image into the buffer (accounting for EINTR's)
-    bytes_remain = image_byte_size;
+    bytes_remain = file_byte_size;
     do {
-        rc = read(image_fd, image_buf+image_byte_size-bytes_remain,
+        rc = read(image_fd, file_buf+file_byte_size-bytes_remain,
                   bytes_remain);
         bytes_remain = (rc > 0) ? bytes_remain - rc : bytes_remain;
     } while ((rc > 0 || rc == -EINTR) && bytes_remain > 0);
@@ -318,7 +484,27 @@ int main(int argc, char **argv)
     if (rc < 0) {
         perror("Unable to read image file");
         rc = -1;
-        goto free_image_buf;
+        goto free_file_buf;
+    }
+
+    // Convert the image into the frame buffer
+    image.data = file_buf;
+    image.width = image_width;
+    image.height = image_height;
+    image.stride = image_width * pixel_format_depth(format);
+    image.format = format;
+    frame.data = image_buf;
+    frame.width = image_width;
+    frame.height = image_height;
+    frame.stride = image_width * sizeof(int);
+    frame.format = PIXEL_XRGB8888;
+    if (num_iterations > 0) {
+        rc = benchmark_conversion(&image, &frame, num_threads, num_iterations);
+        goto free_file_buf;
+    } else if (format != PIXEL_XRGB8888 &&
+               pixel_convert(&image, &frame, true, num_threads) < 0) {
+        rc = 1;
+        goto free_file_buf;
     }
 
     // Initiate a video transfer to the PL fabric
@@ -331,7 +517,7 @@ int main(int argc, char **argv)
     if (ioctl(axidma_fd, AXIDMA_DMA_VIDEO_WRITE, &trans) < 0) {
         perror("Failed to perform a DMA video write transaction");
         rc = -1;
-        goto free_image_buf;
+        goto free_file_buf;
     }
     printf("Image display beginning.\n");
 
@@ -350,11 +536,15 @@ int main(int argc, char **argv)
     if (ioctl(axidma_fd, AXIDMA_STOP_DMA_CHANNEL, &chan_info) < 0) {
         perror("Unable to stop DMA transmit transfer");
         rc = -1;
-        goto free_image_buf;
+        goto free_file_buf;
     }
 
     rc = 0;
 
+free_file_buf:
+    if (file_buf != image_buf) {
+        free(file_buf);
+    }
 free_image_buf:
     munmap(image_buf, image_byte_size);
 close_axidma:
@@ -0,0 +1,566 @@
+/**
+ * @file axidma_grab.c
+ * @date Sunday, October 18, 2026 at 07:14:26 PM EDT
+ *
+ * This program continuously captures frames from a VDMA receive channel, and
+ * records them to a file. It is meant for recording high-rate camera feeds,
+ * and doubles as an end-to-end load test of the driver.
+ *
+ * The frames are captured into a ring of frame buffers with the driver's
+ * capture ring, so a frame is never overwritten while it is being written
+ * out. Each frame is handed to a pool of writer threads, which write it to the
+ * file with O_DIRECT, bypassing the page cache. The driver's frame buffers
+ * can't be used for O_DIRECT I/O directly, since the kernel can't pin them, so
+ * each writer first copies the frame into its own aligned buffer, and releases
+ * the frame back to the ring before the write.
+ *
+ * Each frame is written at the offset given by its sequence number, padded to
+ * the O_DIRECT alignment, so the writers can finish out of order. Frames the
+ * grabber missed are counted as capture drops, and frames that arrived while
+ * all of the writers were busy are counted as write drops. Both leave a hole
+ * in the file.
+ *
+ * @bug No known bugs.
+ **/
+
+#define _GNU_SOURCE             // O_DIRECT flag for open()
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>             // Memcpy and memset functions
+#include <stdint.h>             // Fixed-width integer types
+#include <inttypes.h>           // Format macros for fixed-width integers
+
+#include <fcntl.h>              // Flags for open()
+#include <unistd.h>             // Pwrite and close functions
+#include <pthread.h>            // Writer threads
+#include <getopt.h>             // Option parsing
+#include <errno.h>              // Error codes
+
+#include "util.h"               // Miscellaneous utilities
+#include "conversion.h"         // Convert bytes to MiBs
+#include "libaxidma.h"          // Interface to the AXI DMA library
+
+/*----------------------------------------------------------------------------
+ * Internal Definitions
+ *----------------------------------------------------------------------------*/
+
+// The default resolution of the frames
+#define DEFAULT_HEIGHT          1080
+#define DEFAULT_WIDTH           1920
+#define DEFAULT_DEPTH           3
+
+// The default number of frame buffers in the capture ring
+#define DEFAULT_FRAME_BUFFERS   8
+
+// The default number of writer threads, and the most that can be given
+#define DEFAULT_WRITERS         4
+#define MAX_WRITERS             32
+
+// The default and largest number of frames waiting for a writer
+#define DEFAULT_QUEUE_DEPTH     8
+#define MAX_QUEUE_DEPTH         AXIDMA_MAX_FRAME_BUFFERS
+
+// The default time to record for, in seconds
+#define DEFAULT_DURATION        10.0
+
+// How long to wait for a frame before reporting the channel as idle, in ms
+#define FRAME_TIMEOUT           1000
+
+/* The alignment of the buffers, offsets and lengths for O_DIRECT writes. This
+ * is the page size, which covers the logical block size of most devices. */
+#define DIRECT_IO_ALIGN         4096
+
+// A frame waiting to be written out
+struct write_job {
+    int index;                  // The index of the frame buffer
+    uint64_t sequence;          // The sequence number of the frame
+};
+
+// The state shared between the capture loop and the writers
+struct grabber {
+    axidma_dev_t dev;           // The AXI DMA device
+    int channel;                // The VDMA receive channel
+    int fd;                     // The file the frames are written to
+    void **frames;              // The frame buffers of the capture ring
+    size_t frame_size;          // The size of a frame
+    size_t stride;              // The size of a frame in the file
+    uint64_t first_sequence;    // The sequence of the first frame recorded
+
+    pthread_mutex_t lock;       // Protects the queue and the counters
+    pthread_cond_t ready;       // Signaled when a job is queued, or when done
+    struct write_job jobs[MAX_QUEUE_DEPTH];     // The queue of frames
+    int head;                   // The index of the oldest job in the queue
+    int count;                  // The number of jobs in the queue
+    int depth;                  // The most jobs the queue may hold
+    bool done;                  // No more frames will be queued
+
+    uint64_t captured;          // Frames acquired from the capture ring
+    uint64_t capture_drops;     // Frames the capture loop missed
+    uint64_t write_drops;       // Frames dropped because the queue was full
+    uint64_t written;           // Frames written to the file
+    uint64_t write_errors;      // Frames that failed to be written
+};
+
+// A writer thread and its aligned buffer
+struct writer {
+    pthread_t thread;           // The thread writing the frames
+    struct grabber *grab;       // The state shared with the capture loop
+    void *buf;                  // The aligned buffer the frames are copied to
+};
+
+// The configuration from the command line
+struct grab_config {
+    const char *path;           // The file to record to
+    int channel;                // The channel to capture on, or -1
+    int height;                 // The height of a frame in pixels
+    int width;                  // The width of a frame in pixels
+    int depth;                  // The number of bytes in a pixel
+    int num_frames;             // The number of frame buffers in the ring
+    int num_writers;            // The number of writer threads
+    int queue_depth;            // The most frames waiting for a writer
+    double duration;            // The time to record for, in seconds
+};
+
+/*----------------------------------------------------------------------------
+ * Command-line Interface
+ *----------------------------------------------------------------------------*/
+
+// Prints the usage for this program
+static void print_usage(bool help)
+{
+    FILE* stream = (help) ? stdout : stderr;
+
+    fprintf(stream, "Usage: axidma_grab -o <output path> [-c <channel>] "
+            "[-r <resolution>] [-f <frame buffers>] [-w <writers>] "
+            "[-q <queue depth>] [-d <duration (s)>]\n");
+    if (!help) {
+        return;
+    }
+
+    fprintf(stream, "\t-o <output path>:\t\tThe file to record the frames to. "
+            "The file system must support O_DIRECT.\n");
+    fprintf(stream, "\t-c <channel>:\t\t\tThe VDMA receive channel to capture "
+            "on. Default is the first one.\n");
+    fprintf(stream, "\t-r <resolution>:\t\tThe resolution of the frames, as "
+            "<height>x<width>x<depth>. Default is %dx%dx%d.\n", DEFAULT_HEIGHT,
+            DEFAULT_WIDTH, DEFAULT_DEPTH);
+    fprintf(stream, "\t-f <frame buffers>:\t\tThe number of frame buffers in "
+            "the capture ring. Default is %d.\n", DEFAULT_FRAME_BUFFERS);
+    fprintf(stream, "\t-w <writers>:\t\t\tThe number of writer threads. "
+            "Default is %d.\n", DEFAULT_WRITERS);
+    fprintf(stream, "\t-q <queue depth>:\t\tThe most frames that can wait for "
+            "a writer before frames are dropped. Default is %d.\n",
+            DEFAULT_QUEUE_DEPTH);
+    fprintf(stream, "\t-d <duration (s)>:\t\tHow long to record for. Default "
+            "is %0.1f s.\n", DEFAULT_DURATION);
+    return;
+}
+
+// Parses a positive integer option, at most the given maximum
+static int parse_count(char option, char *arg, int max, int *value)
+{
+    if (parse_int(option, arg, value) < 0) {
+        return -EINVAL;
+    } else if (*value <= 0 || *value > max) {
+        fprintf(stderr, "Error: The argument to -%c must be between 1 and "
+                "%d.\n", option, max);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+// Parses the command line arguments for the grabber
+static int parse_args(int argc, char **argv, struct grab_config *config)
+{
+    char option;
+    double double_arg;
+
+    config->path = NULL;
+    config->channel = -1;
+    config->height = DEFAULT_HEIGHT;
+    config->width = DEFAULT_WIDTH;
+    config->depth = DEFAULT_DEPTH;
+    config->num_frames = DEFAULT_FRAME_BUFFERS;
+    config->num_writers = DEFAULT_WRITERS;
+    config->queue_depth = DEFAULT_QUEUE_DEPTH;
+    config->duration = DEFAULT_DURATION;
+
+    while ((option = getopt(argc, argv, "o:c:r:f:w:q:d:h")) != (char)-1)
+    {
+        switch (option)
+        {
+            // Parse the output path
+            case 'o':
+                config->path = optarg;
+                break;
+
+            // Parse the channel to capture on
+            case 'c':
+                if (parse_int(option, optarg, &config->channel) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                break;
+
+            // Parse the resolution of the frames
+            case 'r':
+                if (parse_resolution(option, optarg, &config->height,
+                            &config->width, &config->depth) < 0 ||
+                        config->height <= 0 || config->width <= 0 ||
+                        config->depth <= 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                break;
+
+            // Parse the number of frame buffers
+            case 'f':
+                if (parse_count(option, optarg, AXIDMA_MAX_FRAME_BUFFERS,
+                                &config->num_frames) < 0 ||
+                        config->num_frames < 2) {
+                    fprintf(stderr, "Error: At least 2 frame buffers are "
+                            "needed.\n");
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                break;
+
+            // Parse the number of writers
+            case 'w':
+                if (parse_count(option, optarg, MAX_WRITERS,
+                                &config->num_writers) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                break;
+
+            // Parse the depth of the write queue
+            case 'q':
+                if (parse_count(option, optarg, MAX_QUEUE_DEPTH,
+                                &config->queue_depth) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                break;
+
+            // Parse the duration of the recording
+            case 'd':
+                if (parse_double(option, optarg, &double_arg) < 0 ||
+                        double_arg <= 0.0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                config->duration = double_arg;
+                break;
+
+            // Print detailed usage message
+            case 'h':
+                print_usage(true);
+                exit(0);
+
+            default:
+                print_usage(false);
+                return -EINVAL;
+        }
+    }
+
+    if (config->path == NULL) {
+        fprintf(stderr, "Error: An output path must be given with -o.\n");
+        print_usage(false);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Writer Threads
+ *----------------------------------------------------------------------------*/
+
+/* Writes out the frames from the queue until the capture loop is done and the
+ * queue is empty. */
+static void *write_frames(void *arg)
+{
+    ssize_t rc;
+    off_t offset;
+    struct write_job job;
+    struct writer *writer;
+    struct grabber *grab;
+
+    writer = arg;
+    grab = writer->grab;
+    while (true)
+    {
+        // Take the oldest frame from the queue
+        pthread_mutex_lock(&grab->lock);
+        while (grab->count == 0 && !grab->done)
+        {
+            pthread_cond_wait(&grab->ready, &grab->lock);
+        }
+        if (grab->count == 0) {
+            pthread_mutex_unlock(&grab->lock);
+            break;
+        }
+        job = grab->jobs[grab->head];
+        grab->head = (grab->head + 1) % MAX_QUEUE_DEPTH;
+        grab->count -= 1;
+        pthread_mutex_unlock(&grab->lock);
+
+        // Copy the frame out, so its frame buffer can capture the next one
+        memcpy(writer->buf, grab->frames[job.index], grab->frame_size);
+        axidma_capture_release(grab->dev, grab->channel, job.index);
+
+        offset = (off_t)(job.sequence - grab->first_sequence) * grab->stride;
+        rc = pwrite(grab->fd, writer->buf, grab->stride, offset);
+        if (rc < 0) {
+            perror("Failed to write the frame");
+        }
+
+        pthread_mutex_lock(&grab->lock);
+        if (rc == (ssize_t)grab->stride) {
+            grab->written += 1;
+        } else {
+            grab->write_errors += 1;
+        }
+        pthread_mutex_unlock(&grab->lock);
+    }
+
+    return NULL;
+}
+
+/* Queues a captured frame for the writers. If the queue is full, the frame is
+ * dropped, and released back to the capture ring straight away. */
+static void queue_frame(struct grabber *grab, int index, uint64_t sequence)
+{
+    int tail;
+    bool queued;
+
+    pthread_mutex_lock(&grab->lock);
+    queued = (grab->count < grab->depth);
+    if (queued) {
+        tail = (grab->head + grab->count) % MAX_QUEUE_DEPTH;
+        grab->jobs[tail].index = index;
+        grab->jobs[tail].sequence = sequence;
+        grab->count += 1;
+        pthread_cond_signal(&grab->ready);
+    } else {
+        grab->write_drops += 1;
+    }
+    pthread_mutex_unlock(&grab->lock);
+
+    if (!queued) {
+        axidma_capture_release(grab->dev, grab->channel, index);
+    }
+    return;
+}
+
+/*----------------------------------------------------------------------------
+ * Capture Loop
+ *----------------------------------------------------------------------------*/
+
+/* Acquires every frame from the capture ring in order for the given duration,
+ * handing each one to the writers. Returns the number of frames the hardware
+ * had no free frame buffer for. */
+static int64_t capture_frames(struct grabber *grab, double duration)
+{
+    int index;
+    uint64_t last_sequence, start_ns, duration_ns;
+    struct axidma_capture_frame frame;
+
+    last_sequence = 0;
+    frame.stalls = 0;
+    start_ns = axidma_time_ns();
+    duration_ns = (uint64_t)(duration * 1e9);
+    while (axidma_time_ns() - start_ns < duration_ns)
+    {
+        index = axidma_capture_acquire(grab->dev, grab->channel, false,
+                                       last_sequence, FRAME_TIMEOUT, &frame);
+        if (index == -EAGAIN) {
+            fprintf(stderr, "No frame was captured for %d ms.\n",
+                    FRAME_TIMEOUT);
+            continue;
+        } else if (index < 0) {
+            return index;
+        }
+
+        // Any gap in the sequence is frames reused before they were acquired
+        if (last_sequence == 0) {
+            grab->first_sequence = frame.sequence;
+        } else {
+            grab->capture_drops += frame.sequence - last_sequence - 1;
+        }
+        last_sequence = frame.sequence;
+        grab->captured += 1;
+        queue_frame(grab, index, frame.sequence);
+    }
+
+    return frame.stalls;
+}
+
+// Prints the results of the recording
+static void print_results(struct grabber *grab, int64_t stalls,
+        double elapsed)
+{
+    uint64_t offered;
+
+    offered = grab->captured + grab->capture_drops;
+    printf("Recorded for %0.2f s:\n", elapsed);
+    printf("\tFrames captured:\t%" PRIu64 " (%0.2f frames/s)\n",
+           grab->captured, grab->captured / elapsed);
+    printf("\tFrames written:\t\t%" PRIu64 " (%0.2f MiB/s)\n", grab->written,
+           BYTE_TO_MIB(grab->written * grab->frame_size) / elapsed);
+    printf("\tCapture drops:\t\t%" PRIu64 " (%0.2f%%)\n", grab->capture_drops,
+           (offered > 0) ? 100.0 * grab->capture_drops / offered : 0.0);
+    printf("\tWrite drops:\t\t%" PRIu64 " (%0.2f%%)\n", grab->write_drops,
+           (offered > 0) ? 100.0 * grab->write_drops / offered : 0.0);
+    printf("\tWrite errors:\t\t%" PRIu64 "\n", grab->write_errors);
+    printf("\tHardware stalls:\t%" PRId64 "\n", stalls);
+    printf("\tFrame stride in file:\t%zu bytes\n", grab->stride);
+    return;
+}
+
+/*----------------------------------------------------------------------------
+ * Main Function
+ *----------------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+    int rc, i, num_writers;
+    int64_t stalls;
+    uint64_t start_ns;
+    const array_t *rx_chans;
+    struct grab_config config;
+    struct grabber grab;
+    struct writer writers[MAX_WRITERS];
+
+    memset(&grab, 0, sizeof(grab));
+    pthread_mutex_init(&grab.lock, NULL);
+    pthread_cond_init(&grab.ready, NULL);
+    num_writers = 0;
+    stalls = 0;
+    start_ns = 0;
+    if (parse_args(argc, argv, &config) < 0) {
+        rc = 1;
+        goto ret;
+    }
+    grab.depth = config.queue_depth;
+    grab.frame_size = (size_t)config.height * config.width * config.depth;
+    grab.stride = (grab.frame_size + DIRECT_IO_ALIGN - 1) &
+                  ~(size_t)(DIRECT_IO_ALIGN - 1);
+
+    // Open the output file, bypassing the page cache
+    grab.fd = open(config.path, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+    if (grab.fd < 0) {
+        fprintf(stderr, "Unable to open '%s' for direct I/O: %s.\n",
+                config.path, strerror(errno));
+        rc = 1;
+        goto ret;
+    }
+
+    // Initialize the AXI DMA device, and find the channel to capture on
+    grab.dev = axidma_init();
+    if (grab.dev == NULL) {
+        fprintf(stderr, "Failed to initialize the AXI DMA device.\n");
+        rc = 1;
+        goto close_output;
+    }
+    rx_chans = axidma_get_vdma_rx(grab.dev);
+    if (config.channel < 0 && rx_chans->len > 0) {
+        config.channel = rx_chans->data[0];
+    }
+    for (i = 0; i < rx_chans->len && rx_chans->data[i] != config.channel; i++)
+    {
+        continue;
+    }
+    if (i == rx_chans->len) {
+        fprintf(stderr, "Error: There is no VDMA receive channel %d.\n",
+                config.channel);
+        rc = 1;
+        goto destroy_axidma;
+    }
+    grab.channel = config.channel;
+
+    // Allocate the frame buffers for the capture ring
+    grab.frames = calloc(config.num_frames, sizeof(grab.frames[0]));
+    if (grab.frames == NULL) {
+        fprintf(stderr, "Unable to allocate the frame buffer array.\n");
+        rc = 1;
+        goto destroy_axidma;
+    }
+    for (i = 0; i < config.num_frames; i++)
+    {
+        grab.frames[i] = axidma_malloc(grab.dev, grab.frame_size);
+        if (grab.frames[i] == NULL) {
+            fprintf(stderr, "Unable to allocate frame buffer %d.\n", i);
+            rc = 1;
+            goto free_frames;
+        }
+    }
+
+    // Start the writers, each with a buffer aligned for direct I/O
+    for (num_writers = 0; num_writers < config.num_writers; num_writers++)
+    {
+        writers[num_writers].grab = &grab;
+        if (posix_memalign(&writers[num_writers].buf, DIRECT_IO_ALIGN,
+                           grab.stride) != 0) {
+            fprintf(stderr, "Unable to allocate a writer's buffer.\n");
+            rc = 1;
+            goto stop_writers;
+        }
+        memset(writers[num_writers].buf, 0, grab.stride);
+        if (pthread_create(&writers[num_writers].thread, NULL, write_frames,
+                           &writers[num_writers]) != 0) {
+            fprintf(stderr, "Unable to start a writer thread.\n");
+            free(writers[num_writers].buf);
+            rc = 1;
+            goto stop_writers;
+        }
+    }
+
+    // Capture the frames until the duration is up
+    rc = axidma_capture_start(grab.dev, grab.channel, config.width,
+            config.height, config.depth, grab.frames, config.num_frames);
+    if (rc < 0) {
+        rc = 1;
+        goto stop_writers;
+    }
+    printf("Recording %dx%dx%d frames from channel %d to '%s' with %d "
+           "writer(s).\n", config.height, config.width, config.depth,
+           grab.channel, config.path, config.num_writers);
+    start_ns = axidma_time_ns();
+    stalls = capture_frames(&grab, config.duration);
+    rc = (stalls < 0) ? 1 : 0;
+
+stop_writers:
+    // Let the writers drain the queue before the capture is stopped
+    pthread_mutex_lock(&grab.lock);
+    grab.done = true;
+    pthread_cond_broadcast(&grab.ready);
+    pthread_mutex_unlock(&grab.lock);
+    for (i = 0; i < num_writers; i++)
+    {
+        pthread_join(writers[i].thread, NULL);
+        free(writers[i].buf);
+    }
+    if (rc == 0) {
+        print_results(&grab, stalls, (axidma_time_ns() - start_ns) / 1e9);
+    }
+    axidma_stop_transfer(grab.dev, grab.channel);
+free_frames:
+    for (i = 0; i < config.num_frames && grab.frames[i] != NULL; i++)
+    {
+        axidma_free(grab.dev, grab.frames[i], grab.frame_size);
+    }
+    free(grab.frames);
+destroy_axidma:
+    axidma_destroy(grab.dev);
+close_output:
+    close(grab.fd);
+ret:
+    pthread_cond_destroy(&grab.ready);
+    pthread_mutex_destroy(&grab.lock);
+    return rc;
+}
@@ -0,0 +1,889 @@
+/**
+ * @file axidma_loadgen.c
+ * @date Sunday, October 18, 2026 at 04:47:12 PM EDT
+ *
+ * This program generates a synthetic workload on one or more AXI DMA channels,
+ * and measures the latency of the transfers under it. Unlike the benchmark,
+ * which sends fixed-size transfers back to back, the transfer sizes are drawn
+ * from a distribution, and the transfers arrive according to an arrival
+ * process, independently of when the previous ones complete.
+ *
+ * The sizes can be fixed, uniform, lognormal, or drawn from an empirical
+ * histogram read from a file. The arrivals can be a Poisson process, bursts
+ * of Poisson arrivals separated by idle periods, or a fixed rate. The workload
+ * is run at each of the given offered loads in turn, and for each load the
+ * offered and achieved rates are reported, along with the latency percentiles.
+ *
+ * The latency of a transfer is measured from when it was scheduled to arrive
+ * until the driver saw it complete. When the channels cannot keep up, the
+ * time spent waiting for room to submit a transfer is included, so that the
+ * latency reflects the queueing the load causes.
+ *
+ * @bug No known bugs.
+ **/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>             // String functions
+#include <stdint.h>             // Fixed-width integer types
+#include <math.h>               // Logarithm and exponential functions
+#include <time.h>               // Sleep functions
+
+#include <getopt.h>             // Option parsing
+#include <errno.h>              // Error codes
+
+#include "util.h"               // Miscellaneous utilities
+#include "conversion.h"         // Convert bytes to MiBs
+#include "libaxidma.h"          // Interface to the AXI DMA library
+
+/*----------------------------------------------------------------------------
+ * Internal Definitions
+ *----------------------------------------------------------------------------*/
+
+// The default duration of the workload at each load, in seconds
+#define DEFAULT_DURATION        5.0
+
+// The default offered load, in transfers per second on each channel
+#define DEFAULT_LOAD            "1000"
+
+// The default distribution of transfer sizes
+#define DEFAULT_SIZES           "fixed:4096"
+
+// The default largest transfer size, which the sizes are clamped to
+#define DEFAULT_MAX_SIZE        (4 * 1024 * 1024)
+
+// The most loads, channels and histogram bins that can be given
+#define MAX_LOADS               32
+#define MAX_CHANNELS            16
+#define MAX_HIST_BINS           256
+
+/* The most transfers in-flight on a channel. This matches the number of
+ * transfers the driver and library track on each channel. */
+#define MAX_INFLIGHT            64
+
+// The types of transfer size distributions
+enum size_type {
+    SIZE_FIXED,                 // Always the same size
+    SIZE_UNIFORM,               // Uniform between a minimum and maximum
+    SIZE_LOGNORMAL,             // Lognormal with a median and shape
+    SIZE_HISTOGRAM,             // Drawn from weighted sizes in a file
+};
+
+// A distribution of transfer sizes
+struct size_dist {
+    enum size_type type;        // The type of the distribution
+    double param1;              // Fixed size, uniform minimum, or median
+    double param2;              // Uniform maximum, or lognormal sigma
+    int num_bins;               // The number of bins in the histogram
+    double sizes[MAX_HIST_BINS];    // The size of each bin
+    double cdf[MAX_HIST_BINS];  // The cumulative weight up to each bin
+    size_t max_size;            // The size transfers are clamped to
+};
+
+// The types of arrival processes
+enum arrival_type {
+    ARRIVAL_POISSON,            // Exponential times between arrivals
+    ARRIVAL_ONOFF,              // Poisson arrivals in bursts
+    ARRIVAL_FIXED,              // Evenly spaced arrivals
+};
+
+// An arrival process, whose average rate is set for each load
+struct arrival_process {
+    enum arrival_type type;     // The type of the arrival process
+    double on_s;                // The length of a burst, for on/off
+    double off_s;               // The idle time between bursts, for on/off
+};
+
+// The state of a channel while generating the workload
+struct load_channel {
+    int channel_id;             // The id of the channel
+    void *buf;                  // The buffer for the transfers
+    int inflight;               // The number of transfers in-flight
+    double next_s;              // Time of the next arrival, in seconds
+    double busy_s;              // Arrival time in the burst time, for on/off
+};
+
+// A transfer that is in-flight, matching an entry waited on
+struct pending_transfer {
+    uint64_t arrival_ns;        // When the transfer was scheduled to arrive
+    size_t len;                 // The length of the transfer
+    struct load_channel *chan;  // The channel the transfer is on
+};
+
+// The results of running the workload at a single load
+struct load_result {
+    uint64_t offered;           // The number of transfers that arrived
+    uint64_t offered_bytes;     // The number of bytes that arrived
+    uint64_t completed;         // The number of transfers that completed
+    uint64_t completed_bytes;   // The number of bytes that completed
+    uint64_t errors;            // The number of transfers that failed
+    uint64_t backlogged;        // Arrivals that waited for room to submit
+    double elapsed;             // Time until the last transfer finished
+    double *latencies;          // The latency of each transfer, in us
+    size_t num_latencies;       // The number of latency samples
+    size_t latency_capacity;    // The space allocated for the samples
+};
+
+// The state of the generator
+struct loadgen {
+    axidma_dev_t dev;                   // The AXI DMA device
+    struct size_dist sizes;             // The distribution of sizes
+    struct arrival_process arrivals;    // The arrival process
+    double rate;                        // The current load on each channel
+    struct load_channel channels[MAX_CHANNELS];     // The channels driven
+    int num_channels;                   // The number of channels
+    struct axidma_wait_entry entries[AXIDMA_MAX_WAIT_ENTRIES];
+    struct pending_transfer pending[AXIDMA_MAX_WAIT_ENTRIES];
+    int num_pending;                    // The number of in-flight transfers
+};
+
+// The configuration from the command line
+struct loadgen_config {
+    double loads[MAX_LOADS];    // The loads to run, in transfers/s per channel
+    int num_loads;              // The number of loads
+    double duration;            // The time to run each load, in seconds
+    long seed;                  // The seed for the random numbers
+    int channels[MAX_CHANNELS]; // The channels given, if any
+    int num_channels;           // The number of channels given
+};
+
+/*----------------------------------------------------------------------------
+ * Distributions
+ *----------------------------------------------------------------------------*/
+
+// Draws a uniform random number in (0, 1]
+static double draw_uniform()
+{
+    return 1.0 - drand48();
+}
+
+// Draws from the standard normal distribution with the Box-Muller transform
+static double draw_normal()
+{
+    return sqrt(-2.0 * log(draw_uniform())) * cos(2.0 * M_PI * drand48());
+}
+
+// Draws an exponential time between arrivals for the given rate
+static double draw_exponential(double rate)
+{
+    return -log(draw_uniform()) / rate;
+}
+
+// Draws a transfer size from the distribution, clamped to [1, max_size]
+static size_t draw_size(const struct size_dist *dist)
+{
+    int i;
+    double size, weight;
+
+    switch (dist->type)
+    {
+        case SIZE_FIXED:
+            size = dist->param1;
+            break;
+
+        case SIZE_UNIFORM:
+            size = dist->param1 + drand48() * (dist->param2 - dist->param1);
+            break;
+
+        case SIZE_LOGNORMAL:
+            size = dist->param1 * exp(dist->param2 * draw_normal());
+            break;
+
+        case SIZE_HISTOGRAM:
+            weight = drand48() * dist->cdf[dist->num_bins - 1];
+            for (i = 0; i < dist->num_bins - 1 && dist->cdf[i] <= weight; i++)
+            {
+                continue;
+            }
+            size = dist->sizes[i];
+            break;
+
+        default:
+            size = 1;
+            break;
+    }
+
+    if (size < 1.0) {
+        return 1;
+    } else if (size > dist->max_size) {
+        return dist->max_size;
+    }
+    return (size_t)size;
+}
+
+/* Advances the channel to its next arrival time for the given average rate.
+ * For on/off arrivals, the arrivals are a Poisson process in the time spent
+ * in bursts, at a higher rate so that the average rate is still met. */
+static void next_arrival(struct load_channel *chan,
+        const struct arrival_process *arrivals, double rate)
+{
+    double period, burst_rate;
+
+    switch (arrivals->type)
+    {
+        case ARRIVAL_POISSON:
+            chan->next_s += draw_exponential(rate);
+            break;
+
+        case ARRIVAL_ONOFF:
+            period = arrivals->on_s + arrivals->off_s;
+            burst_rate = rate * period / arrivals->on_s;
+            chan->busy_s += draw_exponential(burst_rate);
+            chan->next_s = floor(chan->busy_s / arrivals->on_s) * period +
+                           fmod(chan->busy_s, arrivals->on_s);
+            break;
+
+        case ARRIVAL_FIXED:
+            chan->next_s += 1.0 / rate;
+            break;
+    }
+
+    return;
+}
+
+// Reads the weighted sizes of an empirical histogram from a file
+static int read_histogram(const char *path, struct size_dist *dist)
+{
+    FILE *file;
+    char line[256];
+    double size, weight, total;
+
+    file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Unable to open histogram file '%s': %s.\n", path,
+                strerror(errno));
+        return -errno;
+    }
+
+    // Each line is a size and its weight, comments start with a '#'
+    total = 0.0;
+    dist->num_bins = 0;
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        if (line[strspn(line, " \t")] == '#' ||
+                sscanf(line, "%lf %lf", &size, &weight) != 2) {
+            continue;
+        }
+        if (dist->num_bins == MAX_HIST_BINS || size < 1.0 || weight < 0.0) {
+            fprintf(stderr, "Error: Invalid bin '%s' in the histogram, at most "
+                    "%d bins are supported.\n", strtok(line, "\n"),
+                    MAX_HIST_BINS);
+            fclose(file);
+            return -EINVAL;
+        }
+        total += weight;
+        dist->sizes[dist->num_bins] = size;
+        dist->cdf[dist->num_bins] = total;
+        dist->num_bins += 1;
+    }
+    fclose(file);
+
+    if (dist->num_bins == 0 || total <= 0.0) {
+        fprintf(stderr, "Error: The histogram '%s' has no bins.\n", path);
+        return -EINVAL;
+    }
+    return 0;
+}
+
+/* Parses the size distribution, in the form fixed:<size>,
+ * uniform:<min>:<max>, lognormal:<median>:<sigma>, or hist:<file>. */
+static int parse_sizes(char *arg, struct size_dist *dist)
+{
+    char *type, *param1, *param2;
+
+    type = strtok(arg, ":");
+    param1 = strtok(NULL, ":");
+    param2 = strtok(NULL, ":");
+    if (type == NULL || param1 == NULL) {
+        return -EINVAL;
+    }
+
+    if (strcmp(type, "hist") == 0) {
+        dist->type = SIZE_HISTOGRAM;
+        return read_histogram(param1, dist);
+    }
+
+    dist->param1 = strtod(param1, NULL);
+    dist->param2 = (param2 != NULL) ? strtod(param2, NULL) : 0.0;
+    if (strcmp(type, "fixed") == 0 && dist->param1 >= 1.0) {
+        dist->type = SIZE_FIXED;
+    } else if (strcmp(type, "uniform") == 0 && dist->param1 >= 1.0 &&
+               dist->param2 >= dist->param1) {
+        dist->type = SIZE_UNIFORM;
+    } else if (strcmp(type, "lognormal") == 0 && dist->param1 >= 1.0 &&
+               dist->param2 > 0.0) {
+        dist->type = SIZE_LOGNORMAL;
+    } else {
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+/* Parses the arrival process, in the form poisson, fixed, or
+ * onoff:<burst ms>:<idle ms>. */
+static int parse_arrivals(char *arg, struct arrival_process *arrivals)
+{
+    char *type, *on_ms, *off_ms;
+
+    type = strtok(arg, ":");
+    on_ms = strtok(NULL, ":");
+    off_ms = strtok(NULL, ":");
+    if (type == NULL) {
+        return -EINVAL;
+    }
+
+    if (strcmp(type, "poisson") == 0) {
+        arrivals->type = ARRIVAL_POISSON;
+    } else if (strcmp(type, "fixed") == 0) {
+        arrivals->type = ARRIVAL_FIXED;
+    } else if (strcmp(type, "onoff") == 0 && on_ms != NULL && off_ms != NULL) {
+        arrivals->type = ARRIVAL_ONOFF;
+        arrivals->on_s = strtod(on_ms, NULL) / 1000.0;
+        arrivals->off_s = strtod(off_ms, NULL) / 1000.0;
+        if (arrivals->on_s <= 0.0 || arrivals->off_s < 0.0) {
+            return -EINVAL;
+        }
+    } else {
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Command-line Interface
+ *----------------------------------------------------------------------------*/
+
+// Prints the usage for this program
+static void print_usage(bool help)
+{
+    FILE* stream = (help) ? stdout : stderr;
+
+    fprintf(stream, "Usage: axidma_loadgen [-c <channels>] [-s <sizes>] "
+            "[-a <arrivals>] [-l <loads>] [-d <duration (s)>] "
+            "[-m <max size (bytes)>] [-r <seed>]\n");
+    if (!help) {
+        return;
+    }
+
+    fprintf(stream, "\t-c <channels>:\t\t\tA comma-separated list of the "
+            "channels to drive. Default is all of the DMA transmit "
+            "channels.\n");
+    fprintf(stream, "\t-s <sizes>:\t\t\tThe distribution of transfer sizes "
+            "in bytes, one of fixed:<size>, uniform:<min>:<max>, "
+            "lognormal:<median>:<sigma>, or hist:<file>. The histogram file "
+            "has a size and weight on each line. Default is %s.\n",
+            DEFAULT_SIZES);
+    fprintf(stream, "\t-a <arrivals>:\t\t\tThe arrival process, one of "
+            "poisson, fixed, or onoff:<burst (ms)>:<idle (ms)>. Default is "
+            "poisson.\n");
+    fprintf(stream, "\t-l <loads>:\t\t\tA comma-separated list of the offered "
+            "loads to run, in transfers per second on each channel. Default "
+            "is %s.\n", DEFAULT_LOAD);
+    fprintf(stream, "\t-d <duration (s)>:\t\tHow long to run each load. "
+            "Default is %0.1f s.\n", DEFAULT_DURATION);
+    fprintf(stream, "\t-m <max size (bytes)>:\t\tThe largest transfer, which "
+            "sizes are clamped to. Default is %d bytes.\n", DEFAULT_MAX_SIZE);
+    fprintf(stream, "\t-r <seed>:\t\t\tThe seed for the random numbers. "
+            "Default is 1.\n");
+    return;
+}
+
+// Parses a comma-separated list of numbers into the array
+static int parse_list(char *arg, double *values, int max_values)
+{
+    int num_values;
+    char *token, *end;
+
+    num_values = 0;
+    for (token = strtok(arg, ","); token != NULL; token = strtok(NULL, ","))
+    {
+        if (num_values == max_values) {
+            return -EINVAL;
+        }
+        values[num_values] = strtod(token, &end);
+        if (end == token || *end != '\0') {
+            return -EINVAL;
+        }
+        num_values += 1;
+    }
+
+    return num_values;
+}
+
+// Parses the command line arguments for the workload
+static int parse_args(int argc, char **argv, struct loadgen *gen,
+        struct loadgen_config *config)
+{
+    char option;
+    int i, int_arg, rc;
+    double double_arg, channels[MAX_CHANNELS];
+    char default_sizes[] = DEFAULT_SIZES;
+    char default_load[] = DEFAULT_LOAD;
+
+    config->duration = DEFAULT_DURATION;
+    config->seed = 1;
+    config->num_channels = 0;
+    gen->sizes.max_size = DEFAULT_MAX_SIZE;
+    gen->arrivals.type = ARRIVAL_POISSON;
+    parse_sizes(default_sizes, &gen->sizes);
+    config->num_loads = parse_list(default_load, config->loads, MAX_LOADS);
+
+    while ((option = getopt(argc, argv, "c:s:a:l:d:m:r:h")) != (char)-1)
+    {
+        switch (option)
+        {
+            // Parse the list of channels
+            case 'c':
+                rc = parse_list(optarg, channels, MAX_CHANNELS);
+                if (rc <= 0) {
+                    fprintf(stderr, "Error: Invalid list of channels.\n");
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                for (i = 0; i < rc; i++)
+                {
+                    config->channels[i] = (int)channels[i];
+                }
+                config->num_channels = rc;
+                break;
+
+            // Parse the size distribution
+            case 's':
+                if (parse_sizes(optarg, &gen->sizes) < 0) {
+                    fprintf(stderr, "Error: Invalid size distribution.\n");
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                break;
+
+            // Parse the arrival process
+            case 'a':
+                if (parse_arrivals(optarg, &gen->arrivals) < 0) {
+                    fprintf(stderr, "Error: Invalid arrival process.\n");
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                break;
+
+            // Parse the list of loads
+            case 'l':
+                config->num_loads = parse_list(optarg, config->loads,
+                                               MAX_LOADS);
+                for (i = 0; i < config->num_loads; i++)
+                {
+                    if (config->loads[i] <= 0.0) {
+                        config->num_loads = -EINVAL;
+                    }
+                }
+                if (config->num_loads <= 0) {
+                    fprintf(stderr, "Error: Invalid list of loads.\n");
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                break;
+
+            // Parse the duration of each load
+            case 'd':
+                if (parse_double(option, optarg, &double_arg) < 0 ||
+                        double_arg <= 0.0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                config->duration = double_arg;
+                break;
+
+            // Parse the largest transfer size
+            case 'm':
+                if (parse_int(option, optarg, &int_arg) < 0 || int_arg <= 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                gen->sizes.max_size = int_arg;
+                break;
+
+            // Parse the random seed
+            case 'r':
+                if (parse_int(option, optarg, &int_arg) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                config->seed = int_arg;
+                break;
+
+            // Print detailed usage message
+            case 'h':
+                print_usage(true);
+                exit(0);
+
+            default:
+                print_usage(false);
+                return -EINVAL;
+        }
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Workload Generation
+ *----------------------------------------------------------------------------*/
+
+// Adds a latency sample to the results, growing the array as needed
+static int add_latency(struct load_result *result, double latency_us)
+{
+    size_t capacity;
+    double *latencies;
+
+    if (result->num_latencies == result->latency_capacity) {
+        capacity = (result->latency_capacity == 0) ? 4096 :
+                   2 * result->latency_capacity;
+        latencies = realloc(result->latencies, capacity * sizeof(latencies[0]));
+        if (latencies == NULL) {
+            return -ENOMEM;
+        }
+        result->latencies = latencies;
+        result->latency_capacity = capacity;
+    }
+
+    result->latencies[result->num_latencies++] = latency_us;
+    return 0;
+}
+
+/* Waits up to the timeout for any of the in-flight transfers to finish, and
+ * records the latency of each one that did. */
+static int reap_transfers(struct loadgen *gen, int timeout,
+        struct load_result *result)
+{
+    int i, j, rc;
+    uint64_t now_ns, complete_ns;
+
+    if (gen->num_pending == 0) {
+        return 0;
+    }
+
+    for (i = 0; i < gen->num_pending; i++)
+    {
+        gen->entries[i].status = AXIDMA_WAIT_PENDING;
+    }
+    rc = axidma_wait_any(gen->dev, gen->entries, gen->num_pending, timeout);
+    if (rc <= 0) {
+        return rc;
+    }
+
+    // Record the finished transfers, and compact the ones still in-flight
+    now_ns = axidma_time_ns();
+    for (i = 0, j = 0; i < gen->num_pending; i++)
+    {
+        if (gen->entries[i].status == AXIDMA_WAIT_PENDING) {
+            gen->entries[j] = gen->entries[i];
+            gen->pending[j] = gen->pending[i];
+            j += 1;
+            continue;
+        }
+
+        gen->pending[i].chan->inflight -= 1;
+        if (gen->entries[i].status == AXIDMA_WAIT_ERROR) {
+            result->errors += 1;
+            continue;
+        }
+
+        // Use the driver's completion time, if it recorded one
+        complete_ns = gen->entries[i].timestamps.complete_ns;
+        complete_ns = (complete_ns != 0) ? complete_ns : now_ns;
+        result->completed += 1;
+        result->completed_bytes += gen->pending[i].len;
+        if (add_latency(result, (complete_ns - gen->pending[i].arrival_ns) /
+                        1000.0) < 0) {
+            return -ENOMEM;
+        }
+    }
+    gen->num_pending = j;
+
+    return rc;
+}
+
+/* Handles completions until the given time, sleeping for the remainder once
+ * it is too close to wait on the driver, whose timeout is in milliseconds. */
+static int wait_until(struct loadgen *gen, uint64_t target_ns,
+        struct load_result *result)
+{
+    int rc;
+    uint64_t now_ns;
+    struct timespec target;
+
+    for (now_ns = axidma_time_ns(); now_ns < target_ns;
+         now_ns = axidma_time_ns())
+    {
+        if (gen->num_pending == 0 || target_ns - now_ns < 1000000) {
+            target.tv_sec = target_ns / 1000000000ULL;
+            target.tv_nsec = target_ns % 1000000000ULL;
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &target, NULL);
+            break;
+        }
+        rc = reap_transfers(gen, (target_ns - now_ns) / 1000000, result);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+
+    // Pick up anything that finished while sleeping
+    return reap_transfers(gen, 0, result);
+}
+
+// Submits a transfer that arrived on the channel at the given time
+static int submit_transfer(struct loadgen *gen, struct load_channel *chan,
+        uint64_t arrival_ns, struct load_result *result)
+{
+    int rc;
+    size_t len;
+
+    // If there is no room for the transfer, it waits for some to finish
+    if (chan->inflight == MAX_INFLIGHT ||
+            gen->num_pending == AXIDMA_MAX_WAIT_ENTRIES) {
+        result->backlogged += 1;
+    }
+    while (chan->inflight == MAX_INFLIGHT ||
+           gen->num_pending == AXIDMA_MAX_WAIT_ENTRIES)
+    {
+        rc = reap_transfers(gen, -1, result);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+
+    len = draw_size(&gen->sizes);
+    result->offered += 1;
+    result->offered_bytes += len;
+    rc = axidma_oneway_transfer_async(gen->dev, chan->channel_id, chan->buf,
+                                      len);
+    if (rc < 0) {
+        result->errors += 1;
+        return 0;
+    }
+
+    gen->entries[gen->num_pending].channel_id = chan->channel_id;
+    gen->entries[gen->num_pending].cookie = rc;
+    gen->pending[gen->num_pending].arrival_ns = arrival_ns;
+    gen->pending[gen->num_pending].len = len;
+    gen->pending[gen->num_pending].chan = chan;
+    gen->num_pending += 1;
+    chan->inflight += 1;
+
+    return 0;
+}
+
+/* Runs the workload at the current load for the given duration. The arrivals
+ * on each channel are independent, and are issued in order of their time. */
+static int run_load(struct loadgen *gen, double duration,
+        struct load_result *result)
+{
+    int i, rc;
+    uint64_t start_ns, arrival_ns;
+    struct load_channel *chan;
+
+    memset(result, 0, sizeof(*result));
+    for (i = 0; i < gen->num_channels; i++)
+    {
+        gen->channels[i].next_s = 0.0;
+        gen->channels[i].busy_s = 0.0;
+        next_arrival(&gen->channels[i], &gen->arrivals, gen->rate);
+    }
+
+    start_ns = axidma_time_ns();
+    while (true)
+    {
+        // Find the channel with the next arrival
+        chan = &gen->channels[0];
+        for (i = 1; i < gen->num_channels; i++)
+        {
+            if (gen->channels[i].next_s < chan->next_s) {
+                chan = &gen->channels[i];
+            }
+        }
+        if (chan->next_s >= duration) {
+            break;
+        }
+
+        arrival_ns = start_ns + (uint64_t)(chan->next_s * 1e9);
+        rc = wait_until(gen, arrival_ns, result);
+        if (rc < 0) {
+            return rc;
+        }
+        rc = submit_transfer(gen, chan, arrival_ns, result);
+        if (rc < 0) {
+            return rc;
+        }
+        next_arrival(chan, &gen->arrivals, gen->rate);
+    }
+
+    // Let the transfers still in-flight finish
+    while (gen->num_pending > 0)
+    {
+        rc = reap_transfers(gen, 1000, result);
+        if (rc < 0) {
+            return rc;
+        } else if (rc == 0) {
+            fprintf(stderr, "Transfers did not finish within 1 s, stopping "
+                    "the channels.\n");
+            for (i = 0; i < gen->num_channels; i++)
+            {
+                axidma_stop_transfer(gen->dev, gen->channels[i].channel_id);
+                gen->channels[i].inflight = 0;
+            }
+            result->errors += gen->num_pending;
+            gen->num_pending = 0;
+        }
+    }
+    result->elapsed = (axidma_time_ns() - start_ns) / 1e9;
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Reporting
+ *----------------------------------------------------------------------------*/
+
+// Compares two samples for sorting
+static int compare_samples(const void *a, const void *b)
+{
+    double x, y;
+
+    x = *(const double *)a;
+    y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Finds the given percentile of the sorted samples
+static double percentile(const double *samples, size_t num, double pct)
+{
+    if (num == 0) {
+        return 0.0;
+    }
+    return samples[(size_t)((num - 1) * pct / 100.0)];
+}
+
+// Prints the offered and achieved load, and the latency percentiles
+static void print_result(double rate, int num_channels, double duration,
+        struct load_result *result)
+{
+    size_t num;
+    double *samples;
+
+    samples = result->latencies;
+    num = result->num_latencies;
+    qsort(samples, num, sizeof(samples[0]), compare_samples);
+
+    printf("%10.1f  %10.1f  %10.1f  %10.2f  %10.2f  %9.1f  %9.1f  %9.1f  "
+           "%9.1f  %9.1f  %8llu  %6llu\n", rate * num_channels,
+           result->offered / duration, result->completed / result->elapsed,
+           BYTE_TO_MIB(result->offered_bytes) / duration,
+           BYTE_TO_MIB(result->completed_bytes) / result->elapsed,
+           percentile(samples, num, 50.0), percentile(samples, num, 90.0),
+           percentile(samples, num, 99.0), percentile(samples, num, 99.9),
+           percentile(samples, num, 100.0),
+           (unsigned long long)result->backlogged,
+           (unsigned long long)result->errors);
+    fflush(stdout);
+}
+
+/*----------------------------------------------------------------------------
+ * Main Function
+ *----------------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+    int rc, i;
+    const array_t *tx_chans;
+    struct loadgen *gen;
+    struct loadgen_config config;
+    struct load_result result;
+
+    // The generator is large, so it is kept off of the stack
+    gen = calloc(1, sizeof(*gen));
+    if (gen == NULL) {
+        fprintf(stderr, "Unable to allocate the generator.\n");
+        rc = 1;
+        goto ret;
+    }
+    memset(&result, 0, sizeof(result));
+    if (parse_args(argc, argv, gen, &config) < 0) {
+        rc = 1;
+        goto free_gen;
+    }
+    srand48(config.seed);
+
+    // Initialize the AXI DMA device
+    gen->dev = axidma_init();
+    if (gen->dev == NULL) {
+        fprintf(stderr, "Failed to initialize the AXI DMA device.\n");
+        rc = 1;
+        goto free_gen;
+    }
+
+    // Default to driving all of the transmit channels
+    tx_chans = axidma_get_dma_tx(gen->dev);
+    if (config.num_channels == 0) {
+        for (i = 0; i < tx_chans->len && i < MAX_CHANNELS; i++)
+        {
+            config.channels[i] = tx_chans->data[i];
+        }
+        config.num_channels = i;
+    }
+    if (config.num_channels == 0) {
+        fprintf(stderr, "Error: No transmit channels available to drive.\n");
+        rc = 1;
+        goto destroy_axidma;
+    }
+
+    // Allocate a buffer of the largest size for each channel
+    for (i = 0; i < config.num_channels; i++)
+    {
+        gen->channels[i].channel_id = config.channels[i];
+        gen->channels[i].buf = axidma_malloc(gen->dev, gen->sizes.max_size);
+        if (gen->channels[i].buf == NULL) {
+            fprintf(stderr, "Unable to allocate the buffer for channel %d.\n",
+                    config.channels[i]);
+            rc = 1;
+            goto free_buffers;
+        }
+        gen->num_channels += 1;
+    }
+
+    // Run the workload at each load
+    printf("Generating load on %d channel(s) for %0.1f s per load.\n\n",
+           gen->num_channels, config.duration);
+    printf("%10s  %10s  %10s  %10s  %10s  %9s  %9s  %9s  %9s  %9s  %8s  %6s\n",
+           "Target/s", "Offered/s", "Achieved/s", "Off MiB/s", "Ach MiB/s",
+           "P50(us)", "P90(us)", "P99(us)", "P99.9(us)", "Max(us)", "Backlog",
+           "Errors");
+    rc = 0;
+    for (i = 0; i < config.num_loads; i++)
+    {
+        gen->rate = config.loads[i];
+        if (run_load(gen, config.duration, &result) < 0) {
+            fprintf(stderr, "Failed to run the load of %0.1f transfers/s.\n",
+                    gen->rate);
+            rc = 1;
+            break;
+        }
+        print_result(gen->rate, gen->num_channels, config.duration, &result);
+        free(result.latencies);
+        result.latencies = NULL;
+    }
+
+free_buffers:
+    free(result.latencies);
+    for (i = 0; i < gen->num_channels; i++)
+    {
+        axidma_free(gen->dev, gen->channels[i].buf, gen->sizes.max_size);
+    }
+destroy_axidma:
+    axidma_destroy(gen->dev);
+free_gen:
+    free(gen);
+ret:
+    return rc;
+}
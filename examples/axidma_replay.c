@@ -0,0 +1,549 @@
+/**
+ * @file axidma_replay.c
+ * @date Sunday, October 18, 2026 at 03:58:44 PM EDT
+ *
+ * This program replays a workload trace recorded by the AXI DMA library. It
+ * re-issues the same stream of allocations and transfers, on the same
+ * channels and with the same sizes, so that a performance problem seen with a
+ * production program can be reproduced without the program itself.
+ *
+ * By default, each operation is issued at the same time relative to the start
+ * of the trace as it was originally, and the program reports how far behind
+ * that schedule it fell. Alternatively, the operations can be issued back to
+ * back as fast as possible. The contents of the buffers are not recorded, so
+ * only the timing of the workload is reproduced, not its data.
+ *
+ * A trace is recorded by setting the AXIDMA_TRACE environment variable to the
+ * path of the trace file when running the program, or by calling
+ * axidma_trace_start from it.
+ *
+ * @bug No known bugs.
+ **/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>             // Memset function
+#include <stdint.h>             // Fixed-width integer types
+#include <time.h>               // Sleep functions
+
+#include <getopt.h>             // Option parsing
+#include <errno.h>              // Error codes
+
+#include "util.h"               // Miscellaneous utilities
+#include "conversion.h"         // Convert bytes to MiBs
+#include "libaxidma.h"          // Interface to the AXI DMA library
+#include "axidma_trace.h"       // The workload trace format
+
+/*----------------------------------------------------------------------------
+ * Internal Definitions
+ *----------------------------------------------------------------------------*/
+
+// The most frame buffers supported for a video transfer in the trace
+#define MAX_FRAME_BUFFERS       32
+
+// A buffer allocated for the replay, indexed by its id in the trace
+struct replay_buffer {
+    void *addr;                 // The address of the buffer, NULL if freed
+    size_t size;                // The size of the buffer
+};
+
+// The state of the replay
+struct replay {
+    axidma_dev_t dev;           // The AXI DMA device
+    bool fast;                  // Issue the operations as fast as possible
+    struct replay_buffer *buffers;  // The buffers from the trace, by id
+    uint32_t num_buffers;       // The number of entries in the buffers array
+    struct replay_buffer scratch[2];    // Stand-ins for unknown buffers
+    struct axidma_wait_entry outstanding[AXIDMA_MAX_WAIT_ENTRIES];
+    int num_outstanding;        // The number of async transfers in-flight
+    uint64_t num_ops;           // The number of operations replayed
+    uint64_t num_skipped;       // The number of operations skipped
+    uint64_t num_failed;        // The number of operations that failed
+    uint64_t bytes;             // The number of bytes transferred
+    uint64_t max_late_ns;       // The furthest behind schedule the replay fell
+    uint64_t total_late_ns;     // The total time behind schedule
+};
+
+/*----------------------------------------------------------------------------
+ * Command-line Interface
+ *----------------------------------------------------------------------------*/
+
+// Prints the usage for this program
+static void print_usage(bool help)
+{
+    FILE* stream = (help) ? stdout : stderr;
+
+    fprintf(stream, "Usage: axidma_replay [-a] <trace file>\n");
+    if (!help) {
+        return;
+    }
+
+    fprintf(stream, "\t-a:\t\t\t\tIssue the operations as fast as possible, "
+            "instead of with their original timing.\n");
+    fprintf(stream, "\t<trace file>:\t\t\tThe trace to replay, recorded with "
+            "the AXIDMA_TRACE environment variable.\n");
+    return;
+}
+
+// Parses the command line arguments for the replay mode and trace path
+static int parse_args(int argc, char **argv, bool *fast, char **trace_path)
+{
+    char option;
+
+    *fast = false;
+
+    while ((option = getopt(argc, argv, "ah")) != (char)-1)
+    {
+        switch (option)
+        {
+            // Replay as fast as possible
+            case 'a':
+                *fast = true;
+                break;
+
+            // Print detailed usage message
+            case 'h':
+                print_usage(true);
+                exit(0);
+
+            default:
+                print_usage(false);
+                return -EINVAL;
+        }
+    }
+
+    if (argc - optind != 1) {
+        fprintf(stderr, "Error: A trace file must be specified.\n");
+        print_usage(false);
+        return -EINVAL;
+    }
+    *trace_path = argv[optind];
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Buffer Management
+ *----------------------------------------------------------------------------*/
+
+// Checks if the channel exists in the given array of channels
+static bool in_channels(const array_t *channels, int channel)
+{
+    int i;
+
+    for (i = 0; i < channels->len; i++)
+    {
+        if (channels->data[i] == channel) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Checks that the channel from the trace exists on this system
+static bool channel_exists(axidma_dev_t dev, int channel)
+{
+    return in_channels(axidma_get_dma_tx(dev), channel) ||
+           in_channels(axidma_get_dma_rx(dev), channel) ||
+           in_channels(axidma_get_vdma_tx(dev), channel) ||
+           in_channels(axidma_get_vdma_rx(dev), channel);
+}
+
+// Allocates the buffer with the given id from the trace
+static int alloc_buffer(struct replay *replay, uint32_t id, size_t size)
+{
+    uint32_t num_buffers;
+    struct replay_buffer *buffers;
+
+    // Grow the array of buffers to hold the id
+    if (id >= replay->num_buffers) {
+        num_buffers = (id + 1 > 2 * replay->num_buffers) ? id + 1 :
+                      2 * replay->num_buffers;
+        buffers = realloc(replay->buffers, num_buffers * sizeof(buffers[0]));
+        if (buffers == NULL) {
+            return -ENOMEM;
+        }
+        memset(&buffers[replay->num_buffers], 0,
+               (num_buffers - replay->num_buffers) * sizeof(buffers[0]));
+        replay->buffers = buffers;
+        replay->num_buffers = num_buffers;
+    }
+
+    replay->buffers[id].addr = axidma_malloc(replay->dev, size);
+    if (replay->buffers[id].addr == NULL) {
+        return -ENOMEM;
+    }
+    replay->buffers[id].size = size;
+
+    return 0;
+}
+
+// Frees the buffer with the given id from the trace, if it was allocated
+static void free_buffer(struct replay *replay, struct replay_buffer *buffer)
+{
+    if (buffer->addr != NULL) {
+        axidma_free(replay->dev, buffer->addr, buffer->size);
+        buffer->addr = NULL;
+        buffer->size = 0;
+    }
+    return;
+}
+
+/* Finds the buffer for a transfer of the given length. Buffers that were not
+ * allocated through the library while tracing are replaced by a scratch
+ * buffer, which is grown as needed. */
+static void *find_buffer(struct replay *replay, uint32_t id, size_t len,
+        int scratch)
+{
+    struct replay_buffer *buffer;
+
+    if (id != AXIDMA_TRACE_UNKNOWN_BUFFER && id < replay->num_buffers &&
+            replay->buffers[id].addr != NULL &&
+            replay->buffers[id].size >= len) {
+        return replay->buffers[id].addr;
+    }
+
+    buffer = &replay->scratch[scratch];
+    if (buffer->size < len) {
+        free_buffer(replay, buffer);
+        buffer->addr = axidma_malloc(replay->dev, len);
+        if (buffer->addr == NULL) {
+            return NULL;
+        }
+        buffer->size = len;
+    }
+
+    return buffer->addr;
+}
+
+/*----------------------------------------------------------------------------
+ * Replay
+ *----------------------------------------------------------------------------*/
+
+/* Waits for the outstanding async transfers, up to the given number of entries
+ * from the trace, removing the ones that finished. */
+static int wait_outstanding(struct replay *replay, int num_entries,
+        int timeout)
+{
+    int i, j, rc;
+
+    if (replay->num_outstanding == 0) {
+        return 0;
+    }
+    if (num_entries <= 0 || num_entries > replay->num_outstanding) {
+        num_entries = replay->num_outstanding;
+    }
+
+    for (i = 0; i < num_entries; i++)
+    {
+        replay->outstanding[i].status = AXIDMA_WAIT_PENDING;
+    }
+    rc = axidma_wait_any(replay->dev, replay->outstanding, num_entries,
+                         timeout);
+    if (rc < 0) {
+        return rc;
+    }
+
+    // Compact the outstanding transfers, dropping the finished ones
+    for (i = 0, j = 0; i < replay->num_outstanding; i++)
+    {
+        if (i < num_entries &&
+                replay->outstanding[i].status != AXIDMA_WAIT_PENDING) {
+            if (replay->outstanding[i].status == AXIDMA_WAIT_ERROR) {
+                replay->num_failed += 1;
+            }
+            continue;
+        }
+        replay->outstanding[j++] = replay->outstanding[i];
+    }
+    replay->num_outstanding = j;
+
+    return 0;
+}
+
+// Re-issues a single operation from the trace
+static int replay_op(struct replay *replay,
+        const struct axidma_trace_record *record)
+{
+    int i, rc;
+    void *buf, *rx_buf;
+    void *frame_buffers[MAX_FRAME_BUFFERS];
+    bool wait;
+
+    wait = (record->flags & AXIDMA_TRACE_WAIT) != 0;
+    switch (record->op)
+    {
+        case AXIDMA_TRACE_ALLOC:
+            return alloc_buffer(replay, record->buffer_id, record->len);
+
+        case AXIDMA_TRACE_FREE:
+            if (record->buffer_id < replay->num_buffers) {
+                free_buffer(replay, &replay->buffers[record->buffer_id]);
+            }
+            return 0;
+
+        case AXIDMA_TRACE_ONEWAY:
+            buf = find_buffer(replay, record->buffer_id, record->len, 0);
+            if (buf == NULL) {
+                return -ENOMEM;
+            }
+            replay->bytes += record->len;
+            return axidma_oneway_transfer(replay->dev, record->channel, buf,
+                                          record->len, wait);
+
+        case AXIDMA_TRACE_ONEWAY_ASYNC:
+            buf = find_buffer(replay, record->buffer_id, record->len, 0);
+            if (buf == NULL) {
+                return -ENOMEM;
+            }
+
+            // Make room for the transfer if the program never waited on them
+            if (replay->num_outstanding == AXIDMA_MAX_WAIT_ENTRIES) {
+                rc = wait_outstanding(replay, 0, -1);
+                if (rc < 0) {
+                    return rc;
+                }
+            }
+
+            rc = axidma_oneway_transfer_async(replay->dev, record->channel,
+                                              buf, record->len);
+            if (rc < 0) {
+                return rc;
+            }
+            replay->outstanding[replay->num_outstanding].channel_id =
+                    record->channel;
+            replay->outstanding[replay->num_outstanding].cookie = rc;
+            replay->num_outstanding += 1;
+            replay->bytes += record->len;
+            return 0;
+
+        case AXIDMA_TRACE_TWOWAY:
+            buf = find_buffer(replay, record->buffer_id, record->len, 0);
+            rx_buf = find_buffer(replay, record->rx_buffer_id, record->rx_len,
+                                 1);
+            if (buf == NULL || rx_buf == NULL) {
+                return -ENOMEM;
+            }
+            replay->bytes += record->len + record->rx_len;
+            return axidma_twoway_transfer(replay->dev, record->channel, buf,
+                    record->len, NULL, record->rx_channel, rx_buf,
+                    record->rx_len, NULL, wait);
+
+        case AXIDMA_TRACE_VIDEO:
+            // The frame buffers all share the first one's buffer
+            if (record->rx_channel <= 0 ||
+                    record->rx_channel > MAX_FRAME_BUFFERS) {
+                return -EINVAL;
+            }
+            buf = find_buffer(replay, record->buffer_id,
+                    (size_t)record->len * record->rx_len * record->rx_buffer_id,
+                    0);
+            if (buf == NULL) {
+                return -ENOMEM;
+            }
+            for (i = 0; i < record->rx_channel; i++)
+            {
+                frame_buffers[i] = buf;
+            }
+            return axidma_video_transfer(replay->dev, record->channel,
+                    record->len, record->rx_len, record->rx_buffer_id,
+                    frame_buffers, record->rx_channel);
+
+        case AXIDMA_TRACE_STOP:
+            axidma_stop_transfer(replay->dev, record->channel);
+            return 0;
+
+        case AXIDMA_TRACE_WAIT_ANY:
+            return wait_outstanding(replay, record->len,
+                    (record->rx_len == AXIDMA_TRACE_NO_TIMEOUT) ? -1 :
+                    (int)record->rx_len);
+
+        default:
+            replay->num_skipped += 1;
+            return 0;
+    }
+}
+
+// Checks that every channel used by the record exists on this system
+static bool record_channels_exist(axidma_dev_t dev,
+        const struct axidma_trace_record *record)
+{
+    switch (record->op)
+    {
+        case AXIDMA_TRACE_ONEWAY:
+        case AXIDMA_TRACE_ONEWAY_ASYNC:
+        case AXIDMA_TRACE_VIDEO:
+        case AXIDMA_TRACE_STOP:
+            return channel_exists(dev, record->channel);
+
+        case AXIDMA_TRACE_TWOWAY:
+            return channel_exists(dev, record->channel) &&
+                   channel_exists(dev, record->rx_channel);
+
+        default:
+            return true;
+    }
+}
+
+/* Replays all of the records in the trace file. Unless replaying as fast as
+ * possible, each operation waits until its original time relative to the start
+ * of the replay, and the lateness of each operation is recorded. */
+static int replay_trace(struct replay *replay, FILE *trace,
+        size_t record_size, uint64_t *trace_ns)
+{
+    int rc;
+    char *raw;
+    uint64_t start_ns, target_ns, now_ns;
+    struct timespec target;
+    struct axidma_trace_record record;
+
+    // Records from a later version may be larger, the extra fields are skipped
+    *trace_ns = 0;
+    raw = malloc(record_size);
+    if (raw == NULL) {
+        fprintf(stderr, "Unable to allocate the trace record.\n");
+        return -ENOMEM;
+    }
+
+    rc = 0;
+    start_ns = axidma_time_ns();
+    while (fread(raw, record_size, 1, trace) == 1)
+    {
+        memcpy(&record, raw, sizeof(record));
+        *trace_ns = record.timestamp_ns;
+        if (!record_channels_exist(replay->dev, &record)) {
+            replay->num_skipped += 1;
+            continue;
+        }
+
+        // Wait until the operation's original time, and measure how late it is
+        if (!replay->fast) {
+            target_ns = start_ns + record.timestamp_ns;
+            target.tv_sec = target_ns / 1000000000ULL;
+            target.tv_nsec = target_ns % 1000000000ULL;
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &target, NULL);
+            now_ns = axidma_time_ns();
+            if (now_ns > target_ns) {
+                replay->total_late_ns += now_ns - target_ns;
+                if (now_ns - target_ns > replay->max_late_ns) {
+                    replay->max_late_ns = now_ns - target_ns;
+                }
+            }
+        }
+
+        if (replay_op(replay, &record) < 0) {
+            replay->num_failed += 1;
+        }
+        replay->num_ops += 1;
+    }
+
+    if (ferror(trace)) {
+        perror("Unable to read the trace file");
+        rc = -EIO;
+    }
+
+    // Let any async transfers that were never waited on finish
+    while (replay->num_outstanding > 0)
+    {
+        if (wait_outstanding(replay, 0, -1) < 0) {
+            break;
+        }
+    }
+
+    free(raw);
+    return rc;
+}
+
+/*----------------------------------------------------------------------------
+ * Main Function
+ *----------------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+    int rc;
+    uint32_t i;
+    char *trace_path;
+    FILE *trace;
+    uint64_t start_ns, trace_ns;
+    double elapsed;
+    struct axidma_trace_header header;
+    struct replay replay;
+
+    memset(&replay, 0, sizeof(replay));
+    if (parse_args(argc, argv, &replay.fast, &trace_path) < 0) {
+        rc = 1;
+        goto ret;
+    }
+
+    // Open the trace and check that it is in a format we understand
+    trace = fopen(trace_path, "rb");
+    if (trace == NULL) {
+        perror("Unable to open the trace file");
+        rc = 1;
+        goto ret;
+    }
+    if (fread(&header, sizeof(header), 1, trace) != 1 ||
+            header.magic != AXIDMA_TRACE_MAGIC) {
+        fprintf(stderr, "Error: '%s' is not an AXI DMA trace.\n", trace_path);
+        rc = 1;
+        goto close_trace;
+    }
+    if (header.version != AXIDMA_TRACE_VERSION ||
+            header.record_size < sizeof(struct axidma_trace_record)) {
+        fprintf(stderr, "Error: Unsupported trace version %u.\n",
+                header.version);
+        rc = 1;
+        goto close_trace;
+    }
+
+    // Initialize the AXI DMA device
+    replay.dev = axidma_init();
+    if (replay.dev == NULL) {
+        fprintf(stderr, "Failed to initialize the AXI DMA device.\n");
+        rc = 1;
+        goto close_trace;
+    }
+
+    // Replay the trace
+    printf("Replaying '%s' %s.\n", trace_path, replay.fast ?
+           "as fast as possible" : "with its original timing");
+    start_ns = axidma_time_ns();
+    rc = (replay_trace(&replay, trace, header.record_size, &trace_ns) < 0) ?
+         1 : 0;
+    elapsed = (axidma_time_ns() - start_ns) / 1000000000.0;
+
+    // Report how the replay compared to the original run
+    printf("Replay Statistics:\n");
+    printf("\tOperations: %llu (%llu skipped, %llu failed)\n",
+           (unsigned long long)replay.num_ops,
+           (unsigned long long)replay.num_skipped,
+           (unsigned long long)replay.num_failed);
+    printf("\tOriginal Duration: %0.3f s\n", trace_ns / 1000000000.0);
+    printf("\tReplay Duration: %0.3f s\n", elapsed);
+    printf("\tThroughput: %0.2f MiB/s\n", BYTE_TO_MIB(replay.bytes) / elapsed);
+    if (!replay.fast && replay.num_ops > 0) {
+        printf("\tSchedule Lateness: Avg %0.2f us, Max %0.2f us\n",
+               replay.total_late_ns / 1000.0 / replay.num_ops,
+               replay.max_late_ns / 1000.0);
+    }
+    if (replay.num_failed > 0) {
+        rc = 1;
+    }
+
+    // Free any buffers the trace did not free
+    for (i = 0; i < replay.num_buffers; i++)
+    {
+        free_buffer(&replay, &replay.buffers[i]);
+    }
+    free_buffer(&replay, &replay.scratch[0]);
+    free_buffer(&replay, &replay.scratch[1]);
+    free(replay.buffers);
+
+    axidma_destroy(replay.dev);
+close_trace:
+    fclose(trace);
+ret:
+    return rc;
+}
@@ -0,0 +1,330 @@
+/**
+ * @file axidma_top.c
+ * @date Sunday, October 18, 2026 at 10:12:51 AM EDT
+ *
+ * This program is a live monitor for the AXI DMA channels, similar to iostat.
+ * Once per interval, it reads the per-channel counters from the driver's status
+ * page and statistics, and prints the throughput, transfer rate, number of
+ * transfers in-flight, 99th percentile latency, and error and timeout counts
+ * for each channel. It also reports how much DMA buffer memory is in use.
+ *
+ * The status page and statistics are shared by all processes using the
+ * driver, so this can be run alongside the program doing the transfers.
+ *
+ * @bug No known bugs.
+ **/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>             // Memset function
+#include <stdint.h>             // Fixed-width integer types
+
+#include <unistd.h>             // Sleep functions
+#include <getopt.h>             // Option parsing
+#include <errno.h>              // Error codes
+
+#include "util.h"               // Miscellaneous utilities
+#include "conversion.h"         // Convert bytes to MiBs
+#include "libaxidma.h"          // Interface to the AXI DMA library
+
+/*----------------------------------------------------------------------------
+ * Internal Definitions
+ *----------------------------------------------------------------------------*/
+
+// The default interval between updates, in seconds
+#define DEFAULT_INTERVAL        1.0
+
+// The state kept for each channel between updates
+struct channel_monitor {
+    int channel_id;                     // The id of the channel
+    const char *type;                   // The type of the channel (DMA/VDMA)
+    const char *dir;                    // The direction of the channel
+    bool have_status;                   // The status page has the channel
+    struct axidma_chan_status status;   // The last status page counters
+    struct axidma_chan_stats stats;     // The last channel statistics
+};
+
+/*----------------------------------------------------------------------------
+ * Command-line Interface
+ *----------------------------------------------------------------------------*/
+
+// Prints the usage for this program
+static void print_usage(bool help)
+{
+    FILE* stream = (help) ? stdout : stderr;
+
+    fprintf(stream, "Usage: axidma_top [-d <interval (s)>] "
+            "[-n <number of updates>]\n");
+    if (!help) {
+        return;
+    }
+
+    fprintf(stream, "\t-d <interval (s)>:\t\tThe time between updates in "
+            "seconds. Default is %0.1f s.\n", DEFAULT_INTERVAL);
+    fprintf(stream, "\t-n <number of updates>:\t\tThe number of updates to "
+            "print before exiting. Default is to run until interrupted.\n");
+    return;
+}
+
+// Parses the command line arguments for the interval and number of updates
+static int parse_args(int argc, char **argv, double *interval, int *num_updates)
+{
+    double double_arg;
+    int int_arg;
+    char option;
+
+    *interval = DEFAULT_INTERVAL;
+    *num_updates = 0;
+
+    while ((option = getopt(argc, argv, "d:n:h")) != (char)-1)
+    {
+        switch (option)
+        {
+            // Parse the update interval argument
+            case 'd':
+                if (parse_double(option, optarg, &double_arg) < 0 ||
+                        double_arg <= 0.0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                *interval = double_arg;
+                break;
+
+            // Parse the number of updates argument
+            case 'n':
+                if (parse_int(option, optarg, &int_arg) < 0 || int_arg < 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                *num_updates = int_arg;
+                break;
+
+            // Print detailed usage message
+            case 'h':
+                print_usage(true);
+                exit(0);
+
+            default:
+                print_usage(false);
+                return -EINVAL;
+        }
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Monitoring
+ *----------------------------------------------------------------------------*/
+
+// Adds the channels in the array to the list of channels to monitor
+static int add_channels(struct channel_monitor *monitors, int num_monitors,
+        const array_t *channels, const char *type, const char *dir)
+{
+    int i;
+
+    for (i = 0; i < channels->len; i++)
+    {
+        memset(&monitors[num_monitors], 0, sizeof(monitors[num_monitors]));
+        monitors[num_monitors].channel_id = channels->data[i];
+        monitors[num_monitors].type = type;
+        monitors[num_monitors].dir = dir;
+        num_monitors += 1;
+    }
+
+    return num_monitors;
+}
+
+/* Finds the 99th percentile latency from the transfers counted in the
+ * histogram during the interval, reporting the upper bound of its bucket in
+ * microseconds. Returns 0 if there were no transfers. */
+static uint64_t p99_latency(const struct axidma_chan_stats *last,
+                            const struct axidma_chan_stats *now)
+{
+    int i;
+    uint64_t total, count, target;
+
+    total = 0;
+    for (i = 0; i < AXIDMA_LATENCY_BUCKETS; i++)
+    {
+        total += now->latency_hist[i] - last->latency_hist[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    count = 0;
+    target = (total * 99 + 99) / 100;
+    for (i = 0; i < AXIDMA_LATENCY_BUCKETS - 1; i++)
+    {
+        count += now->latency_hist[i] - last->latency_hist[i];
+        if (count >= target) {
+            break;
+        }
+    }
+
+    return (uint64_t)1 << (i + 1);
+}
+
+// Reads the current counters for the channel
+static int read_channel(axidma_dev_t dev, struct channel_monitor *monitor,
+        struct axidma_chan_status *status, struct axidma_chan_stats *stats)
+{
+    if (axidma_get_chan_stats(dev, monitor->channel_id, stats) < 0) {
+        return -1;
+    }
+
+    // Without the status page, only the transfer rate can be computed
+    if (monitor->have_status) {
+        return axidma_get_status(dev, monitor->channel_id, status);
+    }
+    memset(status, 0, sizeof(*status));
+    status->completed = stats->irq_completions + stats->poll_completions;
+    return 0;
+}
+
+// Prints a line with the throughput and latency of the channel
+static void print_channel(struct channel_monitor *monitor,
+        struct axidma_chan_status *status, struct axidma_chan_stats *stats,
+        double elapsed)
+{
+    double mib_rate, transfer_rate;
+    uint64_t p99_us;
+
+    transfer_rate = (status->completed - monitor->status.completed) / elapsed;
+    mib_rate = BYTE_TO_MIB(status->bytes - monitor->status.bytes) / elapsed;
+    p99_us = p99_latency(&monitor->stats, stats);
+
+    printf("%4d  %-4s  %-2s  ", monitor->channel_id, monitor->type,
+           monitor->dir);
+    if (monitor->have_status) {
+        printf("%10.2f  ", mib_rate);
+    } else {
+        printf("%10s  ", "-");
+    }
+    printf("%10.1f  %8u  ", transfer_rate, stats->inflight);
+    if (p99_us != 0) {
+        printf("%10llu  ", (unsigned long long)p99_us);
+    } else {
+        printf("%10s  ", "-");
+    }
+    printf("%8u  %8u  %-4s\n", status->errors, stats->timeouts,
+           stats->polling ? "poll" : "irq");
+}
+
+// Prints the header and the device-wide buffer usage for an update
+static void print_header(axidma_dev_t dev)
+{
+    struct axidma_device_stats dev_stats;
+
+    if (axidma_get_device_stats(dev, &dev_stats) == 0) {
+        printf("DMA buffers: %u (%0.2f MiB), External buffers: %u "
+               "(%0.2f MiB), Pool buffers: %u (%0.2f MiB), Transfer "
+               "allocations: %u\n", dev_stats.num_allocations,
+               BYTE_TO_MIB(dev_stats.allocated_bytes), dev_stats.num_external,
+               BYTE_TO_MIB(dev_stats.external_bytes),
+               dev_stats.num_pool_buffers, BYTE_TO_MIB(dev_stats.pool_bytes),
+               dev_stats.transfer_allocations);
+    }
+    printf("Chan  Type  Dir      MiB/s     Xfers/s  Inflight     P99(us)  "
+           "  Errors  Timeouts  Mode\n");
+}
+
+/*----------------------------------------------------------------------------
+ * Main Function
+ *----------------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+    int rc, i, update, num_updates, num_monitors;
+    double interval, elapsed;
+    uint64_t last_ns, now_ns;
+    axidma_dev_t axidma_dev;
+    struct channel_monitor *monitors;
+    struct axidma_chan_status status;
+    struct axidma_chan_stats stats;
+
+    if (parse_args(argc, argv, &interval, &num_updates) < 0) {
+        rc = 1;
+        goto ret;
+    }
+
+    // Initialize the AXI DMA device
+    axidma_dev = axidma_init();
+    if (axidma_dev == NULL) {
+        fprintf(stderr, "Failed to initialize the AXI DMA device.\n");
+        rc = 1;
+        goto ret;
+    }
+
+    // Gather all of the channels in the system
+    num_monitors = axidma_get_dma_tx(axidma_dev)->len +
+                   axidma_get_dma_rx(axidma_dev)->len +
+                   axidma_get_vdma_tx(axidma_dev)->len +
+                   axidma_get_vdma_rx(axidma_dev)->len +
+                   axidma_get_cdma(axidma_dev)->len;
+    monitors = calloc(num_monitors, sizeof(monitors[0]));
+    if (monitors == NULL) {
+        fprintf(stderr, "Unable to allocate the channel monitors.\n");
+        rc = 1;
+        goto destroy_axidma;
+    }
+    num_monitors = add_channels(monitors, 0, axidma_get_dma_tx(axidma_dev),
+                                "DMA", "TX");
+    num_monitors = add_channels(monitors, num_monitors,
+                                axidma_get_dma_rx(axidma_dev), "DMA", "RX");
+    num_monitors = add_channels(monitors, num_monitors,
+                                axidma_get_vdma_tx(axidma_dev), "VDMA", "TX");
+    num_monitors = add_channels(monitors, num_monitors,
+                                axidma_get_vdma_rx(axidma_dev), "VDMA", "RX");
+    num_monitors = add_channels(monitors, num_monitors,
+                                axidma_get_cdma(axidma_dev), "CDMA", "--");
+
+    // Take the initial snapshot of the counters to compute the rates from
+    for (i = 0; i < num_monitors; i++)
+    {
+        monitors[i].have_status = true;
+        if (axidma_get_status(axidma_dev, monitors[i].channel_id,
+                              &monitors[i].status) < 0) {
+            monitors[i].have_status = false;
+        }
+        if (read_channel(axidma_dev, &monitors[i], &monitors[i].status,
+                         &monitors[i].stats) < 0) {
+            rc = 1;
+            goto free_monitors;
+        }
+    }
+    last_ns = axidma_time_ns();
+
+    // Print the rates for each channel once per interval
+    rc = 0;
+    for (update = 0; num_updates == 0 || update < num_updates; update++)
+    {
+        usleep((useconds_t)(interval * 1000000.0));
+        now_ns = axidma_time_ns();
+        elapsed = (now_ns - last_ns) / 1000000000.0;
+        last_ns = now_ns;
+
+        print_header(axidma_dev);
+        for (i = 0; i < num_monitors; i++)
+        {
+            if (read_channel(axidma_dev, &monitors[i], &status, &stats) < 0) {
+                rc = 1;
+                goto free_monitors;
+            }
+            print_channel(&monitors[i], &status, &stats, elapsed);
+            monitors[i].status = status;
+            monitors[i].stats = stats;
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+
+free_monitors:
+    free(monitors);
+destroy_axidma:
+    axidma_destroy(axidma_dev);
+ret:
+    return rc;
+}
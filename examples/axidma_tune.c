@@ -0,0 +1,651 @@
+/**
+ * @file axidma_tune.c
+ * @date Sunday, October 18, 2026 at 06:02:35 PM EDT
+ *
+ * This program tunes the stream settings for a pair of AXI DMA channels. It
+ * sweeps the chunk size, the number of chunks in-flight, the completion mode,
+ * and the poll interval that completions are coalesced over, streaming a
+ * buffer through the channels with each combination.
+ *
+ * For each combination, it measures the throughput, the 99th percentile
+ * latency of the chunks, and the CPU time used across the whole system, which
+ * includes the driver's interrupts and polling threads. The Xilinx DMA driver
+ * takes an interrupt for every transfer in every mode, so the poll modes only
+ * trade the callback for the polling thread, and show its extra CPU time. The combinations that
+ * are not beaten on all three by another one form the Pareto front. The best
+ * one on the front is written to a profile, which the library loads at
+ * initialization when the AXIDMA_PROFILE environment variable is set.
+ *
+ * On a loopback design, each stream can also be checked with CRC32C on a
+ * helper thread, so that settings which corrupt or drop data are rejected.
+ *
+ * @bug No known bugs.
+ **/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>             // String functions
+#include <stdint.h>             // Fixed-width integer types
+
+#include <unistd.h>             // Access and sysconf functions
+#include <getopt.h>             // Option parsing
+#include <errno.h>              // Error codes
+
+#include "util.h"               // Miscellaneous utilities
+#include "conversion.h"         // Convert bytes to MiBs
+#include "libaxidma.h"          // Interface to the AXI DMA library
+
+/*----------------------------------------------------------------------------
+ * Internal Definitions
+ *----------------------------------------------------------------------------*/
+
+// The default size of the buffer streamed for each combination, in MiB
+#define DEFAULT_STREAM_SIZE     16.0
+
+// The default values to sweep for each setting
+#define DEFAULT_CHUNK_SIZES     "16384,65536,262144,1048576"
+#define DEFAULT_DEPTHS          "1,2,4,8,16"
+#define DEFAULT_MODES           "irq,adaptive,poll"
+#define DEFAULT_INTERVALS       "20,50,200"
+
+// The default path of the profile to write
+#define DEFAULT_PROFILE         "axidma.profile"
+
+// The rates used for the adaptive completion mode, in transfers per second
+#define ADAPTIVE_ENTER_RATE     20000
+#define ADAPTIVE_EXIT_RATE      10000
+
+// The most values that can be swept for each setting
+#define MAX_VALUES              16
+
+// The completion modes that are swept
+enum completion_mode {
+    MODE_IRQ,                   // Always use interrupts
+    MODE_ADAPTIVE,              // Switch to polling at high rates
+    MODE_POLL,                  // Always poll
+};
+
+// The names of the completion modes
+static const char *mode_names[] = { "irq", "adaptive", "poll" };
+
+// The settings to sweep, from the command line
+struct sweep {
+    double chunk_sizes[MAX_VALUES];     // The chunk sizes, in bytes
+    int num_chunk_sizes;
+    double depths[MAX_VALUES];          // The depths
+    int num_depths;
+    enum completion_mode modes[MAX_VALUES];     // The completion modes
+    int num_modes;
+    double intervals[MAX_VALUES];       // The poll intervals, in microseconds
+    int num_intervals;
+};
+
+// The measurements for a single combination of settings
+struct trial {
+    enum completion_mode mode;          // The completion mode
+    struct axidma_stream_config config; // The settings
+    double throughput;                  // The throughput, in MiB/s
+    uint64_t p99_us;                    // The 99th percentile latency
+    double cpu;                         // The CPU cores used on average
+    bool pareto;                        // The trial is on the Pareto front
+};
+
+/*----------------------------------------------------------------------------
+ * Command-line Interface
+ *----------------------------------------------------------------------------*/
+
+// Prints the usage for this program
+static void print_usage(bool help)
+{
+    FILE* stream = (help) ? stdout : stderr;
+
+    fprintf(stream, "Usage: axidma_tune [-t <DMA tx channel>] "
+            "[-r <DMA rx channel>] [-s <stream size (MiB)>] "
+            "[-c <chunk sizes>] [-q <depths>] [-m <modes>] "
+            "[-p <poll intervals (us)>] [-L <latency budget (us)>] "
+            "[-o <profile path>] [-V]\n");
+    if (!help) {
+        return;
+    }
+
+    fprintf(stream, "\t-t <DMA tx channel>:\t\tThe id of the DMA channel to "
+            "stream out on. Default is the first transmit channel.\n");
+    fprintf(stream, "\t-r <DMA rx channel>:\t\tThe id of the DMA channel to "
+            "stream back on. Default is the first receive channel.\n");
+    fprintf(stream, "\t-s <stream size (MiB)>:\t\tThe amount of data streamed "
+            "for each combination. Default is %0.1f MiB.\n",
+            DEFAULT_STREAM_SIZE);
+    fprintf(stream, "\t-c <chunk sizes>:\t\tA comma-separated list of chunk "
+            "sizes in bytes. Default is %s.\n", DEFAULT_CHUNK_SIZES);
+    fprintf(stream, "\t-q <depths>:\t\t\tA comma-separated list of the number "
+            "of chunks in-flight. Default is %s.\n", DEFAULT_DEPTHS);
+    fprintf(stream, "\t-m <modes>:\t\t\tA comma-separated list of completion "
+            "modes, from irq, adaptive, and poll. Default is %s.\n",
+            DEFAULT_MODES);
+    fprintf(stream, "\t-p <poll intervals (us)>:\tA comma-separated list of "
+            "the intervals completions are coalesced over when polling. "
+            "Default is %s.\n", DEFAULT_INTERVALS);
+    fprintf(stream, "\t-L <latency budget (us)>:\tPick the highest throughput "
+            "with a 99th percentile latency within the budget. Default is "
+            "the highest throughput.\n");
+    fprintf(stream, "\t-o <profile path>:\t\tThe profile to write the settings "
+            "to. Settings for other channel pairs in it are kept. Default is "
+            "%s.\n", DEFAULT_PROFILE);
+    fprintf(stream, "\t-V:\t\t\t\tCheck that the data streamed back matches "
+            "the data sent, with CRC32C, rejecting the settings if not.\n");
+    return;
+}
+
+// Parses a comma-separated list of numbers into the array
+static int parse_list(char *arg, double *values, int max_values)
+{
+    int num_values;
+    char *token, *end;
+
+    num_values = 0;
+    for (token = strtok(arg, ","); token != NULL; token = strtok(NULL, ","))
+    {
+        if (num_values == max_values) {
+            return -EINVAL;
+        }
+        values[num_values] = strtod(token, &end);
+        if (end == token || *end != '\0' || values[num_values] <= 0.0) {
+            return -EINVAL;
+        }
+        num_values += 1;
+    }
+
+    return num_values;
+}
+
+// Parses a comma-separated list of completion modes into the array
+static int parse_modes(char *arg, enum completion_mode *modes, int max_modes)
+{
+    int num_modes;
+    enum completion_mode mode;
+    char *token;
+
+    num_modes = 0;
+    for (token = strtok(arg, ","); token != NULL; token = strtok(NULL, ","))
+    {
+        for (mode = MODE_IRQ; mode <= MODE_POLL; mode++)
+        {
+            if (strcmp(token, mode_names[mode]) == 0) {
+                break;
+            }
+        }
+        if (mode > MODE_POLL || num_modes == max_modes) {
+            return -EINVAL;
+        }
+        modes[num_modes++] = mode;
+    }
+
+    return num_modes;
+}
+
+// Parses the command line arguments for the channels and settings to sweep
+static int parse_args(int argc, char **argv, int *tx_channel, int *rx_channel,
+        size_t *stream_size, struct sweep *sweep, double *latency_budget,
+        char **profile_path, bool *verify)
+{
+    char option;
+    int int_arg;
+    double double_arg;
+    char chunk_sizes[] = DEFAULT_CHUNK_SIZES;
+    char depths[] = DEFAULT_DEPTHS;
+    char modes[] = DEFAULT_MODES;
+    char intervals[] = DEFAULT_INTERVALS;
+
+    *tx_channel = -1;
+    *rx_channel = -1;
+    *stream_size = MIB_TO_BYTE(DEFAULT_STREAM_SIZE);
+    *latency_budget = 0.0;
+    *profile_path = DEFAULT_PROFILE;
+    *verify = false;
+    sweep->num_chunk_sizes = parse_list(chunk_sizes, sweep->chunk_sizes,
+                                        MAX_VALUES);
+    sweep->num_depths = parse_list(depths, sweep->depths, MAX_VALUES);
+    sweep->num_modes = parse_modes(modes, sweep->modes, MAX_VALUES);
+    sweep->num_intervals = parse_list(intervals, sweep->intervals, MAX_VALUES);
+
+    while ((option = getopt(argc, argv, "t:r:s:c:q:m:p:L:o:Vh")) != (char)-1)
+    {
+        switch (option)
+        {
+            // Parse the transmit and receive channel arguments
+            case 't':
+            case 'r':
+                if (parse_int(option, optarg, &int_arg) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                *((option == 't') ? tx_channel : rx_channel) = int_arg;
+                break;
+
+            // Parse the stream size argument
+            case 's':
+                if (parse_double(option, optarg, &double_arg) < 0 ||
+                        double_arg <= 0.0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                *stream_size = MIB_TO_BYTE(double_arg);
+                break;
+
+            // Parse the lists of settings to sweep
+            case 'c':
+                sweep->num_chunk_sizes = parse_list(optarg, sweep->chunk_sizes,
+                                                    MAX_VALUES);
+                break;
+            case 'q':
+                sweep->num_depths = parse_list(optarg, sweep->depths,
+                                               MAX_VALUES);
+                break;
+            case 'm':
+                sweep->num_modes = parse_modes(optarg, sweep->modes,
+                                               MAX_VALUES);
+                break;
+            case 'p':
+                sweep->num_intervals = parse_list(optarg, sweep->intervals,
+                                                  MAX_VALUES);
+                break;
+
+            // Parse the latency budget
+            case 'L':
+                if (parse_double(option, optarg, &double_arg) < 0 ||
+                        double_arg <= 0.0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                *latency_budget = double_arg;
+                break;
+
+            // Parse the profile path
+            case 'o':
+                *profile_path = optarg;
+                break;
+
+            // Check the integrity of the streams
+            case 'V':
+                *verify = true;
+                break;
+
+            // Print detailed usage message
+            case 'h':
+                print_usage(true);
+                exit(0);
+
+            default:
+                print_usage(false);
+                return -EINVAL;
+        }
+    }
+
+    if (sweep->num_chunk_sizes <= 0 || sweep->num_depths <= 0 ||
+            sweep->num_modes <= 0 || sweep->num_intervals <= 0) {
+        fprintf(stderr, "Error: Invalid list of settings to sweep.\n");
+        print_usage(false);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Measurement
+ *----------------------------------------------------------------------------*/
+
+/* Reads the CPU time spent busy across all of the CPUs, in clock ticks. This
+ * includes the time in interrupts and kernel threads, which the driver's
+ * completion handling runs in. */
+static uint64_t read_busy_ticks()
+{
+    FILE *file;
+    unsigned long long user, nice, system, idle, iowait, irq, softirq;
+
+    file = fopen("/proc/stat", "r");
+    if (file == NULL) {
+        return 0;
+    }
+    if (fscanf(file, "cpu %llu %llu %llu %llu %llu %llu %llu", &user, &nice,
+               &system, &idle, &iowait, &irq, &softirq) != 7) {
+        fclose(file);
+        return 0;
+    }
+    fclose(file);
+
+    return user + nice + system + irq + softirq;
+}
+
+/* Finds the 99th percentile latency from the transfers counted in the
+ * histogram during the trial, reporting the upper bound of its bucket in
+ * microseconds. Returns 0 if there were no transfers. */
+static uint64_t p99_latency(const struct axidma_chan_stats *before,
+                            const struct axidma_chan_stats *after)
+{
+    int i;
+    uint64_t total, count, target;
+
+    total = 0;
+    for (i = 0; i < AXIDMA_LATENCY_BUCKETS; i++)
+    {
+        total += after->latency_hist[i] - before->latency_hist[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    count = 0;
+    target = (total * 99 + 99) / 100;
+    for (i = 0; i < AXIDMA_LATENCY_BUCKETS - 1; i++)
+    {
+        count += after->latency_hist[i] - before->latency_hist[i];
+        if (count >= target) {
+            break;
+        }
+    }
+
+    return (uint64_t)1 << (i + 1);
+}
+
+/* Streams the buffer with the trial's settings, and measures its performance.
+ * When verifying, the receive buffer is cleared first, so a chunk that never
+ * arrives does not match the last trial's data. */
+static int run_trial(axidma_dev_t dev, int tx_channel, void *tx_buf,
+        int rx_channel, void *rx_buf, size_t stream_size, bool verify,
+        struct trial *trial)
+{
+    int rc, latency_channel;
+    uint64_t start_ns, end_ns, start_ticks, end_ticks;
+    struct axidma_chan_stats before, after;
+    struct axidma_stream_check check;
+
+    // The latency is measured on the receive side, where the chunks finish
+    latency_channel = (rx_channel >= 0) ? rx_channel : tx_channel;
+    rc = axidma_stream_set_config(dev, tx_channel, rx_channel, &trial->config);
+    if (rc < 0) {
+        return rc;
+    }
+    rc = axidma_get_chan_stats(dev, latency_channel, &before);
+    if (rc < 0) {
+        return rc;
+    }
+
+    // The checksums are computed on a helper thread, overlapping the chunks
+    memset(&check, 0, sizeof(check));
+    check.use_thread = true;
+    if (verify) {
+        memset(rx_buf, 0, stream_size);
+    }
+
+    start_ticks = read_busy_ticks();
+    start_ns = axidma_time_ns();
+    rc = axidma_stream_transfer_checked(dev, tx_channel, tx_buf, rx_channel,
+            rx_buf, stream_size, &trial->config, verify ? &check : NULL);
+    end_ns = axidma_time_ns();
+    end_ticks = read_busy_ticks();
+    if (rc == -EBADMSG) {
+        fprintf(stderr, "%d of %d chunks came back different, the first is "
+                "chunk %d.\n", check.num_mismatches, check.num_chunks,
+                check.first_mismatch);
+        return rc;
+    } else if (rc < 0) {
+        return rc;
+    }
+
+    rc = axidma_get_chan_stats(dev, latency_channel, &after);
+    if (rc < 0) {
+        return rc;
+    }
+    trial->throughput = BYTE_TO_MIB(stream_size) / ((end_ns - start_ns) / 1e9);
+    trial->p99_us = p99_latency(&before, &after);
+    trial->cpu = (end_ticks - start_ticks) / (double)sysconf(_SC_CLK_TCK) /
+                 ((end_ns - start_ns) / 1e9);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Pareto Front
+ *----------------------------------------------------------------------------*/
+
+// Checks if trial a is at least as good as b in everything, and better in one
+static bool dominates(const struct trial *a, const struct trial *b)
+{
+    if (a->throughput < b->throughput || a->p99_us > b->p99_us ||
+            a->cpu > b->cpu) {
+        return false;
+    }
+    return a->throughput > b->throughput || a->p99_us < b->p99_us ||
+           a->cpu < b->cpu;
+}
+
+// Marks the trials that are not dominated by any other
+static void find_pareto_front(struct trial *trials, int num_trials)
+{
+    int i, j;
+
+    for (i = 0; i < num_trials; i++)
+    {
+        trials[i].pareto = true;
+        for (j = 0; j < num_trials && trials[i].pareto; j++)
+        {
+            if (j != i && dominates(&trials[j], &trials[i])) {
+                trials[i].pareto = false;
+            }
+        }
+    }
+
+    return;
+}
+
+/* Picks the trial on the Pareto front with the highest throughput, among the
+ * ones within the latency budget. If none are, the lowest latency is picked. */
+static struct trial *pick_trial(struct trial *trials, int num_trials,
+        double latency_budget)
+{
+    int i;
+    struct trial *best, *fastest;
+
+    best = NULL;
+    fastest = NULL;
+    for (i = 0; i < num_trials; i++)
+    {
+        if (!trials[i].pareto) {
+            continue;
+        }
+        if (fastest == NULL || trials[i].p99_us < fastest->p99_us) {
+            fastest = &trials[i];
+        }
+        if (latency_budget > 0.0 && trials[i].p99_us > latency_budget) {
+            continue;
+        }
+        if (best == NULL || trials[i].throughput > best->throughput ||
+                (trials[i].throughput == best->throughput &&
+                 trials[i].cpu < best->cpu)) {
+            best = &trials[i];
+        }
+    }
+
+    return (best != NULL) ? best : fastest;
+}
+
+// Prints the settings and measurements of a trial
+static void print_trial(const struct trial *trial, const char *marker)
+{
+    printf("%-2s %10zu  %5d  %-8s  %10u  %10.2f  %10llu  %6.2f\n", marker,
+           trial->config.chunk_size, trial->config.depth,
+           mode_names[trial->mode], trial->config.poll_interval_us,
+           trial->throughput, (unsigned long long)trial->p99_us, trial->cpu);
+}
+
+/*----------------------------------------------------------------------------
+ * Main Function
+ *----------------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+    int rc, i, j, k, l, num_trials, max_trials, num_intervals;
+    int tx_channel, rx_channel;
+    size_t stream_size;
+    double latency_budget;
+    char *profile_path;
+    bool verify;
+    void *tx_buf, *rx_buf;
+    axidma_dev_t axidma_dev;
+    struct sweep sweep;
+    struct trial *trials, *trial, *best;
+
+    if (parse_args(argc, argv, &tx_channel, &rx_channel, &stream_size, &sweep,
+                   &latency_budget, &profile_path, &verify) < 0) {
+        rc = 1;
+        goto ret;
+    }
+
+    // Initialize the AXI DMA device
+    axidma_dev = axidma_init();
+    if (axidma_dev == NULL) {
+        fprintf(stderr, "Failed to initialize the AXI DMA device.\n");
+        rc = 1;
+        goto ret;
+    }
+
+    // Default to the first transmit and receive channels
+    if (tx_channel == -1 && axidma_get_dma_tx(axidma_dev)->len > 0) {
+        tx_channel = axidma_get_dma_tx(axidma_dev)->data[0];
+    }
+    if (rx_channel == -1 && axidma_get_dma_rx(axidma_dev)->len > 0) {
+        rx_channel = axidma_get_dma_rx(axidma_dev)->data[0];
+    }
+    if (tx_channel == -1 || rx_channel == -1) {
+        fprintf(stderr, "Error: Both a transmit and receive channel are "
+                "required.\n");
+        rc = 1;
+        goto destroy_axidma;
+    }
+
+    // Keep the settings for other channel pairs already in the profile
+    if (access(profile_path, F_OK) == 0 &&
+            axidma_load_profile(axidma_dev, profile_path) < 0) {
+        fprintf(stderr, "Warning: Some of '%s' could not be loaded.\n",
+                profile_path);
+    }
+
+    // Allocate the buffers to stream through, and the trials
+    tx_buf = axidma_malloc(axidma_dev, stream_size);
+    if (tx_buf == NULL) {
+        fprintf(stderr, "Unable to allocate the transmit buffer.\n");
+        rc = 1;
+        goto destroy_axidma;
+    }
+    rx_buf = axidma_malloc(axidma_dev, stream_size);
+    if (rx_buf == NULL) {
+        fprintf(stderr, "Unable to allocate the receive buffer.\n");
+        rc = 1;
+        goto free_tx_buf;
+    }
+    max_trials = sweep.num_chunk_sizes * sweep.num_depths * sweep.num_modes *
+                 sweep.num_intervals;
+    trials = calloc(max_trials, sizeof(trials[0]));
+    if (trials == NULL) {
+        fprintf(stderr, "Unable to allocate the trials.\n");
+        rc = 1;
+        goto free_rx_buf;
+    }
+
+    // Fill the transmit buffer with data that shows if chunks are misplaced
+    if (verify) {
+        for (i = 0; i < (int)(stream_size / sizeof(uint32_t)); i++)
+        {
+            ((uint32_t *)tx_buf)[i] = 0x9e3779b9 * (i + 1);
+        }
+    }
+
+    // Run every combination, the poll interval only matters when polling
+    printf("Tuning channels %d and %d with %0.2f MiB per combination.\n",
+           tx_channel, rx_channel, BYTE_TO_MIB(stream_size));
+    if (verify) {
+        printf("Checking each stream with CRC32C (%s).\n",
+               axidma_crc32c_name());
+    }
+    printf("\n");
+    printf("%-2s %10s  %5s  %-8s  %10s  %10s  %10s  %6s\n", "", "Chunk",
+           "Depth", "Mode", "Poll(us)", "MiB/s", "P99(us)", "CPUs");
+    num_trials = 0;
+    for (i = 0; i < sweep.num_chunk_sizes; i++)
+    {
+        for (j = 0; j < sweep.num_depths; j++)
+        {
+            for (k = 0; k < sweep.num_modes; k++)
+            {
+                num_intervals = (sweep.modes[k] == MODE_IRQ) ? 1 :
+                                sweep.num_intervals;
+                for (l = 0; l < num_intervals; l++)
+                {
+                    trial = &trials[num_trials];
+                    memset(trial, 0, sizeof(*trial));
+                    trial->mode = sweep.modes[k];
+                    trial->config.chunk_size = sweep.chunk_sizes[i];
+                    trial->config.depth = sweep.depths[j];
+                    if (trial->mode == MODE_ADAPTIVE) {
+                        trial->config.poll_enter_rate = ADAPTIVE_ENTER_RATE;
+                        trial->config.poll_exit_rate = ADAPTIVE_EXIT_RATE;
+                    } else if (trial->mode == MODE_POLL) {
+                        trial->config.poll_enter_rate = 1;
+                        trial->config.poll_exit_rate = 0;
+                    }
+                    if (trial->mode != MODE_IRQ) {
+                        trial->config.poll_interval_us = sweep.intervals[l];
+                    }
+
+                    if (run_trial(axidma_dev, tx_channel, tx_buf, rx_channel,
+                                  rx_buf, stream_size, verify, trial) < 0) {
+                        fprintf(stderr, "Failed to stream with chunk size "
+                                "%zu and depth %d, skipping.\n",
+                                trial->config.chunk_size, trial->config.depth);
+                        continue;
+                    }
+                    print_trial(trial, "");
+                    num_trials += 1;
+                }
+            }
+        }
+    }
+    if (num_trials == 0) {
+        fprintf(stderr, "Error: None of the combinations succeeded.\n");
+        rc = 1;
+        goto free_trials;
+    }
+
+    // Report the Pareto front, and save the best settings on it
+    find_pareto_front(trials, num_trials);
+    best = pick_trial(trials, num_trials, latency_budget);
+    printf("\nPareto front (* is the selected settings):\n");
+    for (i = 0; i < num_trials; i++)
+    {
+        if (trials[i].pareto) {
+            print_trial(&trials[i], (&trials[i] == best) ? "*" : "");
+        }
+    }
+
+    rc = 0;
+    if (axidma_stream_set_config(axidma_dev, tx_channel, rx_channel,
+                                 &best->config) < 0 ||
+            axidma_save_profile(axidma_dev, profile_path) < 0) {
+        rc = 1;
+        goto free_trials;
+    }
+    printf("\nWrote the settings to '%s'.\n", profile_path);
+
+free_trials:
+    free(trials);
+free_rx_buf:
+    axidma_free(axidma_dev, rx_buf, stream_size);
+free_tx_buf:
+    axidma_free(axidma_dev, tx_buf, stream_size);
+destroy_axidma:
+    axidma_destroy(axidma_dev);
+ret:
+    return rc;
+}
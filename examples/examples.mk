@@ -17,7 +17,9 @@ include library/library.mk
 
 # The list of example programs
 EXAMPLES_DIR = examples
-EXAMPLES_FILES = axidma_benchmark.c axidma_display_image.c axidma_transfer.c
+EXAMPLES_FILES = axidma_benchmark.c axidma_display_image.c axidma_transfer.c \
+				 axidma_top.c axidma_bench_compare.c axidma_replay.c \
+				 axidma_loadgen.c axidma_tune.c axidma_grab.c
 
 # The variations of specific targets for the example programs
 EXAMPLES_TARGETS = $(EXAMPLES_FILES:%.c=%)
@@ -27,24 +29,38 @@ EXAMPLES_OUTPUT_EXECUTABLES = $(addprefix $(OUTPUT_DIR)/,$(EXAMPLES_TARGETS))
 
 # The local helper function files used across the example programs.
 UTIL_DIR = $(EXAMPLES_DIR)
-UTIL_FILES = util.c
+UTIL_FILES = util.c pixel.c sample.c
 UTIL = $(addprefix $(UTIL_DIR)/,$(UTIL_FILES))
 
 # The compiler flags used to compile the examples
 EXAMPLES_CFLAGS = $(GLOBAL_CFLAGS)
 
+# The Zynq-7000's Cortex-A9 cores have NEON, but 32-bit ARM compilers don't
+# enable it by default, so enable it for the pixel and sample kernels
+ifeq ($(ARCH),arm)
+EXAMPLES_CFLAGS += -mfpu=neon
+endif
+
 # Set the example executables to link against the AXI DMA shared library in
 # the outputs directory
 EXAMPLES_LINKER_FLAGS = -Wl,-rpath,'$$ORIGIN'
-EXAMPLES_LIB_FLAGS = -L $(OUTPUT_DIR) -l $(LIBAXIDMA_NAME) \
+EXAMPLES_LIB_FLAGS = -L $(OUTPUT_DIR) -l $(LIBAXIDMA_NAME) -lm -lpthread \
 					 $(EXAMPLES_LINKER_FLAGS)
 
+# The file that the benchmark matrix appends its results to, the transfer sizes
+# to run it at, and the number of transfers for each size. If a baseline
+# results file is given, the results are compared against it afterwards.
+BENCH_RESULTS ?= $(OUTPUT_DIR)/bench_results.jsonl
+BENCH_SIZES ?= 4096 65536 1048576 4194304
+BENCH_TRANSFERS ?= 1000
+BENCH_BASELINE ?=
+
 ################################################################################
 # Targets
 ################################################################################
 
 # These targets don't correspond to actual generated files
-.PHONY: all examples examples_clean $(EXAMPLES_TARGETS) \
+.PHONY: all examples examples_clean bench $(EXAMPLES_TARGETS) \
 		$(EXAMPLES_CLEAN_TARGETS)
 
 # Allow for secondary expansion in prerequisite lists. This allows for automatic
@@ -69,6 +85,17 @@ $(EXAMPLES_OUTPUT_EXECUTABLES): $(EXAMPLES_DIR)/$$(shell basename $$@) \
 							    $(OUTPUT_DIR)
 	@cp $< $@
 
+# Run the standard benchmark matrix on the hardware, archiving the results, and
+# compare them against the baseline if one is given
+bench: axidma_benchmark axidma_bench_compare
+	@for size in $(BENCH_SIZES); do \
+		$(OUTPUT_DIR)/axidma_benchmark -b $$size -s $$size \
+			-n $(BENCH_TRANSFERS) -w $(BENCH_RESULTS) || exit 1; \
+	done
+ifneq ($(BENCH_BASELINE),)
+	$(OUTPUT_DIR)/axidma_bench_compare $(BENCH_BASELINE) $(BENCH_RESULTS)
+endif
+
 # Clean up all the files generated by compiling the examples
 examples_clean: $(EXAMPLES_CLEAN_TARGETS)
 
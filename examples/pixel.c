@@ -0,0 +1,922 @@
+/**
+ * @file pixel.c
+ * @date Sunday, October 18, 2026 at 06:43:50 PM EDT
+ *
+ * This file contains the routines for converting images between common pixel
+ * formats and the XRGB8888 format used by the VDMA frame buffers.
+ *
+ * Each conversion has a scalar kernel and, where the target has them, NEON or
+ * SSE kernels, which work on a row at a time. The SIMD kernels load and store
+ * whole vectors, so the frame buffer is written in bursts rather than a pixel
+ * at a time, which matters because the DMA buffers are not cached. The rows of
+ * a frame can be split between several threads.
+ *
+ * The YUYV conversions use BT.601 limited range coefficients, scaled down so
+ * that the SIMD kernels can do the arithmetic in 16 bits. The scalar kernels
+ * use the same coefficients, so all of the kernels give identical results.
+ *
+ * @bug No known bugs.
+ **/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>             // Fixed-width integer types
+#include <string.h>             // Memory copy and string functions
+#include <strings.h>            // Case-insensitive string comparison
+#include <errno.h>              // Error codes
+#include <pthread.h>            // Threads for splitting the rows
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PIXEL_NEON
+#include <arm_neon.h>           // NEON intrinsics
+#elif defined(__GNUC__) && defined(__SSE2__)
+#define PIXEL_SSE
+#include <emmintrin.h>          // SSE2 intrinsics
+#include <tmmintrin.h>          // SSSE3 intrinsics, enabled per function
+#endif
+
+#include "pixel.h"              // Pixel format conversion interface
+
+// The most threads a frame can be split between
+#define MAX_CONVERT_THREADS     16
+
+// A kernel that converts the given number of pixels in a row
+typedef void (*row_kernel_t)(const uint8_t *src, uint8_t *dst, int width);
+
+// The part of a frame converted by one thread
+struct convert_job {
+    row_kernel_t kernel;
+    const uint8_t *src;
+    uint8_t *dst;
+    size_t src_stride;
+    size_t dst_stride;
+    int width;
+    int num_rows;
+};
+
+/*----------------------------------------------------------------------------
+ * Pixel Formats
+ *----------------------------------------------------------------------------*/
+
+// The names of the pixel formats, indexed by format
+static const char *format_names[] = {
+    [PIXEL_XRGB8888] = "xrgb8888",
+    [PIXEL_RGB888] = "rgb888",
+    [PIXEL_BGR888] = "bgr888",
+    [PIXEL_RGB565] = "rgb565",
+    [PIXEL_YUYV] = "yuyv",
+};
+
+// The number of bytes in a pixel of each format, indexed by format
+static const int format_depths[] = {
+    [PIXEL_XRGB8888] = 4,
+    [PIXEL_RGB888] = 3,
+    [PIXEL_BGR888] = 3,
+    [PIXEL_RGB565] = 2,
+    [PIXEL_YUYV] = 2,
+};
+
+#define NUM_FORMATS     ((int)(sizeof(format_names) / sizeof(format_names[0])))
+
+// Parses the name of a pixel format
+int pixel_parse_format(const char *name, enum pixel_format *format)
+{
+    int i;
+
+    for (i = 0; i < NUM_FORMATS; i++)
+    {
+        if (strcasecmp(name, format_names[i]) == 0) {
+            *format = i;
+            return 0;
+        }
+    }
+
+    return -EINVAL;
+}
+
+// Gets the name of a pixel format
+const char *pixel_format_name(enum pixel_format format)
+{
+    return format_names[format];
+}
+
+// Gets the number of bytes in a pixel of the format
+int pixel_format_depth(enum pixel_format format)
+{
+    return format_depths[format];
+}
+
+/*----------------------------------------------------------------------------
+ * Scalar Kernels
+ *----------------------------------------------------------------------------*/
+
+// Clamps a value to the range of a byte
+static inline uint8_t clamp_byte(int value)
+{
+    return (value < 0) ? 0 : (value > 255) ? 255 : value;
+}
+
+// Packs the color components into an XRGB8888 pixel
+static inline uint32_t pack_xrgb(uint8_t red, uint8_t green, uint8_t blue)
+{
+    return 0xff000000 | (red << 16) | (green << 8) | blue;
+}
+
+// Converts a YUV sample, with the offsets removed, into an XRGB8888 pixel
+static inline uint32_t yuv_to_xrgb(int y, int u, int v)
+{
+    int luma;
+
+    luma = 74 * y;
+    return pack_xrgb(clamp_byte((luma + 102 * v + 32) >> 6),
+                     clamp_byte((luma - 25 * u - 52 * v + 32) >> 6),
+                     clamp_byte((luma + 129 * u + 32) >> 6));
+}
+
+// Computes the luma of an RGB pixel
+static inline uint8_t rgb_to_y(int red, int green, int blue)
+{
+    return ((33 * red + 65 * green + 13 * blue + 64) >> 7) + 16;
+}
+
+// Computes the chroma of an RGB pixel
+static inline uint8_t rgb_to_u(int red, int green, int blue)
+{
+    return ((-19 * red - 37 * green + 56 * blue + 64) >> 7) + 128;
+}
+
+static inline uint8_t rgb_to_v(int red, int green, int blue)
+{
+    return ((56 * red - 47 * green - 9 * blue + 64) >> 7) + 128;
+}
+
+static void copy_row(const uint8_t *src, uint8_t *dst, int width)
+{
+    memcpy(dst, src, width * format_depths[PIXEL_XRGB8888]);
+}
+
+// Converts 24-bit pixels with the given red and blue offsets into XRGB8888
+static inline void rgb24_to_xrgb_scalar(const uint8_t *src, uint8_t *dst,
+        int width, int red, int blue)
+{
+    int i;
+    uint32_t *pixels;
+
+    pixels = (uint32_t *)dst;
+    for (i = 0; i < width; i++)
+    {
+        pixels[i] = pack_xrgb(src[3*i + red], src[3*i + 1], src[3*i + blue]);
+    }
+}
+
+static inline void xrgb_to_rgb24_scalar(const uint8_t *src, uint8_t *dst,
+        int width, int red, int blue)
+{
+    int i;
+
+    for (i = 0; i < width; i++)
+    {
+        dst[3*i + red] = src[4*i + 2];
+        dst[3*i + 1] = src[4*i + 1];
+        dst[3*i + blue] = src[4*i];
+    }
+}
+
+static void rgb888_to_xrgb_scalar(const uint8_t *src, uint8_t *dst, int width)
+{
+    rgb24_to_xrgb_scalar(src, dst, width, 0, 2);
+}
+
+static void bgr888_to_xrgb_scalar(const uint8_t *src, uint8_t *dst, int width)
+{
+    rgb24_to_xrgb_scalar(src, dst, width, 2, 0);
+}
+
+static void xrgb_to_rgb888_scalar(const uint8_t *src, uint8_t *dst, int width)
+{
+    xrgb_to_rgb24_scalar(src, dst, width, 0, 2);
+}
+
+static void xrgb_to_bgr888_scalar(const uint8_t *src, uint8_t *dst, int width)
+{
+    xrgb_to_rgb24_scalar(src, dst, width, 2, 0);
+}
+
+static void rgb565_to_xrgb_scalar(const uint8_t *src, uint8_t *dst, int width)
+{
+    int i;
+    uint8_t red, green, blue;
+    uint16_t pixel;
+    uint32_t *pixels;
+
+    pixels = (uint32_t *)dst;
+    for (i = 0; i < width; i++)
+    {
+        // Replicate the high bits into the low bits to fill the range
+        pixel = src[2*i] | (src[2*i + 1] << 8);
+        red = (pixel >> 11) & 0x1f;
+        green = (pixel >> 5) & 0x3f;
+        blue = pixel & 0x1f;
+        pixels[i] = pack_xrgb((red << 3) | (red >> 2), (green << 2) |
+                (green >> 4), (blue << 3) | (blue >> 2));
+    }
+}
+
+static void xrgb_to_rgb565_scalar(const uint8_t *src, uint8_t *dst, int width)
+{
+    int i;
+    uint16_t pixel;
+
+    for (i = 0; i < width; i++)
+    {
+        pixel = ((src[4*i + 2] >> 3) << 11) | ((src[4*i + 1] >> 2) << 5) |
+                (src[4*i] >> 3);
+        dst[2*i] = pixel & 0xff;
+        dst[2*i + 1] = pixel >> 8;
+    }
+}
+
+static void yuyv_to_xrgb_scalar(const uint8_t *src, uint8_t *dst, int width)
+{
+    int i, u, v;
+    uint32_t *pixels;
+
+    pixels = (uint32_t *)dst;
+    for (i = 0; i < width; i += 2)
+    {
+        u = src[2*i + 1] - 128;
+        v = src[2*i + 3] - 128;
+        pixels[i] = yuv_to_xrgb(src[2*i] - 16, u, v);
+        pixels[i + 1] = yuv_to_xrgb(src[2*i + 2] - 16, u, v);
+    }
+}
+
+static void xrgb_to_yuyv_scalar(const uint8_t *src, uint8_t *dst, int width)
+{
+    int i, red, green, blue;
+    const uint8_t *pixel;
+
+    for (i = 0; i < width; i += 2)
+    {
+        // The chroma is taken from the average of the pair of pixels
+        pixel = &src[4*i];
+        red = (pixel[2] + pixel[6] + 1) >> 1;
+        green = (pixel[1] + pixel[5] + 1) >> 1;
+        blue = (pixel[0] + pixel[4] + 1) >> 1;
+        dst[2*i] = rgb_to_y(pixel[2], pixel[1], pixel[0]);
+        dst[2*i + 1] = rgb_to_u(red, green, blue);
+        dst[2*i + 2] = rgb_to_y(pixel[6], pixel[5], pixel[4]);
+        dst[2*i + 3] = rgb_to_v(red, green, blue);
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * NEON Kernels
+ *----------------------------------------------------------------------------*/
+
+#if defined(PIXEL_NEON)
+
+static inline void rgb24_to_xrgb_neon(const uint8_t *src, uint8_t *dst,
+        int width, int red, int blue)
+{
+    int i;
+    uint8x16x3_t in;
+    uint8x16x4_t out;
+
+    out.val[3] = vdupq_n_u8(0xff);
+    for (i = 0; i + 16 <= width; i += 16)
+    {
+        in = vld3q_u8(&src[3*i]);
+        out.val[0] = in.val[blue];
+        out.val[1] = in.val[1];
+        out.val[2] = in.val[red];
+        vst4q_u8(&dst[4*i], out);
+    }
+    rgb24_to_xrgb_scalar(&src[3*i], &dst[4*i], width - i, red, blue);
+}
+
+static inline void xrgb_to_rgb24_neon(const uint8_t *src, uint8_t *dst,
+        int width, int red, int blue)
+{
+    int i;
+    uint8x16x4_t in;
+    uint8x16x3_t out;
+
+    for (i = 0; i + 16 <= width; i += 16)
+    {
+        in = vld4q_u8(&src[4*i]);
+        out.val[red] = in.val[2];
+        out.val[1] = in.val[1];
+        out.val[blue] = in.val[0];
+        vst3q_u8(&dst[3*i], out);
+    }
+    xrgb_to_rgb24_scalar(&src[4*i], &dst[3*i], width - i, red, blue);
+}
+
+static void rgb888_to_xrgb_simd(const uint8_t *src, uint8_t *dst, int width)
+{
+    rgb24_to_xrgb_neon(src, dst, width, 0, 2);
+}
+
+static void bgr888_to_xrgb_simd(const uint8_t *src, uint8_t *dst, int width)
+{
+    rgb24_to_xrgb_neon(src, dst, width, 2, 0);
+}
+
+static void xrgb_to_rgb888_simd(const uint8_t *src, uint8_t *dst, int width)
+{
+    xrgb_to_rgb24_neon(src, dst, width, 0, 2);
+}
+
+static void xrgb_to_bgr888_simd(const uint8_t *src, uint8_t *dst, int width)
+{
+    xrgb_to_rgb24_neon(src, dst, width, 2, 0);
+}
+
+static void rgb565_to_xrgb_simd(const uint8_t *src, uint8_t *dst, int width)
+{
+    int i;
+    uint16x8_t in, red, green, blue;
+    uint8x8x4_t out;
+
+    out.val[3] = vdup_n_u8(0xff);
+    for (i = 0; i + 8 <= width; i += 8)
+    {
+        in = vld1q_u16((const uint16_t *)&src[2*i]);
+        red = vshrq_n_u16(in, 11);
+        green = vandq_u16(vshrq_n_u16(in, 5), vdupq_n_u16(0x3f));
+        blue = vandq_u16(in, vdupq_n_u16(0x1f));
+        out.val[0] = vmovn_u16(vorrq_u16(vshlq_n_u16(blue, 3),
+                                         vshrq_n_u16(blue, 2)));
+        out.val[1] = vmovn_u16(vorrq_u16(vshlq_n_u16(green, 2),
+                                         vshrq_n_u16(green, 4)));
+        out.val[2] = vmovn_u16(vorrq_u16(vshlq_n_u16(red, 3),
+                                         vshrq_n_u16(red, 2)));
+        vst4_u8(&dst[4*i], out);
+    }
+    rgb565_to_xrgb_scalar(&src[2*i], &dst[4*i], width - i);
+}
+
+static void xrgb_to_rgb565_simd(const uint8_t *src, uint8_t *dst, int width)
+{
+    int i;
+    uint8x8x4_t in;
+    uint16x8_t out;
+
+    for (i = 0; i + 8 <= width; i += 8)
+    {
+        // Insert the top bits of green and blue below the top bits of red
+        in = vld4_u8(&src[4*i]);
+        out = vshll_n_u8(in.val[2], 8);
+        out = vsriq_n_u16(out, vshll_n_u8(in.val[1], 8), 5);
+        out = vsriq_n_u16(out, vshll_n_u8(in.val[0], 8), 11);
+        vst1q_u16((uint16_t *)&dst[2*i], out);
+    }
+    xrgb_to_rgb565_scalar(&src[4*i], &dst[2*i], width - i);
+}
+
+// Converts eight YUV samples, with the offsets removed, into XRGB8888
+static inline uint8x8x4_t yuv_to_xrgb_neon(int16x8_t y, int16x8_t u,
+        int16x8_t v)
+{
+    int16x8_t luma;
+    uint8x8x4_t out;
+
+    /* The saturating arithmetic only saturates when the result would be
+     * clamped to 255 anyway. */
+    luma = vmulq_n_s16(y, 74);
+    out.val[0] = vqrshrun_n_s16(vqaddq_s16(vqaddq_s16(luma,
+            vshlq_n_s16(u, 7)), u), 6);
+    out.val[1] = vqrshrun_n_s16(vqsubq_s16(vqsubq_s16(luma,
+            vmulq_n_s16(u, 25)), vmulq_n_s16(v, 52)), 6);
+    out.val[2] = vqrshrun_n_s16(vqaddq_s16(luma, vmulq_n_s16(v, 102)), 6);
+    out.val[3] = vdup_n_u8(0xff);
+    return out;
+}
+
+// Removes the offset from eight samples, widening them to 16 bits
+static inline int16x8_t remove_offset_neon(uint8x8_t samples, uint8_t offset)
+{
+    return vreinterpretq_s16_u16(vsubl_u8(samples, vdup_n_u8(offset)));
+}
+
+static void yuyv_to_xrgb_simd(const uint8_t *src, uint8_t *dst, int width)
+{
+    int i, j;
+    int16x8_t u, v;
+    uint8x8x4_t in, even, odd;
+    uint8x8x2_t pair;
+    uint8x16x4_t out;
+
+    for (i = 0; i + 16 <= width; i += 16)
+    {
+        // Convert the even and odd pixels, and then interleave them
+        in = vld4_u8(&src[2*i]);
+        u = remove_offset_neon(in.val[1], 128);
+        v = remove_offset_neon(in.val[3], 128);
+        even = yuv_to_xrgb_neon(remove_offset_neon(in.val[0], 16), u, v);
+        odd = yuv_to_xrgb_neon(remove_offset_neon(in.val[2], 16), u, v);
+        for (j = 0; j < 4; j++)
+        {
+            pair = vzip_u8(even.val[j], odd.val[j]);
+            out.val[j] = vcombine_u8(pair.val[0], pair.val[1]);
+        }
+        vst4q_u8(&dst[4*i], out);
+    }
+    yuyv_to_xrgb_scalar(&src[2*i], &dst[4*i], width - i);
+}
+
+// Computes the luma of eight RGB pixels
+static inline uint8x8_t rgb_to_y_neon(uint8x8_t red, uint8x8_t green,
+        uint8x8_t blue)
+{
+    uint16x8_t luma;
+
+    luma = vmull_u8(red, vdup_n_u8(33));
+    luma = vmlal_u8(luma, green, vdup_n_u8(65));
+    luma = vmlal_u8(luma, blue, vdup_n_u8(13));
+    return vadd_u8(vrshrn_n_u16(luma, 7), vdup_n_u8(16));
+}
+
+// Computes a chroma component of eight RGB pixels, with the given weights
+static inline uint8x8_t rgb_to_chroma_neon(uint8x8_t positive, uint8_t weight,
+        uint8x8_t first, uint8_t first_weight, uint8x8_t second,
+        uint8_t second_weight)
+{
+    uint16x8_t chroma;
+
+    chroma = vmull_u8(positive, vdup_n_u8(weight));
+    chroma = vmlsl_u8(chroma, first, vdup_n_u8(first_weight));
+    chroma = vmlsl_u8(chroma, second, vdup_n_u8(second_weight));
+    return vmovn_u16(vreinterpretq_u16_s16(vaddq_s16(vrshrq_n_s16(
+            vreinterpretq_s16_u16(chroma), 7), vdupq_n_s16(128))));
+}
+
+static void xrgb_to_yuyv_simd(const uint8_t *src, uint8_t *dst, int width)
+{
+    int i;
+    uint8x16x4_t in;
+    uint8x16x2_t red, green, blue;
+    uint8x8_t red_avg, green_avg, blue_avg;
+    uint8x8x4_t out;
+
+    for (i = 0; i + 16 <= width; i += 16)
+    {
+        // Split the pixels into the even and odd ones of each pair
+        in = vld4q_u8(&src[4*i]);
+        blue = vuzpq_u8(in.val[0], in.val[0]);
+        green = vuzpq_u8(in.val[1], in.val[1]);
+        red = vuzpq_u8(in.val[2], in.val[2]);
+        out.val[0] = rgb_to_y_neon(vget_low_u8(red.val[0]),
+                vget_low_u8(green.val[0]), vget_low_u8(blue.val[0]));
+        out.val[2] = rgb_to_y_neon(vget_low_u8(red.val[1]),
+                vget_low_u8(green.val[1]), vget_low_u8(blue.val[1]));
+
+        // The chroma is taken from the average of the pair of pixels
+        red_avg = vrhadd_u8(vget_low_u8(red.val[0]), vget_low_u8(red.val[1]));
+        green_avg = vrhadd_u8(vget_low_u8(green.val[0]),
+                vget_low_u8(green.val[1]));
+        blue_avg = vrhadd_u8(vget_low_u8(blue.val[0]),
+                vget_low_u8(blue.val[1]));
+        out.val[1] = rgb_to_chroma_neon(blue_avg, 56, red_avg, 19, green_avg,
+                37);
+        out.val[3] = rgb_to_chroma_neon(red_avg, 56, green_avg, 47, blue_avg,
+                9);
+        vst4_u8(&dst[2*i], out);
+    }
+    xrgb_to_yuyv_scalar(&src[4*i], &dst[2*i], width - i);
+}
+
+// The name of the vector instructions used by the SIMD kernels
+const char *pixel_simd_name(void)
+{
+    return "NEON";
+}
+
+/*----------------------------------------------------------------------------
+ * SSE Kernels
+ *----------------------------------------------------------------------------*/
+
+#elif defined(PIXEL_SSE)
+
+/* The 24-bit kernels need the byte shuffle from SSSE3, which is not part of
+ * the x86-64 baseline, so they are compiled for it separately, and only used
+ * when the processor has it. The rest only need SSE2. */
+#define SSSE3_KERNEL    __attribute__((target("ssse3")))
+
+// Interleaves eight pixels' color components into XRGB8888, and stores them
+static inline void store_xrgb_sse(uint8_t *dst, __m128i red, __m128i green,
+        __m128i blue)
+{
+    __m128i blue_green, red_alpha;
+
+    // The components are in the low half of each vector, as bytes
+    blue_green = _mm_unpacklo_epi8(blue, green);
+    red_alpha = _mm_unpacklo_epi8(red, _mm_set1_epi8((char)0xff));
+    _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(blue_green,
+                red_alpha));
+    _mm_storeu_si128((__m128i *)&dst[16], _mm_unpackhi_epi16(blue_green,
+                red_alpha));
+}
+
+SSSE3_KERNEL static inline void rgb24_to_xrgb_sse(const uint8_t *src,
+        uint8_t *dst, int width, __m128i shuffle, int red, int blue)
+{
+    int i;
+    __m128i in, alpha;
+
+    // Each load reads 16 bytes for the 12 bytes of four pixels
+    alpha = _mm_set1_epi32(0xff000000);
+    for (i = 0; i + 6 <= width; i += 4)
+    {
+        in = _mm_loadu_si128((const __m128i *)&src[3*i]);
+        _mm_storeu_si128((__m128i *)&dst[4*i],
+                _mm_or_si128(_mm_shuffle_epi8(in, shuffle), alpha));
+    }
+    rgb24_to_xrgb_scalar(&src[3*i], &dst[4*i], width - i, red, blue);
+}
+
+/* Each store writes 16 bytes for the 12 bytes of four pixels. The extra bytes
+ * are overwritten by the next store, so this stops short of the end of the
+ * row. */
+SSSE3_KERNEL static inline void xrgb_to_rgb24_sse(const uint8_t *src,
+        uint8_t *dst, int width, __m128i shuffle, int red, int blue)
+{
+    int i;
+    __m128i in;
+
+    for (i = 0; i + 6 <= width; i += 4)
+    {
+        in = _mm_loadu_si128((const __m128i *)&src[4*i]);
+        _mm_storeu_si128((__m128i *)&dst[3*i], _mm_shuffle_epi8(in, shuffle));
+    }
+    xrgb_to_rgb24_scalar(&src[4*i], &dst[3*i], width - i, red, blue);
+}
+
+SSSE3_KERNEL static void rgb888_to_xrgb_simd(const uint8_t *src, uint8_t *dst,
+        int width)
+{
+    rgb24_to_xrgb_sse(src, dst, width, _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1,
+            8, 7, 6, -1, 11, 10, 9, -1), 0, 2);
+}
+
+SSSE3_KERNEL static void bgr888_to_xrgb_simd(const uint8_t *src, uint8_t *dst,
+        int width)
+{
+    rgb24_to_xrgb_sse(src, dst, width, _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1,
+            6, 7, 8, -1, 9, 10, 11, -1), 2, 0);
+}
+
+SSSE3_KERNEL static void xrgb_to_rgb888_simd(const uint8_t *src, uint8_t *dst,
+        int width)
+{
+    xrgb_to_rgb24_sse(src, dst, width, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9,
+            8, 14, 13, 12, -1, -1, -1, -1), 0, 2);
+}
+
+SSSE3_KERNEL static void xrgb_to_bgr888_simd(const uint8_t *src, uint8_t *dst,
+        int width)
+{
+    xrgb_to_rgb24_sse(src, dst, width, _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9,
+            10, 12, 13, 14, -1, -1, -1, -1), 2, 0);
+}
+
+static void rgb565_to_xrgb_simd(const uint8_t *src, uint8_t *dst, int width)
+{
+    int i;
+    __m128i in, red, green, blue, zero;
+
+    zero = _mm_setzero_si128();
+    for (i = 0; i + 8 <= width; i += 8)
+    {
+        // Replicate the high bits into the low bits to fill the range
+        in = _mm_loadu_si128((const __m128i *)&src[2*i]);
+        red = _mm_srli_epi16(in, 11);
+        green = _mm_and_si128(_mm_srli_epi16(in, 5), _mm_set1_epi16(0x3f));
+        blue = _mm_and_si128(in, _mm_set1_epi16(0x1f));
+        red = _mm_or_si128(_mm_slli_epi16(red, 3), _mm_srli_epi16(red, 2));
+        green = _mm_or_si128(_mm_slli_epi16(green, 2),
+                _mm_srli_epi16(green, 4));
+        blue = _mm_or_si128(_mm_slli_epi16(blue, 3), _mm_srli_epi16(blue, 2));
+        store_xrgb_sse(&dst[4*i], _mm_packus_epi16(red, zero),
+                _mm_packus_epi16(green, zero), _mm_packus_epi16(blue, zero));
+    }
+    rgb565_to_xrgb_scalar(&src[2*i], &dst[4*i], width - i);
+}
+
+// Converts four XRGB8888 pixels to RGB565, in the low half of each 32 bits
+static inline __m128i pack_rgb565_sse(__m128i in)
+{
+    __m128i red, green, blue;
+
+    red = _mm_and_si128(_mm_srli_epi32(in, 8), _mm_set1_epi32(0xf800));
+    green = _mm_and_si128(_mm_srli_epi32(in, 5), _mm_set1_epi32(0x07e0));
+    blue = _mm_and_si128(_mm_srli_epi32(in, 3), _mm_set1_epi32(0x001f));
+    return _mm_or_si128(_mm_or_si128(red, green), blue);
+}
+
+static void xrgb_to_rgb565_simd(const uint8_t *src, uint8_t *dst, int width)
+{
+    int i;
+    __m128i low, high, bias;
+
+    /* SSE2 only packs 32 bits into 16 with signed saturation, so the values
+     * are biased into the signed range and back. */
+    bias = _mm_set1_epi32(0x8000);
+    for (i = 0; i + 8 <= width; i += 8)
+    {
+        low = _mm_sub_epi32(pack_rgb565_sse(_mm_loadu_si128(
+                (const __m128i *)&src[4*i])), bias);
+        high = _mm_sub_epi32(pack_rgb565_sse(_mm_loadu_si128(
+                (const __m128i *)&src[4*i + 16])), bias);
+        _mm_storeu_si128((__m128i *)&dst[2*i], _mm_add_epi16(
+                _mm_packs_epi32(low, high), _mm_set1_epi16((short)0x8000)));
+    }
+    xrgb_to_rgb565_scalar(&src[4*i], &dst[2*i], width - i);
+}
+
+// Rounds and shifts a color component computed in 16 bits to a byte
+static inline __m128i round_component_sse(__m128i component)
+{
+    /* The saturating arithmetic only saturates when the result would be
+     * clamped to 255 anyway. */
+    return _mm_srai_epi16(_mm_adds_epi16(component, _mm_set1_epi16(32)), 6);
+}
+
+static void yuyv_to_xrgb_simd(const uint8_t *src, uint8_t *dst, int width)
+{
+    int i;
+    __m128i in, chroma, y, u, v, luma, red, green, blue;
+
+    for (i = 0; i + 8 <= width; i += 8)
+    {
+        // Spread each pair's chroma to both pixels of the pair
+        in = _mm_loadu_si128((const __m128i *)&src[2*i]);
+        y = _mm_sub_epi16(_mm_and_si128(in, _mm_set1_epi16(0xff)),
+                _mm_set1_epi16(16));
+        chroma = _mm_sub_epi16(_mm_srli_epi16(in, 8), _mm_set1_epi16(128));
+        u = _mm_shufflehi_epi16(_mm_shufflelo_epi16(chroma,
+                _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+        v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(chroma,
+                _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+
+        luma = _mm_mullo_epi16(y, _mm_set1_epi16(74));
+        red = _mm_adds_epi16(luma, _mm_mullo_epi16(v, _mm_set1_epi16(102)));
+        green = _mm_subs_epi16(_mm_subs_epi16(luma, _mm_mullo_epi16(u,
+                _mm_set1_epi16(25))), _mm_mullo_epi16(v, _mm_set1_epi16(52)));
+        blue = _mm_adds_epi16(_mm_adds_epi16(luma, _mm_slli_epi16(u, 7)), u);
+        red = round_component_sse(red);
+        green = round_component_sse(green);
+        blue = round_component_sse(blue);
+        store_xrgb_sse(&dst[4*i], _mm_packus_epi16(red, red),
+                _mm_packus_epi16(green, green), _mm_packus_epi16(blue, blue));
+    }
+    yuyv_to_xrgb_scalar(&src[2*i], &dst[4*i], width - i);
+}
+
+// Extracts a color component of eight XRGB8888 pixels into 16 bits each
+static inline __m128i extract_component_sse(__m128i low, __m128i high,
+        int shift)
+{
+    __m128i mask;
+
+    mask = _mm_set1_epi32(0xff);
+    return _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(low, shift), mask),
+            _mm_and_si128(_mm_srli_epi32(high, shift), mask));
+}
+
+// Averages the pairs of 16-bit components, into the low half of each 32 bits
+static inline __m128i average_pairs_sse(__m128i component)
+{
+    __m128i even, odd;
+
+    even = _mm_and_si128(component, _mm_set1_epi32(0xffff));
+    odd = _mm_srli_epi32(component, 16);
+    return _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(even, odd),
+            _mm_set1_epi32(1)), 1);
+}
+
+// Computes a chroma component from averaged pairs, with the given weights
+static inline __m128i rgb_to_chroma_sse(__m128i positive, short weight,
+        __m128i first, short first_weight, __m128i second, short second_weight)
+{
+    __m128i chroma;
+
+    chroma = _mm_mullo_epi16(positive, _mm_set1_epi16(weight));
+    chroma = _mm_sub_epi16(chroma, _mm_mullo_epi16(first,
+            _mm_set1_epi16(first_weight)));
+    chroma = _mm_sub_epi16(chroma, _mm_mullo_epi16(second,
+            _mm_set1_epi16(second_weight)));
+    chroma = _mm_srai_epi16(_mm_add_epi16(chroma, _mm_set1_epi16(64)), 7);
+    return _mm_and_si128(_mm_add_epi16(chroma, _mm_set1_epi16(128)),
+            _mm_set1_epi32(0xff));
+}
+
+static void xrgb_to_yuyv_simd(const uint8_t *src, uint8_t *dst, int width)
+{
+    int i;
+    __m128i low, high, red, green, blue, luma, u, v;
+
+    for (i = 0; i + 8 <= width; i += 8)
+    {
+        low = _mm_loadu_si128((const __m128i *)&src[4*i]);
+        high = _mm_loadu_si128((const __m128i *)&src[4*i + 16]);
+        red = extract_component_sse(low, high, 16);
+        green = extract_component_sse(low, high, 8);
+        blue = extract_component_sse(low, high, 0);
+
+        luma = _mm_mullo_epi16(red, _mm_set1_epi16(33));
+        luma = _mm_add_epi16(luma, _mm_mullo_epi16(green, _mm_set1_epi16(65)));
+        luma = _mm_add_epi16(luma, _mm_mullo_epi16(blue, _mm_set1_epi16(13)));
+        luma = _mm_add_epi16(_mm_srli_epi16(_mm_add_epi16(luma,
+                _mm_set1_epi16(64)), 7), _mm_set1_epi16(16));
+
+        // The chroma is taken from the average of the pair of pixels
+        red = average_pairs_sse(red);
+        green = average_pairs_sse(green);
+        blue = average_pairs_sse(blue);
+        u = rgb_to_chroma_sse(blue, 56, red, 19, green, 37);
+        v = rgb_to_chroma_sse(red, 56, green, 47, blue, 9);
+
+        // Each 16 bits holds a luma sample, and the chroma sample after it
+        _mm_storeu_si128((__m128i *)&dst[2*i], _mm_or_si128(luma,
+                _mm_slli_epi16(_mm_or_si128(u, _mm_slli_epi32(v, 16)), 8)));
+    }
+    xrgb_to_yuyv_scalar(&src[4*i], &dst[2*i], width - i);
+}
+
+// The name of the vector instructions used by the SIMD kernels
+const char *pixel_simd_name(void)
+{
+    return __builtin_cpu_supports("ssse3") ? "SSSE3" : "SSE2";
+}
+
+#else
+
+const char *pixel_simd_name(void)
+{
+    return "none";
+}
+
+#endif /* PIXEL_NEON */
+
+/*----------------------------------------------------------------------------
+ * Conversion
+ *----------------------------------------------------------------------------*/
+
+// Finds the kernel for the conversion, falling back to the scalar ones
+static row_kernel_t find_kernel(enum pixel_format src, enum pixel_format dst,
+        bool use_simd)
+{
+    bool to_xrgb;
+    enum pixel_format other;
+
+    if (src == PIXEL_XRGB8888 && dst == PIXEL_XRGB8888) {
+        return copy_row;
+    }
+    to_xrgb = (dst == PIXEL_XRGB8888);
+    other = to_xrgb ? src : dst;
+
+#if defined(PIXEL_SSE)
+    // Only the 24-bit kernels need more than SSE2
+    if (use_simd && (other == PIXEL_RGB888 || other == PIXEL_BGR888) &&
+            !__builtin_cpu_supports("ssse3")) {
+        use_simd = false;
+    }
+#endif
+
+#if defined(PIXEL_NEON) || defined(PIXEL_SSE)
+    if (use_simd) {
+        switch (other)
+        {
+            case PIXEL_RGB888:
+                return to_xrgb ? rgb888_to_xrgb_simd : xrgb_to_rgb888_simd;
+            case PIXEL_BGR888:
+                return to_xrgb ? bgr888_to_xrgb_simd : xrgb_to_bgr888_simd;
+            case PIXEL_RGB565:
+                return to_xrgb ? rgb565_to_xrgb_simd : xrgb_to_rgb565_simd;
+            case PIXEL_YUYV:
+                return to_xrgb ? yuyv_to_xrgb_simd : xrgb_to_yuyv_simd;
+            default:
+                return NULL;
+        }
+    }
+#else
+    (void)use_simd;
+#endif
+
+    switch (other)
+    {
+        case PIXEL_RGB888:
+            return to_xrgb ? rgb888_to_xrgb_scalar : xrgb_to_rgb888_scalar;
+        case PIXEL_BGR888:
+            return to_xrgb ? bgr888_to_xrgb_scalar : xrgb_to_bgr888_scalar;
+        case PIXEL_RGB565:
+            return to_xrgb ? rgb565_to_xrgb_scalar : xrgb_to_rgb565_scalar;
+        case PIXEL_YUYV:
+            return to_xrgb ? yuyv_to_xrgb_scalar : xrgb_to_yuyv_scalar;
+        default:
+            return NULL;
+    }
+}
+
+// Converts the rows of a job
+static void *convert_rows(void *arg)
+{
+    int i;
+    struct convert_job *job;
+
+    job = arg;
+    for (i = 0; i < job->num_rows; i++)
+    {
+        job->kernel(job->src + i * job->src_stride,
+                    job->dst + i * job->dst_stride, job->width);
+    }
+
+    return NULL;
+}
+
+/* Converts the source image into the destination image. One of the images must
+ * be XRGB8888. The rows are split between the given number of threads. */
+int pixel_convert(const struct pixel_image *src, struct pixel_image *dst,
+        bool use_simd, int num_threads)
+{
+    int i, rows_per_job, first_row;
+    bool started[MAX_CONVERT_THREADS];
+    row_kernel_t kernel;
+    pthread_t threads[MAX_CONVERT_THREADS];
+    struct convert_job jobs[MAX_CONVERT_THREADS];
+
+    // Check that the conversion is supported
+    if (src->width != dst->width || src->height != dst->height) {
+        fprintf(stderr, "Error: The images must be the same size.\n");
+        return -EINVAL;
+    } else if (src->width < 0 || src->height < 0) {
+        fprintf(stderr, "Error: The image size must not be negative.\n");
+        return -EINVAL;
+    } else if (src->format != PIXEL_XRGB8888 &&
+               dst->format != PIXEL_XRGB8888) {
+        fprintf(stderr, "Error: Either the source or destination image must "
+                "be %s.\n", pixel_format_name(PIXEL_XRGB8888));
+        return -EINVAL;
+    } else if ((src->format == PIXEL_YUYV || dst->format == PIXEL_YUYV) &&
+               src->width % 2 != 0) {
+        fprintf(stderr, "Error: The width of a %s image must be even.\n",
+                pixel_format_name(PIXEL_YUYV));
+        return -EINVAL;
+    }
+    kernel = find_kernel(src->format, dst->format, use_simd);
+    if (kernel == NULL) {
+        return -EINVAL;
+    }
+
+    // An empty image has no rows to split between the threads
+    if (src->height == 0) {
+        return 0;
+    }
+
+    // Split the rows evenly between the threads
+    if (num_threads < 1) {
+        num_threads = 1;
+    } else if (num_threads > MAX_CONVERT_THREADS) {
+        num_threads = MAX_CONVERT_THREADS;
+    }
+    if (num_threads > src->height) {
+        num_threads = src->height;
+    }
+    rows_per_job = (src->height + num_threads - 1) / num_threads;
+
+    first_row = 0;
+    for (i = 0; i < num_threads; i++)
+    {
+        jobs[i].kernel = kernel;
+        jobs[i].src = (const uint8_t *)src->data + first_row * src->stride;
+        jobs[i].dst = (uint8_t *)dst->data + first_row * dst->stride;
+        jobs[i].src_stride = src->stride;
+        jobs[i].dst_stride = dst->stride;
+        jobs[i].width = src->width;
+        jobs[i].num_rows = (src->height - first_row < rows_per_job) ?
+                           src->height - first_row : rows_per_job;
+        first_row += jobs[i].num_rows;
+    }
+
+    /* The calling thread converts the first rows itself. If a thread can't be
+     * started, its rows are converted here as well. */
+    for (i = 1; i < num_threads; i++)
+    {
+        started[i] = (pthread_create(&threads[i], NULL, convert_rows,
+                                     &jobs[i]) == 0);
+    }
+    convert_rows(&jobs[0]);
+    for (i = 1; i < num_threads; i++)
+    {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            convert_rows(&jobs[i]);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file pixel.h
+ * @date Sunday, October 18, 2026 at 06:41:12 PM EDT
+ *
+ * This file contains the interface for converting images between common pixel
+ * formats and the XRGB8888 format used by the VDMA frame buffers.
+ *
+ * @bug No known bugs.
+ **/
+
+#ifndef PIXEL_H_
+#define PIXEL_H_
+
+#include <stdbool.h>            // Boolean type
+#include <stddef.h>             // Size type
+
+// The pixel formats that can be converted to and from XRGB8888
+enum pixel_format {
+    PIXEL_XRGB8888,             // 32-bit, B, G, R, X in memory
+    PIXEL_RGB888,               // 24-bit, R, G, B in memory
+    PIXEL_BGR888,               // 24-bit, B, G, R in memory
+    PIXEL_RGB565,               // 16-bit little-endian, red in the high bits
+    PIXEL_YUYV,                 // 4:2:2, Y0, U, Y1, V in memory (BT.601)
+};
+
+// An image in memory, where stride is the number of bytes between rows
+struct pixel_image {
+    void *data;
+    int width;
+    int height;
+    size_t stride;
+    enum pixel_format format;
+};
+
+// Pixel format utilities
+int pixel_parse_format(const char *name, enum pixel_format *format);
+const char *pixel_format_name(enum pixel_format format);
+int pixel_format_depth(enum pixel_format format);
+
+// The name of the vector instructions used by the SIMD kernels, if any
+const char *pixel_simd_name(void);
+
+/* Converts the source image into the destination image. One of the images must
+ * be XRGB8888. The rows are split between the given number of threads. */
+int pixel_convert(const struct pixel_image *src, struct pixel_image *dst,
+        bool use_simd, int num_threads);
+
+#endif /* PIXEL_H_ */
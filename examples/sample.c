@@ -0,0 +1,576 @@
+/**
+ * @file sample.c
+ * @date Sunday, October 18, 2026 at 08:14:02 PM EDT
+ *
+ * This file contains the routines for unpacking the packed ADC samples
+ * received over DMA into 16-bit integers or floats.
+ *
+ * Each format has a scalar kernel and, where the target has them, NEON or SSE
+ * kernels. The SIMD kernels read the stream straight out of the DMA buffer in
+ * whole vectors, and unpack, byte-swap, sign-extend and convert the samples
+ * in registers, so the uncached DMA memory is only read once, in bursts.
+ *
+ * All of the SIMD kernels work the same way. The bytes holding each sample are
+ * shuffled into a vector lane, in the order that puts the sample's bits next
+ * to each other. The lane is then shifted left so the sample's sign bit is at
+ * the top of the lane, and arithmetically shifted right to sign-extend it.
+ * Only the shuffle and the shifts differ between the formats.
+ *
+ * @bug No known bugs.
+ **/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>             // Fixed-width integer types
+#include <string.h>             // Memory copy and string functions
+#include <strings.h>            // Case-insensitive string comparison
+#include <errno.h>              // Error codes
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SAMPLE_NEON
+#include <arm_neon.h>           // NEON intrinsics
+#elif defined(__GNUC__) && defined(__SSE2__)
+#define SAMPLE_SSE
+#include <smmintrin.h>          // SSE4.1 intrinsics, enabled per function
+#endif
+
+#include "sample.h"             // Sample unpacking interface
+
+/* How eight samples are gathered from the stream into vector lanes. Formats
+ * narrower than 14 bits fit into 16-bit lanes, while a 14-bit sample can span
+ * three bytes, so it is gathered into a 32-bit lane. */
+struct sample_layout {
+    int bytes;                  // Stream bytes holding eight samples
+    bool wide;                  // Uses 32-bit lanes, in two vectors
+    uint8_t shuffle[2][16];     // Stream byte for each lane byte, 0x80 for 0
+    int lshift[8];              // Left shift of each lane to the sign bit
+    int rshift;                 // Arithmetic right shift to sign-extend
+};
+
+/*----------------------------------------------------------------------------
+ * Sample Formats
+ *----------------------------------------------------------------------------*/
+
+// The names of the sample formats, indexed by packing and then endianness
+static const char *format_names[][2] = {
+    [SAMPLE_PACKED12] = { "12le", "12be" },
+    [SAMPLE_PACKED14] = { "14le", "14be" },
+    [SAMPLE_INT16] = { "16le", "16be" },
+};
+
+// The bits in a sample, and the samples in a group, indexed by packing
+static const int format_bits[] = {
+    [SAMPLE_PACKED12] = 12,
+    [SAMPLE_PACKED14] = 14,
+    [SAMPLE_INT16] = 16,
+};
+static const int format_group_sizes[] = {
+    [SAMPLE_PACKED12] = 2,
+    [SAMPLE_PACKED14] = 4,
+    [SAMPLE_INT16] = 1,
+};
+
+#define NUM_PACKINGS    ((int)(sizeof(format_names) / sizeof(format_names[0])))
+
+// The vector layouts, indexed by packing and then endianness
+static const struct sample_layout layouts[][2] = {
+    [SAMPLE_PACKED12] = {
+        {
+            .bytes = 12,
+            .shuffle = {{ 0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11 }},
+            .lshift = { 4, 0, 4, 0, 4, 0, 4, 0 },
+            .rshift = 4,
+        }, {
+            .bytes = 12,
+            .shuffle = {{ 1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10 }},
+            .lshift = { 0, 4, 0, 4, 0, 4, 0, 4 },
+            .rshift = 4,
+        },
+    },
+    [SAMPLE_PACKED14] = {
+        {
+            .bytes = 14,
+            .wide = true,
+            .shuffle = {
+                { 0x80, 0, 1, 2, 0x80, 1, 2, 3, 0x80, 3, 4, 5, 0x80, 5, 6, 7 },
+                { 0x80, 7, 8, 9, 0x80, 8, 9, 10, 0x80, 10, 11, 12, 0x80, 12, 13,
+                  14 },
+            },
+            .lshift = { 10, 4, 6, 8, 10, 4, 6, 8 },
+            .rshift = 18,
+        }, {
+            .bytes = 14,
+            .wide = true,
+            .shuffle = {
+                { 0x80, 2, 1, 0, 0x80, 3, 2, 1, 0x80, 5, 4, 3, 0x80, 7, 6, 5 },
+                { 0x80, 9, 8, 7, 0x80, 10, 9, 8, 0x80, 12, 11, 10, 0x80, 14, 13,
+                  12 },
+            },
+            .lshift = { 0, 6, 4, 2, 0, 6, 4, 2 },
+            .rshift = 18,
+        },
+    },
+    [SAMPLE_INT16] = {
+        {
+            .bytes = 16,
+            .shuffle = {{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+                          15 }},
+        }, {
+            .bytes = 16,
+            .shuffle = {{ 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15,
+                          14 }},
+        },
+    },
+};
+
+// Parses the name of a sample format
+int sample_parse_format(const char *name, struct sample_format *format)
+{
+    int i, j;
+
+    for (i = 0; i < NUM_PACKINGS; i++)
+    {
+        for (j = 0; j < 2; j++)
+        {
+            if (strcasecmp(name, format_names[i][j]) == 0) {
+                format->packing = i;
+                format->big_endian = (j == 1);
+                return 0;
+            }
+        }
+    }
+
+    return -EINVAL;
+}
+
+// Gets the name of a sample format
+const char *sample_format_name(const struct sample_format *format)
+{
+    return format_names[format->packing][format->big_endian];
+}
+
+// Gets the number of bits in a sample of the format
+int sample_format_bits(const struct sample_format *format)
+{
+    return format_bits[format->packing];
+}
+
+// Gets the number of samples that are packed together into whole bytes
+int sample_group_size(const struct sample_format *format)
+{
+    return format_group_sizes[format->packing];
+}
+
+// Gets the number of bytes the given number of samples are packed into
+size_t sample_packed_size(const struct sample_format *format,
+        size_t num_samples)
+{
+    return num_samples * format_bits[format->packing] / 8;
+}
+
+/*----------------------------------------------------------------------------
+ * Scalar Kernels
+ *----------------------------------------------------------------------------*/
+
+// Sign-extends the low bits of a value
+static inline int16_t sign_extend(uint32_t value, int bits)
+{
+    return (int16_t)((int32_t)(value << (32 - bits)) >> (32 - bits));
+}
+
+// Unpacks a group of samples from the stream, returning the bytes consumed
+static inline int unpack_group(const struct sample_format *format,
+        const uint8_t *src, int16_t *dst)
+{
+    int i;
+    uint64_t word;
+
+    switch (format->packing)
+    {
+        case SAMPLE_PACKED12:
+            if (format->big_endian) {
+                dst[0] = sign_extend((src[0] << 4) | (src[1] >> 4), 12);
+                dst[1] = sign_extend(((src[1] & 0x0f) << 8) | src[2], 12);
+            } else {
+                dst[0] = sign_extend(src[0] | ((src[1] & 0x0f) << 8), 12);
+                dst[1] = sign_extend((src[1] >> 4) | (src[2] << 4), 12);
+            }
+            return 3;
+
+        case SAMPLE_PACKED14:
+            word = 0;
+            for (i = 0; i < 7; i++)
+            {
+                word |= (uint64_t)src[i] << (format->big_endian ?
+                                             8 * (6 - i) : 8 * i);
+            }
+            for (i = 0; i < 4; i++)
+            {
+                dst[i] = sign_extend(word >> (format->big_endian ?
+                                              42 - 14 * i : 14 * i), 14);
+            }
+            return 7;
+
+        case SAMPLE_INT16:
+            dst[0] = format->big_endian ? (src[0] << 8) | src[1] :
+                     src[0] | (src[1] << 8);
+            return 2;
+    }
+
+    return 0;
+}
+
+static void unpack_int16_scalar(const struct sample_format *format,
+        const uint8_t *src, int16_t *dst, size_t num_samples)
+{
+    size_t i;
+    int group_size;
+
+    group_size = format_group_sizes[format->packing];
+    for (i = 0; i < num_samples; i += group_size)
+    {
+        src += unpack_group(format, src, &dst[i]);
+    }
+}
+
+static void unpack_float_scalar(const struct sample_format *format,
+        const uint8_t *src, float *dst, size_t num_samples, float scale)
+{
+    size_t i;
+    int j, group_size;
+    int16_t group[4];
+
+    group_size = format_group_sizes[format->packing];
+    for (i = 0; i < num_samples; i += group_size)
+    {
+        src += unpack_group(format, src, group);
+        for (j = 0; j < group_size; j++)
+        {
+            dst[i + j] = group[j] * scale;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * NEON Kernels
+ *----------------------------------------------------------------------------*/
+
+#if defined(SAMPLE_NEON)
+
+// The layout of a format, loaded into vectors
+struct simd_layout {
+    bool wide;
+    uint8x16_t shuffle[2];
+    int16x8_t narrow_lshift;
+    int32x4_t wide_lshift[2];
+    int16x8_t narrow_rshift;
+    int32x4_t wide_rshift;
+};
+
+static void load_layout(const struct sample_layout *layout,
+        struct simd_layout *simd)
+{
+    int i;
+    int16_t narrow_lshift[8];
+
+    simd->wide = layout->wide;
+    simd->shuffle[0] = vld1q_u8(layout->shuffle[0]);
+    simd->shuffle[1] = vld1q_u8(layout->shuffle[1]);
+    for (i = 0; i < 8; i++)
+    {
+        narrow_lshift[i] = layout->lshift[i];
+    }
+    simd->narrow_lshift = vld1q_s16(narrow_lshift);
+    simd->wide_lshift[0] = vld1q_s32(&layout->lshift[0]);
+    simd->wide_lshift[1] = vld1q_s32(&layout->lshift[4]);
+
+    // A negative shift count shifts right, arithmetically for signed lanes
+    simd->narrow_rshift = vdupq_n_s16(-layout->rshift);
+    simd->wide_rshift = vdupq_n_s32(-layout->rshift);
+}
+
+/* Shuffles the bytes of a vector, zeroing the lanes with an index past the end.
+ * AArch64 has a 16-byte table lookup, while 32-bit ARM only looks up eight
+ * bytes at a time, from a table of up to four 8-byte vectors. */
+static inline uint8x16_t shuffle_simd(uint8x16_t in, uint8x16_t shuffle)
+{
+#if defined(__aarch64__)
+    return vqtbl1q_u8(in, shuffle);
+#else
+    uint8x8x2_t table;
+
+    table.val[0] = vget_low_u8(in);
+    table.val[1] = vget_high_u8(in);
+    return vcombine_u8(vtbl2_u8(table, vget_low_u8(shuffle)),
+                       vtbl2_u8(table, vget_high_u8(shuffle)));
+#endif
+}
+
+// Unpacks eight samples, reading 16 bytes from the stream
+static inline int16x8_t unpack8_simd(const struct simd_layout *simd,
+        const uint8_t *src)
+{
+    uint8x16_t in;
+    int16x8_t narrow;
+    int32x4_t low, high;
+
+    in = vld1q_u8(src);
+    if (simd->wide) {
+        low = vreinterpretq_s32_u8(shuffle_simd(in, simd->shuffle[0]));
+        high = vreinterpretq_s32_u8(shuffle_simd(in, simd->shuffle[1]));
+        low = vshlq_s32(vshlq_s32(low, simd->wide_lshift[0]),
+                        simd->wide_rshift);
+        high = vshlq_s32(vshlq_s32(high, simd->wide_lshift[1]),
+                         simd->wide_rshift);
+        return vcombine_s16(vmovn_s32(low), vmovn_s32(high));
+    }
+
+    narrow = vreinterpretq_s16_u8(shuffle_simd(in, simd->shuffle[0]));
+    return vshlq_s16(vshlq_s16(narrow, simd->narrow_lshift),
+                     simd->narrow_rshift);
+}
+
+static inline void store_int16_simd(int16_t *dst, int16x8_t samples)
+{
+    vst1q_s16(dst, samples);
+}
+
+/* 32-bit NEON flushes denormals to zero, so the results only differ from the
+ * scalar kernel's for a scale small enough to give denormals. */
+static inline void store_float_simd(float *dst, int16x8_t samples,
+        float scale)
+{
+    vst1q_f32(dst, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(
+            vget_low_s16(samples))), scale));
+    vst1q_f32(&dst[4], vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(
+            vget_high_s16(samples))), scale));
+}
+
+#define SIMD_KERNEL
+
+// The name of the vector instructions used by the SIMD kernels
+const char *sample_simd_name(void)
+{
+    return "NEON";
+}
+
+static bool simd_supported(void)
+{
+    return true;
+}
+
+/*----------------------------------------------------------------------------
+ * SSE Kernels
+ *----------------------------------------------------------------------------*/
+
+#elif defined(SAMPLE_SSE)
+
+/* The kernels need the byte shuffle from SSSE3, and the 32-bit multiply from
+ * SSE4.1, which are not part of the x86-64 baseline, so they are compiled for
+ * SSE4.1 separately, and only used when the processor has it. The left shifts
+ * are done as multiplies, as SSE has no shift by a different count per lane. */
+#define SIMD_KERNEL     __attribute__((target("sse4.1")))
+
+// The layout of a format, loaded into vectors
+struct simd_layout {
+    bool wide;
+    __m128i shuffle[2];
+    __m128i narrow_multiply;
+    __m128i wide_multiply[2];
+    __m128i rshift;
+};
+
+SIMD_KERNEL static void load_layout(const struct sample_layout *layout,
+        struct simd_layout *simd)
+{
+    const int *lshift;
+
+    lshift = layout->lshift;
+    simd->wide = layout->wide;
+    simd->shuffle[0] = _mm_loadu_si128((const __m128i *)layout->shuffle[0]);
+    simd->shuffle[1] = _mm_loadu_si128((const __m128i *)layout->shuffle[1]);
+    simd->narrow_multiply = _mm_setr_epi16(1 << lshift[0], 1 << lshift[1],
+            1 << lshift[2], 1 << lshift[3], 1 << lshift[4], 1 << lshift[5],
+            1 << lshift[6], 1 << lshift[7]);
+    simd->wide_multiply[0] = _mm_setr_epi32(1 << lshift[0], 1 << lshift[1],
+            1 << lshift[2], 1 << lshift[3]);
+    simd->wide_multiply[1] = _mm_setr_epi32(1 << lshift[4], 1 << lshift[5],
+            1 << lshift[6], 1 << lshift[7]);
+    simd->rshift = _mm_cvtsi32_si128(layout->rshift);
+}
+
+// Unpacks eight samples, reading 16 bytes from the stream
+SIMD_KERNEL static inline __m128i unpack8_simd(const struct simd_layout *simd,
+        const uint8_t *src)
+{
+    __m128i in, low, high;
+
+    in = _mm_loadu_si128((const __m128i *)src);
+    if (simd->wide) {
+        low = _mm_mullo_epi32(_mm_shuffle_epi8(in, simd->shuffle[0]),
+                              simd->wide_multiply[0]);
+        high = _mm_mullo_epi32(_mm_shuffle_epi8(in, simd->shuffle[1]),
+                               simd->wide_multiply[1]);
+        return _mm_packs_epi32(_mm_sra_epi32(low, simd->rshift),
+                               _mm_sra_epi32(high, simd->rshift));
+    }
+
+    return _mm_sra_epi16(_mm_mullo_epi16(_mm_shuffle_epi8(in,
+            simd->shuffle[0]), simd->narrow_multiply), simd->rshift);
+}
+
+SIMD_KERNEL static inline void store_int16_simd(int16_t *dst,
+        __m128i samples)
+{
+    _mm_storeu_si128((__m128i *)dst, samples);
+}
+
+SIMD_KERNEL static inline void store_float_simd(float *dst, __m128i samples,
+        float scale)
+{
+    __m128 scales;
+
+    // Sign-extend the samples to 32 bits by shifting them down from the top
+    scales = _mm_set1_ps(scale);
+    _mm_storeu_ps(dst, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(
+            _mm_unpacklo_epi16(samples, samples), 16)), scales));
+    _mm_storeu_ps(&dst[4], _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(
+            _mm_unpackhi_epi16(samples, samples), 16)), scales));
+}
+
+// The name of the vector instructions used by the SIMD kernels
+const char *sample_simd_name(void)
+{
+    return __builtin_cpu_supports("sse4.1") ? "SSE4.1" : "none";
+}
+
+static bool simd_supported(void)
+{
+    return __builtin_cpu_supports("sse4.1");
+}
+
+#else
+
+const char *sample_simd_name(void)
+{
+    return "none";
+}
+
+#endif /* SAMPLE_NEON */
+
+#if defined(SAMPLE_NEON) || defined(SAMPLE_SSE)
+
+/* Unpacks the samples eight at a time, while a whole vector can be read from
+ * the stream, returning the number unpacked. The rest are left to the scalar
+ * kernel, as the last vector would read past the end of the stream. */
+SIMD_KERNEL static size_t unpack_int16_simd(const struct sample_layout *layout,
+        const uint8_t *src, int16_t *dst, size_t num_samples,
+        size_t packed_size)
+{
+    size_t i, offset;
+    struct simd_layout simd;
+
+    load_layout(layout, &simd);
+    for (i = 0, offset = 0; i + 8 <= num_samples && offset + 16 <= packed_size;
+         i += 8, offset += layout->bytes)
+    {
+        store_int16_simd(&dst[i], unpack8_simd(&simd, &src[offset]));
+    }
+
+    return i;
+}
+
+SIMD_KERNEL static size_t unpack_float_simd(const struct sample_layout *layout,
+        const uint8_t *src, float *dst, size_t num_samples, size_t packed_size,
+        float scale)
+{
+    size_t i, offset;
+    struct simd_layout simd;
+
+    load_layout(layout, &simd);
+    for (i = 0, offset = 0; i + 8 <= num_samples && offset + 16 <= packed_size;
+         i += 8, offset += layout->bytes)
+    {
+        store_float_simd(&dst[i], unpack8_simd(&simd, &src[offset]), scale);
+    }
+
+    return i;
+}
+
+#endif /* SAMPLE_NEON || SAMPLE_SSE */
+
+/*----------------------------------------------------------------------------
+ * Unpacking
+ *----------------------------------------------------------------------------*/
+
+// Checks that the samples fill a whole number of groups
+static int check_samples(const struct sample_format *format,
+        size_t num_samples)
+{
+    if (num_samples % format_group_sizes[format->packing] != 0) {
+        fprintf(stderr, "Error: The number of %s samples must be a multiple "
+                "of %d.\n", sample_format_name(format),
+                format_group_sizes[format->packing]);
+        return -EINVAL;
+    }
+    return 0;
+}
+
+/* Unpacks the samples into 16-bit integers, sign-extending them. The number of
+ * samples must be a multiple of the format's group size. */
+int sample_unpack_int16(const struct sample_format *format, const void *src,
+        int16_t *dst, size_t num_samples, bool use_simd)
+{
+    size_t done;
+    const uint8_t *stream;
+
+    if (check_samples(format, num_samples) < 0) {
+        return -EINVAL;
+    }
+
+    stream = src;
+    done = 0;
+#if defined(SAMPLE_NEON) || defined(SAMPLE_SSE)
+    if (use_simd && simd_supported()) {
+        done = unpack_int16_simd(&layouts[format->packing][format->big_endian],
+                stream, dst, num_samples, sample_packed_size(format,
+                num_samples));
+    }
+#else
+    (void)use_simd;
+#endif
+
+    unpack_int16_scalar(format, stream + sample_packed_size(format, done),
+                        &dst[done], num_samples - done);
+    return 0;
+}
+
+/* Unpacks the samples into floats, multiplying each one by the scale. The
+ * number of samples must be a multiple of the format's group size. */
+int sample_unpack_float(const struct sample_format *format, const void *src,
+        float *dst, size_t num_samples, float scale, bool use_simd)
+{
+    size_t done;
+    const uint8_t *stream;
+
+    if (check_samples(format, num_samples) < 0) {
+        return -EINVAL;
+    }
+
+    stream = src;
+    done = 0;
+#if defined(SAMPLE_NEON) || defined(SAMPLE_SSE)
+    if (use_simd && simd_supported()) {
+        done = unpack_float_simd(&layouts[format->packing][format->big_endian],
+                stream, dst, num_samples, sample_packed_size(format,
+                num_samples), scale);
+    }
+#else
+    (void)use_simd;
+#endif
+
+    unpack_float_scalar(format, stream + sample_packed_size(format, done),
+                        &dst[done], num_samples - done, scale);
+    return 0;
+}
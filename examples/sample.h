@@ -0,0 +1,54 @@
+/**
+ * @file sample.h
+ * @date Sunday, October 18, 2026 at 08:12:37 PM EDT
+ *
+ * This file contains the interface for unpacking the packed ADC samples
+ * received over DMA into 16-bit integers or floats.
+ *
+ * @bug No known bugs.
+ **/
+
+#ifndef SAMPLE_H_
+#define SAMPLE_H_
+
+#include <stdbool.h>            // Boolean type
+#include <stddef.h>             // Size type
+#include <stdint.h>             // Fixed-width integer types
+
+// The ways the signed samples can be packed into a stream
+enum sample_packing {
+    SAMPLE_PACKED12,            // Two 12-bit samples in every 3 bytes
+    SAMPLE_PACKED14,            // Four 14-bit samples in every 7 bytes
+    SAMPLE_INT16,               // One 16-bit sample in every 2 bytes
+};
+
+/* The format of a stream of samples. A big-endian stream has the first sample
+ * in the most significant bits of the first byte, a little-endian stream in
+ * the least significant bits. */
+struct sample_format {
+    enum sample_packing packing;
+    bool big_endian;
+};
+
+// Sample format utilities
+int sample_parse_format(const char *name, struct sample_format *format);
+const char *sample_format_name(const struct sample_format *format);
+int sample_format_bits(const struct sample_format *format);
+int sample_group_size(const struct sample_format *format);
+size_t sample_packed_size(const struct sample_format *format,
+        size_t num_samples);
+
+// The name of the vector instructions used by the SIMD kernels, if any
+const char *sample_simd_name(void);
+
+/* Unpacks the samples into 16-bit integers, sign-extending them. The number of
+ * samples must be a multiple of the format's group size. */
+int sample_unpack_int16(const struct sample_format *format, const void *src,
+        int16_t *dst, size_t num_samples, bool use_simd);
+
+/* Unpacks the samples into floats, multiplying each one by the scale. The
+ * number of samples must be a multiple of the format's group size. */
+int sample_unpack_float(const struct sample_format *format, const void *src,
+        float *dst, size_t num_samples, float scale, bool use_simd);
+
+#endif /* SAMPLE_H_ */
@@ -13,6 +13,7 @@
 #define AXIDMA_IOCTL_H_
 
 #include <asm/ioctl.h>              // IOCTL macros
+#include <linux/types.h>            // Fixed-width integer types
 
 /*----------------------------------------------------------------------------
  * IOCTL Defintions
@@ -24,6 +25,62 @@
 // The standard path to the AXI DMA device
 #define AXIDMA_DEV_PATH     ("/dev/" AXIDMA_DEV_NAME)
 
+/*----------------------------------------------------------------------------
+ * Memory Map Definitions
+ *----------------------------------------------------------------------------*/
+
+/* The granularity of the special offsets passed to mmap. This is a multiple of
+ * all of the supported page sizes. An offset of 0 allocates a new DMA buffer. */
+#define AXIDMA_MMAP_OFFSET_UNIT     0x10000
+
+// The offset to pass to mmap to map the read-only status page
+#define AXIDMA_STATUS_PAGE_OFFSET   (1 * AXIDMA_MMAP_OFFSET_UNIT)
+
+// The size of the status page to pass to mmap
+#define AXIDMA_STATUS_PAGE_SIZE     4096
+
+// The maximum number of named buffer pools, and of buffers in each pool
+#define AXIDMA_MAX_POOLS            16
+#define AXIDMA_MAX_POOL_BUFFERS     1024
+
+/* The offset to pass to mmap to map a buffer of a named buffer pool. Each
+ * buffer has its own offset, after the status page. */
+#define AXIDMA_POOL_OFFSET(pool_id, index) \
+    ((2 + (pool_id) * AXIDMA_MAX_POOL_BUFFERS + (index)) * \
+     AXIDMA_MMAP_OFFSET_UNIT)
+
+// The maximum number of channels that are reported in the status page
+#define AXIDMA_STATUS_MAX_CHANNELS  64
+
+/**
+ * Structure holding the progress counters for a channel in the status page.
+ *
+ * The counters are protected by a sequence lock. The driver makes the sequence
+ * odd while it updates the counters, and even again once it is done. A reader
+ * must retry if the sequence was odd, or changed while reading the counters.
+ **/
+struct axidma_chan_status {
+    __u32 sequence;                 ///< Sequence lock count for the counters.
+    __s32 channel_id;               ///< The id of the channel.
+    __u64 completed;                ///< Number of transfers completed.
+    __u64 bytes;                    ///< Number of bytes in completed transfers.
+    __s32 last_cookie;              ///< Cookie of the last completed transfer.
+    __u32 errors;                   ///< Number of transfers that failed.
+};
+
+/**
+ * Structure representing the layout of the read-only status page.
+ *
+ * The status page is mapped by calling mmap on the AXI DMA device at the
+ * offset #AXIDMA_STATUS_PAGE_OFFSET, with a size of #AXIDMA_STATUS_PAGE_SIZE.
+ * The channels are in the same order as returned by AXIDMA_GET_DMA_CHANNELS.
+ **/
+struct axidma_status_page {
+    __u32 num_channels;             ///< The number of channels in the page.
+    __u32 reserved;                 ///< Reserved for future use.
+    struct axidma_chan_status channels[AXIDMA_STATUS_MAX_CHANNELS];
+};
+
 /*----------------------------------------------------------------------------
  * IOCTL Argument Definitions
  *----------------------------------------------------------------------------*/
@@ -46,13 +103,16 @@ enum axidma_dir {
 /**
  * Enumeration for the type of a DMA channel.
  *
- * There are two types of channels, the standard DMA channel, and the special
- * video DMA (VDMA) channel. The VDMA channel is for transferring frame buffers
- * and other display related data.
+ * There are three types of channels, the standard DMA channel, the special
+ * video DMA (VDMA) channel, and the central DMA (CDMA) channel. The VDMA
+ * channel is for transferring frame buffers and other display related data.
+ * The CDMA channel copies between buffers in memory, and does not have a
+ * direction; it is reported as a transmit channel.
  **/
 enum axidma_type {
     AXIDMA_DMA,                     ///< Standard AXI DMA engine
-    AXIDMA_VDMA                     ///< Specialized AXI video DMA enginge
+    AXIDMA_VDMA,                    ///< Specialized AXI video DMA enginge
+    AXIDMA_CDMA                     ///< Memory-to-memory AXI central DMA engine
 };
 
 /**
@@ -67,6 +127,40 @@ struct axidma_video_frame {
     int depth;                      ///< Depth of the image in terms of pixels.
 };
 
+/**
+ * Structure holding the kernel timestamps for a transfer.
+ *
+ * The timestamps are taken with the kernel's monotonic clock, which is the same
+ * clock as CLOCK_MONOTONIC in userspace, and are in nanoseconds. A timestamp
+ * is 0 if that point has not been reached, or is no longer known.
+ *
+ * The difference between the issue and submit times is the time spent queued
+ * in the driver, and the difference between the complete and issue times is
+ * the time spent in the hardware.
+ **/
+struct axidma_timestamps {
+    __u64 submit_ns;                ///< When the transfer was submitted.
+    __u64 issue_ns;                 ///< When the engine was told to start it.
+    __u64 complete_ns;              ///< When the completion callback ran.
+};
+
+// The number of 32-bit sideband words the AXI DMA carries with each packet
+#define AXIDMA_METADATA_WORDS           5
+
+/**
+ * Structure holding the sideband metadata carried with a packet.
+ *
+ * When the AXI DMA is built with the status and control streams, each packet
+ * carries the APP0 to APP4 words alongside the payload. They are sent on the
+ * control stream for a transmit transfer, and received from the status stream
+ * for a receive transfer. The length is the number of valid bytes in the
+ * words, which is 0 when the transfer has no metadata.
+ **/
+struct axidma_metadata {
+    __u32 len;                      ///< The number of valid bytes in app.
+    __u32 app[AXIDMA_METADATA_WORDS];   ///< The APP0 to APP4 words.
+};
+
 // TODO: Channel really should not be here
 struct axidma_chan {
     enum axidma_dir dir;            // The DMA direction of the channel
@@ -82,6 +176,7 @@ struct axidma_num_channels {
     int num_dma_rx_channels;        // DMA receive channels available
     int num_vdma_tx_channels;       // VDMA transmit channels available
     int num_vdma_rx_channels;       // VDMA receive channels available
+    int num_cdma_channels;          // CDMA memory copy channels available
 };
 
 struct axidma_channel_info {
@@ -99,6 +194,9 @@ struct axidma_transaction {
     int channel_id;                 // The id of the DMA channel to use
     void *buf;                      // The buffer used for the transaction
     size_t buf_len;                 // The length of the buffer
+    int cookie;                     // The cookie for the transfer (output)
+    struct axidma_timestamps timestamps;    // The transfer's times (output)
+    struct axidma_metadata metadata;    // The packet's sideband words
 
     // Kept as a union for extend ability.
     union {
@@ -116,6 +214,37 @@ struct axidma_inout_transaction {
     void *rx_buf;                   // The buffer to place the data in
     size_t rx_buf_len;              // The length of the receive buffer
     struct axidma_video_frame rx_frame; // Frame information for receive.
+    int tx_cookie;                  // The cookie for the transmit (output)
+    int rx_cookie;                  // The cookie for the receive (output)
+    struct axidma_timestamps tx_timestamps; // The transmit's times (output)
+    struct axidma_timestamps rx_timestamps; // The receive's times (output)
+};
+
+// The maximum number of frame buffers for a video transfer, as for the VDMA
+#define AXIDMA_MAX_FRAME_BUFFERS        32
+
+// The limits on the shape of a copy, in rows, and bytes between rows
+#define AXIDMA_MAX_COPY_ROWS            65536
+#define AXIDMA_MAX_COPY_STRIDE          (16 * 1024 * 1024)
+
+/**
+ * Structure representing a memory-to-memory copy on a CDMA channel.
+ *
+ * The copy moves a number of rows of the same length, so that a rectangle can
+ * be copied out of or into a larger image. A flat copy is a single row, and
+ * the strides are then ignored.
+ **/
+struct axidma_memcpy_transaction {
+    bool wait;                      // Indicates if the call is blocking
+    int channel_id;                 // The id of the CDMA channel to use
+    void *dst;                      // The buffer to copy into
+    void *src;                      // The buffer to copy from
+    size_t len;                     // The number of bytes in each row
+    int num_rows;                   // The number of rows to copy
+    size_t dst_stride;              // The bytes between rows in dst
+    size_t src_stride;              // The bytes between rows in src
+    int cookie;                     // The cookie for the copy (output)
+    struct axidma_timestamps timestamps;    // The copy's times (output)
 };
 
 struct axidma_video_transaction {
@@ -125,6 +254,204 @@ struct axidma_video_transaction {
     struct axidma_video_frame frame;        // Information about the frame
 };
 
+/**
+ * Enumeration for the state of a transfer waited on with AXIDMA_WAIT_ANY.
+ **/
+enum axidma_wait_status {
+    AXIDMA_WAIT_PENDING,            ///< The transfer is still in progress.
+    AXIDMA_WAIT_COMPLETE,           ///< The transfer completed successfully.
+    AXIDMA_WAIT_ERROR               ///< The transfer completed with an error.
+};
+
+/**
+ * Structure representing a single transfer to wait on.
+ *
+ * A transfer is identified by the channel it was submitted on, along with the
+ * cookie returned by the driver when the transfer was submitted.
+ *
+ * The length is the number of bytes transferred, which for a receive transfer
+ * is the size of the packet that ended it. The engine only reports this to the
+ * completion callback, so a transfer completed while the channel is polling,
+ * or on a kernel older than 4.9, reports the full length of its buffer. A
+ * receive that can carry metadata always completes from the callback, so it
+ * reports both the metadata and the length even while the channel is polling.
+ **/
+struct axidma_wait_entry {
+    int channel_id;                 ///< The id of the transfer's channel.
+    int cookie;                     ///< The cookie returned for the transfer.
+    enum axidma_wait_status status; ///< The state of the transfer (output).
+    struct axidma_timestamps timestamps;    ///< The transfer's times (output).
+    struct axidma_metadata metadata;    ///< The received sideband (output).
+    __u64 len;                      ///< The bytes transferred (output).
+};
+
+// The maximum number of transfers that can be waited on in a single call
+#define AXIDMA_MAX_WAIT_ENTRIES         256
+
+struct axidma_wait_any {
+    int num_entries;                // The number of transfers to wait on
+    struct axidma_wait_entry *entries;  // The transfers to wait on
+    int timeout;                    // Timeout in milliseconds, <0 is infinite
+};
+
+/**
+ * Structure representing the adaptive completion settings for a channel.
+ *
+ * Completions are normally handled from the DMA engine's interrupt. When the
+ * completion rate on the channel rises to the enter rate, the driver switches
+ * the channel to polling. Transfers are then submitted without requesting an
+ * interrupt, and a kernel thread checks for their completion every poll
+ * interval. Once the rate falls below the exit rate, the channel goes back to
+ * using interrupts. The rates are in transfers per second.
+ *
+ * The Xilinx DMA driver ignores the request for an interrupt, and still takes
+ * one for every transfer. Polling only moves the completion handling off of
+ * the driver's callback, and does not reduce the interrupt load.
+ **/
+struct axidma_adaptive_config {
+    int channel_id;                 ///< The id of the channel to configure.
+    __u32 poll_enter_rate;          ///< Rate to start polling at, 0 disables.
+    __u32 poll_exit_rate;           ///< Rate to go back to interrupts below.
+    __u32 poll_interval_us;         ///< Time between polls in microseconds.
+};
+
+/* The number of buckets in the latency histogram of a channel. Bucket 0 counts
+ * latencies below 2 us, and bucket i counts latencies from 2^i up to 2^(i+1)
+ * microseconds. The last bucket also counts all larger latencies. */
+#define AXIDMA_LATENCY_BUCKETS          24
+
+/**
+ * Structure holding the statistics for the completion handling of a channel.
+ *
+ * The latency of a transfer is measured from when it was submitted to the
+ * driver until the driver saw it complete, so it includes any time queued.
+ **/
+struct axidma_chan_stats {
+    int channel_id;                 ///< The id of the channel (input).
+    int polling;                    ///< Indicates if the channel is polling.
+    struct axidma_adaptive_config config;   ///< The current adaptive settings.
+    __u64 irq_mode_ns;              ///< Time spent using interrupts.
+    __u64 poll_mode_ns;             ///< Time spent polling.
+    __u64 mode_switches;            ///< Number of switches between the modes.
+    __u64 irq_completions;          ///< Transfers completed by an interrupt.
+    __u64 poll_completions;         ///< Transfers completed by polling.
+    __u32 inflight;                 ///< Transfers currently in-flight.
+    __u32 queued;                   ///< Transfers waiting to be issued.
+    __u32 timeouts;                 ///< Blocking transfers that timed out.
+    __u64 latency_hist[AXIDMA_LATENCY_BUCKETS]; ///< Histogram of latencies.
+};
+
+/**
+ * Structure holding the usage of the DMA buffers across the whole device.
+ **/
+struct axidma_device_stats {
+    __u32 num_allocations;          ///< Number of DMA buffers allocated.
+    __u32 num_external;             ///< Number of external buffers registered.
+    __u64 allocated_bytes;          ///< Total size of the DMA buffers.
+    __u64 external_bytes;           ///< Total size of the external buffers.
+    __u32 transfer_allocations;     ///< Heap allocations made by transfers.
+    __u32 num_pool_buffers;         ///< Number of buffers in named pools.
+    __u64 pool_bytes;               ///< Total size of the named pools.
+};
+
+/**
+ * Structure representing a frame of a capture ring, acquired or released by a
+ * consumer.
+ *
+ * When acquiring, the consumer either asks for the newest frame, which suits a
+ * preview, or the oldest frame after the last one it saw, which suits a
+ * recorder that wants every frame.
+ **/
+struct axidma_capture_frame {
+    int channel_id;                 ///< The id of the capture channel.
+    int latest;                     ///< Acquire the newest frame, not oldest.
+    __u64 after_sequence;           ///< Only acquire frames after this one.
+    int timeout;                    ///< Timeout in milliseconds, <0 is infinite.
+    int index;                      ///< The frame buffer index (output).
+    __u64 sequence;                 ///< The frame's number, from 1 (output).
+    __u64 timestamp_ns;             ///< When the frame was captured (output).
+    __u64 unread;                   ///< Frames reused unread (output).
+    __u64 stalls;                   ///< Times no frame buffer was free (output).
+};
+
+// The maximum length of the name of a buffer pool, including the terminator
+#define AXIDMA_POOL_NAME_LEN            32
+
+/**
+ * Structure representing a named buffer pool owned by the driver.
+ *
+ * The buffers of a pool are allocated when it is created, and are kept until
+ * it is destroyed, independently of the processes using them. A process can
+ * attach to an existing pool by name, and map its buffers with mmap, using
+ * the offsets given by #AXIDMA_POOL_OFFSET.
+ **/
+struct axidma_pool_config {
+    char name[AXIDMA_POOL_NAME_LEN];    ///< The name of the pool.
+    int num_buffers;                ///< The number of buffers in the pool.
+    __u64 buffer_size;              ///< The size of each buffer in bytes.
+    int pool_id;                    ///< The id of the pool (output).
+    int attached;                   ///< The pool already existed (output).
+};
+
+/**
+ * Structure representing where and how the completions of a channel are
+ * processed by the driver's completion thread.
+ *
+ * The CPU pins the thread to a single core, and a value of -1 lets it run on
+ * any core. A priority between 1 and 99 runs the thread with the SCHED_FIFO
+ * real-time policy, and a priority of 0 uses the normal policy.
+ **/
+struct axidma_completion_config {
+    int channel_id;                 ///< The id of the channel to configure.
+    int cpu;                        ///< The CPU to run on, or -1 for any.
+    int priority;                   ///< The SCHED_FIFO priority, or 0.
+};
+
+/**
+ * Enumeration for how the transfers queued on a channel by different processes
+ * are ordered into the hardware.
+ *
+ * FIFO issues the transfers in the order they were submitted. FAIR gives each
+ * process a share of the channel's bytes in proportion to its weight, using
+ * deficit round robin. PRIORITY always issues the transfers of the process
+ * with the highest priority first, alternating between processes of the same
+ * priority.
+ **/
+enum axidma_sched_policy {
+    AXIDMA_SCHED_FIFO,              ///< Issue transfers in submission order
+    AXIDMA_SCHED_FAIR,              ///< Share bytes between processes by weight
+    AXIDMA_SCHED_PRIORITY,          ///< Strict priority between processes
+};
+
+/**
+ * Structure representing the scheduling settings for a channel.
+ *
+ * The limits bound the work committed to the DMA engine at once, which is the
+ * longest a newly scheduled transfer can wait behind transfers that were
+ * already issued. At least one transfer is always issued, even if it is larger
+ * than the byte limit.
+ **/
+struct axidma_sched_config {
+    int channel_id;                 ///< The id of the channel to configure.
+    enum axidma_sched_policy policy;    ///< How the queued transfers are picked.
+    int max_hw_transfers;           ///< Transfers issued at once, 0 for all.
+    __u64 max_hw_bytes;             ///< Bytes issued at once, 0 for no limit.
+};
+
+/**
+ * Structure representing the scheduling parameters of a process on a channel.
+ *
+ * The weight is only used by the fair policy, and the priority by the priority
+ * policy. Processes that were not configured have a weight of 1 and a priority
+ * of 0.
+ **/
+struct axidma_submitter_config {
+    int channel_id;                 ///< The id of the channel to configure.
+    int pid;                        ///< The process id, or 0 for the caller.
+    __u32 weight;                   ///< Share of the channel, 0 for defaults.
+    int priority;                   ///< Higher priorities are issued first.
+};
+
 /*----------------------------------------------------------------------------
  * IOCTL Interface
  *----------------------------------------------------------------------------*/
@@ -133,7 +460,7 @@ struct axidma_video_transaction {
 #define AXIDMA_IOCTL_MAGIC              'W'
 
 // The number of IOCTL's implemented, used for verification
-#define AXIDMA_NUM_IOCTLS               10
+#define AXIDMA_NUM_IOCTLS               24
 
 /**
  * Returns the number of available DMA channels in the system.
@@ -147,6 +474,7 @@ struct axidma_video_transaction {
  *  - num_dma_rx_channels - The number of receive AXI DMA channels
  *  - num_vdma_tx_channels - The number of transmit AXI VDMA channels
  *  - num_vdma_rx_channels - The number of receive AXI VDMA channels
+ *  - num_cdma_channels - The number of AXI CDMA channels
  **/
 #define AXIDMA_GET_NUM_DMA_CHANNELS     _IOW(AXIDMA_IOCTL_MAGIC, 0, \
                                              struct axidma_num_channels)
@@ -178,6 +506,16 @@ struct axidma_video_transaction {
 #define AXIDMA_GET_DMA_CHANNELS         _IOR(AXIDMA_IOCTL_MAGIC, 1, \
                                              struct axidma_channel_info)
 
+/* The flag for AXIDMA_SET_DMA_SIGNAL that has the signal carry the low bits of
+ * the completed transfer's cookie, above the channel id. */
+#define AXIDMA_SIGNAL_WITH_COOKIE       (1 << 16)
+
+// Packs and unpacks the channel id and cookie carried by a completion signal
+#define AXIDMA_SIGNAL_VALUE(channel_id, cookie) \
+    ((int)((channel_id) & 0xffff) | (int)(((cookie) & 0x7fff) << 16))
+#define AXIDMA_SIGNAL_CHANNEL(value)    ((value) & 0xffff)
+#define AXIDMA_SIGNAL_COOKIE(value)     (((value) >> 16) & 0x7fff)
+
 /**
  * Register the given signal to be sent when DMA transactions complete.
  *
@@ -188,14 +526,18 @@ struct axidma_video_transaction {
  *
  * The signal must be one of the POSIX real time signals. So, it must be
  * between the signals SIGRTMIN and SIGRTMAX. The kernel will deliver the
- * channel id back to the userspace signal handler.
+ * channel id back to the userspace signal handler, in si_int. If the signal is
+ * or'ed with #AXIDMA_SIGNAL_WITH_COOKIE, si_int also carries the low 15 bits of
+ * the completed transfer's cookie, so the handler can tell which transfer
+ * completed. These are unpacked with AXIDMA_SIGNAL_CHANNEL() and
+ * AXIDMA_SIGNAL_COOKIE(), and the channel id must then be below 65536.
  *
  * This can be used to have a user callback function, effectively emulating an
  * interrupt in userspace. The user must register their signal handler for
  * the specified signal for this to happen.
  *
  * Inputs:
- *  - signal - The signal to send upon transaction completion.
+ *  - signal - The signal to send upon transaction completion, and its flags.
  **/
 #define AXIDMA_SET_DMA_SIGNAL           _IO(AXIDMA_IOCTL_MAGIC, 2)
 
@@ -241,6 +583,13 @@ struct axidma_video_transaction {
  *  - channel_id - The id for the channel you want receive data over.
  *  - buf - The address of the buffer you want to receive the data in.
  *  - buf_len - The number of bytes to receive.
+ *
+ * Outputs:
+ *  - cookie - The cookie identifying the transfer, for AXIDMA_WAIT_ANY.
+ *  - timestamps - The kernel timestamps for the transfer. The completion time
+ *                 is only known if the call was blocking.
+ *  - metadata - The sideband words received with the packet, if the call was
+ *               blocking. Otherwise, they are reported by AXIDMA_WAIT_ANY.
  **/
 #define AXIDMA_DMA_READ                 _IOR(AXIDMA_IOCTL_MAGIC, 4, \
                                              struct axidma_transaction)
@@ -262,6 +611,13 @@ struct axidma_video_transaction {
  *  - channel_id - The id for the channel you want to send data over.
  *  - buf - The address of the data you want to send.
  *  - buf_len - The number of bytes to send.
+ *  - metadata - The sideband words to send with the packet. A length of 0
+ *               sends none, otherwise the channel must support metadata.
+ *
+ * Outputs:
+ *  - cookie - The cookie identifying the transfer, for AXIDMA_WAIT_ANY.
+ *  - timestamps - The kernel timestamps for the transfer. The completion time
+ *                 is only known if the call was blocking.
  **/
 #define AXIDMA_DMA_WRITE                _IOR(AXIDMA_IOCTL_MAGIC, 5, \
                                              struct axidma_transaction)
@@ -287,6 +643,12 @@ struct axidma_video_transaction {
  *  - tx_buf_len - The number of bytes you want to send.
  *  - rx_buf - The address of the buffer you want to receive data in.
  *  - rx_buf_len - The number of bytes you want to receive.
+ *
+ * Outputs:
+ *  - tx_cookie - The cookie identifying the transmit transfer.
+ *  - rx_cookie - The cookie identifying the receive transfer.
+ *  - tx_timestamps - The kernel timestamps for the transmit transfer.
+ *  - rx_timestamps - The kernel timestamps for the receive transfer.
  **/
 #define AXIDMA_DMA_READWRITE            _IOR(AXIDMA_IOCTL_MAGIC, 6, \
                                              struct axidma_inout_transaction)
@@ -377,4 +739,273 @@ struct axidma_video_transaction {
  **/
 #define AXIDMA_UNREGISTER_BUFFER        _IO(AXIDMA_IOCTL_MAGIC, 10)
 
+/**
+ * Waits until any one of the given transfers completes, or the timeout expires.
+ *
+ * This allows a single thread to multiplex several asynchronous transfers,
+ * possibly spread over many channels, without needing to handle signals. The
+ * transfers are identified by their channel id and the cookie returned when
+ * they were submitted. Upon return, the status of every entry is updated, so
+ * all transfers that have finished are reported, not just the first one.
+ *
+ * A timeout of 0 polls the transfers without sleeping, and a negative timeout
+ * waits indefinitely. The ioctl returns the number of finished transfers,
+ * which is 0 if the timeout expired.
+ *
+ * Inputs:
+ *  - num_entries - The number of transfers, at most AXIDMA_MAX_WAIT_ENTRIES.
+ *  - entries - An array of channel id and cookie pairs to wait on.
+ *  - timeout - The maximum time to wait in milliseconds.
+ *
+ * Outputs:
+ *  - entries - The status of each transfer is updated, along with its kernel
+ *              timestamps and received metadata, if they are still known to
+ *              the driver.
+ **/
+#define AXIDMA_WAIT_ANY                 _IOR(AXIDMA_IOCTL_MAGIC, 11, \
+                                             struct axidma_wait_any)
+
+/**
+ * Configures the adaptive interrupt and polling completion mode for a channel.
+ *
+ * At high transfer rates, taking an interrupt for every completion wastes CPU
+ * time, while always polling wastes a core at low rates. With this enabled,
+ * the driver measures the completion rate of the channel, and switches between
+ * the two modes as the rate crosses the given thresholds. The exit rate must
+ * not be larger than the enter rate, so that the channel does not oscillate
+ * between the modes. An enter rate of 0 disables polling for the channel.
+ *
+ * Inputs:
+ *  - channel_id - The id for the channel to configure.
+ *  - poll_enter_rate - The completions per second at which polling starts.
+ *  - poll_exit_rate - The completions per second below which polling stops.
+ *  - poll_interval_us - The time between polls, in microseconds.
+ **/
+#define AXIDMA_SET_ADAPTIVE             _IOR(AXIDMA_IOCTL_MAGIC, 12, \
+                                             struct axidma_adaptive_config)
+
+/**
+ * Gets the completion handling statistics for a channel.
+ *
+ * This reports which mode the channel is currently in, the time it has spent
+ * in each mode, and how many transfers were completed in each mode. It also
+ * reports the number of transfers in-flight, the number of timeouts, and a
+ * histogram of the transfer latencies.
+ *
+ * Inputs:
+ *  - channel_id - The id for the channel to get the statistics for.
+ *
+ * Outputs:
+ *  - The remaining fields of the structure.
+ **/
+#define AXIDMA_GET_CHAN_STATS           _IOR(AXIDMA_IOCTL_MAGIC, 13, \
+                                             struct axidma_chan_stats)
+
+/**
+ * Sets the CPU affinity and scheduling priority of a channel's completion
+ * thread.
+ *
+ * The completion thread polls for and retires the channel's transfers when the
+ * adaptive mode has switched it to polling, so it determines where the waiting
+ * threads are woken up from. The thread is created by this call if it does not
+ * exist yet, and the settings are kept for the lifetime of the driver.
+ *
+ * The DMA interrupt and the Xilinx DMA driver's completion tasklet are owned by
+ * the DMA engine, so they are not affected. Their CPU can be set through the
+ * interrupt's /proc/irq/<irq>/smp_affinity file.
+ *
+ * Inputs:
+ *  - channel_id - The id for the channel to configure.
+ *  - cpu - The CPU to pin the thread to, or -1 for any CPU.
+ *  - priority - The SCHED_FIFO priority from 1 to 99, or 0 for SCHED_NORMAL.
+ **/
+#define AXIDMA_SET_COMPLETION_CONFIG    _IOR(AXIDMA_IOCTL_MAGIC, 14, \
+                                             struct axidma_completion_config)
+
+/**
+ * Gets the usage of the DMA buffers across the whole device.
+ *
+ * The buffers allocated through mmap come from the contiguous memory allocator
+ * (CMA), so this shows how much of it is being used by the driver.
+ *
+ * Outputs:
+ *  - num_allocations - The number of DMA buffers currently allocated.
+ *  - num_external - The number of external DMA buffers registered.
+ *  - allocated_bytes - The total size of the allocated DMA buffers.
+ *  - external_bytes - The total size of the registered external buffers.
+ *  - transfer_allocations - The number of times the driver had to allocate
+ *                           memory to perform a transfer, because its
+ *                           preallocated memory was in use. This stays at 0
+ *                           in steady state.
+ *  - num_pool_buffers - The number of buffers in the named buffer pools.
+ *  - pool_bytes - The total size of the named buffer pools.
+ **/
+#define AXIDMA_GET_DEVICE_STATS         _IOW(AXIDMA_IOCTL_MAGIC, 15, \
+                                             struct axidma_device_stats)
+
+/**
+ * Sets how the transfers submitted by different processes on a channel are
+ * scheduled into the DMA engine.
+ *
+ * Transfers are queued per process in the driver, and only issued to the
+ * engine while the channel is below its in-flight limits. A process submitting
+ * large bulk transfers then cannot fill the engine's queue ahead of a process
+ * with latency sensitive transfers. By default, the policy is FIFO, and all of
+ * the channel's transfers can be in-flight, so transfers are issued as soon as
+ * they are submitted.
+ *
+ * Inputs:
+ *  - channel_id - The id for the channel to configure.
+ *  - policy - How the next transfer to issue is picked.
+ *  - max_hw_transfers - The number of transfers issued to the engine at once,
+ *                       or 0 to allow all of the channel's transfers.
+ *  - max_hw_bytes - The number of bytes issued to the engine at once, or 0 for
+ *                   no limit.
+ **/
+#define AXIDMA_SET_SCHED                _IOR(AXIDMA_IOCTL_MAGIC, 16, \
+                                             struct axidma_sched_config)
+
+/**
+ * Sets the weight and priority of a process's transfers on a channel.
+ *
+ * The driver tracks a limited number of processes per channel. A process that
+ * was configured keeps its entry until it is reset by passing a weight of 0.
+ *
+ * Inputs:
+ *  - channel_id - The id for the channel to configure.
+ *  - pid - The id of the process, or 0 for the calling process.
+ *  - weight - The process's share of the channel under the fair policy, or 0
+ *             to reset the process to the defaults.
+ *  - priority - The process's priority under the priority policy.
+ **/
+#define AXIDMA_SET_SUBMITTER            _IOR(AXIDMA_IOCTL_MAGIC, 17, \
+                                             struct axidma_submitter_config)
+
+/**
+ * Creates a named buffer pool, or attaches to it if it already exists.
+ *
+ * The driver allocates all of the pool's buffers when the pool is created, and
+ * owns them until the pool is destroyed with AXIDMA_DESTROY_POOL. Thus, a
+ * process that restarts can attach to its pool by name, and map the same
+ * buffers again, without having to allocate any memory. The buffers are
+ * mapped with mmap at the offsets given by #AXIDMA_POOL_OFFSET, and they are
+ * not freed when they are unmapped.
+ *
+ * If the pool already exists, the number and size of the buffers must match.
+ *
+ * Inputs:
+ *  - name - The name of the pool, which must not be empty.
+ *  - num_buffers - The number of buffers in the pool.
+ *  - buffer_size - The size of each buffer in bytes.
+ *
+ * Outputs:
+ *  - pool_id - The id of the pool, used to compute the mmap offsets.
+ *  - attached - 1 if the pool already existed, and 0 if it was created.
+ **/
+#define AXIDMA_OPEN_POOL                _IOR(AXIDMA_IOCTL_MAGIC, 18, \
+                                             struct axidma_pool_config)
+
+/**
+ * Destroys a named buffer pool, freeing all of its buffers.
+ *
+ * This fails if any of the pool's buffers are still mapped by a process.
+ *
+ * Inputs:
+ *  - name - The name of the pool.
+ **/
+#define AXIDMA_DESTROY_POOL             _IOR(AXIDMA_IOCTL_MAGIC, 19, \
+                                             struct axidma_pool_config)
+
+/**
+ * Starts capturing frames on a VDMA receive channel into a ring of frame
+ * buffers shared by several consumers.
+ *
+ * The driver keeps the hardware capturing into the frame buffers that no
+ * consumer is using. A completed frame is kept until a newer frame needs its
+ * buffer, and never reused while a consumer holds a reference to it with
+ * AXIDMA_ACQUIRE_FRAME. Frames are never copied, so the frame buffers are
+ * usually the buffers of a named pool, which consumers in other processes map
+ * by name, and then refer to by their index in the ring.
+ *
+ * The capture runs until the channel is stopped with AXIDMA_STOP_DMA_CHANNEL.
+ *
+ * Inputs:
+ *  - channel_id - The id for the VDMA receive channel to capture on.
+ *  - num_frame_buffers - The number of frame buffers in the ring, at least 2.
+ *  - frame_buffers - An array of the frame buffer addresses.
+ *  - frame - The width, height, and depth of the frames.
+ **/
+#define AXIDMA_START_CAPTURE            _IOR(AXIDMA_IOCTL_MAGIC, 20, \
+                                             struct axidma_video_transaction)
+
+/**
+ * Acquires a reference to a captured frame, waiting for one if needed.
+ *
+ * The frame's buffer is not reused for a new frame until the reference is
+ * released with AXIDMA_RELEASE_FRAME. The reference belongs to the open file
+ * it was acquired on, and is released when that file is closed, so a consumer
+ * that exits can't hold the frame forever. A file holds each frame at most
+ * once, so the frames it already holds are skipped.
+ *
+ * Inputs:
+ *  - channel_id - The id for the capture channel.
+ *  - latest - Whether to acquire the newest frame, or the oldest one after
+ *             after_sequence.
+ *  - after_sequence - Only frames with a larger sequence are acquired.
+ *  - timeout - The time to wait for a frame in milliseconds, or <0 to wait
+ *              indefinitely.
+ *
+ * Outputs:
+ *  - index - The index of the frame's buffer in the ring.
+ *  - sequence - The number of the frame since the capture started.
+ *  - timestamp_ns - The monotonic time when the frame was captured.
+ *  - unread - The number of frames whose buffers were reused before any
+ *             consumer acquired them.
+ *  - stalls - The number of times the hardware had no free frame buffer to
+ *             capture into, because consumers held all of them.
+ **/
+#define AXIDMA_ACQUIRE_FRAME            _IOR(AXIDMA_IOCTL_MAGIC, 21, \
+                                             struct axidma_capture_frame)
+
+/**
+ * Releases a reference to a captured frame, from AXIDMA_ACQUIRE_FRAME.
+ *
+ * Inputs:
+ *  - channel_id - The id for the capture channel.
+ *  - index - The index of the frame's buffer in the ring.
+ **/
+#define AXIDMA_RELEASE_FRAME            _IOR(AXIDMA_IOCTL_MAGIC, 22, \
+                                             struct axidma_capture_frame)
+
+/**
+ * Copies data between two buffers in memory with an AXI CDMA channel.
+ *
+ * The copy is done by the hardware, so it does not use any CPU time, and does
+ * not pass through the CPU's caches. Both buffers must be within address ranges
+ * that were allocated by a call to mmap with the AXI DMA device, or that were
+ * registered as external DMA buffers. The copy is scheduled and completed like
+ * any other transfer on the channel, so a non-blocking copy can be waited on
+ * with AXIDMA_WAIT_ANY.
+ *
+ * Copies of more than one row need the DMA engine to support interleaved
+ * transfers, unless the rows are contiguous in both buffers.
+ *
+ * Inputs:
+ *  - wait - Indicates if the call should be blocking or non-blocking
+ *  - channel_id - The id for the CDMA channel to copy with.
+ *  - dst - The address of the buffer to copy into.
+ *  - src - The address of the buffer to copy from.
+ *  - len - The number of bytes in each row.
+ *  - num_rows - The number of rows to copy, at least 1.
+ *  - dst_stride - The number of bytes between rows in the destination.
+ *  - src_stride - The number of bytes between rows in the source.
+ *
+ * Outputs:
+ *  - cookie - The cookie identifying the copy, for AXIDMA_WAIT_ANY.
+ *  - timestamps - The kernel timestamps for the copy. The completion time is
+ *                 only known if the call was blocking.
+ **/
+#define AXIDMA_DMA_MEMCPY               _IOR(AXIDMA_IOCTL_MAGIC, 23, \
+                                             struct axidma_memcpy_transaction)
+
 #endif /* AXIDMA_IOCTL_H_ */
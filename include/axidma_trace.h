@@ -0,0 +1,99 @@
+/**
+ * @file axidma_trace.h
+ * @date Sunday, October 18, 2026 at 03:26:18 PM EDT
+ *
+ * This file defines the format of the workload traces recorded by the AXI DMA
+ * library, and replayed by axidma_replay.
+ *
+ * A trace is a header followed by a sequence of fixed-size records, one for
+ * each operation performed through the library, in the order they were issued.
+ * All fields are in the native byte order of the machine that recorded them.
+ **/
+
+#ifndef AXIDMA_TRACE_H_
+#define AXIDMA_TRACE_H_
+
+#include <stdint.h>             // Fixed-width integer types
+
+/*----------------------------------------------------------------------------
+ * Trace Format Definitions
+ *----------------------------------------------------------------------------*/
+
+// The magic number at the start of a trace file ("AXTR")
+#define AXIDMA_TRACE_MAGIC              0x52545841
+
+// The version of the trace format, bumped on incompatible changes
+#define AXIDMA_TRACE_VERSION            1
+
+// The environment variable that enables tracing when the library is initialized
+#define AXIDMA_TRACE_ENV                "AXIDMA_TRACE"
+
+// The buffer id for a buffer that was not allocated through the library
+#define AXIDMA_TRACE_UNKNOWN_BUFFER     0
+
+// The timeout recorded for a wait with a negative timeout, which never expires
+#define AXIDMA_TRACE_NO_TIMEOUT         UINT32_MAX
+
+/**
+ * The header at the start of a trace file.
+ *
+ * The record size allows a reader to skip over fields added to the end of
+ * each record by a later version.
+ **/
+struct axidma_trace_header {
+    uint32_t magic;                 ///< AXIDMA_TRACE_MAGIC
+    uint16_t version;               ///< AXIDMA_TRACE_VERSION
+    uint16_t record_size;           ///< The size of each record in bytes
+    uint64_t start_ns;              ///< Monotonic time the trace started
+};
+
+/**
+ * Enumeration for the operations recorded in the trace.
+ **/
+enum axidma_trace_op {
+    AXIDMA_TRACE_ALLOC,             ///< A buffer was allocated
+    AXIDMA_TRACE_FREE,              ///< A buffer was freed
+    AXIDMA_TRACE_ONEWAY,            ///< A one-way transfer was performed
+    AXIDMA_TRACE_ONEWAY_ASYNC,      ///< A one-way transfer was submitted
+    AXIDMA_TRACE_TWOWAY,            ///< A two-way transfer was performed
+    AXIDMA_TRACE_VIDEO,             ///< A video transfer was started
+    AXIDMA_TRACE_STOP,              ///< The transfers on a channel were stopped
+    AXIDMA_TRACE_WAIT_ANY,          ///< The caller waited on async transfers
+};
+
+// Flag for the record indicating the caller blocked until the transfer finished
+#define AXIDMA_TRACE_WAIT               (1 << 0)
+
+/**
+ * A single operation in the trace.
+ *
+ * The meaning of the fields depends on the operation:
+ *  - ALLOC/FREE - buffer_id and len describe the buffer.
+ *  - ONEWAY/ONEWAY_ASYNC - channel, buffer_id and len describe the transfer.
+ *  - TWOWAY - channel, buffer_id and len describe the transmit side, and the
+ *    rx_ fields describe the receive side.
+ *  - VIDEO - buffer_id is the first frame buffer, len is the width, rx_len is
+ *    the height, rx_buffer_id is the depth, and rx_channel is the number of
+ *    frame buffers.
+ *  - STOP - only the channel is used.
+ *  - WAIT_ANY - channel is the first entry's channel, len is the number of
+ *    entries, and rx_len is the timeout in milliseconds, or
+ *    #AXIDMA_TRACE_NO_TIMEOUT if the wait had no timeout.
+ *
+ * A buffer id is assigned by the library to each buffer from #axidma_malloc,
+ * starting from 1, and is never reused within a trace.
+ **/
+struct axidma_trace_record {
+    uint64_t timestamp_ns;          ///< Time since the start of the trace
+    uint32_t len;                   ///< Length of the buffer or transfer
+    uint32_t rx_len;                ///< Length of the receive transfer
+    uint32_t buffer_id;             ///< Buffer used for the operation
+    uint32_t rx_buffer_id;          ///< Buffer used for the receive transfer
+    int16_t channel;                ///< Channel for the operation, or -1
+    int16_t rx_channel;             ///< Channel for the receive transfer
+    uint8_t op;                     ///< The operation, an axidma_trace_op
+    uint8_t flags;                  ///< AXIDMA_TRACE_* flags
+    uint16_t reserved;              ///< Reserved, always 0
+};
+
+#endif /* AXIDMA_TRACE_H_ */
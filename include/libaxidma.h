@@ -11,6 +11,8 @@
 #ifndef LIBAXIDMA_H_
 #define LIBAXIDMA_H_
 
+#include <stdint.h>         // Fixed-width integer types
+
 #include "axidma_ioctl.h"   // Video frame structure
 
 /**
@@ -39,6 +41,145 @@ typedef struct array {
     int *data;      ///< Pointer to the memory buffer for the array
 } array_t;
 
+/**
+ * A structure holding the counters kept by the library for a channel.
+ *
+ * These are counted in userspace, so they include the time spent in the
+ * library's calls into the driver. They are retrieved with #axidma_get_stats.
+ **/
+struct axidma_user_stats {
+    uint64_t transfers;     ///< Number of transfers submitted on the channel
+    uint64_t completions;   ///< Number of completions seen by the library
+    uint64_t bytes;         ///< Number of bytes submitted on the channel
+    uint64_t blocked_ns;    ///< Time spent blocked in the driver's ioctls
+};
+
+/**
+ * A structure that breaks down the latency of a transfer into its components.
+ *
+ * This is computed from the kernel timestamps for a transfer by
+ * #axidma_split_latency.
+ **/
+struct axidma_latency {
+    uint64_t queueing_ns;   ///< Time queued in the driver before being started
+    uint64_t hardware_ns;   ///< Time spent in the DMA hardware
+    uint64_t wakeup_ns;     ///< Time from completion until the caller woke up
+};
+
+/**
+ * A structure holding the settings for streaming data over a channel pair.
+ *
+ * A stream is split into chunks, which are each a separate DMA transfer, and
+ * several chunks are kept in-flight at once. Receive chunks can also be kept
+ * posted ahead of the transmit chunks, as credits, so that an accelerator that
+ * produces its output in bursts always has somewhere to write it, instead of
+ * back-pressuring the transmit channel. The completion settings are
+ * applied to the channels with #axidma_set_adaptive when the settings are
+ * loaded from a profile. These are found for a given board by the
+ * axidma_tune example program.
+ **/
+struct axidma_stream_config {
+    size_t chunk_size;          ///< Size of each transfer in the stream
+    int depth;                  ///< Number of transfers in-flight per channel
+    int rx_credits;             ///< Receive chunks posted ahead of transmit
+    uint32_t poll_enter_rate;   ///< Rate to start polling at, 0 disables
+    uint32_t poll_exit_rate;    ///< Rate to go back to interrupts below
+    uint32_t poll_interval_us;  ///< Time between polls, 0 for the default
+};
+
+/**
+ * A structure for checking the integrity of the data in a stream.
+ *
+ * The CRC32C of each chunk is computed as it is sent, and again once it is
+ * received. When the stream goes both ways, the two are compared, so a chunk
+ * that comes back different than it was sent is reported. The checksums can
+ * be computed on a helper thread, so they overlap with the transfers instead
+ * of delaying them.
+ **/
+struct axidma_stream_check {
+    bool use_thread;            ///< Compute the checksums on a helper thread
+    uint32_t *tx_crcs;          ///< CRC32C of each chunk sent, or NULL
+    uint32_t *rx_crcs;          ///< CRC32C of each chunk received, or NULL
+    int num_chunks;             ///< Set to the number of chunks checked
+    int num_mismatches;         ///< Set to the number of chunks that differed
+    int first_mismatch;         ///< Set to the first chunk that differed, or -1
+};
+
+/**
+ * A structure holding the receive credit level achieved by a duplex stream.
+ *
+ * The credit level is the number of receive chunks posted to the channel that
+ * have not been filled yet. It is sampled each time chunks complete, while
+ * there are still receive chunks left to post. If it drops to zero, the
+ * fabric had nowhere to write its output until the next chunk was posted.
+ **/
+struct axidma_stream_stats {
+    int num_samples;            ///< The number of times the level was sampled
+    int min_rx_credits;         ///< The lowest credit level
+    double mean_rx_credits;     ///< The average credit level
+    int rx_starved;             ///< The times the credit level dropped to zero
+};
+
+/**
+ * Type definition for a receive demultiplexer.
+ *
+ * This is a pointer to an opaque struct, created by #axidma_demux_create.
+ **/
+typedef struct axidma_demux* axidma_demux_t;
+
+/**
+ * A structure describing a packet routed to a flow by a demultiplexer.
+ *
+ * The packet is not copied, it points into the receive buffer it arrived in.
+ * The buffer is only posted to the channel again once every packet in it has
+ * been given back with #axidma_demux_release.
+ **/
+struct axidma_packet {
+    void *data;                 ///< The start of the packet in the buffer
+    size_t len;                 ///< The length of the packet in bytes
+    struct axidma_metadata metadata;    ///< The buffer's sideband words
+    int buffer;                 ///< The buffer holding the packet (internal)
+};
+
+/**
+ * A structure holding the counters for a flow of a demultiplexer.
+ *
+ * For the demultiplexer as a whole, these count the receive buffers that
+ * completed, and the buffers that were not routed to any flow.
+ **/
+struct axidma_demux_stats {
+    uint64_t packets;           ///< Packets routed to the flow
+    uint64_t bytes;             ///< Bytes in the routed packets
+    uint64_t drops;             ///< Packets dropped as the flow's ring was full
+};
+
+/**
+ * Type definition for a demultiplexer's classification function.
+ *
+ * The function is called once for each completed receive buffer, with the
+ * number of bytes received in it and the metadata received with it. The
+ * length is the whole buffer if the driver could not get it from the engine,
+ * see #axidma_wait_any. It finds the packets in the buffer, and routes
+ * each one to its flow with #axidma_demux_route. It runs on the
+ * demultiplexer's thread, so it should be short.
+ **/
+typedef void (*axidma_classify_t)(axidma_demux_t demux, void *buf, size_t len,
+        const struct axidma_metadata *metadata, void *data);
+
+/**
+ * A structure holding the settings for a receive demultiplexer.
+ **/
+struct axidma_demux_config {
+    int channel;                ///< The DMA receive channel to read from
+    void **buffers;             ///< The receive buffers, from #axidma_malloc
+    int num_buffers;            ///< The number of buffers, at most 64
+    size_t buffer_size;         ///< The size of each receive buffer
+    int num_flows;              ///< The number of flows to route packets to
+    int ring_size;              ///< Packets per flow's ring, a power of two
+    axidma_classify_t classify; ///< Routes the packets, NULL routes by APP0
+    void *data;                 ///< The data to pass to the classify function
+};
+
 /**
  * Type definition for a AXI DMA callback function.
  *
@@ -110,6 +251,19 @@ const array_t *axidma_get_vdma_tx(axidma_dev_t dev);
  **/
 const array_t *axidma_get_vdma_rx(axidma_dev_t dev);
 
+/**
+ * Gets the available AXI CDMA memory copy channels, returning their channel
+ * ID's.
+ *
+ * These channels copy data between two buffers in memory, rather than moving
+ * it to or from the FPGA, and are used with #axidma_memcpy. This function is
+ * guaranteed to never fail.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @return An array of channel ID's of the available AXI CDMA channels.
+ **/
+const array_t *axidma_get_cdma(axidma_dev_t dev);
+
 /**
  * Allocates DMA buffer suitable for an AXI DMA/VDMA device of \p size bytes.
  *
@@ -138,6 +292,56 @@ void *axidma_malloc(axidma_dev_t dev, size_t size);
  **/
 void axidma_free(axidma_dev_t dev, void *addr, size_t size);
 
+/**
+ * Creates a named pool of DMA buffers owned by the driver, or attaches to the
+ * pool if it already exists, and maps all of its buffers.
+ *
+ * Unlike the buffers from #axidma_malloc, the pool's buffers are not freed when
+ * the process unmaps them or exits. The driver keeps them until the pool is
+ * destroyed with #axidma_pool_destroy. A process that restarts can then attach
+ * to its pool by name, and get the same buffers back without allocating any
+ * memory, which is fast and cannot fail because of fragmentation.
+ *
+ * If the pool already exists, \p num_buffers and \p buffer_size must match
+ * the values it was created with.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] name The name of the pool, at most 31 characters.
+ * @param[in] num_buffers The number of buffers in the pool.
+ * @param[in] buffer_size The size of each buffer in bytes.
+ * @param[out] buffers An array of \p num_buffers entries, which is filled in
+ *                     with the addresses of the buffers.
+ * @return 1 if an existing pool was attached to, 0 if the pool was created,
+ *         or a negative number on failure.
+ **/
+int axidma_pool_open(axidma_dev_t dev, const char *name, int num_buffers,
+        size_t buffer_size, void **buffers);
+
+/**
+ * Unmaps the buffers of a named pool, mapped by #axidma_pool_open.
+ *
+ * The pool, and the data in its buffers, is kept by the driver. This function
+ * will abort if the buffers were not mapped by #axidma_pool_open.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] buffers The addresses of the buffers.
+ * @param[in] num_buffers The number of buffers in the pool.
+ * @param[in] buffer_size The size of each buffer in bytes.
+ **/
+void axidma_pool_close(axidma_dev_t dev, void **buffers, int num_buffers,
+        size_t buffer_size);
+
+/**
+ * Destroys a named pool of DMA buffers, freeing its memory in the driver.
+ *
+ * This fails if any process still has one of the pool's buffers mapped.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] name The name of the pool.
+ * @return 0 upon success, a negative number on failure.
+ **/
+int axidma_pool_destroy(axidma_dev_t dev, const char *name);
+
 /**
  * Registers a DMA buffer that was allocated externally, by another driver.
  *
@@ -213,6 +417,56 @@ void axidma_set_callback(axidma_dev_t dev, int channel, axidma_cb_t callback,
 int axidma_oneway_transfer(axidma_dev_t dev, int channel, void *buf, size_t len,
         bool wait);
 
+/**
+ * Submits a single asynchronous DMA transfer on the DMA channel.
+ *
+ * This function is identical to #axidma_oneway_transfer with \p wait set to
+ * false, except that it returns the cookie identifying the transfer. The
+ * cookie, together with the channel, can be passed to #axidma_wait_any to
+ * wait for the transfer to complete without handling signals.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel DMA channel the transfer is performed on.
+ * @param[in] buf Address of the DMA buffer to transfer, previously allocated by
+ *                #axidma_malloc or registered with #axidma_register_buffer.
+ * @param[in] len Number of bytes that will be transfered.
+ * @return A positive cookie for the transfer upon success, a negative number
+ *         on failure.
+ **/
+int axidma_oneway_transfer_async(axidma_dev_t dev, int channel, void *buf,
+        size_t len);
+
+/**
+ * Performs a single DMA transfer that carries the packet's sideband metadata.
+ *
+ * When the AXI DMA is built with the status and control streams, each packet
+ * carries up to #AXIDMA_METADATA_WORDS APP words, which the hardware can use
+ * for timestamps or flow ids without them being part of the payload. For a
+ * transmit channel, the words in \p metadata are sent with the packet. For a
+ * receive channel, \p metadata is filled in with the words received when
+ * \p wait is true. Otherwise, they are reported in the entry for the transfer
+ * by #axidma_wait_any. Metadata is received even while the channel is polling,
+ * as receive transfers that can carry it are always completed from the
+ * engine's interrupt.
+ *
+ * This requires a 5.6 or later kernel, and a DMA engine that supports the
+ * metadata interface, which otherwise fails the transfer if any metadata is
+ * sent, and reports a length of 0 for the received metadata.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel DMA channel the transfer is performed on.
+ * @param[in] buf Address of the DMA buffer to transfer, previously allocated by
+ *                #axidma_malloc or registered with #axidma_register_buffer.
+ * @param[in] len Number of bytes that will be transfered.
+ * @param[in,out] metadata The sideband words to send, or the ones received.
+ * @param[in] wait Indicates if the transfer should be synchronous or
+ *                 asynchronous. If true, this function will block.
+ * @return A positive cookie for the transfer upon success, a negative number
+ *         on failure.
+ **/
+int axidma_oneway_transfer_meta(axidma_dev_t dev, int channel, void *buf,
+        size_t len, struct axidma_metadata *metadata, bool wait);
+
 /**
  * Performs a two coupled DMA transfers, one in the receive direction, the other
  * in the transmit direction.
@@ -248,6 +502,55 @@ int axidma_twoway_transfer(axidma_dev_t dev, int tx_channel, void *tx_buf,
         void *rx_buf, size_t rx_len, struct axidma_video_frame *rx_frame,
         bool wait);
 
+/**
+ * Copies data between two DMA buffers with an AXI CDMA channel.
+ *
+ * The copy is offloaded to the CDMA engine, leaving the processor free. Both
+ * buffers must have been allocated by #axidma_malloc or registered with
+ * #axidma_register_buffer. If \p wait is false, the copy is submitted and the
+ * returned cookie can be passed to #axidma_wait_any, or the channel's callback
+ * is invoked when it completes. This function will abort if the channel is not
+ * a CDMA channel.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel CDMA channel the copy is performed on.
+ * @param[in] dst Address of the DMA buffer to copy to.
+ * @param[in] src Address of the DMA buffer to copy from.
+ * @param[in] len Number of bytes that will be copied.
+ * @param[in] wait Indicates if the copy should be synchronous or
+ *                 asynchronous. If true, this function will block.
+ * @return A positive cookie for the copy upon success, a negative number on
+ *         failure.
+ **/
+int axidma_memcpy(axidma_dev_t dev, int channel, void *dst, const void *src,
+        size_t len, bool wait);
+
+/**
+ * Copies a rectangle of rows between two DMA buffers with an AXI CDMA channel.
+ *
+ * This is the same as #axidma_memcpy, except that \p height rows of \p width
+ * bytes are copied, such as a region of a frame buffer. Rows that are not
+ * contiguous in both buffers need a DMA engine that supports interleaved
+ * transfers, otherwise the copy fails. The copy is limited to
+ * #AXIDMA_MAX_COPY_ROWS rows, and strides of #AXIDMA_MAX_COPY_STRIDE bytes.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel CDMA channel the copy is performed on.
+ * @param[in] dst Address of the first row in the DMA buffer to copy to.
+ * @param[in] dst_stride Number of bytes between rows in \p dst.
+ * @param[in] src Address of the first row in the DMA buffer to copy from.
+ * @param[in] src_stride Number of bytes between rows in \p src.
+ * @param[in] width Number of bytes copied from each row.
+ * @param[in] height Number of rows that will be copied.
+ * @param[in] wait Indicates if the copy should be synchronous or
+ *                 asynchronous. If true, this function will block.
+ * @return A positive cookie for the copy upon success, a negative number on
+ *         failure.
+ **/
+int axidma_memcpy_2d(axidma_dev_t dev, int channel, void *dst,
+        size_t dst_stride, const void *src, size_t src_stride, size_t width,
+        int height, bool wait);
+
 /**
  * Starts a video DMA (VDMA) loop/continuous transfer on the given channel.
  *
@@ -277,6 +580,69 @@ int axidma_twoway_transfer(axidma_dev_t dev, int tx_channel, void *tx_buf,
 int axidma_video_transfer(axidma_dev_t dev, int display_channel, size_t width,
         size_t height, size_t depth, void **frame_buffers, int num_buffers);
 
+/**
+ * Starts capturing frames on a VDMA receive channel into a ring of frame
+ * buffers, which several consumers can read from at once.
+ *
+ * Unlike #axidma_video_transfer, the hardware never overwrites a frame that a
+ * consumer holds with #axidma_capture_acquire. Instead, it captures into the
+ * buffers nobody is using, and if there are none, it waits until a frame is
+ * released. To share the frames with other processes, allocate the frame
+ * buffers from a named pool with #axidma_pool_open, and have the consumers
+ * open the same pool, using the frame index to find the buffer.
+ *
+ * This function is non-blocking. The capture is stopped with
+ * #axidma_stop_transfer.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel VDMA receive channel to capture on.
+ * @param[in] width The number of pixels in a row of the frame buffer.
+ * @param[in] height The number rows in the frame buffer.
+ * @param[in] depth The number of bytes in a pixel.
+ * @param[in] frame_buffers A list of frame buffer addresses.
+ * @param[in] num_buffers The number of buffers in \p frame_buffers, at least
+ *                        2, and at most #AXIDMA_MAX_FRAME_BUFFERS.
+ * @return 0 upon success, a negative number on failure.
+ **/
+int axidma_capture_start(axidma_dev_t dev, int channel, size_t width,
+        size_t height, size_t depth, void **frame_buffers, int num_buffers);
+
+/**
+ * Acquires a reference to a frame captured by #axidma_capture_start.
+ *
+ * A preview usually asks for the \p latest frame, skipping any it missed. A
+ * recorder passes the sequence of the last frame it saw in
+ * \p after_sequence to get every frame in order, and can check the unread
+ * count in \p frame to see whether it fell behind. The frame must be released
+ * with #axidma_capture_release once the consumer is done with it.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel The channel the capture is running on.
+ * @param[in] latest Whether to acquire the newest frame, rather than the
+ *                   oldest.
+ * @param[in] after_sequence Only frames with a larger sequence are acquired,
+ *                           0 for any frame.
+ * @param[in] timeout The time to wait for a frame in milliseconds, or a
+ *                    negative number to wait indefinitely.
+ * @param[out] frame The sequence, timestamp and ring statistics of the frame.
+ * @return The index of the frame's buffer upon success, -EAGAIN on a timeout,
+ *         -EPIPE if the capture is not running, or another negative number on
+ *         failure.
+ **/
+int axidma_capture_acquire(axidma_dev_t dev, int channel, bool latest,
+        uint64_t after_sequence, int timeout,
+        struct axidma_capture_frame *frame);
+
+/**
+ * Releases a reference to a frame acquired by #axidma_capture_acquire.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel The channel the capture is running on.
+ * @param[in] index The index of the frame's buffer.
+ * @return 0 upon success, a negative number on failure.
+ **/
+int axidma_capture_release(axidma_dev_t dev, int channel, int index);
+
 /**
  * Stops the DMA transfer on specified DMA channel.
  *
@@ -290,4 +656,535 @@ int axidma_video_transfer(axidma_dev_t dev, int display_channel, size_t width,
  **/
 void axidma_stop_transfer(axidma_dev_t dev, int channel);
 
+/**
+ * Waits until any one of the given asynchronous transfers completes.
+ *
+ * This function allows a single thread to service many channels, sleeping
+ * until the first of several transfers finishes. Each entry is a channel id
+ * and cookie pair, as returned by #axidma_oneway_transfer_async. Upon return,
+ * the status field of every entry is updated, so all of the transfers that
+ * have finished are reported. A finished receive transfer's entry also holds
+ * the sideband metadata received with it, as with
+ * #axidma_oneway_transfer_meta, and the number of bytes received. The engine
+ * only reports that length when the transfer completes from its interrupt, so
+ * a transfer completed while the channel is polling reports its full length,
+ * unless it can carry metadata, as those always complete from the interrupt.
+ *
+ * This function will abort if \p num_entries is not between 1 and
+ * #AXIDMA_MAX_WAIT_ENTRIES.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in,out] entries An array of the transfers to wait on.
+ * @param[in] num_entries The number of transfers in \p entries.
+ * @param[in] timeout The maximum time to wait in milliseconds. A timeout of 0
+ *                    polls the transfers, and a negative one waits forever.
+ * @return The number of finished transfers, 0 if the timeout expired, or a
+ *         negative number on failure.
+ **/
+int axidma_wait_any(axidma_dev_t dev, struct axidma_wait_entry *entries,
+        int num_entries, int timeout);
+
+/**
+ * Gets the kernel timestamps for the last completed transfer on a channel.
+ *
+ * The timestamps are recorded for blocking transfers, and for asynchronous
+ * transfers that are reported as complete by #axidma_wait_any. Along with
+ * them, the library records when the caller woke up for the transfer, which is
+ * when the blocking call or the wait returned.
+ *
+ * This function will abort if the channel is invalid.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel DMA channel to get the timestamps for.
+ * @param[out] timestamps The kernel timestamps for the transfer.
+ * @param[out] wakeup_ns The time the caller woke up for the transfer, in
+ *                       nanoseconds of the monotonic clock. May be NULL.
+ **/
+void axidma_get_timestamps(axidma_dev_t dev, int channel,
+        struct axidma_timestamps *timestamps, uint64_t *wakeup_ns);
+
+/**
+ * Gets the counters kept by the library for a channel.
+ *
+ * The time blocked includes the submission ioctls, the whole of blocking
+ * transfers, and the calls to #axidma_wait_any, which are charged to the
+ * channel of their first entry.
+ *
+ * This function will abort if the channel is invalid.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel DMA channel to get the counters for.
+ * @param[out] stats The library's counters for the channel.
+ **/
+void axidma_get_stats(axidma_dev_t dev, int channel,
+        struct axidma_user_stats *stats);
+
+/**
+ * Gets a snapshot of the counters for a channel from the status page.
+ *
+ * The driver's status page is mapped read-only by #axidma_init, so this only
+ * performs memory loads, with no system call. It is suitable for polling the
+ * progress of asynchronous transfers in a tight loop, by watching the number of
+ * completed transfers or the last completed cookie.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel DMA channel to get the counters for.
+ * @param[out] status The counters for the channel.
+ * @return 0 upon success, a negative number if the status page is not
+ *         available, or the channel is not in it.
+ **/
+int axidma_get_status(axidma_dev_t dev, int channel,
+        struct axidma_chan_status *status);
+
+/**
+ * Configures the adaptive interrupt and polling completion mode for a channel.
+ *
+ * When the completion rate of the channel reaches the enter rate, the driver
+ * stops requesting an interrupt for each transfer, and instead polls for
+ * completions in a kernel thread. Once the rate falls below the exit rate, it
+ * goes back to using interrupts.
+ *
+ * The Xilinx DMA driver ignores the request, and still takes an interrupt and
+ * runs its tasklet for every transfer. Polling therefore only moves the
+ * completion handling from the callback to the polling thread, batching the
+ * wakeups of the waiters over the poll interval. It does not reduce the
+ * interrupt load, and the thread adds its own CPU time on top of it.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel DMA channel to configure.
+ * @param[in] enter_rate Transfers per second at which polling starts. A value
+ *                       of 0 disables polling.
+ * @param[in] exit_rate Transfers per second below which polling stops. This
+ *                      must not be larger than the enter rate.
+ * @param[in] interval_us Time between polls in microseconds, or 0 for the
+ *                        driver's default.
+ * @return 0 upon success, a negative number on failure.
+ **/
+int axidma_set_adaptive(axidma_dev_t dev, int channel, uint32_t enter_rate,
+        uint32_t exit_rate, uint32_t interval_us);
+
+/**
+ * Gets the completion handling statistics for a channel.
+ *
+ * This reports which mode the channel is in, the adaptive settings, the time
+ * spent in each mode, and the number of transfers completed in each mode.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel DMA channel to get the statistics for.
+ * @param[out] stats The statistics for the channel.
+ * @return 0 upon success, a negative number on failure.
+ **/
+int axidma_get_chan_stats(axidma_dev_t dev, int channel,
+        struct axidma_chan_stats *stats);
+
+/**
+ * Gets the usage of the DMA buffers across the whole device.
+ *
+ * This reports the number and total size of the buffers allocated with
+ * #axidma_malloc, and of the external buffers registered with
+ * #axidma_register_buffer.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[out] stats The buffer usage of the device.
+ * @return 0 upon success, a negative number on failure.
+ **/
+int axidma_get_device_stats(axidma_dev_t dev, struct axidma_device_stats *stats);
+
+/**
+ * Splits the latency of a transfer into its queueing, hardware and wake-up
+ * components.
+ *
+ * A component is reported as 0 if one of the timestamps it depends on is not
+ * known. This function can never fail.
+ *
+ * @param[in] timestamps The kernel timestamps for the transfer.
+ * @param[in] wakeup_ns The time the caller woke up for the transfer, as
+ *                      returned by #axidma_time_ns.
+ * @param[out] latency The breakdown of the transfer's latency.
+ **/
+void axidma_split_latency(const struct axidma_timestamps *timestamps,
+        uint64_t wakeup_ns, struct axidma_latency *latency);
+
+/**
+ * Gets the current time of the monotonic clock in nanoseconds.
+ *
+ * This is the same clock used by the driver for the transfer timestamps, so
+ * the two can be directly compared.
+ *
+ * @return The current time in nanoseconds.
+ **/
+uint64_t axidma_time_ns();
+
+/**
+ * Sets the CPU affinity and priority of the driver's completion thread for a
+ * channel.
+ *
+ * The completion thread retires transfers when the channel is polling for
+ * completions (see #axidma_set_adaptive), so this controls where that work
+ * runs. This does not affect the DMA interrupt itself, whose affinity is set
+ * through /proc/irq.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel DMA channel to configure.
+ * @param[in] cpu The CPU to pin the thread to, or -1 for any CPU.
+ * @param[in] priority The SCHED_FIFO priority from 1 to 99, or 0 to use the
+ *                     normal scheduling policy.
+ * @return 0 upon success, a negative number on failure.
+ **/
+int axidma_set_completion_config(axidma_dev_t dev, int channel, int cpu,
+        int priority);
+
+/**
+ * Sets how the transfers submitted by different processes on a channel are
+ * scheduled into the DMA hardware.
+ *
+ * The driver queues the transfers of each process separately, and only issues
+ * them to the hardware while the channel is below its in-flight limits. Small
+ * limits keep a latency sensitive process from waiting behind a large backlog
+ * of bulk transfers from another process, at some cost in throughput.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel DMA channel to configure.
+ * @param[in] policy How the next transfer to issue is picked.
+ * @param[in] max_transfers The number of transfers issued to the hardware at
+ *                          once, or 0 for no limit.
+ * @param[in] max_bytes The number of bytes issued to the hardware at once, or
+ *                      0 for no limit. A single transfer is always issued,
+ *                      even if it is larger.
+ * @return 0 upon success, a negative number on failure.
+ **/
+int axidma_set_sched(axidma_dev_t dev, int channel,
+        enum axidma_sched_policy policy, int max_transfers, uint64_t max_bytes);
+
+/**
+ * Sets the weight and priority of a process's transfers on a channel.
+ *
+ * The weight is the process's share of the channel's bytes under
+ * #AXIDMA_SCHED_FAIR, and the priority orders the processes under
+ * #AXIDMA_SCHED_PRIORITY. Processes that are not configured have a weight of 1
+ * and a priority of 0.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel DMA channel to configure.
+ * @param[in] pid The process to configure, or 0 for the calling process.
+ * @param[in] weight The share of the channel, or 0 to reset the process to the
+ *                   defaults.
+ * @param[in] priority The priority, where higher priorities are issued first.
+ * @return 0 upon success, a negative number on failure.
+ **/
+int axidma_set_submitter(axidma_dev_t dev, int channel, int pid,
+        uint32_t weight, int priority);
+
+/**
+ * Pins the calling thread to a single CPU.
+ *
+ * This is intended for threads running a control loop on an isolated core.
+ *
+ * @param[in] cpu The CPU to run the calling thread on.
+ * @return 0 upon success, a negative number on failure.
+ **/
+int axidma_pin_thread(int cpu);
+
+/**
+ * Sets the real-time scheduling priority of the calling thread.
+ *
+ * This requires the CAP_SYS_NICE capability for a non-zero priority.
+ *
+ * @param[in] priority The SCHED_FIFO priority from 1 to 99, or 0 to use the
+ *                     normal scheduling policy.
+ * @return 0 upon success, a negative number on failure.
+ **/
+int axidma_set_realtime(int priority);
+
+/**
+ * Locks all of the process' current and future memory into RAM.
+ *
+ * This prevents page faults on the real-time path, and should be called once
+ * all of the buffers have been allocated.
+ *
+ * @return 0 upon success, a negative number on failure.
+ **/
+int axidma_lock_memory();
+
+/**
+ * Starts recording a trace of the operations performed through the library.
+ *
+ * Every allocation, transfer, stop and wait is appended to the trace as a
+ * compact binary record, with its time, channel, size, whether it blocked, and
+ * the id of its buffer. The format is defined in axidma_trace.h, and the trace
+ * can be replayed with the axidma_replay example program. Any trace already
+ * being recorded is stopped first.
+ *
+ * Tracing is also started by #axidma_init if the AXIDMA_TRACE environment
+ * variable is set to the path of the trace file.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] path The path of the file to record the trace to.
+ * @return 0 upon success, a negative number on failure.
+ **/
+int axidma_trace_start(axidma_dev_t dev, const char *path);
+
+/**
+ * Stops recording the trace, and flushes it out to the file.
+ *
+ * This is called by #axidma_destroy, and does nothing if no trace is being
+ * recorded.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ **/
+void axidma_trace_stop(axidma_dev_t dev);
+
+/**
+ * Loads the stream settings for channel pairs from a profile file.
+ *
+ * The profile is written by #axidma_save_profile, usually through the
+ * axidma_tune example program. The completion settings in the profile are
+ * applied to each of its channels, and the chunk size and depth are used by
+ * #axidma_stream_transfer for the channel pair.
+ *
+ * A profile is also loaded by #axidma_init if the AXIDMA_PROFILE environment
+ * variable is set to its path.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] path The path of the profile file.
+ * @return 0 upon success, a negative number on failure.
+ **/
+int axidma_load_profile(axidma_dev_t dev, const char *path);
+
+/**
+ * Saves the stream settings for all of the channel pairs to a profile file.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] path The path of the profile file.
+ * @return 0 upon success, a negative number on failure.
+ **/
+int axidma_save_profile(axidma_dev_t dev, const char *path);
+
+/**
+ * Sets the stream settings for a channel pair, replacing any from a profile.
+ *
+ * This also applies the completion settings to the channels.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] tx_channel DMA channel the stream is sent on, or -1 for none.
+ * @param[in] rx_channel DMA channel the stream is received on, or -1 for none.
+ * @param[in] config The settings for the stream.
+ * @return 0 upon success, a negative number on failure.
+ **/
+int axidma_stream_set_config(axidma_dev_t dev, int tx_channel, int rx_channel,
+        const struct axidma_stream_config *config);
+
+/**
+ * Gets the stream settings for a channel pair.
+ *
+ * If no settings were loaded or set for the pair, the library's defaults are
+ * returned. This function can never fail.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] tx_channel DMA channel the stream is sent on, or -1 for none.
+ * @param[in] rx_channel DMA channel the stream is received on, or -1 for none.
+ * @param[out] config The settings for the stream.
+ **/
+void axidma_stream_get_config(axidma_dev_t dev, int tx_channel, int rx_channel,
+        struct axidma_stream_config *config);
+
+/**
+ * Streams a buffer over a channel pair, splitting it into chunks.
+ *
+ * The buffer is sent in chunks of the configured size, keeping the configured
+ * number of chunks in-flight on each channel, and received back in chunks of
+ * the same size. Either channel may be -1 to stream in only one direction.
+ * This call blocks until the whole buffer has been transferred.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] tx_channel DMA channel to send the buffer on, or -1 for none.
+ * @param[in] tx_buf Buffer to send, previously allocated by #axidma_malloc.
+ * @param[in] rx_channel DMA channel to receive the buffer on, or -1 for none.
+ * @param[in] rx_buf Buffer to receive into, previously allocated by
+ *                   #axidma_malloc.
+ * @param[in] len The number of bytes to stream in each direction.
+ * @param[in] config The settings for the stream, or NULL to use the ones from
+ *                   the profile for the channel pair.
+ * @return 0 upon success, a negative number on failure.
+ **/
+int axidma_stream_transfer(axidma_dev_t dev, int tx_channel, void *tx_buf,
+        int rx_channel, void *rx_buf, size_t len,
+        const struct axidma_stream_config *config);
+
+/**
+ * Streams a buffer over a channel pair, checking the integrity of each chunk.
+ *
+ * This streams the buffer like #axidma_stream_transfer, but computes the
+ * CRC32C of each chunk before it is sent, and after it is received. When the
+ * check's arrays are given, they must have room for a checksum for each chunk
+ * of the stream, and are filled in with them, so the stream can also be
+ * checked against checksums carried by the data itself.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] tx_channel DMA channel to send the buffer on, or -1 for none.
+ * @param[in] tx_buf Buffer to send, previously allocated by #axidma_malloc.
+ * @param[in] rx_channel DMA channel to receive the buffer on, or -1 for none.
+ * @param[in] rx_buf Buffer to receive into, previously allocated by
+ *                   #axidma_malloc.
+ * @param[in] len The number of bytes to stream in each direction.
+ * @param[in] config The settings for the stream, or NULL to use the ones from
+ *                   the profile for the channel pair.
+ * @param[in,out] check How to check the stream, and where the result of the
+ *                      check is placed, or NULL to not check it.
+ * @return 0 upon success, -EBADMSG if any chunk was received differently than
+ *         it was sent, and another negative number on failure.
+ **/
+int axidma_stream_transfer_checked(axidma_dev_t dev, int tx_channel,
+        void *tx_buf, int rx_channel, void *rx_buf, size_t len,
+        const struct axidma_stream_config *config,
+        struct axidma_stream_check *check);
+
+/**
+ * Streams a buffer out and back through an accelerator, reporting the receive
+ * credit level that was kept.
+ *
+ * This streams the buffer like #axidma_stream_transfer, which always keeps the
+ * receive chunk for each transmit chunk posted before it is sent, and the
+ * configured number of receive credits posted ahead of that. A transmit chunk
+ * is only sent once there are enough receive chunks posted ahead of it. The
+ * credit level that was achieved can be used to pick the number of credits,
+ * the goal being that it never drops to zero.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] tx_channel DMA channel to send the buffer on.
+ * @param[in] tx_buf Buffer to send, previously allocated by #axidma_malloc.
+ * @param[in] rx_channel DMA channel to receive the buffer on.
+ * @param[in] rx_buf Buffer to receive into, previously allocated by
+ *                   #axidma_malloc.
+ * @param[in] len The number of bytes to stream in each direction.
+ * @param[in] config The settings for the stream, or NULL to use the ones from
+ *                   the profile for the channel pair.
+ * @param[out] stats The receive credit level that was achieved.
+ * @return 0 upon success, a negative number on failure.
+ **/
+int axidma_stream_duplex(axidma_dev_t dev, int tx_channel, void *tx_buf,
+        int rx_channel, void *rx_buf, size_t len,
+        const struct axidma_stream_config *config,
+        struct axidma_stream_stats *stats);
+
+/**
+ * Computes the CRC32C (Castagnoli) checksum of a buffer.
+ *
+ * This uses the CRC instructions of ARMv8 or SSE4.2 when the processor has
+ * them, and a table otherwise. The checksum of a buffer split into pieces can
+ * be computed by passing the checksum of the pieces before it as the initial
+ * value.
+ *
+ * @param[in] crc The checksum of the preceding data, or 0 to start.
+ * @param[in] buf The buffer to checksum.
+ * @param[in] len The number of bytes in the buffer.
+ * @return The checksum of the preceding data and the buffer.
+ **/
+uint32_t axidma_crc32c(uint32_t crc, const void *buf, size_t len);
+
+/**
+ * Gets the name of the implementation used by #axidma_crc32c.
+ *
+ * @return "ARMv8", "SSE4.2", or "table".
+ **/
+const char *axidma_crc32c_name(void);
+
+/**
+ * Creates a demultiplexer that routes the packets from a receive channel to
+ * separate flows, and starts its thread.
+ *
+ * A single receive channel often carries the packets of many logical flows.
+ * The demultiplexer keeps all of the receive buffers posted to the channel,
+ * and has a single thread that classifies each completed buffer once. The
+ * packets are routed to a lock-free ring per flow, without being copied, so
+ * that each flow can be consumed by its own thread with
+ * #axidma_demux_receive. Each buffer is counted by the number of packets in
+ * it that are still held, and is posted to the channel again once they have
+ * all been released.
+ *
+ * Without a classify function, each buffer is a single packet, which is
+ * routed to the flow given by the APP0 word of its metadata. Buffers whose
+ * flow is out of range are dropped.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] config The settings for the demultiplexer.
+ * @return The demultiplexer upon success, NULL on failure.
+ **/
+axidma_demux_t axidma_demux_create(axidma_dev_t dev,
+        const struct axidma_demux_config *config);
+
+/**
+ * Stops a demultiplexer, then frees it.
+ *
+ * The flows' consumers must have finished with the demultiplexer first, which
+ * they can be told to do with #axidma_demux_stop.
+ *
+ * @param[in] demux A demultiplexer returned by #axidma_demux_create.
+ **/
+void axidma_demux_destroy(axidma_demux_t demux);
+
+/**
+ * Stops a demultiplexer's thread and the transfers on its channel.
+ *
+ * Any consumers waiting in #axidma_demux_receive are woken up, and it fails
+ * once their flow's ring is empty.
+ *
+ * @param[in] demux A demultiplexer returned by #axidma_demux_create.
+ **/
+void axidma_demux_stop(axidma_demux_t demux);
+
+/**
+ * Routes a packet in the buffer being classified to a flow.
+ *
+ * This may only be called from the demultiplexer's classify function. If the
+ * flow's ring is full, the packet is dropped and counted.
+ *
+ * @param[in] demux The demultiplexer passed to the classify function.
+ * @param[in] flow The flow to route the packet to.
+ * @param[in] data The start of the packet, inside the buffer.
+ * @param[in] len The length of the packet in bytes.
+ * @return 0 upon success, a negative number if the packet was dropped.
+ **/
+int axidma_demux_route(axidma_demux_t demux, int flow, void *data, size_t len);
+
+/**
+ * Takes the next packet routed to a flow, waiting for one if needed.
+ *
+ * Each flow must have a single consumer thread. The packet must be given back
+ * with #axidma_demux_release once the consumer is done with it.
+ *
+ * @param[in] demux A demultiplexer returned by #axidma_demux_create.
+ * @param[in] flow The flow to take the packet from.
+ * @param[out] packet The packet that was taken.
+ * @param[in] timeout The maximum time to wait in milliseconds. A timeout of 0
+ *                    polls the flow, and a negative one waits forever.
+ * @return 1 if a packet was taken, 0 if the timeout expired, or a negative
+ *         number if the demultiplexer was stopped.
+ **/
+int axidma_demux_receive(axidma_demux_t demux, int flow,
+        struct axidma_packet *packet, int timeout);
+
+/**
+ * Gives back a packet taken with #axidma_demux_receive.
+ *
+ * This can be called from any thread. Once all of the packets in a buffer are
+ * released, the buffer is posted to the channel again.
+ *
+ * @param[in] demux A demultiplexer returned by #axidma_demux_create.
+ * @param[in] packet The packet to release.
+ **/
+void axidma_demux_release(axidma_demux_t demux,
+        const struct axidma_packet *packet);
+
+/**
+ * Gets the counters for a flow of a demultiplexer, or for the whole of it.
+ *
+ * @param[in] demux A demultiplexer returned by #axidma_demux_create.
+ * @param[in] flow The flow to get the counters for, or -1 for the counters of
+ *                 the demultiplexer as a whole.
+ * @param[out] stats The counters for the flow.
+ **/
+void axidma_demux_get_stats(axidma_demux_t demux, int flow,
+        struct axidma_demux_stats *stats);
+
 #endif /* LIBAXIDMA_H_ */
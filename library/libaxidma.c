@@ -10,6 +10,8 @@
  * @bug No known bugs.
  **/
 
+#define _GNU_SOURCE             // CPU affinity macros and functions
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
@@ -23,14 +25,166 @@
 #include <unistd.h>             // Close() system call
 #include <errno.h>              // Error codes
 #include <signal.h>             // Signal handling functions
+#include <time.h>               // Monotonic clock functions
+#include <sched.h>              // CPU affinity and scheduling functions
+#include <pthread.h>            // Thread creation functions
+#include <sys/syscall.h>        // Futex system call
+#include <linux/futex.h>        // Futex operations
 
 #include "libaxidma.h"          // Local definitions
 #include "axidma_ioctl.h"       // The IOCTL interface to AXI DMA
+#include "axidma_trace.h"       // The workload trace format
+
+/* The CRC32C instructions are compiled in for the architecture, and enabled per
+ * function, so they are only used when the processor has them. */
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <nmmintrin.h>          // SSE4.2 CRC32 intrinsics
+#define CRC32C_SSE42
+#elif defined(__GNUC__) && defined(__aarch64__)
+#include <arm_acle.h>           // ARMv8 CRC32 intrinsics
+#include <sys/auxv.h>           // Processor capabilities
+#include <asm/hwcap.h>          // Processor capability bits
+#define CRC32C_ARMV8
+#endif
+
+/* USDT probes are compiled in when the SystemTap headers are available, and
+ * are a single no-op instruction each until a tracer attaches to them. */
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>            // USDT probe definitions
+#define AXIDMA_HAVE_SDT
+#endif
+#endif
 
 /*----------------------------------------------------------------------------
  * Internal definitions
  *----------------------------------------------------------------------------*/
 
+/* Fires the libaxidma USDT probe with the given name, passing it the channel,
+ * the length of the transfer or allocation, and the buffer. */
+#ifdef AXIDMA_HAVE_SDT
+#define AXIDMA_PROBE(name, channel, len, buf) \
+    DTRACE_PROBE3(libaxidma, name, channel, len, buf)
+#else
+#define AXIDMA_PROBE(name, channel, len, buf) \
+    do { (void)(channel); (void)(len); (void)(buf); } while (0)
+#endif
+
+/* The number of in-flight transfers tracked per channel to find their buffers
+ * when they complete. This matches the driver's limit on in-flight transfers,
+ * and the driver's cookies are sequential, so they never collide. */
+#define INFLIGHT_SLOTS          64
+
+/* The number of buffers from axidma_malloc that are tracked to give them ids
+ * in the trace. Buffers past this are traced as unknown. This is a fixed size,
+ * so transfers on other threads can look up buffers while one is allocated. */
+#define TRACE_MAX_BUFFERS       256
+
+// The size of the stdio buffer for the trace file, to batch the writes
+#define TRACE_BUFFER_SIZE       (64 * 1024)
+
+// The environment variable that names the profile to load at initialization
+#define PROFILE_ENV             "AXIDMA_PROFILE"
+
+// The most channel pairs that can have stream settings
+#define MAX_STREAM_PROFILES     32
+
+// The default stream settings, when there are none for the channel pair
+#define DEFAULT_STREAM_CHUNK    (256 * 1024)
+#define DEFAULT_STREAM_DEPTH    4
+
+// The stream settings for a channel pair
+struct stream_profile {
+    int tx_channel;             ///< The transmit channel, or -1 for none
+    int rx_channel;             ///< The receive channel, or -1 for none
+    struct axidma_stream_config config;     ///< The settings for the pair
+};
+
+// The CRC32C (Castagnoli) polynomial, in bit-reversed order
+#define CRC32C_POLY             0x82f63b78
+
+/* The state of the integrity check of a stream. The stream publishes the
+ * number of chunks ready to be checksummed in each direction, and the helper
+ * thread, if any, sleeps on the generation until more are published. */
+struct stream_checker {
+    const char *tx_buf;         ///< The buffer being sent, or NULL
+    const char *rx_buf;         ///< The buffer being received, or NULL
+    size_t len;                 ///< The length of the stream
+    size_t chunk_size;          ///< The size of each chunk
+    uint32_t *tx_crcs;          ///< The checksum of each chunk sent
+    uint32_t *rx_crcs;          ///< The checksum of each chunk received
+    int tx_ready;               ///< Chunks that can be checksummed, if sent
+    int rx_ready;               ///< Chunks that can be checksummed, if received
+    int tx_checked;             ///< Chunks sent that have been checksummed
+    int rx_checked;             ///< Chunks received that have been checksummed
+    bool use_thread;            ///< Checksums are computed by the helper thread
+    pthread_t thread;           ///< The helper thread
+    uint32_t generation;        ///< Bumped whenever more chunks are published
+    uint32_t waiting;           ///< The helper thread is sleeping
+    uint32_t stopped;           ///< The stream published its last chunks
+};
+
+/* The time the demultiplexer waits for receive buffers to complete before
+ * checking if it was stopped, in milliseconds. */
+#define DEMUX_WAIT_TIMEOUT      100
+
+// A receive buffer owned by a demultiplexer
+struct demux_buffer {
+    void *buf;                  ///< The address of the buffer
+    bool posted;                ///< The buffer is posted to the channel
+    int cookie;                 ///< The transfer's cookie, while posted
+    uint64_t sequence;          ///< The order the buffer was posted in
+    uint32_t refcount;          ///< Routed packets not yet released
+    size_t len;                 ///< The bytes received in the buffer
+    struct axidma_metadata metadata;    ///< Received with the buffer
+};
+
+/* A flow's ring of packets. The demultiplexer's thread is the only producer,
+ * and the flow's consumer the only consumer, so the indices need no lock. The
+ * tail doubles as the futex the consumer sleeps on. */
+struct demux_flow {
+    struct axidma_packet *ring;     ///< The packets routed to the flow
+    uint32_t head;              ///< The next packet to take, by the consumer
+    uint32_t tail;              ///< The next slot to fill, by the producer
+    uint32_t waiting;           ///< The consumer is sleeping on the tail
+    struct axidma_demux_stats stats;    ///< Counters for the flow
+};
+
+// The state of a receive demultiplexer
+struct axidma_demux {
+    axidma_dev_t dev;           ///< The device the channel belongs to
+    struct axidma_demux_config config;  ///< The demultiplexer's settings
+    struct demux_buffer *buffers;   ///< The receive buffers
+    struct demux_flow *flows;   ///< The flows packets are routed to
+    struct axidma_wait_entry *entries;  ///< For waiting on posted buffers
+    int *order;                 ///< The buffer for each entry, in posted order
+    int current;                ///< The buffer being classified
+    int routed;                 ///< Packets routed from the current buffer
+    uint64_t next_sequence;     ///< The order of the next buffer posted
+    uint32_t released;          ///< Futex bumped when a buffer is freed
+    uint32_t idle;              ///< The thread is sleeping on released
+    bool stopped;               ///< The thread was told to stop
+    bool running;               ///< The thread has not been joined
+    pthread_t thread;           ///< The thread classifying the buffers
+    struct axidma_demux_stats stats;    ///< Counters for all the buffers
+};
+
+// A buffer allocated by axidma_malloc, and its id in the trace
+struct traced_buffer {
+    void *addr;                 ///< Address of the buffer, NULL if unused
+    size_t size;                ///< Size of the buffer
+    uint32_t id;                ///< Id of the buffer in the trace
+};
+
+/* The buffer and length of an in-flight transfer. The tag is the low bits of
+ * the transfer's cookie plus one, negated if the transfer completed before it
+ * was recorded, and 0 once its completion is reported. */
+struct inflight_transfer {
+    void *buf;                  ///< The buffer used for the transfer
+    size_t len;                 ///< The length of the transfer
+    int tag;                    ///< The transfer's tag, accessed atomically
+};
+
 // A structure that holds metadata about each channel
 typedef struct dma_channel {
     enum axidma_dir dir;        ///< Direction of the channel
@@ -38,6 +192,10 @@ typedef struct dma_channel {
     int channel_id;             ///< Integer id of the channel.
     axidma_cb_t callback;       ///< Callback function for channel completion
     void *user_data;            ///< User data to pass to the callback
+    struct axidma_timestamps timestamps;    ///< Last completed transfer's times
+    uint64_t wakeup_ns;         ///< When the caller woke up for the transfer
+    struct axidma_user_stats stats;     ///< Userspace counters for the channel
+    struct inflight_transfer inflight[INFLIGHT_SLOTS];  ///< By cookie
 } dma_channel_t;
 
 // The structure that represents the AXI DMA device
@@ -48,8 +206,16 @@ struct axidma_dev {
     array_t dma_rx_chans;       ///< Channel id's for the DMA receive channels
     array_t vdma_tx_chans;      ///< Channel id's for the VDMA transmit channels
     array_t vdma_rx_chans;      ///< Channel id's for the VDMA receive channels
+    array_t cdma_chans;         ///< Channel id's for the CDMA copy channels
     int num_channels;           ///< The total number of DMA channels
     dma_channel_t *channels;    ///< All of the VDMA/DMA channels in the system
+    const struct axidma_status_page *status_page;   ///< Mapped channel counters
+    FILE *trace;                ///< The file the trace is recorded to, or NULL
+    uint64_t trace_start_ns;    ///< When the trace was started
+    uint32_t next_buffer_id;    ///< The id for the next allocated buffer
+    struct traced_buffer buffers[TRACE_MAX_BUFFERS];    ///< Allocated buffers
+    int num_profiles;           ///< The number of channel pairs with settings
+    struct stream_profile profiles[MAX_STREAM_PROFILES];    ///< Stream settings
 };
 
 // The DMA device structure, and a boolean checking if it's already open
@@ -108,6 +274,18 @@ static int categorize_channels(axidma_dev_t dev,
         return -ENOMEM;
     }
 
+    // Allocate an array for the CDMA channel ids
+    dev->cdma_chans.data = malloc(num_chan->num_cdma_channels *
+            sizeof(dev->cdma_chans.data[0]));
+    if (dev->cdma_chans.data == NULL) {
+        free(dev->channels);
+        free(dev->dma_tx_chans.data);
+        free(dev->dma_rx_chans.data);
+        free(dev->vdma_tx_chans.data);
+        free(dev->vdma_rx_chans.data);
+        return -ENOMEM;
+    }
+
     // Place the DMA channel ID's into the appropiate array
     dev->num_channels = num_chan->num_channels;
     for (i = 0; i < num_chan->num_channels; i++)
@@ -123,6 +301,8 @@ static int categorize_channels(axidma_dev_t dev,
             array = &dev->vdma_tx_chans;
         } else if (chan->dir == AXIDMA_READ && chan->type == AXIDMA_VDMA) {
             array = &dev->vdma_rx_chans;
+        } else if (chan->type == AXIDMA_CDMA) {
+            array = &dev->cdma_chans;
         }
         assert(array != NULL);
 
@@ -137,6 +317,10 @@ static int categorize_channels(axidma_dev_t dev,
         dma_chan->channel_id = chan->channel_id;
         dma_chan->callback = NULL;
         dma_chan->user_data = NULL;
+        memset(&dma_chan->timestamps, 0, sizeof(dma_chan->timestamps));
+        dma_chan->wakeup_ns = 0;
+        memset(&dma_chan->stats, 0, sizeof(dma_chan->stats));
+        memset(dma_chan->inflight, 0, sizeof(dma_chan->inflight));
     }
 
     // Assign the length of the arrays
@@ -185,20 +369,81 @@ static int probe_channels(axidma_dev_t dev)
     return rc;
 }
 
+// Accounts for a completed transfer on the channel, and fires its probe
+static void count_completion(dma_channel_t *chan, void *buf, size_t len)
+{
+    AXIDMA_PROBE(complete, chan->channel_id, len, buf);
+    __atomic_fetch_add(&chan->stats.completions, 1, __ATOMIC_RELAXED);
+    return;
+}
+
+/* Gets the tag of an in-flight transfer, from the low bits of its cookie that
+ * the completion signal carries. */
+static int inflight_tag(int cookie)
+{
+    return AXIDMA_SIGNAL_COOKIE(AXIDMA_SIGNAL_VALUE(0, cookie)) + 1;
+}
+
+/* Reports the completion of an in-flight transfer, given its cookie, or just
+ * the low bits the signal carries. It is only reported the first time. If the
+ * transfer has not been recorded yet, which happens when the signal arrives as
+ * the submission returns, it is marked for record_inflight to report. */
+static void complete_inflight(dma_channel_t *chan, int cookie)
+{
+    int tag, expected;
+    struct inflight_transfer *transfer;
+
+    tag = inflight_tag(cookie);
+    transfer = &chan->inflight[cookie % INFLIGHT_SLOTS];
+    expected = __atomic_load_n(&transfer->tag, __ATOMIC_ACQUIRE);
+    while (expected != tag)
+    {
+        if (__atomic_compare_exchange_n(&transfer->tag, &expected, -tag, false,
+                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return;
+        }
+    }
+
+    if (__atomic_compare_exchange_n(&transfer->tag, &expected, 0, false,
+                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        count_completion(chan, transfer->buf, transfer->len);
+    }
+    return;
+}
+
+/* Records the buffer of an asynchronous transfer, so it can be reported when
+ * the transfer completes, reporting it now if it already has. */
+static void record_inflight(dma_channel_t *chan, int cookie, void *buf,
+        size_t len)
+{
+    int tag;
+    struct inflight_transfer *transfer;
+
+    tag = inflight_tag(cookie);
+    transfer = &chan->inflight[cookie % INFLIGHT_SLOTS];
+    transfer->buf = buf;
+    transfer->len = len;
+    if (__atomic_exchange_n(&transfer->tag, tag, __ATOMIC_ACQ_REL) == -tag) {
+        complete_inflight(chan, cookie);
+    }
+    return;
+}
+
 static void axidma_callback(int signal, siginfo_t *siginfo, void *context)
 {
     int channel_id;
     dma_channel_t *chan;
 
-    assert(0 <= siginfo->si_int && siginfo->si_int < axidma_dev.num_channels);
+    channel_id = AXIDMA_SIGNAL_CHANNEL(siginfo->si_int);
+    assert(channel_id < axidma_dev.num_channels);
 
     // Silence the compiler
     (void)signal;
     (void)context;
 
-    // If the user defined a callback for a given channel, invoke it
-    channel_id = siginfo->si_int;
+    // Report the transfer the signal is for, and invoke the user's callback
     chan = &axidma_dev.channels[channel_id];
+    complete_inflight(chan, AXIDMA_SIGNAL_COOKIE(siginfo->si_int));
     if (chan->callback != NULL) {
         chan->callback(channel_id, chan->user_data);
     }
@@ -224,8 +469,10 @@ static int setup_dma_callback(axidma_dev_t dev)
         return rc;
     }
 
-    // Tell the driver to deliver us SIGRTMIN upon DMA completion
-    rc = ioctl(dev->fd, AXIDMA_SET_DMA_SIGNAL, SIGRTMIN);
+    /* Tell the driver to deliver us SIGRTMIN upon DMA completion, with the
+     * cookie of the transfer that completed. */
+    rc = ioctl(dev->fd, AXIDMA_SET_DMA_SIGNAL,
+               SIGRTMIN | AXIDMA_SIGNAL_WITH_COOKIE);
     if (rc < 0) {
         perror("Failed to set the DMA callback signal");
         return rc;
@@ -266,6 +513,398 @@ static unsigned long dir_to_ioctl(enum axidma_dir dir)
     return 0;
 }
 
+/* Records the kernel timestamps for the last completed transfer on the
+ * channel, along with the time that the caller woke up for it. */
+static void record_timestamps(dma_channel_t *chan,
+        const struct axidma_timestamps *timestamps, uint64_t wakeup_ns)
+{
+    chan->timestamps = *timestamps;
+    chan->wakeup_ns = wakeup_ns;
+    return;
+}
+
+/* Accounts for a transfer submitted on the channel, and the time spent blocked
+ * in the driver submitting it. The counters are updated atomically, as they
+ * may be read by another thread. */
+static void count_transfer(dma_channel_t *chan, size_t len, uint64_t start_ns,
+        uint64_t end_ns)
+{
+    __atomic_fetch_add(&chan->stats.transfers, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&chan->stats.bytes, len, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&chan->stats.blocked_ns, end_ns - start_ns,
+                       __ATOMIC_RELAXED);
+    return;
+}
+
+// Finds the trace id of the allocated buffer containing the address
+static uint32_t trace_buffer_id(axidma_dev_t dev, const void *addr)
+{
+    int i;
+    const char *start;
+
+    for (i = 0; i < TRACE_MAX_BUFFERS; i++)
+    {
+        start = dev->buffers[i].addr;
+        if (start != NULL && start <= (const char *)addr &&
+                (const char *)addr < start + dev->buffers[i].size) {
+            return dev->buffers[i].id;
+        }
+    }
+
+    return AXIDMA_TRACE_UNKNOWN_BUFFER;
+}
+
+/* Appends the record to the trace, timestamped relative to the start of the
+ * trace. Tracing is stopped if the trace cannot be written. */
+static void trace_write(axidma_dev_t dev, struct axidma_trace_record *record,
+        uint64_t time_ns)
+{
+    record->timestamp_ns = time_ns - dev->trace_start_ns;
+    if (fwrite(record, sizeof(*record), 1, dev->trace) != 1) {
+        perror("Failed to write the AXI DMA trace, stopping the trace");
+        axidma_trace_stop(dev);
+    }
+    return;
+}
+
+// Records an allocation or free of the buffer in the trace
+static void trace_buffer(axidma_dev_t dev, enum axidma_trace_op op,
+        const struct traced_buffer *buffer, uint64_t time_ns)
+{
+    struct axidma_trace_record record;
+
+    memset(&record, 0, sizeof(record));
+    record.op = op;
+    record.channel = -1;
+    record.rx_channel = -1;
+    record.buffer_id = buffer->id;
+    record.len = buffer->size;
+    trace_write(dev, &record, time_ns);
+    return;
+}
+
+/* Records a transfer in the trace. For one-way transfers, the receive channel
+ * is -1, and the receive buffer is unused. */
+static void trace_transfer(axidma_dev_t dev, enum axidma_trace_op op,
+        bool wait, uint64_t time_ns, int channel, void *buf, size_t len,
+        int rx_channel, void *rx_buf, size_t rx_len)
+{
+    struct axidma_trace_record record;
+
+    memset(&record, 0, sizeof(record));
+    record.op = op;
+    record.flags = wait ? AXIDMA_TRACE_WAIT : 0;
+    record.channel = channel;
+    record.buffer_id = trace_buffer_id(dev, buf);
+    record.len = len;
+    record.rx_channel = rx_channel;
+    if (rx_channel >= 0) {
+        record.rx_buffer_id = trace_buffer_id(dev, rx_buf);
+        record.rx_len = rx_len;
+    }
+    trace_write(dev, &record, time_ns);
+    return;
+}
+
+// Finds the stream settings for the channel pair, or NULL if there are none
+static struct stream_profile *find_profile(axidma_dev_t dev, int tx_channel,
+        int rx_channel)
+{
+    int i;
+
+    for (i = 0; i < dev->num_profiles; i++)
+    {
+        if (dev->profiles[i].tx_channel == tx_channel &&
+                dev->profiles[i].rx_channel == rx_channel) {
+            return &dev->profiles[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Applies the completion settings for a stream to one of its channels
+static int apply_stream_config(axidma_dev_t dev, int channel,
+        const struct axidma_stream_config *config)
+{
+    if (channel < 0) {
+        return 0;
+    }
+    return axidma_set_adaptive(dev, channel, config->poll_enter_rate,
+                               config->poll_exit_rate,
+                               config->poll_interval_us);
+}
+
+/* Waits for any of the chunks of a stream to finish, removing them from the
+ * in-flight entries. Returns the number of chunks finished on each channel. */
+static int reap_chunks(axidma_dev_t dev, struct axidma_wait_entry *entries,
+        int *num_entries, int *tx_done, int *rx_done)
+{
+    int i, j, rc;
+
+    for (i = 0; i < *num_entries; i++)
+    {
+        entries[i].status = AXIDMA_WAIT_PENDING;
+    }
+    rc = axidma_wait_any(dev, entries, *num_entries, -1);
+    if (rc < 0) {
+        return rc;
+    }
+
+    // Keep the chunks still in-flight, and count the ones that finished
+    for (i = 0, j = 0; i < *num_entries; i++)
+    {
+        if (entries[i].status == AXIDMA_WAIT_PENDING) {
+            entries[j++] = entries[i];
+        } else if (entries[i].status == AXIDMA_WAIT_ERROR) {
+            rc = -EIO;
+        } else if (find_channel(dev, entries[i].channel_id)->dir ==
+                   AXIDMA_WRITE) {
+            *tx_done += 1;
+        } else {
+            *rx_done += 1;
+        }
+    }
+    *num_entries = j;
+
+    return (rc < 0) ? rc : 0;
+}
+
+/* Sleeps until the futex no longer holds the given value, or the timeout in
+ * milliseconds expires, with a negative timeout waiting forever. */
+static void futex_wait(uint32_t *futex, uint32_t value, int timeout)
+{
+    struct timespec timeout_ts;
+
+    timeout_ts.tv_sec = timeout / 1000;
+    timeout_ts.tv_nsec = (long)(timeout % 1000) * 1000000;
+    syscall(SYS_futex, futex, FUTEX_WAIT_PRIVATE, value,
+            (timeout < 0) ? NULL : &timeout_ts, NULL, 0);
+    return;
+}
+
+// Wakes up all of the threads sleeping on the futex
+static void futex_wake(uint32_t *futex)
+{
+    syscall(SYS_futex, futex, FUTEX_WAKE_PRIVATE, INT32_MAX, NULL, NULL, 0);
+    return;
+}
+
+/*----------------------------------------------------------------------------
+ * Integrity Checking
+ *----------------------------------------------------------------------------*/
+
+// The table for computing the CRC32C a byte at a time, and the implementation
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+static uint32_t crc32c_table[256];
+static uint32_t (*crc32c_update)(uint32_t crc, const uint8_t *buf, size_t len);
+static const char *crc32c_impl;
+
+// Updates the CRC32C with the buffer, a byte at a time using the table
+static uint32_t crc32c_update_table(uint32_t crc, const uint8_t *buf,
+        size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        crc = crc32c_table[(crc ^ buf[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(CRC32C_SSE42)
+
+/* Updates the CRC32C with the buffer, using the SSE4.2 instructions. The bytes
+ * before the first aligned word and after the last are done one at a time. */
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_update_hw(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    uint64_t crc64, word;
+
+    for (; len > 0 && ((uintptr_t)buf & 7) != 0; buf++, len--)
+    {
+        crc = _mm_crc32_u8(crc, *buf);
+    }
+    for (crc64 = crc; len >= 8; buf += 8, len -= 8)
+    {
+        memcpy(&word, buf, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    for (crc = crc64; len > 0; buf++, len--)
+    {
+        crc = _mm_crc32_u8(crc, *buf);
+    }
+    return crc;
+}
+
+static bool crc32c_hw_supported(void)
+{
+    return __builtin_cpu_supports("sse4.2");
+}
+
+#define CRC32C_HW_NAME          "SSE4.2"
+
+#elif defined(CRC32C_ARMV8)
+
+/* Updates the CRC32C with the buffer, using the ARMv8 CRC instructions. The
+ * bytes before the first aligned word and after the last are done one at a
+ * time. */
+__attribute__((target("+crc")))
+static uint32_t crc32c_update_hw(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    uint64_t word;
+
+    for (; len > 0 && ((uintptr_t)buf & 7) != 0; buf++, len--)
+    {
+        crc = __crc32cb(crc, *buf);
+    }
+    for (; len >= 8; buf += 8, len -= 8)
+    {
+        memcpy(&word, buf, sizeof(word));
+        crc = __crc32cd(crc, word);
+    }
+    for (; len > 0; buf++, len--)
+    {
+        crc = __crc32cb(crc, *buf);
+    }
+    return crc;
+}
+
+static bool crc32c_hw_supported(void)
+{
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+}
+
+#define CRC32C_HW_NAME          "ARMv8"
+
+#endif /* CRC32C_SSE42 */
+
+// Builds the CRC32C table, and picks the fastest implementation available
+static void crc32c_init(void)
+{
+    int i, bit;
+    uint32_t crc;
+
+    for (i = 0; i < 256; i++)
+    {
+        crc = i;
+        for (bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+        }
+        crc32c_table[i] = crc;
+    }
+
+    crc32c_update = crc32c_update_table;
+    crc32c_impl = "table";
+#if defined(CRC32C_SSE42) || defined(CRC32C_ARMV8)
+    if (crc32c_hw_supported()) {
+        crc32c_update = crc32c_update_hw;
+        crc32c_impl = CRC32C_HW_NAME;
+    }
+#endif
+    return;
+}
+
+// Computes the checksum of the chunk of the stream in the given buffer
+static uint32_t checksum_chunk(struct stream_checker *checker,
+        const char *buf, int chunk)
+{
+    size_t offset, chunk_len;
+
+    offset = (size_t)chunk * checker->chunk_size;
+    chunk_len = (checker->len - offset < checker->chunk_size) ?
+                checker->len - offset : checker->chunk_size;
+    return axidma_crc32c(0, buf + offset, chunk_len);
+}
+
+// Checksums the chunks that are ready in each direction
+static void checksum_chunks(struct stream_checker *checker, int tx_ready,
+        int rx_ready)
+{
+    for (; checker->tx_checked < tx_ready; checker->tx_checked++)
+    {
+        checker->tx_crcs[checker->tx_checked] = checksum_chunk(checker,
+                checker->tx_buf, checker->tx_checked);
+    }
+    for (; checker->rx_checked < rx_ready; checker->rx_checked++)
+    {
+        checker->rx_crcs[checker->rx_checked] = checksum_chunk(checker,
+                checker->rx_buf, checker->rx_checked);
+    }
+    return;
+}
+
+/* The helper thread, which checksums the chunks as the stream publishes them,
+ * until the stream has stopped and every published chunk is done. */
+static void *checker_thread(void *arg)
+{
+    int tx_ready, rx_ready;
+    uint32_t generation, stopped;
+    struct stream_checker *checker;
+
+    checker = arg;
+    while (true)
+    {
+        generation = __atomic_load_n(&checker->generation, __ATOMIC_SEQ_CST);
+        stopped = __atomic_load_n(&checker->stopped, __ATOMIC_SEQ_CST);
+        tx_ready = __atomic_load_n(&checker->tx_ready, __ATOMIC_ACQUIRE);
+        rx_ready = __atomic_load_n(&checker->rx_ready, __ATOMIC_ACQUIRE);
+        if (checker->tx_checked < tx_ready || checker->rx_checked < rx_ready) {
+            checksum_chunks(checker, tx_ready, rx_ready);
+            continue;
+        } else if (stopped) {
+            break;
+        }
+
+        /* Announce that the thread is sleeping before checking the generation
+         * again, so the stream either sees it, or the chunks are seen. */
+        __atomic_store_n(&checker->waiting, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&checker->generation, __ATOMIC_SEQ_CST) ==
+                generation) {
+            futex_wait(&checker->generation, generation, -1);
+        }
+        __atomic_store_n(&checker->waiting, 0, __ATOMIC_RELAXED);
+    }
+
+    return NULL;
+}
+
+/* Publishes the chunks of the stream that can be checksummed, which are the
+ * ones about to be sent, and the ones that have been received. Without a
+ * helper thread, they are checksummed right away. */
+static void checker_publish(struct stream_checker *checker, int tx_ready,
+        int rx_ready)
+{
+    __atomic_store_n(&checker->tx_ready, tx_ready, __ATOMIC_RELEASE);
+    __atomic_store_n(&checker->rx_ready, rx_ready, __ATOMIC_RELEASE);
+    if (!checker->use_thread) {
+        checksum_chunks(checker, tx_ready, rx_ready);
+        return;
+    }
+
+    __atomic_add_fetch(&checker->generation, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&checker->waiting, __ATOMIC_SEQ_CST)) {
+        futex_wake(&checker->generation);
+    }
+    return;
+}
+
+// Waits for the helper thread to checksum the last chunks published, if any
+static void checker_stop(struct stream_checker *checker)
+{
+    if (!checker->use_thread) {
+        return;
+    }
+
+    __atomic_store_n(&checker->stopped, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&checker->generation, 1, __ATOMIC_SEQ_CST);
+    futex_wake(&checker->generation);
+    pthread_join(checker->thread, NULL);
+    return;
+}
+
 /*----------------------------------------------------------------------------
  * Public Interface
  *----------------------------------------------------------------------------*/
@@ -299,6 +938,29 @@ struct axidma_dev *axidma_init()
         return NULL;
     }
 
+    /* Map the driver's status page, so progress can be checked without a system
+     * call. This is optional, so older drivers without it are still usable. */
+    axidma_dev.status_page = mmap(NULL, AXIDMA_STATUS_PAGE_SIZE, PROT_READ,
+            MAP_SHARED, axidma_dev.fd, AXIDMA_STATUS_PAGE_OFFSET);
+    if (axidma_dev.status_page == MAP_FAILED) {
+        axidma_dev.status_page = NULL;
+    }
+
+    /* Record a trace of the workload if requested by the environment, so that
+     * an unmodified program can be traced. A failure here is not fatal. */
+    axidma_dev.trace = NULL;
+    axidma_dev.next_buffer_id = AXIDMA_TRACE_UNKNOWN_BUFFER + 1;
+    memset(axidma_dev.buffers, 0, sizeof(axidma_dev.buffers));
+    if (getenv(AXIDMA_TRACE_ENV) != NULL) {
+        axidma_trace_start(&axidma_dev, getenv(AXIDMA_TRACE_ENV));
+    }
+
+    // Load the tuned stream settings, if there are any. This is not fatal.
+    axidma_dev.num_profiles = 0;
+    if (getenv(PROFILE_ENV) != NULL) {
+        axidma_load_profile(&axidma_dev, getenv(PROFILE_ENV));
+    }
+
     // Return the AXI DMA device to the user
     axidma_dev.initialized = true;
     return &axidma_dev;
@@ -307,13 +969,23 @@ struct axidma_dev *axidma_init()
 // Tears down the given AXI DMA device structure
 void axidma_destroy(axidma_dev_t dev)
 {
+    // Flush out the trace, if one is being recorded
+    axidma_trace_stop(dev);
+
     // Free the arrays used for channel id's and channel metadata
+    free(dev->cdma_chans.data);
     free(dev->vdma_rx_chans.data);
     free(dev->vdma_tx_chans.data);
     free(dev->dma_rx_chans.data);
     free(dev->dma_tx_chans.data);
     free(dev->channels);
 
+    // Unmap the status page, if the driver provided one
+    if (dev->status_page != NULL) {
+        munmap((void *)dev->status_page, AXIDMA_STATUS_PAGE_SIZE);
+        dev->status_page = NULL;
+    }
+
     // Close the AXI DMA device
     if (close(dev->fd) < 0) {
         perror("Failed to close the AXI DMA device");
@@ -349,11 +1021,18 @@ const array_t *axidma_get_vdma_rx(axidma_dev_t dev)
     return &dev->vdma_rx_chans;
 }
 
+// Returns an array of all the available AXI CDMA memory copy channels
+const array_t *axidma_get_cdma(axidma_dev_t dev)
+{
+    return &dev->cdma_chans;
+}
+
 /* Allocates a region of memory suitable for use with the AXI DMA driver. Note
  * that this is a quite expensive operation, and should be done at initalization
  * time. */
 void *axidma_malloc(axidma_dev_t dev, size_t size)
 {
+    int i;
     void *addr;
 
     // Call the device's mmap method to allocate the memory region
@@ -362,6 +1041,23 @@ void *axidma_malloc(axidma_dev_t dev, size_t size)
         return NULL;
     }
 
+    AXIDMA_PROBE(alloc, -1, size, addr);
+
+    // Give the buffer an id, so transfers using it can be identified in a trace
+    for (i = 0; i < TRACE_MAX_BUFFERS; i++)
+    {
+        if (dev->buffers[i].addr == NULL) {
+            dev->buffers[i].size = size;
+            dev->buffers[i].id = dev->next_buffer_id++;
+            dev->buffers[i].addr = addr;
+            if (dev->trace != NULL) {
+                trace_buffer(dev, AXIDMA_TRACE_ALLOC, &dev->buffers[i],
+                             axidma_time_ns());
+            }
+            break;
+        }
+    }
+
     return addr;
 }
 
@@ -370,9 +1066,22 @@ void *axidma_malloc(axidma_dev_t dev, size_t size)
  * call, or this function will throw an exception. */
 void axidma_free(axidma_dev_t dev, void *addr, size_t size)
 {
-    // Silence the compiler
-    (void)dev;
+    int i;
+
+    // Release the buffer's id
+    for (i = 0; i < TRACE_MAX_BUFFERS; i++)
+    {
+        if (dev->buffers[i].addr == addr) {
+            if (dev->trace != NULL) {
+                trace_buffer(dev, AXIDMA_TRACE_FREE, &dev->buffers[i],
+                             axidma_time_ns());
+            }
+            dev->buffers[i].addr = NULL;
+            break;
+        }
+    }
 
+    AXIDMA_PROBE(free, -1, size, addr);
     if (munmap(addr, size) < 0) {
         perror("Failed to free the AXI DMA memory mapped region");
         assert(false);
@@ -381,6 +1090,80 @@ void axidma_free(axidma_dev_t dev, void *addr, size_t size)
     return;
 }
 
+/* Creates the named buffer pool in the driver, or attaches to it if it already
+ * exists, and maps all of its buffers. Returns 1 if the pool was attached to,
+ * so the caller knows the buffers hold the data from before. */
+int axidma_pool_open(axidma_dev_t dev, const char *name, int num_buffers,
+        size_t buffer_size, void **buffers)
+{
+    int i, rc;
+    struct axidma_pool_config config;
+
+    memset(&config, 0, sizeof(config));
+    if (strlen(name) >= sizeof(config.name)) {
+        fprintf(stderr, "Error: Buffer pool name '%s' is too long.\n", name);
+        return -EINVAL;
+    }
+    strcpy(config.name, name);
+    config.num_buffers = num_buffers;
+    config.buffer_size = buffer_size;
+    if (ioctl(dev->fd, AXIDMA_OPEN_POOL, &config) < 0) {
+        perror("Failed to open the buffer pool");
+        return -errno;
+    }
+
+    // Map each of the pool's buffers at its own offset
+    for (i = 0; i < num_buffers; i++)
+    {
+        buffers[i] = mmap(NULL, buffer_size, PROT_READ|PROT_WRITE, MAP_SHARED,
+                          dev->fd, AXIDMA_POOL_OFFSET(config.pool_id, i));
+        if (buffers[i] == MAP_FAILED) {
+            rc = -errno;
+            perror("Failed to map the buffer pool's buffer");
+            axidma_pool_close(dev, buffers, i, buffer_size);
+            return rc;
+        }
+        AXIDMA_PROBE(alloc, -1, buffer_size, buffers[i]);
+    }
+
+    return config.attached;
+}
+
+/* Unmaps the buffers of a named buffer pool. The pool itself, and the data in
+ * its buffers, is kept by the driver. */
+void axidma_pool_close(axidma_dev_t dev, void **buffers, int num_buffers,
+        size_t buffer_size)
+{
+    int i;
+
+    (void)dev;
+    for (i = 0; i < num_buffers; i++)
+    {
+        AXIDMA_PROBE(free, -1, buffer_size, buffers[i]);
+        if (munmap(buffers[i], buffer_size) < 0) {
+            perror("Failed to unmap the buffer pool's buffer");
+            assert(false);
+        }
+    }
+
+    return;
+}
+
+// Destroys the named buffer pool, freeing its memory in the driver
+int axidma_pool_destroy(axidma_dev_t dev, const char *name)
+{
+    struct axidma_pool_config config;
+
+    memset(&config, 0, sizeof(config));
+    strncpy(config.name, name, sizeof(config.name) - 1);
+    if (ioctl(dev->fd, AXIDMA_DESTROY_POOL, &config) < 0) {
+        perror("Failed to destroy the buffer pool");
+        return -errno;
+    }
+
+    return 0;
+}
+
 /* Sets up a callback function to be called whenever the transaction completes
  * on the given channel for asynchronous transfers. */
 void axidma_set_callback(axidma_dev_t dev, int channel, axidma_cb_t callback,
@@ -443,6 +1226,7 @@ int axidma_oneway_transfer(axidma_dev_t dev, int channel, void *buf,
         size_t len, bool wait)
 {
     int rc;
+    uint64_t start_ns, end_ns;
     struct axidma_transaction trans;
     unsigned long axidma_cmd;
     dma_channel_t *dma_chan;
@@ -455,16 +1239,128 @@ int axidma_oneway_transfer(axidma_dev_t dev, int channel, void *buf,
     trans.channel_id = channel;
     trans.buf = buf;
     trans.buf_len = len;
+    memset(&trans.metadata, 0, sizeof(trans.metadata));
     axidma_cmd = dir_to_ioctl(dma_chan->dir);
 
     // Perform the given transfer
+    AXIDMA_PROBE(submit, channel, len, buf);
+    start_ns = axidma_time_ns();
     rc = ioctl(dev->fd, axidma_cmd, &trans);
+    end_ns = axidma_time_ns();
     if (rc < 0) {
         perror("Failed to perform the AXI DMA transfer");
         return rc;
     }
+    count_transfer(dma_chan, len, start_ns, end_ns);
+    if (dev->trace != NULL) {
+        trace_transfer(dev, AXIDMA_TRACE_ONEWAY, wait, start_ns, channel, buf,
+                       len, -1, NULL, 0);
+    }
 
-    return 0;
+    // For blocking transfers, the transfer has completed by now
+    if (wait) {
+        record_timestamps(dma_chan, &trans.timestamps, end_ns);
+        count_completion(dma_chan, buf, len);
+    }
+
+    return 0;
+}
+
+/* This submits a one-way transfer over AXI DMA without waiting for it to
+ * complete, returning the cookie that identifies it for axidma_wait_any. */
+int axidma_oneway_transfer_async(axidma_dev_t dev, int channel, void *buf,
+        size_t len)
+{
+    int rc;
+    uint64_t start_ns, end_ns;
+    struct axidma_transaction trans;
+    unsigned long axidma_cmd;
+    dma_channel_t *dma_chan;
+
+    assert(find_channel(dev, channel) != NULL);
+
+    // Setup the argument structure to the IOCTL
+    dma_chan = find_channel(dev, channel);
+    trans.wait = false;
+    trans.channel_id = channel;
+    trans.buf = buf;
+    trans.buf_len = len;
+    memset(&trans.metadata, 0, sizeof(trans.metadata));
+    axidma_cmd = dir_to_ioctl(dma_chan->dir);
+
+    // Submit the given transfer, the driver fills in the cookie
+    AXIDMA_PROBE(submit, channel, len, buf);
+    start_ns = axidma_time_ns();
+    rc = ioctl(dev->fd, axidma_cmd, &trans);
+    end_ns = axidma_time_ns();
+    if (rc < 0) {
+        perror("Failed to submit the AXI DMA transfer");
+        return rc;
+    }
+    count_transfer(dma_chan, len, start_ns, end_ns);
+    if (dev->trace != NULL) {
+        trace_transfer(dev, AXIDMA_TRACE_ONEWAY_ASYNC, false, start_ns, channel,
+                       buf, len, -1, NULL, 0);
+    }
+
+    // Remember the buffer, so it can be reported when the transfer completes
+    record_inflight(dma_chan, trans.cookie, buf, len);
+
+    return trans.cookie;
+}
+
+/* This performs a one-way transfer that carries the packet's sideband words,
+ * sending them with a transmit transfer, or returning the ones received with a
+ * blocking receive transfer. */
+int axidma_oneway_transfer_meta(axidma_dev_t dev, int channel, void *buf,
+        size_t len, struct axidma_metadata *metadata, bool wait)
+{
+    int rc;
+    uint64_t start_ns, end_ns;
+    struct axidma_transaction trans;
+    unsigned long axidma_cmd;
+    dma_channel_t *dma_chan;
+
+    assert(find_channel(dev, channel) != NULL);
+
+    // Setup the argument structure to the IOCTL
+    dma_chan = find_channel(dev, channel);
+    trans.wait = wait;
+    trans.channel_id = channel;
+    trans.buf = buf;
+    trans.buf_len = len;
+    trans.metadata = *metadata;
+    axidma_cmd = dir_to_ioctl(dma_chan->dir);
+
+    // Perform the given transfer, the driver fills in the cookie
+    AXIDMA_PROBE(submit, channel, len, buf);
+    start_ns = axidma_time_ns();
+    rc = ioctl(dev->fd, axidma_cmd, &trans);
+    end_ns = axidma_time_ns();
+    if (rc < 0) {
+        perror("Failed to perform the AXI DMA transfer");
+        return rc;
+    }
+    count_transfer(dma_chan, len, start_ns, end_ns);
+    if (dev->trace != NULL) {
+        trace_transfer(dev, wait ? AXIDMA_TRACE_ONEWAY :
+                       AXIDMA_TRACE_ONEWAY_ASYNC, wait, start_ns, channel, buf,
+                       len, -1, NULL, 0);
+    }
+
+    /* For blocking transfers, the transfer has completed by now, and the
+     * received metadata is known. Otherwise, it is reported by wait any. */
+    if (wait) {
+        record_timestamps(dma_chan, &trans.timestamps, end_ns);
+        count_completion(dma_chan, buf, len);
+        if (dma_chan->dir == AXIDMA_READ) {
+            *metadata = trans.metadata;
+        }
+    } else {
+        record_inflight(dma_chan, trans.cookie, buf, len);
+    }
+
+    return trans.cookie;
 }
 
 /* This performs a two-way transfer over AXI DMA, both sending data out and
@@ -475,6 +1371,8 @@ int axidma_twoway_transfer(axidma_dev_t dev, int tx_channel, void *tx_buf,
         bool wait)
 {
     int rc;
+    uint64_t start_ns, wakeup_ns;
+    dma_channel_t *tx_chan, *rx_chan;
     struct axidma_inout_transaction trans;
 
     assert(find_channel(dev, tx_channel) != NULL);
@@ -504,14 +1402,106 @@ int axidma_twoway_transfer(axidma_dev_t dev, int tx_channel, void *tx_buf,
     }
 
     // Perform the read-write transfer
+    AXIDMA_PROBE(submit, tx_channel, tx_len, tx_buf);
+    AXIDMA_PROBE(submit, rx_channel, rx_len, rx_buf);
+    start_ns = axidma_time_ns();
     rc = ioctl(dev->fd, AXIDMA_DMA_READWRITE, &trans);
+    wakeup_ns = axidma_time_ns();
     if (rc < 0) {
         perror("Failed to perform the AXI DMA read-write transfer");
+        return rc;
+    }
+    tx_chan = find_channel(dev, tx_channel);
+    rx_chan = find_channel(dev, rx_channel);
+    count_transfer(tx_chan, tx_len, start_ns, wakeup_ns);
+    count_transfer(rx_chan, rx_len, start_ns, wakeup_ns);
+    if (dev->trace != NULL) {
+        trace_transfer(dev, AXIDMA_TRACE_TWOWAY, wait, start_ns, tx_channel,
+                       tx_buf, tx_len, rx_channel, rx_buf, rx_len);
+    }
+
+    // For blocking transfers, both transfers have completed by now
+    if (wait) {
+        record_timestamps(tx_chan, &trans.tx_timestamps, wakeup_ns);
+        record_timestamps(rx_chan, &trans.rx_timestamps, wakeup_ns);
+        count_completion(tx_chan, tx_buf, tx_len);
+        count_completion(rx_chan, rx_buf, rx_len);
+    } else {
+        record_inflight(tx_chan, trans.tx_cookie, tx_buf, tx_len);
+        record_inflight(rx_chan, trans.rx_cookie, rx_buf, rx_len);
     }
 
     return rc;
 }
 
+/* Submits a copy of a number of rows between two DMA buffers on a CDMA channel,
+ * returning the cookie that identifies it. */
+static int submit_memcpy(axidma_dev_t dev, int channel, void *dst,
+        size_t dst_stride, const void *src, size_t src_stride, size_t len,
+        int num_rows, bool wait)
+{
+    int rc;
+    size_t copy_len;
+    uint64_t start_ns, end_ns;
+    struct axidma_memcpy_transaction trans;
+    dma_channel_t *dma_chan;
+
+    assert(find_channel(dev, channel) != NULL);
+    assert(find_channel(dev, channel)->type == AXIDMA_CDMA);
+
+    // Setup the argument structure to the IOCTL
+    dma_chan = find_channel(dev, channel);
+    trans.wait = wait;
+    trans.channel_id = channel;
+    trans.dst = dst;
+    trans.src = (void *)src;
+    trans.len = len;
+    trans.num_rows = num_rows;
+    trans.dst_stride = dst_stride;
+    trans.src_stride = src_stride;
+    copy_len = len * num_rows;
+
+    // Perform the given copy, the driver fills in the cookie
+    AXIDMA_PROBE(submit, channel, copy_len, dst);
+    start_ns = axidma_time_ns();
+    rc = ioctl(dev->fd, AXIDMA_DMA_MEMCPY, &trans);
+    end_ns = axidma_time_ns();
+    if (rc < 0) {
+        perror("Failed to perform the AXI CDMA copy");
+        return rc;
+    }
+    count_transfer(dma_chan, copy_len, start_ns, end_ns);
+
+    /* For blocking copies, the copy has completed by now. Otherwise, remember
+     * the destination, so it can be reported when the copy completes. */
+    if (wait) {
+        record_timestamps(dma_chan, &trans.timestamps, end_ns);
+        count_completion(dma_chan, dst, copy_len);
+    } else {
+        record_inflight(dma_chan, trans.cookie, dst, copy_len);
+    }
+
+    return trans.cookie;
+}
+
+/* This copies data between two DMA buffers with a CDMA channel, offloading the
+ * copy from the processor. The user determines if this call is blocking. */
+int axidma_memcpy(axidma_dev_t dev, int channel, void *dst, const void *src,
+        size_t len, bool wait)
+{
+    return submit_memcpy(dev, channel, dst, len, src, len, len, 1, wait);
+}
+
+/* This copies a rectangle of rows between two DMA buffers with a CDMA channel,
+ * where each buffer has its own distance between rows. */
+int axidma_memcpy_2d(axidma_dev_t dev, int channel, void *dst,
+        size_t dst_stride, const void *src, size_t src_stride, size_t width,
+        int height, bool wait)
+{
+    return submit_memcpy(dev, channel, dst, dst_stride, src, src_stride, width,
+                         height, wait);
+}
+
 /* This function performs a video transfer over AXI DMA, setting up a VDMA
  * channel to either read from or write to given frame buffers on-demand
  * continuously. This call is always non-blocking. The transfer can only be
@@ -521,7 +1511,9 @@ int axidma_video_transfer(axidma_dev_t dev, int display_channel, size_t width,
 {
     int rc;
     unsigned long axidma_cmd;
+    uint64_t start_ns;
     struct axidma_video_transaction trans;
+    struct axidma_trace_record record;
     dma_channel_t *dma_chan;
 
     assert(find_channel(dev, display_channel) != NULL);
@@ -538,24 +1530,114 @@ int axidma_video_transfer(axidma_dev_t dev, int display_channel, size_t width,
     axidma_cmd = (dma_chan->dir == AXIDMA_READ) ? AXIDMA_DMA_VIDEO_READ :
                                                   AXIDMA_DMA_VIDEO_WRITE;
     // Perform the video transfer
+    AXIDMA_PROBE(submit, display_channel, width * height * depth,
+                 frame_buffers[0]);
+    start_ns = axidma_time_ns();
     rc = ioctl(dev->fd, axidma_cmd, &trans);
     if (rc < 0) {
         perror("Failed to perform the AXI DMA video write transfer");
+    } else if (dev->trace != NULL) {
+        memset(&record, 0, sizeof(record));
+        record.op = AXIDMA_TRACE_VIDEO;
+        record.channel = display_channel;
+        record.buffer_id = trace_buffer_id(dev, frame_buffers[0]);
+        record.len = width;
+        record.rx_len = height;
+        record.rx_buffer_id = depth;
+        record.rx_channel = num_buffers;
+        trace_write(dev, &record, start_ns);
     }
 
     return rc;
 }
 
+/* Starts capturing frames into a ring of frame buffers on a VDMA receive
+ * channel, shared by any number of consumers. The capture can only be stopped
+ * with a call to axidma_stop_transfer. */
+int axidma_capture_start(axidma_dev_t dev, int channel, size_t width,
+        size_t height, size_t depth, void **frame_buffers, int num_buffers)
+{
+    struct axidma_video_transaction trans;
+
+    assert(find_channel(dev, channel) != NULL);
+    assert(find_channel(dev, channel)->type == AXIDMA_VDMA);
+    assert(find_channel(dev, channel)->dir == AXIDMA_READ);
+
+    trans.channel_id = channel;
+    trans.num_frame_buffers = num_buffers;
+    trans.frame_buffers = frame_buffers;
+    trans.frame.width = width;
+    trans.frame.height = height;
+    trans.frame.depth = depth;
+    if (ioctl(dev->fd, AXIDMA_START_CAPTURE, &trans) < 0) {
+        perror("Failed to start the video capture");
+        return -errno;
+    }
+
+    return 0;
+}
+
+/* Acquires a reference to a captured frame, either the newest one or the
+ * oldest one after the given sequence, returning the index of its buffer. */
+int axidma_capture_acquire(axidma_dev_t dev, int channel, bool latest,
+        uint64_t after_sequence, int timeout,
+        struct axidma_capture_frame *frame)
+{
+    assert(find_channel(dev, channel) != NULL);
+
+    memset(frame, 0, sizeof(*frame));
+    frame->channel_id = channel;
+    frame->latest = latest;
+    frame->after_sequence = after_sequence;
+    frame->timeout = timeout;
+    if (ioctl(dev->fd, AXIDMA_ACQUIRE_FRAME, frame) < 0) {
+        // A timeout is an expected outcome, so it is not reported
+        if (errno != EAGAIN) {
+            perror("Failed to acquire a captured frame");
+        }
+        return -errno;
+    }
+
+    return frame->index;
+}
+
+// Releases a reference to a captured frame, so its buffer can be reused
+int axidma_capture_release(axidma_dev_t dev, int channel, int index)
+{
+    struct axidma_capture_frame frame;
+
+    assert(find_channel(dev, channel) != NULL);
+
+    memset(&frame, 0, sizeof(frame));
+    frame.channel_id = channel;
+    frame.index = index;
+    if (ioctl(dev->fd, AXIDMA_RELEASE_FRAME, &frame) < 0) {
+        perror("Failed to release the captured frame");
+        return -errno;
+    }
+
+    return 0;
+}
+
 /* This function stops all transfers on the given channel with the given
  * direction. This function is required to stop any video transfers, or any
  * non-blocking transfers. */
 void axidma_stop_transfer(axidma_dev_t dev, int channel)
 {
     struct axidma_chan chan;
+    struct axidma_trace_record record;
     dma_channel_t *dma_chan;
 
     assert(find_channel(dev, channel) != NULL);
 
+    if (dev->trace != NULL) {
+        memset(&record, 0, sizeof(record));
+        record.op = AXIDMA_TRACE_STOP;
+        record.channel = channel;
+        record.rx_channel = -1;
+        trace_write(dev, &record, axidma_time_ns());
+    }
+
     // Setup the argument structure for the IOCTL
     dma_chan = find_channel(dev, channel);
     chan.channel_id = channel;
@@ -570,3 +1652,1162 @@ void axidma_stop_transfer(axidma_dev_t dev, int channel)
 
     return;
 }
+
+/* Waits until any of the given transfers completes, or the timeout expires. The
+ * status of each entry is updated, and the number of finished transfers is
+ * returned, which is 0 if the timeout expired. */
+int axidma_wait_any(axidma_dev_t dev, struct axidma_wait_entry *entries,
+        int num_entries, int timeout)
+{
+    int rc, i;
+    uint64_t start_ns, wakeup_ns;
+    dma_channel_t *dma_chan;
+    struct axidma_wait_any wait_any;
+    struct axidma_trace_record record;
+
+    assert(0 < num_entries && num_entries <= AXIDMA_MAX_WAIT_ENTRIES);
+
+    // Setup the argument structure for the IOCTL
+    wait_any.num_entries = num_entries;
+    wait_any.entries = entries;
+    wait_any.timeout = timeout;
+
+    // Wait for the transfers, retrying if we were interrupted by a signal
+    start_ns = axidma_time_ns();
+    if (dev->trace != NULL) {
+        memset(&record, 0, sizeof(record));
+        record.op = AXIDMA_TRACE_WAIT_ANY;
+        record.channel = entries[0].channel_id;
+        record.rx_channel = -1;
+        record.len = num_entries;
+        record.rx_len = (timeout < 0) ? AXIDMA_TRACE_NO_TIMEOUT :
+                        (uint32_t)timeout;
+        trace_write(dev, &record, start_ns);
+    }
+    do {
+        rc = ioctl(dev->fd, AXIDMA_WAIT_ANY, &wait_any);
+    } while (rc < 0 && errno == EINTR);
+    if (rc < 0) {
+        perror("Failed to wait on the AXI DMA transfers");
+        return rc;
+    }
+
+    /* Record the timestamps of the transfers that completed. The time spent
+     * blocked is charged to the channel of the first entry. */
+    wakeup_ns = axidma_time_ns();
+    dma_chan = find_channel(dev, entries[0].channel_id);
+    __atomic_fetch_add(&dma_chan->stats.blocked_ns, wakeup_ns - start_ns,
+                       __ATOMIC_RELAXED);
+    for (i = 0; i < num_entries; i++)
+    {
+        if (entries[i].status == AXIDMA_WAIT_COMPLETE) {
+            dma_chan = find_channel(dev, entries[i].channel_id);
+            record_timestamps(dma_chan, &entries[i].timestamps, wakeup_ns);
+            complete_inflight(dma_chan, entries[i].cookie);
+        }
+    }
+
+    return rc;
+}
+
+/* Gets the kernel timestamps for the last completed transfer on the given
+ * channel, and the time that the caller woke up for it. */
+void axidma_get_timestamps(axidma_dev_t dev, int channel,
+        struct axidma_timestamps *timestamps, uint64_t *wakeup_ns)
+{
+    dma_channel_t *dma_chan;
+
+    assert(find_channel(dev, channel) != NULL);
+
+    dma_chan = find_channel(dev, channel);
+    *timestamps = dma_chan->timestamps;
+    if (wakeup_ns != NULL) {
+        *wakeup_ns = dma_chan->wakeup_ns;
+    }
+
+    return;
+}
+
+/* Gets the userspace counters for the channel. Each counter is read atomically,
+ * but they are not a consistent snapshot if another thread is transferring. */
+void axidma_get_stats(axidma_dev_t dev, int channel,
+        struct axidma_user_stats *stats)
+{
+    dma_channel_t *dma_chan;
+
+    assert(find_channel(dev, channel) != NULL);
+
+    dma_chan = find_channel(dev, channel);
+    stats->transfers = __atomic_load_n(&dma_chan->stats.transfers,
+                                       __ATOMIC_RELAXED);
+    stats->completions = __atomic_load_n(&dma_chan->stats.completions,
+                                         __ATOMIC_RELAXED);
+    stats->bytes = __atomic_load_n(&dma_chan->stats.bytes, __ATOMIC_RELAXED);
+    stats->blocked_ns = __atomic_load_n(&dma_chan->stats.blocked_ns,
+                                        __ATOMIC_RELAXED);
+
+    return;
+}
+
+/* Reads a consistent snapshot of the channel's counters from the status page.
+ * The driver bumps the sequence count before and after every update, so the
+ * read is retried while it is odd, or if it changed during the copy. */
+int axidma_get_status(axidma_dev_t dev, int channel,
+        struct axidma_chan_status *status)
+{
+    int i;
+    uint32_t num_channels, start, end;
+    const struct axidma_chan_status *chan_status;
+
+    if (dev->status_page == NULL) {
+        fprintf(stderr, "Error: The status page is not available.\n");
+        return -1;
+    }
+
+    // Find the entry for the channel in the status page
+    chan_status = NULL;
+    num_channels = dev->status_page->num_channels;
+    for (i = 0; i < (int)num_channels && i < AXIDMA_STATUS_MAX_CHANNELS; i++)
+    {
+        if (dev->status_page->channels[i].channel_id == channel) {
+            chan_status = &dev->status_page->channels[i];
+            break;
+        }
+    }
+    if (chan_status == NULL) {
+        fprintf(stderr, "Error: Channel %d is not in the status page.\n",
+                channel);
+        return -1;
+    }
+
+    do {
+        start = __atomic_load_n(&chan_status->sequence, __ATOMIC_ACQUIRE);
+        status->channel_id = chan_status->channel_id;
+        status->completed = chan_status->completed;
+        status->bytes = chan_status->bytes;
+        status->last_cookie = chan_status->last_cookie;
+        status->errors = chan_status->errors;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        end = __atomic_load_n(&chan_status->sequence, __ATOMIC_RELAXED);
+    } while ((start & 1) != 0 || start != end);
+
+    status->sequence = end;
+    return 0;
+}
+
+/* Configures the driver to switch the channel between interrupt-driven and
+ * polled completions as its completion rate crosses the given thresholds. */
+int axidma_set_adaptive(axidma_dev_t dev, int channel, uint32_t enter_rate,
+        uint32_t exit_rate, uint32_t interval_us)
+{
+    struct axidma_adaptive_config config;
+
+    assert(find_channel(dev, channel) != NULL);
+
+    config.channel_id = channel;
+    config.poll_enter_rate = enter_rate;
+    config.poll_exit_rate = exit_rate;
+    config.poll_interval_us = interval_us;
+    if (ioctl(dev->fd, AXIDMA_SET_ADAPTIVE, &config) < 0) {
+        perror("Failed to configure the adaptive completion mode");
+        return -errno;
+    }
+
+    return 0;
+}
+
+// Gets the statistics for the completion handling modes of the channel
+int axidma_get_chan_stats(axidma_dev_t dev, int channel,
+        struct axidma_chan_stats *stats)
+{
+    assert(find_channel(dev, channel) != NULL);
+
+    memset(stats, 0, sizeof(*stats));
+    stats->channel_id = channel;
+    if (ioctl(dev->fd, AXIDMA_GET_CHAN_STATS, stats) < 0) {
+        perror("Failed to get the channel statistics");
+        return -errno;
+    }
+
+    return 0;
+}
+
+// Gets the usage of the DMA buffers across the whole device
+int axidma_get_device_stats(axidma_dev_t dev, struct axidma_device_stats *stats)
+{
+    if (ioctl(dev->fd, AXIDMA_GET_DEVICE_STATS, stats) < 0) {
+        perror("Failed to get the device statistics");
+        return -errno;
+    }
+
+    return 0;
+}
+
+/* Splits the latency of a transfer into the time spent queued in the driver,
+ * the time spent in the hardware, and the time taken to wake up the caller. A
+ * component is 0 if one of its timestamps is not known. */
+void axidma_split_latency(const struct axidma_timestamps *timestamps,
+        uint64_t wakeup_ns, struct axidma_latency *latency)
+{
+    const struct axidma_timestamps *ts;
+
+    ts = timestamps;
+    latency->queueing_ns = (ts->submit_ns != 0 && ts->issue_ns >= ts->submit_ns)
+                           ? ts->issue_ns - ts->submit_ns : 0;
+    latency->hardware_ns = (ts->issue_ns != 0 && ts->complete_ns >= ts->issue_ns)
+                           ? ts->complete_ns - ts->issue_ns : 0;
+    latency->wakeup_ns = (ts->complete_ns != 0 && wakeup_ns >= ts->complete_ns)
+                         ? wakeup_ns - ts->complete_ns : 0;
+    return;
+}
+
+/* Returns the current time of the monotonic clock in nanoseconds. This is the
+ * same clock that the driver uses for its timestamps. */
+uint64_t axidma_time_ns()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/* Sets the CPU and real-time priority of the driver's completion thread for
+ * the given channel. */
+int axidma_set_completion_config(axidma_dev_t dev, int channel, int cpu,
+        int priority)
+{
+    struct axidma_completion_config config;
+
+    assert(find_channel(dev, channel) != NULL);
+
+    config.channel_id = channel;
+    config.cpu = cpu;
+    config.priority = priority;
+    if (ioctl(dev->fd, AXIDMA_SET_COMPLETION_CONFIG, &config) < 0) {
+        perror("Failed to configure the channel's completion thread");
+        return -errno;
+    }
+
+    return 0;
+}
+
+// Sets how the transfers of different processes on a channel are scheduled
+int axidma_set_sched(axidma_dev_t dev, int channel,
+        enum axidma_sched_policy policy, int max_transfers, uint64_t max_bytes)
+{
+    struct axidma_sched_config config;
+
+    assert(find_channel(dev, channel) != NULL);
+
+    config.channel_id = channel;
+    config.policy = policy;
+    config.max_hw_transfers = max_transfers;
+    config.max_hw_bytes = max_bytes;
+    if (ioctl(dev->fd, AXIDMA_SET_SCHED, &config) < 0) {
+        perror("Failed to set the channel's scheduling policy");
+        return -errno;
+    }
+
+    return 0;
+}
+
+// Sets the weight and priority of a process's transfers on a channel
+int axidma_set_submitter(axidma_dev_t dev, int channel, int pid,
+        uint32_t weight, int priority)
+{
+    struct axidma_submitter_config config;
+
+    assert(find_channel(dev, channel) != NULL);
+
+    config.channel_id = channel;
+    config.pid = pid;
+    config.weight = weight;
+    config.priority = priority;
+    if (ioctl(dev->fd, AXIDMA_SET_SUBMITTER, &config) < 0) {
+        perror("Failed to set the process's scheduling parameters");
+        return -errno;
+    }
+
+    return 0;
+}
+
+// Pins the calling thread to the given CPU
+int axidma_pin_thread(int cpu)
+{
+    cpu_set_t cpu_set;
+
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) < 0) {
+        perror("Failed to pin the thread to the CPU");
+        return -errno;
+    }
+
+    return 0;
+}
+
+/* Runs the calling thread with the SCHED_FIFO real-time policy at the given
+ * priority, or with the normal policy if the priority is 0. */
+int axidma_set_realtime(int priority)
+{
+    struct sched_param param;
+    int policy;
+
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = priority;
+    policy = (priority > 0) ? SCHED_FIFO : SCHED_OTHER;
+    if (sched_setscheduler(0, policy, &param) < 0) {
+        perror("Failed to set the scheduling policy of the thread");
+        return -errno;
+    }
+
+    return 0;
+}
+
+/* Locks all of the process' current and future memory into RAM, so that the
+ * real-time path never takes a page fault. */
+int axidma_lock_memory()
+{
+    if (mlockall(MCL_CURRENT|MCL_FUTURE) < 0) {
+        perror("Failed to lock the process' memory");
+        return -errno;
+    }
+
+    return 0;
+}
+
+/* Starts recording a trace of every operation performed through the library
+ * to the given file. The buffers that are already allocated are recorded at
+ * the start of the trace, so the replay can allocate them. */
+int axidma_trace_start(axidma_dev_t dev, const char *path)
+{
+    int i, rc;
+    struct axidma_trace_header header;
+
+    axidma_trace_stop(dev);
+
+    // Open the trace file, and buffer the writes to keep tracing cheap
+    dev->trace = fopen(path, "wb");
+    if (dev->trace == NULL) {
+        perror("Unable to open the AXI DMA trace file");
+        return -1;
+    }
+    setvbuf(dev->trace, NULL, _IOFBF, TRACE_BUFFER_SIZE);
+
+    // Write out the header for the trace
+    dev->trace_start_ns = axidma_time_ns();
+    header.magic = AXIDMA_TRACE_MAGIC;
+    header.version = AXIDMA_TRACE_VERSION;
+    header.record_size = sizeof(struct axidma_trace_record);
+    header.start_ns = dev->trace_start_ns;
+    if (fwrite(&header, sizeof(header), 1, dev->trace) != 1) {
+        perror("Failed to write the AXI DMA trace header");
+        rc = -1;
+        goto close_trace;
+    }
+
+    // Record the buffers that already exist
+    for (i = 0; i < TRACE_MAX_BUFFERS && dev->trace != NULL; i++)
+    {
+        if (dev->buffers[i].addr != NULL) {
+            trace_buffer(dev, AXIDMA_TRACE_ALLOC, &dev->buffers[i],
+                         dev->trace_start_ns);
+        }
+    }
+
+    return (dev->trace != NULL) ? 0 : -1;
+
+close_trace:
+    fclose(dev->trace);
+    dev->trace = NULL;
+    return rc;
+}
+
+// Stops recording the trace, flushing it out to the file
+void axidma_trace_stop(axidma_dev_t dev)
+{
+    FILE *trace;
+
+    if (dev->trace == NULL) {
+        return;
+    }
+
+    trace = dev->trace;
+    dev->trace = NULL;
+    if (fclose(trace) != 0) {
+        perror("Failed to close the AXI DMA trace file");
+    }
+
+    return;
+}
+
+/* Loads the stream settings for each channel pair from the profile, applying
+ * their completion settings. Each line of the profile has the settings for
+ * one channel pair, and lines starting with a '#' are comments. */
+int axidma_load_profile(axidma_dev_t dev, const char *path)
+{
+    FILE *file;
+    int rc, line_num, tx_channel, rx_channel;
+    char line[256];
+    struct axidma_stream_config config;
+
+    file = fopen(path, "r");
+    if (file == NULL) {
+        perror("Unable to open the AXI DMA profile");
+        return -1;
+    }
+
+    rc = 0;
+    for (line_num = 1; fgets(line, sizeof(line), file) != NULL; line_num++)
+    {
+        if (line[strspn(line, " \t\n")] == '\0' ||
+                line[strspn(line, " \t")] == '#') {
+            continue;
+        }
+
+        // The receive credits are optional, as older profiles do not have them
+        config.rx_credits = 0;
+        if (sscanf(line, "stream %d %d chunk_size=%zu depth=%d "
+                   "poll_enter_rate=%u poll_exit_rate=%u poll_interval_us=%u "
+                   "rx_credits=%d", &tx_channel, &rx_channel,
+                   &config.chunk_size, &config.depth, &config.poll_enter_rate,
+                   &config.poll_exit_rate, &config.poll_interval_us,
+                   &config.rx_credits) < 7) {
+            fprintf(stderr, "%s:%d: Malformed stream settings in the AXI DMA "
+                    "profile.\n", path, line_num);
+            rc = -1;
+            continue;
+        }
+
+        // Skip channels that are not on this system, so profiles are portable
+        if ((tx_channel >= 0 && find_channel(dev, tx_channel) == NULL) ||
+                (rx_channel >= 0 && find_channel(dev, rx_channel) == NULL)) {
+            fprintf(stderr, "%s:%d: Channels %d and %d are not available, "
+                    "skipping.\n", path, line_num, tx_channel, rx_channel);
+            continue;
+        }
+        if (axidma_stream_set_config(dev, tx_channel, rx_channel, &config) < 0) {
+            rc = -1;
+        }
+    }
+
+    fclose(file);
+    return rc;
+}
+
+// Saves the stream settings for all of the channel pairs to the profile
+int axidma_save_profile(axidma_dev_t dev, const char *path)
+{
+    int i;
+    FILE *file;
+    struct stream_profile *profile;
+
+    file = fopen(path, "w");
+    if (file == NULL) {
+        perror("Unable to open the AXI DMA profile");
+        return -1;
+    }
+
+    fprintf(file, "# AXI DMA stream profile, generated by axidma_tune\n");
+    fprintf(file, "# stream <tx channel> <rx channel> <settings>\n");
+    for (i = 0; i < dev->num_profiles; i++)
+    {
+        profile = &dev->profiles[i];
+        fprintf(file, "stream %d %d chunk_size=%zu depth=%d "
+                "poll_enter_rate=%u poll_exit_rate=%u poll_interval_us=%u "
+                "rx_credits=%d\n", profile->tx_channel, profile->rx_channel,
+                profile->config.chunk_size, profile->config.depth,
+                profile->config.poll_enter_rate, profile->config.poll_exit_rate,
+                profile->config.poll_interval_us, profile->config.rx_credits);
+    }
+
+    if (fclose(file) != 0) {
+        perror("Failed to write the AXI DMA profile");
+        return -1;
+    }
+    return 0;
+}
+
+// Sets the stream settings for the channel pair, and applies them
+int axidma_stream_set_config(axidma_dev_t dev, int tx_channel, int rx_channel,
+        const struct axidma_stream_config *config)
+{
+    struct stream_profile *profile;
+
+    assert(tx_channel < 0 || find_channel(dev, tx_channel) != NULL);
+    assert(rx_channel < 0 || find_channel(dev, rx_channel) != NULL);
+
+    if (config->chunk_size == 0 || config->depth <= 0 ||
+            config->depth > INFLIGHT_SLOTS) {
+        fprintf(stderr, "Invalid stream settings, the depth must be from 1 to "
+                "%d.\n", INFLIGHT_SLOTS);
+        return -EINVAL;
+    } else if (config->rx_credits < 0 ||
+               config->depth + config->rx_credits > INFLIGHT_SLOTS) {
+        fprintf(stderr, "Invalid stream settings, the depth and receive "
+                "credits can add up to at most %d.\n", INFLIGHT_SLOTS);
+        return -EINVAL;
+    }
+
+    // Find the settings for the pair, or add them
+    profile = find_profile(dev, tx_channel, rx_channel);
+    if (profile == NULL) {
+        if (dev->num_profiles == MAX_STREAM_PROFILES) {
+            fprintf(stderr, "Too many channel pairs with stream settings.\n");
+            return -ENOMEM;
+        }
+        profile = &dev->profiles[dev->num_profiles++];
+        profile->tx_channel = tx_channel;
+        profile->rx_channel = rx_channel;
+    }
+    profile->config = *config;
+
+    if (apply_stream_config(dev, tx_channel, config) < 0 ||
+            apply_stream_config(dev, rx_channel, config) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// Gets the stream settings for the channel pair, or the defaults
+void axidma_stream_get_config(axidma_dev_t dev, int tx_channel, int rx_channel,
+        struct axidma_stream_config *config)
+{
+    struct stream_profile *profile;
+
+    profile = find_profile(dev, tx_channel, rx_channel);
+    if (profile != NULL) {
+        *config = profile->config;
+        return;
+    }
+
+    memset(config, 0, sizeof(*config));
+    config->chunk_size = DEFAULT_STREAM_CHUNK;
+    config->depth = DEFAULT_STREAM_DEPTH;
+    return;
+}
+
+/* Streams the buffer over the channel pair in chunks, keeping up to the depth
+ * of chunks in-flight on each channel. The receive chunk is always submitted
+ * before its transmit chunk, so the receiver is ready for the data, along with
+ * the receive credits ahead of it. If a check is given, each chunk is
+ * checksummed before it is sent and after it is received, and the checksums
+ * are compared once the stream finishes. If stats are given, the receive
+ * credit level is sampled after each completion. */
+static int run_stream(axidma_dev_t dev, int tx_channel, void *tx_buf,
+        int rx_channel, void *rx_buf, size_t len,
+        const struct axidma_stream_config *config,
+        struct axidma_stream_check *check, struct axidma_stream_stats *stats)
+{
+    int i, rc, num_entries, num_chunks, tx_next, rx_next, tx_done, rx_done;
+    int rx_window, rx_level;
+    uint64_t rx_level_total;
+    size_t offset, chunk_len;
+    struct axidma_stream_config profile_config;
+    struct axidma_wait_entry entries[2 * INFLIGHT_SLOTS];
+    struct stream_checker checker;
+
+    assert(tx_channel >= 0 || rx_channel >= 0);
+    assert(tx_channel < 0 || find_channel(dev, tx_channel)->dir == AXIDMA_WRITE);
+    assert(rx_channel < 0 || find_channel(dev, rx_channel)->dir == AXIDMA_READ);
+
+    if (config == NULL) {
+        axidma_stream_get_config(dev, tx_channel, rx_channel, &profile_config);
+        config = &profile_config;
+    }
+    assert(config->chunk_size > 0);
+    assert(0 < config->depth && config->depth <= INFLIGHT_SLOTS);
+    assert(0 <= config->rx_credits &&
+           config->depth + config->rx_credits <= INFLIGHT_SLOTS);
+
+    // Set up the checksums for each chunk, and start the helper thread
+    num_chunks = (len + config->chunk_size - 1) / config->chunk_size;
+    memset(&checker, 0, sizeof(checker));
+    if (check != NULL) {
+        checker.tx_buf = (tx_channel < 0) ? NULL : tx_buf;
+        checker.rx_buf = (rx_channel < 0) ? NULL : rx_buf;
+        checker.len = len;
+        checker.chunk_size = config->chunk_size;
+        checker.tx_crcs = check->tx_crcs;
+        checker.rx_crcs = check->rx_crcs;
+        if (checker.tx_crcs == NULL) {
+            checker.tx_crcs = malloc(num_chunks * sizeof(checker.tx_crcs[0]));
+        }
+        if (checker.rx_crcs == NULL) {
+            checker.rx_crcs = malloc(num_chunks * sizeof(checker.rx_crcs[0]));
+        }
+        if (checker.tx_crcs == NULL || checker.rx_crcs == NULL) {
+            fprintf(stderr, "Unable to allocate the stream's checksums.\n");
+            rc = -ENOMEM;
+            goto free_checksums;
+        }
+
+        checker.use_thread = check->use_thread;
+        if (checker.use_thread) {
+            rc = -pthread_create(&checker.thread, NULL, checker_thread,
+                                 &checker);
+            if (rc < 0) {
+                fprintf(stderr, "Unable to create the checksum thread: %s\n",
+                        strerror(-rc));
+                goto free_checksums;
+            }
+        }
+    }
+
+    /* Keep each channel's queue full until all the chunks have finished. The
+     * receive queue also holds the credits, and a transmit chunk is only sent
+     * once its receive chunk and the credits after it are posted, or there
+     * are no more receive chunks to post. */
+    if (stats != NULL) {
+        memset(stats, 0, sizeof(*stats));
+    }
+    rx_window = config->depth + config->rx_credits;
+    rx_level_total = 0;
+    tx_next = (tx_channel < 0) ? num_chunks : 0;
+    rx_next = (rx_channel < 0) ? num_chunks : 0;
+    tx_done = tx_next;
+    rx_done = rx_next;
+    num_entries = 0;
+    while (tx_done < num_chunks || rx_done < num_chunks)
+    {
+        while (rx_next < num_chunks && rx_next - rx_done < rx_window)
+        {
+            offset = (size_t)rx_next * config->chunk_size;
+            chunk_len = (len - offset < config->chunk_size) ? len - offset :
+                        config->chunk_size;
+            rc = axidma_oneway_transfer_async(dev, rx_channel,
+                    (char *)rx_buf + offset, chunk_len);
+            if (rc < 0) {
+                goto stop_stream;
+            }
+            entries[num_entries].channel_id = rx_channel;
+            entries[num_entries++].cookie = rc;
+            rx_next += 1;
+        }
+        while (tx_next < num_chunks && tx_next - tx_done < config->depth &&
+               (tx_next + config->rx_credits < rx_next ||
+                (tx_next < rx_next && rx_next == num_chunks)))
+        {
+            offset = (size_t)tx_next * config->chunk_size;
+            chunk_len = (len - offset < config->chunk_size) ? len - offset :
+                        config->chunk_size;
+            if (checker.tx_buf != NULL) {
+                checker_publish(&checker, tx_next + 1, checker.rx_ready);
+            }
+            rc = axidma_oneway_transfer_async(dev, tx_channel,
+                    (char *)tx_buf + offset, chunk_len);
+            if (rc < 0) {
+                goto stop_stream;
+            }
+            entries[num_entries].channel_id = tx_channel;
+            entries[num_entries++].cookie = rc;
+            tx_next += 1;
+        }
+
+        rc = reap_chunks(dev, entries, &num_entries, &tx_done, &rx_done);
+        if (rc < 0) {
+            fprintf(stderr, "A chunk of the AXI DMA stream failed.\n");
+            goto stop_stream;
+        }
+        if (checker.rx_buf != NULL) {
+            checker_publish(&checker, checker.tx_ready, rx_done);
+        }
+
+        // Sample the receive chunks left posted, before any more are posted
+        if (stats != NULL && rx_next < num_chunks) {
+            rx_level = rx_next - rx_done;
+            if (stats->num_samples == 0 || rx_level < stats->min_rx_credits) {
+                stats->min_rx_credits = rx_level;
+            }
+            stats->rx_starved += (rx_level == 0) ? 1 : 0;
+            stats->num_samples += 1;
+            rx_level_total += rx_level;
+        }
+    }
+    if (stats != NULL && stats->num_samples > 0) {
+        stats->mean_rx_credits = (double)rx_level_total / stats->num_samples;
+    }
+
+    // Compare the checksums of the chunks that went both ways
+    rc = 0;
+    if (check != NULL) {
+        checker_stop(&checker);
+        check->num_chunks = num_chunks;
+        check->num_mismatches = 0;
+        check->first_mismatch = -1;
+        for (i = 0; i < num_chunks && checker.tx_buf != NULL &&
+                    checker.rx_buf != NULL; i++)
+        {
+            if (checker.tx_crcs[i] == checker.rx_crcs[i]) {
+                continue;
+            } else if (check->first_mismatch < 0) {
+                check->first_mismatch = i;
+            }
+            check->num_mismatches += 1;
+        }
+        rc = (check->num_mismatches > 0) ? -EBADMSG : 0;
+    }
+    goto free_checksums;
+
+// Stop the chunks that are still in-flight on a failure
+stop_stream:
+    if (tx_channel >= 0) {
+        axidma_stop_transfer(dev, tx_channel);
+    }
+    if (rx_channel >= 0) {
+        axidma_stop_transfer(dev, rx_channel);
+    }
+    if (check != NULL) {
+        checker_stop(&checker);
+    }
+free_checksums:
+    if (check != NULL && checker.tx_crcs != check->tx_crcs) {
+        free(checker.tx_crcs);
+    }
+    if (check != NULL && checker.rx_crcs != check->rx_crcs) {
+        free(checker.rx_crcs);
+    }
+    return rc;
+}
+
+// Streams the buffer over the channel pair in chunks
+int axidma_stream_transfer(axidma_dev_t dev, int tx_channel, void *tx_buf,
+        int rx_channel, void *rx_buf, size_t len,
+        const struct axidma_stream_config *config)
+{
+    return run_stream(dev, tx_channel, tx_buf, rx_channel, rx_buf, len, config,
+                      NULL, NULL);
+}
+
+// Streams the buffer over the channel pair, checking the integrity of each chunk
+int axidma_stream_transfer_checked(axidma_dev_t dev, int tx_channel,
+        void *tx_buf, int rx_channel, void *rx_buf, size_t len,
+        const struct axidma_stream_config *config,
+        struct axidma_stream_check *check)
+{
+    return run_stream(dev, tx_channel, tx_buf, rx_channel, rx_buf, len, config,
+                      check, NULL);
+}
+
+// Streams the buffer out and back, reporting the receive credit level kept
+int axidma_stream_duplex(axidma_dev_t dev, int tx_channel, void *tx_buf,
+        int rx_channel, void *rx_buf, size_t len,
+        const struct axidma_stream_config *config,
+        struct axidma_stream_stats *stats)
+{
+    assert(tx_channel >= 0 && rx_channel >= 0);
+    assert(stats != NULL);
+
+    return run_stream(dev, tx_channel, tx_buf, rx_channel, rx_buf, len, config,
+                      NULL, stats);
+}
+
+// Computes the CRC32C of the buffer, continuing from the given checksum
+uint32_t axidma_crc32c(uint32_t crc, const void *buf, size_t len)
+{
+    pthread_once(&crc32c_once, crc32c_init);
+    return ~crc32c_update(~crc, buf, len);
+}
+
+// Gets the name of the CRC32C implementation
+const char *axidma_crc32c_name(void)
+{
+    pthread_once(&crc32c_once, crc32c_init);
+    return crc32c_impl;
+}
+
+/*----------------------------------------------------------------------------
+ * Receive Demultiplexer
+ *----------------------------------------------------------------------------*/
+
+// Drops a reference to the buffer, freeing it to be posted again if it was last
+static void demux_put_buffer(axidma_demux_t demux, struct demux_buffer *buffer)
+{
+    if (__atomic_sub_fetch(&buffer->refcount, 1, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
+
+    __atomic_add_fetch(&demux->released, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&demux->idle, __ATOMIC_SEQ_CST)) {
+        futex_wake(&demux->released);
+    }
+    return;
+}
+
+// Posts all of the buffers that are free to the channel, returning the number
+static int demux_post_buffers(axidma_demux_t demux)
+{
+    int i, rc, num_posted;
+    struct demux_buffer *buffer;
+
+    num_posted = 0;
+    for (i = 0; i < demux->config.num_buffers; i++)
+    {
+        buffer = &demux->buffers[i];
+        if (!buffer->posted &&
+                __atomic_load_n(&buffer->refcount, __ATOMIC_ACQUIRE) == 0) {
+            memset(&buffer->metadata, 0, sizeof(buffer->metadata));
+            rc = axidma_oneway_transfer_meta(demux->dev, demux->config.channel,
+                    buffer->buf, demux->config.buffer_size, &buffer->metadata,
+                    false);
+            if (rc < 0) {
+                continue;
+            }
+            buffer->posted = true;
+            buffer->cookie = rc;
+            buffer->sequence = demux->next_sequence++;
+        }
+        num_posted += buffer->posted ? 1 : 0;
+    }
+
+    return num_posted;
+}
+
+/* Routes each buffer to the flow given by its APP0 word, which is how the
+ * fabric usually passes on the packet's TDEST. */
+static void demux_classify_app0(axidma_demux_t demux, void *buf, size_t len,
+        const struct axidma_metadata *metadata, void *data)
+{
+    (void)data;
+
+    if (metadata->len >= sizeof(metadata->app[0])) {
+        axidma_demux_route(demux, metadata->app[0], buf, len);
+    }
+    return;
+}
+
+// Classifies a completed buffer, routing its packets to the flows
+static void demux_classify_buffer(axidma_demux_t demux, int index)
+{
+    struct demux_buffer *buffer;
+
+    /* The thread holds a reference while classifying, so that the buffer is
+     * not freed until all of its packets have been routed. */
+    buffer = &demux->buffers[index];
+    buffer->posted = false;
+    __atomic_store_n(&buffer->refcount, 1, __ATOMIC_RELAXED);
+
+    demux->current = index;
+    demux->routed = 0;
+    __atomic_add_fetch(&demux->stats.packets, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&demux->stats.bytes, buffer->len, __ATOMIC_RELAXED);
+    demux->config.classify(demux, buffer->buf, buffer->len, &buffer->metadata,
+                           demux->config.data);
+    if (demux->routed == 0) {
+        __atomic_add_fetch(&demux->stats.drops, 1, __ATOMIC_RELAXED);
+    }
+    demux->current = -1;
+
+    demux_put_buffer(demux, buffer);
+    return;
+}
+
+/* The demultiplexer's thread, which keeps the free buffers posted, and
+ * classifies the buffers as they complete, in the order they were posted. */
+static void *demux_thread(void *arg)
+{
+    int i, j, rc, num_posted, num_entries;
+    uint32_t released;
+    axidma_demux_t demux;
+    struct axidma_wait_entry *entries;
+    struct demux_buffer *buffers;
+    int *order;
+
+    demux = arg;
+    entries = demux->entries;
+    buffers = demux->buffers;
+    order = demux->order;
+    while (!__atomic_load_n(&demux->stopped, __ATOMIC_ACQUIRE))
+    {
+        // If every buffer is held by the consumers, wait for one to be freed
+        released = __atomic_load_n(&demux->released, __ATOMIC_SEQ_CST);
+        num_posted = demux_post_buffers(demux);
+        if (num_posted == 0) {
+            __atomic_store_n(&demux->idle, 1, __ATOMIC_SEQ_CST);
+            if (!__atomic_load_n(&demux->stopped, __ATOMIC_SEQ_CST)) {
+                futex_wait(&demux->released, released, DEMUX_WAIT_TIMEOUT);
+            }
+            __atomic_store_n(&demux->idle, 0, __ATOMIC_SEQ_CST);
+            continue;
+        }
+
+        // Sort the posted buffers in the order they were posted in
+        num_entries = 0;
+        for (i = 0; i < demux->config.num_buffers; i++)
+        {
+            if (!buffers[i].posted) {
+                continue;
+            }
+            for (j = num_entries; j > 0 &&
+                 buffers[order[j-1]].sequence > buffers[i].sequence; j--)
+            {
+                order[j] = order[j-1];
+            }
+            order[j] = i;
+            num_entries += 1;
+        }
+
+        // Wait on the posted buffers
+        for (i = 0; i < num_entries; i++)
+        {
+            entries[i].channel_id = demux->config.channel;
+            entries[i].cookie = buffers[order[i]].cookie;
+        }
+        rc = axidma_wait_any(demux->dev, entries, num_entries,
+                             DEMUX_WAIT_TIMEOUT);
+        if (rc <= 0) {
+            continue;
+        }
+
+        /* Classify the completed buffers in the order they were posted, which
+         * is the order the packets arrived in. A failed buffer is posted
+         * again. */
+        for (i = 0; i < num_entries; i++)
+        {
+            if (entries[i].status == AXIDMA_WAIT_COMPLETE) {
+                buffers[order[i]].metadata = entries[i].metadata;
+                buffers[order[i]].len = entries[i].len;
+                demux_classify_buffer(demux, order[i]);
+            } else if (entries[i].status == AXIDMA_WAIT_ERROR) {
+                buffers[order[i]].posted = false;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/* Creates the demultiplexer for the receive channel, posting all of its buffers
+ * and starting the thread that routes their packets to the flows. */
+axidma_demux_t axidma_demux_create(axidma_dev_t dev,
+        const struct axidma_demux_config *config)
+{
+    int i, rc;
+    axidma_demux_t demux;
+
+    assert(find_channel(dev, config->channel) != NULL);
+    assert(find_channel(dev, config->channel)->dir == AXIDMA_READ);
+
+    if (config->num_buffers <= 0 || config->num_buffers > INFLIGHT_SLOTS ||
+            config->buffer_size == 0 || config->num_flows <= 0) {
+        fprintf(stderr, "Invalid demultiplexer settings, there must be from 1 "
+                "to %d buffers, and at least one flow.\n", INFLIGHT_SLOTS);
+        return NULL;
+    } else if (config->ring_size <= 0 ||
+               (config->ring_size & (config->ring_size - 1)) != 0) {
+        fprintf(stderr, "The demultiplexer's ring size must be a power of "
+                "two.\n");
+        return NULL;
+    }
+
+    // Allocate the demultiplexer, along with its buffers, flows and rings
+    demux = calloc(1, sizeof(*demux));
+    if (demux == NULL) {
+        return NULL;
+    }
+    demux->dev = dev;
+    demux->config = *config;
+    if (demux->config.classify == NULL) {
+        demux->config.classify = demux_classify_app0;
+    }
+    demux->current = -1;
+    demux->buffers = calloc(config->num_buffers, sizeof(demux->buffers[0]));
+    demux->entries = calloc(config->num_buffers, sizeof(demux->entries[0]));
+    demux->order = calloc(config->num_buffers, sizeof(demux->order[0]));
+    demux->flows = calloc(config->num_flows, sizeof(demux->flows[0]));
+    if (demux->buffers == NULL || demux->entries == NULL ||
+            demux->order == NULL || demux->flows == NULL) {
+        goto free_demux;
+    }
+    for (i = 0; i < config->num_flows; i++)
+    {
+        demux->flows[i].ring = calloc(config->ring_size,
+                                      sizeof(demux->flows[i].ring[0]));
+        if (demux->flows[i].ring == NULL) {
+            goto free_demux;
+        }
+    }
+    for (i = 0; i < config->num_buffers; i++)
+    {
+        demux->buffers[i].buf = config->buffers[i];
+    }
+
+    // Start the thread, which posts the buffers to the channel
+    rc = pthread_create(&demux->thread, NULL, demux_thread, demux);
+    if (rc != 0) {
+        errno = rc;
+        perror("Unable to start the demultiplexer thread");
+        goto free_demux;
+    }
+    demux->running = true;
+
+    return demux;
+
+free_demux:
+    for (i = 0; demux->flows != NULL && i < config->num_flows; i++)
+    {
+        free(demux->flows[i].ring);
+    }
+    free(demux->flows);
+    free(demux->order);
+    free(demux->entries);
+    free(demux->buffers);
+    free(demux);
+    return NULL;
+}
+
+/* Stops the demultiplexer's thread and the transfers on its channel, then
+ * wakes up all of the consumers, so they see that it was stopped. */
+void axidma_demux_stop(axidma_demux_t demux)
+{
+    int i;
+
+    if (!demux->running) {
+        return;
+    }
+
+    __atomic_store_n(&demux->stopped, true, __ATOMIC_SEQ_CST);
+    futex_wake(&demux->released);
+    pthread_join(demux->thread, NULL);
+    demux->running = false;
+    axidma_stop_transfer(demux->dev, demux->config.channel);
+
+    for (i = 0; i < demux->config.num_flows; i++)
+    {
+        futex_wake(&demux->flows[i].tail);
+    }
+    return;
+}
+
+// Stops the demultiplexer, then frees it
+void axidma_demux_destroy(axidma_demux_t demux)
+{
+    int i;
+
+    axidma_demux_stop(demux);
+    for (i = 0; i < demux->config.num_flows; i++)
+    {
+        free(demux->flows[i].ring);
+    }
+    free(demux->flows);
+    free(demux->order);
+    free(demux->entries);
+    free(demux->buffers);
+    free(demux);
+    return;
+}
+
+/* Routes the packet to the flow's ring, taking a reference on the buffer for
+ * it. This is only called by the demultiplexer's thread, the ring's producer. */
+int axidma_demux_route(axidma_demux_t demux, int flow, void *data, size_t len)
+{
+    uint32_t tail, head;
+    struct demux_flow *dflow;
+    struct axidma_packet *packet;
+    struct demux_buffer *buffer;
+
+    assert(demux->current >= 0);
+    if (flow < 0 || flow >= demux->config.num_flows) {
+        return -EINVAL;
+    }
+
+    // Drop the packet if the consumer has fallen a whole ring behind
+    dflow = &demux->flows[flow];
+    tail = dflow->tail;
+    head = __atomic_load_n(&dflow->head, __ATOMIC_ACQUIRE);
+    if (tail - head == (uint32_t)demux->config.ring_size) {
+        __atomic_add_fetch(&dflow->stats.drops, 1, __ATOMIC_RELAXED);
+        return -ENOBUFS;
+    }
+
+    buffer = &demux->buffers[demux->current];
+    __atomic_add_fetch(&buffer->refcount, 1, __ATOMIC_RELAXED);
+    packet = &dflow->ring[tail & (demux->config.ring_size - 1)];
+    packet->data = data;
+    packet->len = len;
+    packet->metadata = buffer->metadata;
+    packet->buffer = demux->current;
+    demux->routed += 1;
+    __atomic_add_fetch(&dflow->stats.packets, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&dflow->stats.bytes, len, __ATOMIC_RELAXED);
+
+    // Publish the packet, and wake up the consumer if it is sleeping
+    __atomic_store_n(&dflow->tail, tail + 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&dflow->waiting, __ATOMIC_SEQ_CST)) {
+        futex_wake(&dflow->tail);
+    }
+    return 0;
+}
+
+/* Takes the next packet from the flow's ring, sleeping on the ring's tail until
+ * the producer publishes one, the timeout expires, or the demultiplexer stops.
+ * This is only called by the flow's consumer. */
+int axidma_demux_receive(axidma_demux_t demux, int flow,
+        struct axidma_packet *packet, int timeout)
+{
+    uint32_t head, tail;
+    uint64_t deadline_ns, now_ns;
+    int remaining;
+    struct demux_flow *dflow;
+
+    assert(0 <= flow && flow < demux->config.num_flows);
+
+    dflow = &demux->flows[flow];
+    deadline_ns = axidma_time_ns() + (uint64_t)timeout * 1000000;
+    head = dflow->head;
+    while (true)
+    {
+        tail = __atomic_load_n(&dflow->tail, __ATOMIC_ACQUIRE);
+        if (tail != head) {
+            *packet = dflow->ring[head & (demux->config.ring_size - 1)];
+            __atomic_store_n(&dflow->head, head + 1, __ATOMIC_RELEASE);
+            return 1;
+        } else if (__atomic_load_n(&demux->stopped, __ATOMIC_ACQUIRE)) {
+            return -ECANCELED;
+        }
+
+        // Find the time left to wait, if any
+        remaining = -1;
+        if (timeout >= 0) {
+            now_ns = axidma_time_ns();
+            if (now_ns >= deadline_ns) {
+                return 0;
+            }
+            remaining = (deadline_ns - now_ns + 999999) / 1000000;
+        }
+
+        /* Announce that the consumer is sleeping before checking the tail
+         * again, so the producer either sees it, or the packet is seen. */
+        __atomic_store_n(&dflow->waiting, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&dflow->tail, __ATOMIC_SEQ_CST) == tail &&
+                !__atomic_load_n(&demux->stopped, __ATOMIC_SEQ_CST)) {
+            futex_wait(&dflow->tail, tail, remaining);
+        }
+        __atomic_store_n(&dflow->waiting, 0, __ATOMIC_RELAXED);
+    }
+}
+
+// Gives back the packet, reposting its buffer once all of its packets are back
+void axidma_demux_release(axidma_demux_t demux,
+        const struct axidma_packet *packet)
+{
+    assert(0 <= packet->buffer && packet->buffer < demux->config.num_buffers);
+
+    demux_put_buffer(demux, &demux->buffers[packet->buffer]);
+    return;
+}
+
+// Gets the counters for the flow, or for the whole demultiplexer
+void axidma_demux_get_stats(axidma_demux_t demux, int flow,
+        struct axidma_demux_stats *stats)
+{
+    const struct axidma_demux_stats *counters;
+
+    assert(-1 <= flow && flow < demux->config.num_flows);
+
+    counters = (flow < 0) ? &demux->stats : &demux->flows[flow].stats;
+    stats->packets = __atomic_load_n(&counters->packets, __ATOMIC_RELAXED);
+    stats->bytes = __atomic_load_n(&counters->bytes, __ATOMIC_RELAXED);
+    stats->drops = __atomic_load_n(&counters->drops, __ATOMIC_RELAXED);
+    return;
+}
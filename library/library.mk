@@ -15,7 +15,7 @@ LIBAXIDMA_MAKEFILE_=included
 ################################################################################
 
 # The flags for compiling the library
-LIBAXIDMA_CFLAGS = $(GLOBAL_CFLAGS) -fPIC -shared \
+LIBAXIDMA_CFLAGS = $(GLOBAL_CFLAGS) -fPIC -shared -pthread \
 				   -Wno-missing-field-initializers
 
 # The files that makeup the AXI DMA library
@@ -25,7 +25,7 @@ LIBAXIDMA = $(addprefix $(LIBAXIDMA_DIR)/,$(LIBAXIDMA_FILES))
 
 # The header files for the AXI DMA library interface
 LIBAXIDMA_INC_DIRS = include
-LIBAXIDMA_INC_FILES = libaxidma.h axidma_ioctl.h
+LIBAXIDMA_INC_FILES = libaxidma.h axidma_ioctl.h axidma_trace.h
 LIBAXIDMA_INC = $(addprefix $(LIBAXIDMA_INC_DIRS)/,$(LIBAXIDMA_INC_FILES))
 LIBAXIDMA_INC_FLAGS = $(addprefix -I ,$(LIBAXIDMA_INC_DIRS))
 